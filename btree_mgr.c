@@ -0,0 +1,1059 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "btree_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "tables.h"
+
+// Define constants
+#define META_PAGE 0
+#define BTREE_POOL_SIZE 256
+#define BTREE_MAGIC 0x42545245 // "BTRE"
+#define BTREE_MAX_DEPTH 32
+
+// Index file layout:
+// Page 0 holds the BTreeMeta below; every other page is one node:
+// [NodeHeader][Entry 0]...[Entry maxKeys-1][Child 0]...[Child maxKeys]
+// An entry is a RID followed by keyLength key bytes. Entries are ordered
+// by key and then RID, so duplicate keys stay distinct. Leaves use only
+// the entries and chain to the next leaf; an inner node with numKeys
+// separators has numKeys + 1 children, and child i holds the entries
+// from separator i-1 (inclusive) up to separator i (exclusive).
+// Deletes only remove leaf entries; nodes are never merged, which keeps
+// separators valid and lookups O(log n) in the size the tree has grown to.
+
+typedef struct BTreeMeta {
+    int magic;          // BTREE_MAGIC
+    DataType keyType;   // Type of the keys
+    int keyLength;      // Bytes per key
+    int maxKeys;        // Maximum entries per node
+    int root;           // Page of the root node
+    int numNodes;       // Nodes in the tree
+    int numEntries;     // Entries in the leaves
+    int numPages;       // Pages in the file (next node goes here)
+} BTreeMeta;
+
+typedef struct NodeHeader {
+    int isLeaf;         // Leaf or inner node
+    int numKeys;        // Entries (leaf) or separators (inner) in use
+    int next;           // Next leaf in key order, NO_PAGE at the end
+    int reserved;
+} NodeHeader;
+
+typedef struct BTreeManager {
+    BM_BufferPool *bufferPool;
+    BTreeMeta meta;     // Cached copy of page 0, written on close
+    int entrySize;      // sizeof(RID) + keyLength
+    int metaDirty;      // Whether meta differs from page 0
+    char *keyBuffer;    // Encoded key of the current operation
+} BTreeManager;
+
+typedef struct BTreeScanManager {
+    int leaf;           // Leaf the cursor is on, NO_PAGE when done
+    int pos;            // Next entry of that leaf
+    int hasHigh;        // Whether the scan has an upper bound
+    char *high;         // Encoded upper bound
+    int bounded;        // Whether the scan has any bound, so NaN keys end it
+} BTreeScanManager;
+
+// Smallest RID, to search for the first entry of a key
+static const RID MIN_RID = { INT_MIN, INT_MIN };
+
+// Helper functions for node layout
+static int getMaxKeysPerPage(int keyLength) {
+    int entrySize = (int)sizeof(RID) + keyLength;
+    return (PAGE_SIZE - (int)sizeof(NodeHeader) - (int)sizeof(int)) / (entrySize + (int)sizeof(int));
+}
+
+static NodeHeader *getNodeHeader(char *page) {
+    return (NodeHeader *)page;
+}
+
+static char *getEntry(BTreeManager *mgr, char *page, int i) {
+    return page + sizeof(NodeHeader) + (size_t)i * mgr->entrySize;
+}
+
+static char *getEntryKey(BTreeManager *mgr, char *page, int i) {
+    return getEntry(mgr, page, i) + sizeof(RID);
+}
+
+static RID getEntryRID(BTreeManager *mgr, char *page, int i) {
+    RID rid;
+    memcpy(&rid, getEntry(mgr, page, i), sizeof(RID));
+    return rid;
+}
+
+static int getChild(BTreeManager *mgr, char *page, int i) {
+    int child;
+    char *children = getEntry(mgr, page, mgr->meta.maxKeys);
+    memcpy(&child, children + (size_t)i * sizeof(int), sizeof(int));
+    return child;
+}
+
+static void setChild(BTreeManager *mgr, char *page, int i, int child) {
+    char *children = getEntry(mgr, page, mgr->meta.maxKeys);
+    memcpy(children + (size_t)i * sizeof(int), &child, sizeof(int));
+}
+
+// Encode a key value the way a record stores it (strings NUL-padded)
+static RC encodeKey(BTreeManager *mgr, Value *key, char *dest) {
+    if (key == NULL || key->dt != mgr->meta.keyType) {
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    }
+
+    switch (key->dt) {
+        case DT_INT:
+            memcpy(dest, &key->v.intV, sizeof(int));
+            break;
+        case DT_FLOAT:
+            memcpy(dest, &key->v.floatV, sizeof(float));
+            break;
+        case DT_STRING: {
+            int len = strlen(key->v.stringV);
+            if (len > mgr->meta.keyLength) {
+                len = mgr->meta.keyLength;
+            }
+            memcpy(dest, key->v.stringV, len);
+            memset(dest + len, 0, mgr->meta.keyLength - len);
+            break;
+        }
+        default:
+            return RC_RM_UNKOWN_DATATYPE;
+    }
+    return RC_OK;
+}
+
+static int compareKeys(BTreeManager *mgr, const char *left, const char *right) {
+    switch (mgr->meta.keyType) {
+        case DT_INT: {
+            int l, r;
+            memcpy(&l, left, sizeof(int));
+            memcpy(&r, right, sizeof(int));
+            return (l > r) - (l < r);
+        }
+        case DT_FLOAT: {
+            // NaN sorts after every number, so the order stays total
+            float l, r;
+            memcpy(&l, left, sizeof(float));
+            memcpy(&r, right, sizeof(float));
+            if (isnan(l) || isnan(r)) {
+                return (isnan(l) != 0) - (isnan(r) != 0);
+            }
+            return (l > r) - (l < r);
+        }
+        default:
+            return strncmp(left, right, mgr->meta.keyLength);
+    }
+}
+
+// Whether an encoded key is a NaN float, which sorts like one key but
+// equals no key, not even itself
+static int isNanKey(BTreeManager *mgr, const char *key) {
+    float f;
+    if (mgr->meta.keyType != DT_FLOAT) {
+        return 0;
+    }
+    memcpy(&f, key, sizeof(float));
+    return isnan(f);
+}
+
+static int compareRIDs(RID left, RID right) {
+    if (left.page != right.page) {
+        return (left.page > right.page) - (left.page < right.page);
+    }
+    return (left.slot > right.slot) - (left.slot < right.slot);
+}
+
+// Compare entry i of a node with the pair (key, rid)
+static int compareEntry(BTreeManager *mgr, char *page, int i, const char *key, RID rid) {
+    int keyCmp = compareKeys(mgr, getEntryKey(mgr, page, i), key);
+    return (keyCmp != 0) ? keyCmp : compareRIDs(getEntryRID(mgr, page, i), rid);
+}
+
+// Number of entries of a node that are <= (key, rid)
+static int upperBound(BTreeManager *mgr, char *page, const char *key, RID rid) {
+    int low = 0, high = getNodeHeader(page)->numKeys;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compareEntry(mgr, page, mid, key, rid) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Number of entries of a node that are < (key, rid)
+static int lowerBound(BTreeManager *mgr, char *page, const char *key, RID rid) {
+    int low = 0, high = getNodeHeader(page)->numKeys;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compareEntry(mgr, page, mid, key, rid) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Descend from the root to the leaf that holds (key, rid), remembering
+// the inner nodes passed on the way in path
+static RC findLeaf(BTreeManager *mgr, const char *key, RID rid, int *path, int *depth, int *leaf) {
+    BM_PageHandle page;
+    int pageNum = mgr->meta.root;
+
+    *depth = 0;
+    while (1) {
+        RC pinResult = pinPage(mgr->bufferPool, &page, pageNum);
+        if (pinResult != RC_OK) {
+            return pinResult;
+        }
+
+        if (getNodeHeader(page.data)->isLeaf) {
+            *leaf = pageNum;
+            return unpinPage(mgr->bufferPool, &page);
+        }
+
+        if (*depth >= BTREE_MAX_DEPTH) {
+            unpinPage(mgr->bufferPool, &page);
+            return RC_IM_N_TO_LAGE;
+        }
+        if (path != NULL) {
+            path[*depth] = pageNum;
+        }
+        (*depth)++;
+
+        int child = getChild(mgr, page.data, upperBound(mgr, page.data, key, rid));
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+        pageNum = child;
+    }
+}
+
+// Allocate and pin a fresh node at the end of the file
+static RC newNode(BTreeManager *mgr, BM_PageHandle *page, int isLeaf) {
+    int pageNum = mgr->meta.numPages;
+    RC pinResult = pinPage(mgr->bufferPool, page, pageNum);
+    if (pinResult != RC_OK) {
+        return pinResult;
+    }
+
+    memset(page->data, 0, PAGE_SIZE);
+    NodeHeader *header = getNodeHeader(page->data);
+    header->isLeaf = isLeaf;
+    header->numKeys = 0;
+    header->next = NO_PAGE;
+
+    mgr->meta.numPages++;
+    mgr->meta.numNodes++;
+    mgr->metaDirty = 1;
+    return markDirty(mgr->bufferPool, page);
+}
+
+static RC writeMeta(BTreeManager *mgr) {
+    BM_PageHandle page;
+    RC pinResult = pinPage(mgr->bufferPool, &page, META_PAGE);
+    if (pinResult != RC_OK) {
+        return pinResult;
+    }
+
+    memcpy(page.data, &mgr->meta, sizeof(BTreeMeta));
+    RC markResult = markDirty(mgr->bufferPool, &page);
+    RC unpinResult = unpinPage(mgr->bufferPool, &page);
+    if (markResult != RC_OK) {
+        return markResult;
+    }
+    if (unpinResult == RC_OK) {
+        mgr->metaDirty = 0;
+    }
+    return unpinResult;
+}
+
+// Insert separator (key, rid) with right child into inner node path[level],
+// splitting upwards as needed. level < 0 means the root itself split.
+static RC insertIntoParent(BTreeManager *mgr, int *path, int level, int left,
+                           const char *entry, int right) {
+    BM_PageHandle page;
+    RC rc;
+
+    if (level < 0) {
+        // Grow a new root above the old one
+        rc = newNode(mgr, &page, 0);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        memcpy(getEntry(mgr, page.data, 0), entry, mgr->entrySize);
+        setChild(mgr, page.data, 0, left);
+        setChild(mgr, page.data, 1, right);
+        getNodeHeader(page.data)->numKeys = 1;
+        mgr->meta.root = page.pageNum;
+        return unpinPage(mgr->bufferPool, &page);
+    }
+
+    rc = pinPage(mgr->bufferPool, &page, path[level]);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    NodeHeader *header = getNodeHeader(page.data);
+    RID rid;
+    memcpy(&rid, entry, sizeof(RID));
+    int pos = upperBound(mgr, page.data, entry + sizeof(RID), rid);
+    int maxKeys = mgr->meta.maxKeys;
+
+    if (header->numKeys < maxKeys) {
+        memmove(getEntry(mgr, page.data, pos + 1), getEntry(mgr, page.data, pos),
+                (size_t)(header->numKeys - pos) * mgr->entrySize);
+        memcpy(getEntry(mgr, page.data, pos), entry, mgr->entrySize);
+        for (int i = header->numKeys + 1; i > pos + 1; i--) {
+            setChild(mgr, page.data, i, getChild(mgr, page.data, i - 1));
+        }
+        setChild(mgr, page.data, pos + 1, right);
+        header->numKeys++;
+
+        rc = markDirty(mgr->bufferPool, &page);
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        return (rc != RC_OK) ? rc : unpinResult;
+    }
+
+    // Split: lay out all maxKeys + 1 separators and maxKeys + 2 children
+    char *entries = (char *)malloc((size_t)(maxKeys + 1) * mgr->entrySize);
+    int *children = (int *)malloc(sizeof(int) * (maxKeys + 2));
+    if (entries == NULL || children == NULL) {
+        free(entries);
+        free(children);
+        unpinPage(mgr->bufferPool, &page);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    memcpy(entries, getEntry(mgr, page.data, 0), (size_t)pos * mgr->entrySize);
+    memcpy(entries + (size_t)pos * mgr->entrySize, entry, mgr->entrySize);
+    memcpy(entries + (size_t)(pos + 1) * mgr->entrySize, getEntry(mgr, page.data, pos),
+           (size_t)(maxKeys - pos) * mgr->entrySize);
+    for (int i = 0, j = 0; i <= maxKeys + 1; i++) {
+        children[i] = (i == pos + 1) ? right : getChild(mgr, page.data, j++);
+    }
+
+    // The middle separator moves up; the halves around it stay behind
+    int total = maxKeys + 1;
+    int leftKeys = total / 2;
+    int rightKeys = total - leftKeys - 1;
+
+    BM_PageHandle sibling;
+    rc = newNode(mgr, &sibling, 0);
+    if (rc != RC_OK) {
+        free(entries);
+        free(children);
+        unpinPage(mgr->bufferPool, &page);
+        return rc;
+    }
+
+    memcpy(getEntry(mgr, page.data, 0), entries, (size_t)leftKeys * mgr->entrySize);
+    for (int i = 0; i <= leftKeys; i++) {
+        setChild(mgr, page.data, i, children[i]);
+    }
+    header->numKeys = leftKeys;
+
+    memcpy(getEntry(mgr, sibling.data, 0), entries + (size_t)(leftKeys + 1) * mgr->entrySize,
+           (size_t)rightKeys * mgr->entrySize);
+    for (int i = 0; i <= rightKeys; i++) {
+        setChild(mgr, sibling.data, i, children[leftKeys + 1 + i]);
+    }
+    getNodeHeader(sibling.data)->numKeys = rightKeys;
+
+    char *middle = (char *)malloc(mgr->entrySize);
+    if (middle != NULL) {
+        memcpy(middle, entries + (size_t)leftKeys * mgr->entrySize, mgr->entrySize);
+    }
+    free(entries);
+    free(children);
+
+    int leftPage = page.pageNum;
+    int rightPage = sibling.pageNum;
+    rc = markDirty(mgr->bufferPool, &page);
+    unpinPage(mgr->bufferPool, &page);
+    unpinPage(mgr->bufferPool, &sibling);
+    if (middle == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    if (rc == RC_OK) {
+        rc = insertIntoParent(mgr, path, level - 1, leftPage, middle, rightPage);
+    }
+    free(middle);
+    return rc;
+}
+
+// Init and shutdown index manager
+RC initIndexManager(void *mgmtData) {
+    (void)mgmtData; // Suppress unused parameter warning
+    initStorageManager();
+    return RC_OK;
+}
+
+RC shutdownIndexManager() {
+    return RC_OK;
+}
+
+// Create a btree index in its own page file
+RC createBtree(char *idxId, DataType keyType, int keyLength, int n) {
+    if (idxId == NULL || keyLength <= 0 || n < 0) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (keyType != DT_INT && keyType != DT_FLOAT && keyType != DT_STRING) {
+        return RC_RM_UNKOWN_DATATYPE;
+    }
+
+    int maxKeys = getMaxKeysPerPage(keyLength);
+    if (n > maxKeys || maxKeys < 2) {
+        return RC_IM_N_TO_LAGE;
+    }
+    if (n > 0) {
+        maxKeys = (n < 2) ? 2 : n;
+    }
+
+    RC createResult = createPageFile(idxId);
+    if (createResult != RC_OK) {
+        return createResult;
+    }
+
+    BM_BufferPool *bm = MAKE_POOL();
+    RC initResult = initBufferPool(bm, idxId, BTREE_POOL_SIZE, RS_LRU, NULL);
+    if (initResult != RC_OK) {
+        free(bm);
+        return initResult;
+    }
+
+    // Meta page plus an empty leaf as the root
+    BTreeMeta meta;
+    meta.magic = BTREE_MAGIC;
+    meta.keyType = keyType;
+    meta.keyLength = keyLength;
+    meta.maxKeys = maxKeys;
+    meta.root = 1;
+    meta.numNodes = 1;
+    meta.numEntries = 0;
+    meta.numPages = 2;
+
+    BM_PageHandle page;
+    RC rc = pinPage(bm, &page, META_PAGE);
+    if (rc == RC_OK) {
+        memcpy(page.data, &meta, sizeof(BTreeMeta));
+        markDirty(bm, &page);
+        rc = unpinPage(bm, &page);
+    }
+    if (rc == RC_OK) {
+        rc = pinPage(bm, &page, meta.root);
+    }
+    if (rc == RC_OK) {
+        memset(page.data, 0, PAGE_SIZE);
+        NodeHeader *header = getNodeHeader(page.data);
+        header->isLeaf = 1;
+        header->next = NO_PAGE;
+        markDirty(bm, &page);
+        rc = unpinPage(bm, &page);
+    }
+
+    RC shutdownResult = shutdownBufferPool(bm);
+    free(bm);
+    return (rc != RC_OK) ? rc : shutdownResult;
+}
+
+// Open a btree index
+RC openBtree(BTreeHandle **tree, char *idxId) {
+    if (tree == NULL || idxId == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // Check the file exists before the buffer pool creates it
+    FILE *file = fopen(idxId, "rb");
+    if (file == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    fclose(file);
+
+    BTreeManager *mgr = (BTreeManager *)calloc(1, sizeof(BTreeManager));
+    BTreeHandle *handle = (BTreeHandle *)malloc(sizeof(BTreeHandle));
+    BM_BufferPool *bm = MAKE_POOL();
+    if (mgr == NULL || handle == NULL || bm == NULL) {
+        free(mgr);
+        free(handle);
+        free(bm);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RC initResult = initBufferPool(bm, idxId, BTREE_POOL_SIZE, RS_LRU, NULL);
+    if (initResult != RC_OK) {
+        free(mgr);
+        free(handle);
+        free(bm);
+        return initResult;
+    }
+
+    BM_PageHandle page;
+    RC rc = pinPage(bm, &page, META_PAGE);
+    if (rc == RC_OK) {
+        memcpy(&mgr->meta, page.data, sizeof(BTreeMeta));
+        rc = unpinPage(bm, &page);
+    }
+    if (rc == RC_OK && mgr->meta.magic != BTREE_MAGIC) {
+        rc = RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (rc == RC_OK) {
+        mgr->keyBuffer = (char *)malloc(mgr->meta.keyLength);
+        if (mgr->keyBuffer == NULL) {
+            rc = RC_MEM_ALLOC_FAILED;
+        }
+    }
+    if (rc != RC_OK) {
+        shutdownBufferPool(bm);
+        free(bm);
+        free(mgr->keyBuffer);
+        free(mgr);
+        free(handle);
+        return rc;
+    }
+
+    mgr->bufferPool = bm;
+    mgr->entrySize = (int)sizeof(RID) + mgr->meta.keyLength;
+
+    handle->keyType = mgr->meta.keyType;
+    handle->idxId = (char *)malloc(strlen(idxId) + 1);
+    if (handle->idxId != NULL) {
+        strcpy(handle->idxId, idxId);
+    }
+    handle->mgmtData = mgr;
+
+    *tree = handle;
+    return RC_OK;
+}
+
+// Close a btree index, writing back its pages
+RC closeBtree(BTreeHandle *tree) {
+    if (tree == NULL || tree->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    RC rc = mgr->metaDirty ? writeMeta(mgr) : RC_OK;
+    RC shutdownResult = shutdownBufferPool(mgr->bufferPool);
+
+    free(mgr->bufferPool);
+    free(mgr->keyBuffer);
+    free(mgr);
+    free(tree->idxId);
+    free(tree);
+    return (rc != RC_OK) ? rc : shutdownResult;
+}
+
+// Delete a btree index
+RC deleteBtree(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Access information about a b-tree
+RC getNumNodes(BTreeHandle *tree, int *result) {
+    if (tree == NULL || tree->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    *result = ((BTreeManager *)tree->mgmtData)->meta.numNodes;
+    return RC_OK;
+}
+
+RC getNumEntries(BTreeHandle *tree, int *result) {
+    if (tree == NULL || tree->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    *result = ((BTreeManager *)tree->mgmtData)->meta.numEntries;
+    return RC_OK;
+}
+
+RC getKeyType(BTreeHandle *tree, DataType *result) {
+    if (tree == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    *result = tree->keyType;
+    return RC_OK;
+}
+
+// Find the first entry >= (key, rid), following the leaf chain past
+// leaves that have no such entry. *leaf is NO_PAGE when there is none.
+static RC seekEntry(BTreeManager *mgr, const char *key, RID rid, int *leaf, int *pos) {
+    int depth;
+    RC rc = findLeaf(mgr, key, rid, NULL, &depth, leaf);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    BM_PageHandle page;
+    while (*leaf != NO_PAGE) {
+        rc = pinPage(mgr->bufferPool, &page, *leaf);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        *pos = lowerBound(mgr, page.data, key, rid);
+        int found = *pos < getNodeHeader(page.data)->numKeys;
+        int next = getNodeHeader(page.data)->next;
+        rc = unpinPage(mgr->bufferPool, &page);
+        if (rc != RC_OK || found) {
+            return rc;
+        }
+        *leaf = next;
+    }
+    return RC_OK;
+}
+
+// Find the RID of the first entry of a key
+RC findKey(BTreeHandle *tree, Value *key, RID *result) {
+    if (tree == NULL || tree->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    int leaf, pos;
+    rc = seekEntry(mgr, mgr->keyBuffer, MIN_RID, &leaf, &pos);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (leaf == NO_PAGE) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    BM_PageHandle page;
+    rc = pinPage(mgr->bufferPool, &page, leaf);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    int found = !isNanKey(mgr, mgr->keyBuffer) &&
+                compareKeys(mgr, getEntryKey(mgr, page.data, pos), mgr->keyBuffer) == 0;
+    if (found) {
+        *result = getEntryRID(mgr, page.data, pos);
+    }
+    rc = unpinPage(mgr->bufferPool, &page);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    return found ? RC_OK : RC_IM_KEY_NOT_FOUND;
+}
+
+// Insert the entry (key, rid)
+RC insertKey(BTreeHandle *tree, Value *key, RID rid) {
+    if (tree == NULL || tree->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    char *entry = (char *)malloc(mgr->entrySize);
+    if (entry == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    memcpy(entry, &rid, sizeof(RID));
+    RC rc = encodeKey(mgr, key, entry + sizeof(RID));
+    if (rc != RC_OK) {
+        free(entry);
+        return rc;
+    }
+    const char *keyBytes = entry + sizeof(RID);
+
+    int path[BTREE_MAX_DEPTH];
+    int depth, leaf;
+    rc = findLeaf(mgr, keyBytes, rid, path, &depth, &leaf);
+    if (rc != RC_OK) {
+        free(entry);
+        return rc;
+    }
+
+    BM_PageHandle page;
+    rc = pinPage(mgr->bufferPool, &page, leaf);
+    if (rc != RC_OK) {
+        free(entry);
+        return rc;
+    }
+
+    NodeHeader *header = getNodeHeader(page.data);
+    int pos = lowerBound(mgr, page.data, keyBytes, rid);
+    if (pos < header->numKeys && compareEntry(mgr, page.data, pos, keyBytes, rid) == 0) {
+        unpinPage(mgr->bufferPool, &page);
+        free(entry);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    int maxKeys = mgr->meta.maxKeys;
+    mgr->meta.numEntries++;
+    mgr->metaDirty = 1;
+
+    if (header->numKeys < maxKeys) {
+        memmove(getEntry(mgr, page.data, pos + 1), getEntry(mgr, page.data, pos),
+                (size_t)(header->numKeys - pos) * mgr->entrySize);
+        memcpy(getEntry(mgr, page.data, pos), entry, mgr->entrySize);
+        header->numKeys++;
+
+        free(entry);
+        rc = markDirty(mgr->bufferPool, &page);
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        return (rc != RC_OK) ? rc : unpinResult;
+    }
+
+    // Split the leaf: the upper half moves to a new leaf linked after it
+    char *entries = (char *)malloc((size_t)(maxKeys + 1) * mgr->entrySize);
+    if (entries == NULL) {
+        unpinPage(mgr->bufferPool, &page);
+        free(entry);
+        return RC_MEM_ALLOC_FAILED;
+    }
+    memcpy(entries, getEntry(mgr, page.data, 0), (size_t)pos * mgr->entrySize);
+    memcpy(entries + (size_t)pos * mgr->entrySize, entry, mgr->entrySize);
+    memcpy(entries + (size_t)(pos + 1) * mgr->entrySize, getEntry(mgr, page.data, pos),
+           (size_t)(maxKeys - pos) * mgr->entrySize);
+
+    int total = maxKeys + 1;
+    int leftKeys = (total + 1) / 2;
+
+    BM_PageHandle sibling;
+    rc = newNode(mgr, &sibling, 1);
+    if (rc != RC_OK) {
+        free(entries);
+        unpinPage(mgr->bufferPool, &page);
+        free(entry);
+        return rc;
+    }
+
+    NodeHeader *siblingHeader = getNodeHeader(sibling.data);
+    memcpy(getEntry(mgr, page.data, 0), entries, (size_t)leftKeys * mgr->entrySize);
+    header->numKeys = leftKeys;
+    memcpy(getEntry(mgr, sibling.data, 0), entries + (size_t)leftKeys * mgr->entrySize,
+           (size_t)(total - leftKeys) * mgr->entrySize);
+    siblingHeader->numKeys = total - leftKeys;
+    siblingHeader->next = header->next;
+    header->next = sibling.pageNum;
+
+    // The first entry of the new leaf separates the two in the parent
+    memcpy(entry, getEntry(mgr, sibling.data, 0), mgr->entrySize);
+    free(entries);
+
+    int leftPage = page.pageNum;
+    int rightPage = sibling.pageNum;
+    rc = markDirty(mgr->bufferPool, &page);
+    unpinPage(mgr->bufferPool, &page);
+    unpinPage(mgr->bufferPool, &sibling);
+    if (rc == RC_OK) {
+        rc = insertIntoParent(mgr, path, depth - 1, leftPage, entry, rightPage);
+    }
+    free(entry);
+    return rc;
+}
+
+// Remove the entry (key, rid) from its leaf
+static RC removeEntry(BTreeManager *mgr, const char *key, RID rid) {
+    int depth, leaf;
+    RC rc = findLeaf(mgr, key, rid, NULL, &depth, &leaf);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    BM_PageHandle page;
+    rc = pinPage(mgr->bufferPool, &page, leaf);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    NodeHeader *header = getNodeHeader(page.data);
+    int pos = lowerBound(mgr, page.data, key, rid);
+    if (pos >= header->numKeys || compareEntry(mgr, page.data, pos, key, rid) != 0) {
+        unpinPage(mgr->bufferPool, &page);
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    memmove(getEntry(mgr, page.data, pos), getEntry(mgr, page.data, pos + 1),
+            (size_t)(header->numKeys - pos - 1) * mgr->entrySize);
+    header->numKeys--;
+    mgr->meta.numEntries--;
+    mgr->metaDirty = 1;
+
+    rc = markDirty(mgr->bufferPool, &page);
+    RC unpinResult = unpinPage(mgr->bufferPool, &page);
+    return (rc != RC_OK) ? rc : unpinResult;
+}
+
+// Delete the first entry of a key
+RC deleteKey(BTreeHandle *tree, Value *key) {
+    RID rid;
+    RC rc = findKey(tree, key, &rid);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    return removeEntry(mgr, mgr->keyBuffer, rid);
+}
+
+// Delete the entry (key, rid)
+RC deleteEntry(BTreeHandle *tree, Value *key, RID rid) {
+    if (tree == NULL || tree->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    return removeEntry(mgr, mgr->keyBuffer, rid);
+}
+
+// Scan all entries in key order
+RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle) {
+    return openTreeRangeScan(tree, NULL, NULL, handle);
+}
+
+// Scan the entries whose key lies between low and high
+RC openTreeRangeScan(BTreeHandle *tree, Value *low, Value *high, BT_ScanHandle **handle) {
+    if (tree == NULL || tree->mgmtData == NULL || handle == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    BT_ScanHandle *scan = (BT_ScanHandle *)malloc(sizeof(BT_ScanHandle));
+    BTreeScanManager *scanMgr = (BTreeScanManager *)calloc(1, sizeof(BTreeScanManager));
+    char *lowKey = (char *)malloc(mgr->meta.keyLength);
+    if (scan == NULL || scanMgr == NULL || lowKey == NULL) {
+        free(scan);
+        free(scanMgr);
+        free(lowKey);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RC rc = RC_OK;
+    scanMgr->bounded = (low != NULL || high != NULL);
+    if (high != NULL) {
+        scanMgr->high = (char *)malloc(mgr->meta.keyLength);
+        scanMgr->hasHigh = 1;
+        rc = (scanMgr->high == NULL) ? RC_MEM_ALLOC_FAILED : encodeKey(mgr, high, scanMgr->high);
+    }
+
+    if (rc == RC_OK && low != NULL) {
+        rc = encodeKey(mgr, low, lowKey);
+        if (rc == RC_OK) {
+            rc = seekEntry(mgr, lowKey, MIN_RID, &scanMgr->leaf, &scanMgr->pos);
+        }
+        // A NaN bound admits no key
+        if (rc == RC_OK && (isNanKey(mgr, lowKey) || (scanMgr->hasHigh && isNanKey(mgr, scanMgr->high)))) {
+            scanMgr->leaf = NO_PAGE;
+        }
+    } else if (rc == RC_OK && scanMgr->hasHigh && isNanKey(mgr, scanMgr->high)) {
+        scanMgr->leaf = NO_PAGE;
+    } else if (rc == RC_OK) {
+        // Leftmost leaf: descend along child 0
+        BM_PageHandle page;
+        int pageNum = mgr->meta.root;
+        while (rc == RC_OK) {
+            rc = pinPage(mgr->bufferPool, &page, pageNum);
+            if (rc != RC_OK) {
+                break;
+            }
+            int isLeaf = getNodeHeader(page.data)->isLeaf;
+            int child = isLeaf ? pageNum : getChild(mgr, page.data, 0);
+            rc = unpinPage(mgr->bufferPool, &page);
+            if (isLeaf) {
+                break;
+            }
+            pageNum = child;
+        }
+        scanMgr->leaf = pageNum;
+        scanMgr->pos = 0;
+    }
+    free(lowKey);
+
+    if (rc != RC_OK) {
+        free(scanMgr->high);
+        free(scanMgr);
+        free(scan);
+        return rc;
+    }
+
+    scan->tree = tree;
+    scan->mgmtData = scanMgr;
+    *handle = scan;
+    return RC_OK;
+}
+
+// Return the RID of the next entry in key order
+RC nextEntry(BT_ScanHandle *handle, RID *result) {
+    if (handle == NULL || handle->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)handle->tree->mgmtData;
+    BTreeScanManager *scanMgr = (BTreeScanManager *)handle->mgmtData;
+    BM_PageHandle page;
+
+    while (scanMgr->leaf != NO_PAGE) {
+        RC rc = pinPage(mgr->bufferPool, &page, scanMgr->leaf);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        NodeHeader *header = getNodeHeader(page.data);
+        if (scanMgr->pos >= header->numKeys) {
+            // Leaf exhausted (or emptied by deletes): move along the chain
+            scanMgr->leaf = header->next;
+            scanMgr->pos = 0;
+            rc = unpinPage(mgr->bufferPool, &page);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            continue;
+        }
+
+        // NaN keys come last and lie within no bound
+        const char *key = getEntryKey(mgr, page.data, scanMgr->pos);
+        if ((scanMgr->hasHigh && compareKeys(mgr, key, scanMgr->high) > 0) ||
+            (scanMgr->bounded && isNanKey(mgr, key))) {
+            scanMgr->leaf = NO_PAGE;
+            unpinPage(mgr->bufferPool, &page);
+            break;
+        }
+
+        *result = getEntryRID(mgr, page.data, scanMgr->pos++);
+        return unpinPage(mgr->bufferPool, &page);
+    }
+
+    return RC_IM_NO_MORE_ENTRIES;
+}
+
+RC closeTreeScan(BT_ScanHandle *handle) {
+    if (handle == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BTreeScanManager *scanMgr = (BTreeScanManager *)handle->mgmtData;
+    if (scanMgr != NULL) {
+        free(scanMgr->high);
+        free(scanMgr);
+    }
+    free(handle);
+    return RC_OK;
+}
+
+// Append formatted text to a growing string
+static void appendText(char **text, int *length, int *capacity, const char *piece) {
+    int pieceLength = strlen(piece);
+    if (*text == NULL) {
+        return;
+    }
+    if (*length + pieceLength + 1 > *capacity) {
+        int newCapacity = *capacity * 2 + pieceLength;
+        char *grown = (char *)realloc(*text, newCapacity);
+        if (grown == NULL) {
+            free(*text);
+            *text = NULL;
+            return;
+        }
+        *text = grown;
+        *capacity = newCapacity;
+    }
+    memcpy(*text + *length, piece, pieceLength + 1);
+    *length += pieceLength;
+}
+
+static void formatKey(BTreeManager *mgr, const char *key, char *dest, int size) {
+    switch (mgr->meta.keyType) {
+        case DT_INT: {
+            int v;
+            memcpy(&v, key, sizeof(int));
+            snprintf(dest, size, "%d", v);
+            break;
+        }
+        case DT_FLOAT: {
+            float v;
+            memcpy(&v, key, sizeof(float));
+            snprintf(dest, size, "%f", v);
+            break;
+        }
+        default:
+            snprintf(dest, size, "%.*s", mgr->meta.keyLength, key);
+            break;
+    }
+}
+
+// Print one node per line in depth-first order:
+// inner nodes as (page)[child,key,child,...], leaves as
+// (page)[page.slot,key,...,next leaf]
+static void printNode(BTreeManager *mgr, int pageNum, char **text, int *length, int *capacity) {
+    BM_PageHandle page;
+    if (pinPage(mgr->bufferPool, &page, pageNum) != RC_OK) {
+        return;
+    }
+
+    NodeHeader *header = getNodeHeader(page.data);
+    int numKeys = header->numKeys;
+    int isLeaf = header->isLeaf;
+    char piece[128];
+    char key[96];
+    int *children = NULL;
+
+    snprintf(piece, sizeof(piece), "(%d)[", pageNum);
+    appendText(text, length, capacity, piece);
+    if (!isLeaf) {
+        children = (int *)malloc(sizeof(int) * (numKeys + 1));
+    }
+    for (int i = 0; i < numKeys; i++) {
+        formatKey(mgr, getEntryKey(mgr, page.data, i), key, sizeof(key));
+        if (isLeaf) {
+            RID rid = getEntryRID(mgr, page.data, i);
+            snprintf(piece, sizeof(piece), "%d.%d,%s,", rid.page, rid.slot, key);
+        } else {
+            snprintf(piece, sizeof(piece), "%d,%s,", getChild(mgr, page.data, i), key);
+        }
+        appendText(text, length, capacity, piece);
+    }
+    if (isLeaf) {
+        snprintf(piece, sizeof(piece), "%d]\n", header->next);
+    } else {
+        snprintf(piece, sizeof(piece), "%d]\n", getChild(mgr, page.data, numKeys));
+        if (children != NULL) {
+            for (int i = 0; i <= numKeys; i++) {
+                children[i] = getChild(mgr, page.data, i);
+            }
+        }
+    }
+    appendText(text, length, capacity, piece);
+    unpinPage(mgr->bufferPool, &page);
+
+    if (children != NULL) {
+        for (int i = 0; i <= numKeys; i++) {
+            printNode(mgr, children[i], text, length, capacity);
+        }
+        free(children);
+    }
+}
+
+// Debug output of the whole tree; the caller frees the string
+char *printTree(BTreeHandle *tree) {
+    if (tree == NULL || tree->mgmtData == NULL) {
+        return NULL;
+    }
+
+    BTreeManager *mgr = (BTreeManager *)tree->mgmtData;
+    int length = 0;
+    int capacity = 256;
+    char *text = (char *)malloc(capacity);
+    if (text != NULL) {
+        text[0] = '\0';
+        printNode(mgr, mgr->meta.root, &text, &length, &capacity);
+    }
+    return text;
+}
@@ -0,0 +1,57 @@
+#ifndef BTREE_MGR_H
+#define BTREE_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// structure for accessing btrees
+typedef struct BTreeHandle {
+	DataType keyType;
+	char *idxId;
+	void *mgmtData;
+} BTreeHandle;
+
+typedef struct BT_ScanHandle {
+	BTreeHandle *tree;
+	void *mgmtData;
+} BT_ScanHandle;
+
+// init and shutdown index manager
+extern RC initIndexManager (void *mgmtData);
+extern RC shutdownIndexManager ();
+
+// create, destroy, open, and close an btree index
+// keyLength is the size of a key in bytes (typeLength for DT_STRING keys),
+// n the maximum number of keys per node, or 0 for as many as fit a page
+extern RC createBtree (char *idxId, DataType keyType, int keyLength, int n);
+extern RC openBtree (BTreeHandle **tree, char *idxId);
+extern RC closeBtree (BTreeHandle *tree);
+extern RC deleteBtree (char *idxId);
+
+// access information about a b-tree
+extern RC getNumNodes (BTreeHandle *tree, int *result);
+extern RC getNumEntries (BTreeHandle *tree, int *result);
+extern RC getKeyType (BTreeHandle *tree, DataType *result);
+
+// index access: entries are (key, RID) pairs kept in key order, and a key
+// may occur with several RIDs. findKey returns the first RID of a key,
+// deleteKey removes that entry and deleteEntry one exact pair.
+extern RC findKey (BTreeHandle *tree, Value *key, RID *result);
+extern RC insertKey (BTreeHandle *tree, Value *key, RID rid);
+extern RC deleteKey (BTreeHandle *tree, Value *key);
+extern RC deleteEntry (BTreeHandle *tree, Value *key, RID rid);
+
+// ordered scans over all entries, or over the keys between low and high
+// (both inclusive, NULL for no bound); nextEntry returns
+// RC_IM_NO_MORE_ENTRIES after the last one. FLOAT NaN keys sort after all
+// others: a full scan returns them last, while findKey and range scans
+// treat NaN as equal to nothing and inside no bound.
+extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
+extern RC openTreeRangeScan (BTreeHandle *tree, Value *low, Value *high, BT_ScanHandle **handle);
+extern RC nextEntry (BT_ScanHandle *handle, RID *result);
+extern RC closeTreeScan (BT_ScanHandle *handle);
+
+// debug and test functions
+extern char *printTree (BTreeHandle *tree);
+
+#endif // BTREE_MGR_H
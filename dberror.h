@@ -36,10 +36,15 @@ typedef int RC;
 #define RC_RM_INVALID_ATTRIBUTE 207
 #define RC_RM_INVALID_RECORD 208
 #define RC_RM_INVALID_SLOT 209
+#define RC_RM_TABLE_NOT_EMPTY 210
+#define RC_RM_SCAN_OPEN 211
+#define RC_RM_SUM_OVERFLOW 212
 #define RC_IM_KEY_NOT_FOUND 300
 #define RC_IM_KEY_ALREADY_EXISTS 301
 #define RC_IM_N_TO_LAGE 302
 #define RC_IM_NO_MORE_ENTRIES 303
+#define RC_IM_INDEX_ALREADY_EXISTS 304
+#define RC_IM_INDEX_NOT_FOUND 305
 
 extern char *RC_message;
 extern void printError(RC error);
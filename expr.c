@@ -1,5 +1,10 @@
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EXPR_AVX2   // AVX2 batch kernels, chosen at run time
+#endif
 #include "dberror.h"
 #include "record_mgr.h"
 #include "expr.h"
@@ -88,6 +93,95 @@ RC boolOr(Value *left, Value *right, Value *result) {
 }
 
 // ================== Expression Evaluation ==================
+// Whether two values are floats of which at least one is NaN. Every
+// comparison with NaN is false except <>, as in float arithmetic.
+static bool unorderedValues(Value *left, Value *right) {
+    return left->dt == DT_FLOAT && right->dt == DT_FLOAT &&
+           (isnan(left->v.floatV) || isnan(right->v.floatV));
+}
+
+// Apply a comparison operator in terms of valueEquals/valueSmaller
+static RC compareValues(OpType type, Value *left, Value *right, Value *result) {
+    if (unorderedValues(left, right) &&
+            (type == OP_COMP_SMALLER_EQUAL || type == OP_COMP_GREATER_EQUAL)) {
+        // Not the negation of > or <, which are false as well
+        result->dt = DT_BOOL;
+        result->v.boolV = false;
+        return RC_OK;
+    }
+
+    switch (type) {
+        case OP_COMP_EQUAL:
+            return valueEquals(left, right, result);
+        case OP_COMP_SMALLER:
+            return valueSmaller(left, right, result);
+        case OP_COMP_GREATER:
+            return valueSmaller(right, left, result);
+        case OP_COMP_SMALLER_EQUAL:
+            EXPR_CHECK(valueSmaller(right, left, result));
+            break;
+        case OP_COMP_GREATER_EQUAL:
+            EXPR_CHECK(valueSmaller(left, right, result));
+            break;
+        case OP_COMP_NOT_EQUAL:
+            EXPR_CHECK(valueEquals(left, right, result));
+            break;
+        default:
+            THROW(RC_RM_UNKNOWN_OPERATOR, "Unsupported operator");
+    }
+    // The last three are negations of the first ones
+    result->v.boolV = !result->v.boolV;
+    return RC_OK;
+}
+
+// Evaluate BETWEEN and IN, stopping at the first argument that decides
+static RC evalListOp(Record *record, Schema *schema, Operator *op, Value **result) {
+    Value *input = NULL;
+    Value *arg = NULL;
+    Value cmp;
+    RC rc = RC_OK;
+    bool matches = (op->type == OP_BETWEEN);
+
+    if (op->type == OP_BETWEEN && op->numArgs != 3)
+        THROW(RC_RM_UNKNOWN_OPERATOR, "BETWEEN takes three arguments");
+
+    EXPR_CHECK(evalExpr(record, schema, op->args[0], &input));
+
+    for (int i = 1; i < op->numArgs; i++) {
+        if ((rc = evalExpr(record, schema, op->args[i], &arg)) != RC_OK)
+            goto cleanup;
+
+        if (op->type == OP_IN)
+            rc = valueEquals(input, arg, &cmp);
+        else if (i == 1)
+            rc = valueSmaller(input, arg, &cmp);   // below the lower bound
+        else
+            rc = valueSmaller(arg, input, &cmp);   // above the upper bound
+        if (rc == RC_OK && op->type == OP_BETWEEN && unorderedValues(input, arg))
+            cmp.v.boolV = true;                    // NaN is within no bounds
+        freeVal(arg);
+        if (rc != RC_OK)
+            goto cleanup;
+
+        if (cmp.v.boolV) {
+            matches = (op->type == OP_IN);
+            break;
+        }
+    }
+
+    *result = (Value *) malloc(sizeof(Value));
+    if (!*result) {
+        rc = RC_MEM_ALLOC_FAILED;
+        goto cleanup;
+    }
+    (*result)->dt = DT_BOOL;
+    (*result)->v.boolV = matches;
+
+cleanup:
+    freeVal(input);
+    return rc;
+}
+
 RC evalExpr(Record *record, Schema *schema, Expr *expr, Value **result) {
     Value *lIn = NULL;
     Value *rIn = NULL;
@@ -98,10 +192,22 @@ RC evalExpr(Record *record, Schema *schema, Expr *expr, Value **result) {
             Operator *op = expr->expr.op;
             bool twoArgs = (op->type != OP_BOOL_NOT);
 
+            // BETWEEN and IN take a variable number of arguments
+            if (op->type == OP_BETWEEN || op->type == OP_IN)
+                return evalListOp(record, schema, op, result);
+
             // Evaluate left argument
             if ((rc = evalExpr(record, schema, op->args[0], &lIn)) != RC_OK) 
                 goto cleanup;
 
+            // Short-circuit: a false left side decides AND, a true one decides OR
+            if ((op->type == OP_BOOL_AND || op->type == OP_BOOL_OR) && lIn->dt == DT_BOOL
+                && (lIn->v.boolV ? 1 : 0) == (op->type == OP_BOOL_OR)) {
+                *result = lIn;
+                lIn = NULL;
+                goto cleanup;
+            }
+
             // Evaluate right argument if needed
             if (twoArgs && (rc = evalExpr(record, schema, op->args[1], &rIn)) != RC_OK)
                 goto cleanup;
@@ -125,10 +231,12 @@ RC evalExpr(Record *record, Schema *schema, Expr *expr, Value **result) {
                     rc = boolOr(lIn, rIn, *result);
                     break;
                 case OP_COMP_EQUAL:
-                    rc = valueEquals(lIn, rIn, *result);
-                    break;
                 case OP_COMP_SMALLER:
-                    rc = valueSmaller(lIn, rIn, *result);
+                case OP_COMP_GREATER:
+                case OP_COMP_SMALLER_EQUAL:
+                case OP_COMP_GREATER_EQUAL:
+                case OP_COMP_NOT_EQUAL:
+                    rc = compareValues(op->type, lIn, rIn, *result);
                     break;
                 default:
                     THROW(RC_RM_UNKNOWN_OPERATOR, "Unsupported operator");
@@ -159,6 +267,1326 @@ cleanup:
 }
 
 
+
+// ================== Expression Optimization ==================
+// optimizeExpr builds a simplified copy of an expression: NOT(NOT x)
+// becomes x, comparisons whose arguments are all constants and NOT of a constant
+// are folded, and AND/OR with a constant side collapse to whichever
+// side decides the result. The input expression is not modified.
+
+static bool isBoolConst(Expr *expr) {
+  return expr->type == EXPR_CONST && expr->expr.cons->dt == DT_BOOL;
+}
+
+// Free an operator node without freeing its arguments
+static void freeOperatorShell(Expr *expr) {
+  free(expr->expr.op->args);
+  free(expr->expr.op);
+  free(expr);
+}
+
+static bool isComparisonOp(OpType type) {
+  switch (type) {
+    case OP_COMP_EQUAL:
+    case OP_COMP_SMALLER:
+    case OP_COMP_GREATER:
+    case OP_COMP_SMALLER_EQUAL:
+    case OP_COMP_GREATER_EQUAL:
+    case OP_COMP_NOT_EQUAL:
+    case OP_BETWEEN:
+    case OP_IN:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// True if all arguments are constants of one type, so comparing them cannot fail
+static bool sameTypeConstants(Expr **args, int numArgs) {
+  for (int i = 0; i < numArgs; i++) {
+    if (args[i]->type != EXPR_CONST || args[i]->expr.cons->dt != args[0]->expr.cons->dt)
+      return false;
+  }
+  return true;
+}
+
+static RC optimizeNode(Expr *expr, Expr **result) {
+  Expr *folded;
+
+  switch (expr->type) {
+    case EXPR_CONST: {
+      Value *value = (Value *) malloc(sizeof(Value));
+      if (value == NULL)
+        return RC_MEM_ALLOC_FAILED;
+      CPVAL(value, expr->expr.cons);
+      MAKE_CONS(folded, value);
+      *result = folded;
+      return RC_OK;
+    }
+    case EXPR_ATTRREF:
+      MAKE_ATTRREF(folded, expr->expr.attrRef);
+      *result = folded;
+      return RC_OK;
+    case EXPR_OP:
+      break;
+  }
+
+  Operator *op = expr->expr.op;
+  Expr **args = (Expr **) malloc(sizeof(Expr *) * op->numArgs);
+  if (args == NULL)
+    return RC_MEM_ALLOC_FAILED;
+
+  for (int i = 0; i < op->numArgs; i++) {
+    RC rc = optimizeNode(op->args[i], &args[i]);
+    if (rc != RC_OK) {
+      while (--i >= 0)
+        freeExpr(args[i]);
+      free(args);
+      return rc;
+    }
+  }
+
+  switch (op->type) {
+    case OP_BOOL_NOT:
+      if (args[0]->type == EXPR_OP && args[0]->expr.op->type == OP_BOOL_NOT) {
+        *result = args[0]->expr.op->args[0];
+        freeOperatorShell(args[0]);
+        free(args);
+        return RC_OK;
+      }
+      if (isBoolConst(args[0])) {
+        args[0]->expr.cons->v.boolV = !args[0]->expr.cons->v.boolV;
+        *result = args[0];
+        free(args);
+        return RC_OK;
+      }
+      break;
+
+    case OP_BOOL_AND:
+    case OP_BOOL_OR: {
+      // false decides AND, true decides OR; the other constant drops out,
+      // but only if what remains is known to be boolean
+      int decider = (op->type == OP_BOOL_OR);
+      Expr *cons = isBoolConst(args[0]) ? args[0] : (isBoolConst(args[1]) ? args[1] : NULL);
+      if (cons != NULL) {
+        Expr *other = (cons == args[0]) ? args[1] : args[0];
+        if ((cons->expr.cons->v.boolV ? 1 : 0) == decider) {
+          freeExpr(other);
+          *result = cons;
+          free(args);
+          return RC_OK;
+        }
+        if (other->type == EXPR_OP || isBoolConst(other)) {
+          freeExpr(cons);
+          *result = other;
+          free(args);
+          return RC_OK;
+        }
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  // Rebuild the operator over the optimized arguments
+  Operator *newOp = (Operator *) malloc(sizeof(Operator));
+  folded = (Expr *) malloc(sizeof(Expr));
+  if (newOp == NULL || folded == NULL) {
+    for (int i = 0; i < op->numArgs; i++)
+      freeExpr(args[i]);
+    free(args);
+    free(newOp);
+    free(folded);
+    return RC_MEM_ALLOC_FAILED;
+  }
+  newOp->type = op->type;
+  newOp->numArgs = op->numArgs;
+  newOp->args = args;
+  folded->type = EXPR_OP;
+  folded->expr.op = newOp;
+
+  // Comparisons over constants of one type evaluate to a constant
+  if (isComparisonOp(op->type) && sameTypeConstants(args, op->numArgs)) {
+    Value *value = NULL;
+    if (evalExpr(NULL, NULL, folded, &value) == RC_OK) {
+      freeExpr(folded);
+      MAKE_CONS(folded, value);
+    }
+  }
+
+  *result = folded;
+  return RC_OK;
+}
+
+RC optimizeExpr(Expr *expr, Expr **result) {
+  if (expr == NULL || result == NULL)
+    return RC_FILE_HANDLE_NOT_INIT;
+
+  return optimizeNode(expr, result);
+}
+
+// ================== Compiled Expressions ==================
+// compileExpr lowers an Expr tree once into a flat array of typed nodes:
+// attribute references become byte offsets into the record, constants
+// are decoded up front and every comparison knows its operand type.
+// evalCompiledExpr then runs directly on raw record bytes without any
+// heap allocation. Since all types are known when compiling, type errors
+// are reported by compileExpr and evaluation itself cannot fail.
+//
+// Nested ANDs (and ORs) are flattened into one node with a list of
+// children that is evaluated with short-circuiting. Children start out
+// ordered by a static cost estimate; every REORDER_INTERVAL evaluations
+// the list is re-sorted by cost per decisive outcome observed so far, so
+// cheap conjuncts that reject most rows move to the front. These
+// statistics live in the program, so a program must not be shared
+// between threads.
+//
+// IN lists of at least IN_HASH_MIN_VALUES constants are probed through an
+// open-addressing hash set instead of being compared one by one.
+
+#define REORDER_INTERVAL 256
+#define IN_HASH_MIN_VALUES 8
+
+typedef enum CompiledNodeKind {
+  CN_AND,
+  CN_OR,
+  CN_NOT,
+  CN_CMP,
+  CN_BETWEEN,
+  CN_IN,
+  CN_BOOL
+} CompiledNodeKind;
+
+typedef enum CompiledOperandKind {
+  CO_ATTR,
+  CO_CONST,
+  CO_NODE
+} CompiledOperandKind;
+
+typedef struct CompiledOperand {
+  CompiledOperandKind kind;
+  DataType dt;
+  int offset;      // CO_ATTR: offset of the attribute in the record
+  int length;      // CO_ATTR: typeLength for strings
+  int node;        // CO_NODE: index of a boolean sub-expression
+  union {
+    int intV;
+    float floatV;
+    int boolV;
+    char *stringV;
+  } cons;          // CO_CONST: pre-decoded constant
+} CompiledOperand;
+
+typedef struct CompiledInList {
+  int numValues;
+  CompiledOperand *values;
+  int numBuckets;  // 0: probe values one by one; otherwise a power of two
+  int *buckets;    // index into values, -1 for an empty bucket
+} CompiledInList;
+
+typedef struct CompiledNode {
+  CompiledNodeKind kind;
+  OpType op;       // CN_CMP: one of the OP_COMP_* operators
+  DataType dt;     // CN_CMP/CN_BETWEEN/CN_IN: type of all operands
+  int left;        // CN_NOT: child node index
+  int first;       // CN_AND/CN_OR: children are prog->children[first..first+count)
+  int count;
+  int cost;        // static estimate of the evaluation cost
+  long evaluated;  // times evaluated as a child of CN_AND/CN_OR
+  long passed;     // how many of those returned true
+  long sinceReorder; // CN_AND/CN_OR: evaluations since the last re-sort
+  CompiledOperand args[3]; // CN_BETWEEN uses all three, CN_IN only args[0]
+  CompiledInList *in;      // CN_IN: the list of candidate values
+} CompiledNode;
+
+struct CompiledExpr {
+  int numNodes;
+  int root;
+  CompiledNode *nodes;
+  int numChildren;
+  int *children;   // child lists of CN_AND/CN_OR nodes
+  int *scratch;    // selection vectors used by evalCompiledBatch
+  int scratchSize;
+  int scratchTop;
+  int useAvx2;     // batch kernels may use AVX2 on this CPU
+};
+
+static int countExprNodes(Expr *expr) {
+  if (expr->type != EXPR_OP)
+    return 1;
+
+  Operator *op = expr->expr.op;
+  int count = 1;
+  for (int i = 0; i < op->numArgs; i++)
+    count += countExprNodes(op->args[i]);
+  return count;
+}
+
+// Number of operands of a flattened chain of type opType rooted at expr
+static int countChainArgs(Expr *expr, OpType opType) {
+  if (expr->type != EXPR_OP || expr->expr.op->type != opType)
+    return 1;
+
+  Operator *op = expr->expr.op;
+  return countChainArgs(op->args[0], opType) + countChainArgs(op->args[1], opType);
+}
+
+static RC compileNode(CompiledExpr *prog, Expr *expr, Schema *schema, int *index);
+static unsigned int hashOperand(CompiledExpr *prog, DataType dt, const CompiledOperand *operand,
+                                const char *data);
+
+// Compile the operands of a flattened AND/OR chain into its child list
+static RC compileChainArgs(CompiledExpr *prog, Expr *expr, OpType opType, Schema *schema,
+                           int *children, int *count) {
+  if (expr->type != EXPR_OP || expr->expr.op->type != opType)
+    return compileNode(prog, expr, schema, &children[(*count)++]);
+
+  Operator *op = expr->expr.op;
+  EXPR_CHECK(compileChainArgs(prog, op->args[0], opType, schema, children, count));
+  return compileChainArgs(prog, op->args[1], opType, schema, children, count);
+}
+
+static int operandCost(const CompiledOperand *operand, const CompiledExpr *prog) {
+  if (operand->kind == CO_NODE)
+    return prog->nodes[operand->node].cost;
+  return (operand->dt == DT_STRING) ? 4 : 1;
+}
+
+// Rank of a child of an AND/OR node: expected cost per decisive outcome
+// (false for AND, true for OR); lower ranks run first
+static double childRank(const CompiledNode *child, int decider) {
+  double decisive = decider ? child->passed : child->evaluated - child->passed;
+  return child->cost * (child->evaluated + 2) / (decisive + 1);
+}
+
+static void sortChildren(CompiledExpr *prog, CompiledNode *node) {
+  int decider = (node->kind == CN_OR);
+  int *children = &prog->children[node->first];
+
+  // Insertion sort: child lists are short and usually nearly sorted
+  for (int i = 1; i < node->count; i++) {
+    int child = children[i];
+    double rank = childRank(&prog->nodes[child], decider);
+    int j = i - 1;
+    while (j >= 0 && childRank(&prog->nodes[children[j]], decider) > rank) {
+      children[j + 1] = children[j];
+      j--;
+    }
+    children[j + 1] = child;
+  }
+}
+
+// Resolve one side of a comparison to an attribute, constant or sub-expression
+static RC compileOperand(CompiledExpr *prog, Expr *expr, Schema *schema,
+                         CompiledOperand *operand) {
+  switch (expr->type) {
+    case EXPR_ATTRREF: {
+      int attr = expr->expr.attrRef;
+      if (schema == NULL || attr < 0 || attr >= schema->numAttr)
+        return RC_RM_INVALID_ATTRIBUTE;
+      operand->kind = CO_ATTR;
+      operand->offset = getAttrOffset(schema, attr);
+      operand->length = schema->typeLength[attr];
+      operand->dt = schema->dataTypes[attr];
+      return RC_OK;
+    }
+    case EXPR_CONST: {
+      Value *cons = expr->expr.cons;
+      operand->kind = CO_CONST;
+      operand->dt = cons->dt;
+      switch (cons->dt) {
+        case DT_INT:
+          operand->cons.intV = cons->v.intV;
+          break;
+        case DT_FLOAT:
+          operand->cons.floatV = cons->v.floatV;
+          break;
+        case DT_BOOL:
+          operand->cons.boolV = cons->v.boolV ? 1 : 0;
+          break;
+        case DT_STRING:
+          operand->cons.stringV = (char *) malloc(strlen(cons->v.stringV) + 1);
+          if (operand->cons.stringV == NULL)
+            return RC_MEM_ALLOC_FAILED;
+          strcpy(operand->cons.stringV, cons->v.stringV);
+          break;
+      }
+      return RC_OK;
+    }
+    case EXPR_OP:
+      operand->kind = CO_NODE;
+      operand->dt = DT_BOOL;
+      return compileNode(prog, expr, schema, &operand->node);
+  }
+  return RC_RM_UNKNOWN_OPERATOR;
+}
+
+// Compile the candidates of an IN; long constant lists get a hash set
+static RC compileInList(CompiledExpr *prog, CompiledNode *node, Operator *op, Schema *schema) {
+  CompiledInList *in = (CompiledInList *) calloc(1, sizeof(CompiledInList));
+  if (in == NULL)
+    return RC_MEM_ALLOC_FAILED;
+  node->in = in;
+
+  in->values = (CompiledOperand *) calloc(op->numArgs, sizeof(CompiledOperand));
+  if (in->values == NULL)
+    return RC_MEM_ALLOC_FAILED;
+
+  bool allConstant = true;
+  int listCost = 0;
+  for (int i = 1; i < op->numArgs; i++) {
+    CompiledOperand *value = &in->values[in->numValues];
+    EXPR_CHECK(compileOperand(prog, op->args[i], schema, value));
+    in->numValues++;
+    if (value->dt != node->dt)
+      return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    if (value->kind != CO_CONST)
+      allConstant = false;
+    listCost += operandCost(value, prog);
+  }
+  node->cost = operandCost(&node->args[0], prog) + listCost;
+
+  if (!allConstant || in->numValues < IN_HASH_MIN_VALUES)
+    return RC_OK;
+
+  // At most half full, so probe sequences stay short
+  int numBuckets = 1;
+  while (numBuckets < 2 * in->numValues)
+    numBuckets <<= 1;
+  in->buckets = (int *) malloc(sizeof(int) * numBuckets);
+  if (in->buckets == NULL)
+    return RC_MEM_ALLOC_FAILED;
+  in->numBuckets = numBuckets;
+  for (int i = 0; i < numBuckets; i++)
+    in->buckets[i] = -1;
+
+  unsigned int mask = (unsigned int) numBuckets - 1;
+  for (int i = 0; i < in->numValues; i++) {
+    unsigned int bucket = hashOperand(prog, node->dt, &in->values[i], NULL) & mask;
+    while (in->buckets[bucket] >= 0)
+      bucket = (bucket + 1) & mask;
+    in->buckets[bucket] = i;
+  }
+  node->cost = operandCost(&node->args[0], prog) + 2;
+  return RC_OK;
+}
+
+// Append the node for expr (and its children) and return its index
+static RC compileNode(CompiledExpr *prog, Expr *expr, Schema *schema, int *index) {
+  // The node array is sized up front, so node stays valid while children are added
+  CompiledNode *node = &prog->nodes[prog->numNodes];
+
+  memset(node, 0, sizeof(CompiledNode));
+  for (int i = 0; i < 3; i++)
+    node->args[i].kind = CO_NODE;
+  *index = prog->numNodes++;
+
+  if (expr->type != EXPR_OP) {
+    // A lone attribute or constant is only valid as a boolean
+    node->kind = CN_BOOL;
+    EXPR_CHECK(compileOperand(prog, expr, schema, &node->args[0]));
+    if (node->args[0].dt != DT_BOOL)
+      return RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN;
+    node->cost = 1;
+    return RC_OK;
+  }
+
+  Operator *op = expr->expr.op;
+  switch (op->type) {
+    case OP_BOOL_NOT:
+      node->kind = CN_NOT;
+      EXPR_CHECK(compileNode(prog, op->args[0], schema, &node->left));
+      node->cost = prog->nodes[node->left].cost;
+      return RC_OK;
+
+    case OP_BOOL_AND:
+    case OP_BOOL_OR:
+      node->kind = (op->type == OP_BOOL_AND) ? CN_AND : CN_OR;
+      node->first = prog->numChildren;
+      prog->numChildren += countChainArgs(expr, op->type);
+      EXPR_CHECK(compileChainArgs(prog, expr, op->type, schema,
+                                  &prog->children[node->first], &node->count));
+      for (int i = 0; i < node->count; i++)
+        node->cost += prog->nodes[prog->children[node->first + i]].cost;
+      sortChildren(prog, node);
+      return RC_OK;
+
+    case OP_COMP_EQUAL:
+    case OP_COMP_SMALLER:
+    case OP_COMP_GREATER:
+    case OP_COMP_SMALLER_EQUAL:
+    case OP_COMP_GREATER_EQUAL:
+    case OP_COMP_NOT_EQUAL:
+      node->kind = CN_CMP;
+      node->op = op->type;
+      EXPR_CHECK(compileOperand(prog, op->args[0], schema, &node->args[0]));
+      EXPR_CHECK(compileOperand(prog, op->args[1], schema, &node->args[1]));
+      if (node->args[0].dt != node->args[1].dt)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+      node->dt = node->args[0].dt;
+      node->cost = operandCost(&node->args[0], prog) + operandCost(&node->args[1], prog);
+      return RC_OK;
+
+    case OP_BETWEEN:
+      if (op->numArgs != 3)
+        return RC_RM_UNKNOWN_OPERATOR;
+      node->kind = CN_BETWEEN;
+      for (int i = 0; i < 3; i++) {
+        EXPR_CHECK(compileOperand(prog, op->args[i], schema, &node->args[i]));
+        if (node->args[i].dt != node->args[0].dt)
+          return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+        node->cost += operandCost(&node->args[i], prog);
+      }
+      node->dt = node->args[0].dt;
+      return RC_OK;
+
+    case OP_IN:
+      node->kind = CN_IN;
+      EXPR_CHECK(compileOperand(prog, op->args[0], schema, &node->args[0]));
+      node->dt = node->args[0].dt;
+      return compileInList(prog, node, op, schema);
+
+    default:
+      return RC_RM_UNKNOWN_OPERATOR;
+  }
+}
+
+RC compileExpr(Expr *expr, Schema *schema, CompiledExpr **result) {
+  if (expr == NULL || result == NULL)
+    return RC_FILE_HANDLE_NOT_INIT;
+
+  CompiledExpr *prog = (CompiledExpr *) malloc(sizeof(CompiledExpr));
+  if (prog == NULL)
+    return RC_MEM_ALLOC_FAILED;
+
+  int maxNodes = countExprNodes(expr);
+  prog->numNodes = 0;
+  prog->numChildren = 0;
+  prog->scratch = NULL;
+  prog->scratchSize = 0;
+  prog->scratchTop = 0;
+#ifdef EXPR_AVX2
+  prog->useAvx2 = __builtin_cpu_supports("avx2");
+#else
+  prog->useAvx2 = 0;
+#endif
+  prog->nodes = (CompiledNode *) malloc(sizeof(CompiledNode) * maxNodes);
+  prog->children = (int *) malloc(sizeof(int) * maxNodes);
+  if (prog->nodes == NULL || prog->children == NULL) {
+    free(prog->nodes);
+    free(prog->children);
+    free(prog);
+    return RC_MEM_ALLOC_FAILED;
+  }
+
+  RC rc = compileNode(prog, expr, schema, &prog->root);
+  if (rc != RC_OK) {
+    freeCompiledExpr(prog);
+    return rc;
+  }
+
+  *result = prog;
+  return RC_OK;
+}
+
+// Compare two strings the way valueEquals/valueSmaller see them: an
+// attribute ends at its first NUL or after typeLength bytes
+static int compareBoundedStrings(const char *left, int leftLen, const char *right, int rightLen) {
+  int i;
+  for (i = 0; i < leftLen && i < rightLen; i++) {
+    unsigned char l = (unsigned char) left[i];
+    unsigned char r = (unsigned char) right[i];
+    if (l != r || l == '\0')
+      return (int) l - (int) r;
+  }
+  unsigned char l = (i < leftLen) ? (unsigned char) left[i] : '\0';
+  unsigned char r = (i < rightLen) ? (unsigned char) right[i] : '\0';
+  return (int) l - (int) r;
+}
+
+static int evalCompiledNode(CompiledExpr *prog, int index, const char *data);
+
+static int operandBool(CompiledExpr *prog, const CompiledOperand *operand, const char *data) {
+  switch (operand->kind) {
+    case CO_ATTR:
+      return ((const unsigned char *) data)[operand->offset] != 0;
+    case CO_CONST:
+      return operand->cons.boolV;
+    case CO_NODE:
+      return evalCompiledNode(prog, operand->node, data);
+  }
+  return 0;
+}
+
+static int operandInt(const CompiledOperand *operand, const char *data) {
+  int value;
+  if (operand->kind != CO_ATTR)
+    return operand->cons.intV;
+  memcpy(&value, data + operand->offset, sizeof(int));
+  return value;
+}
+
+static float operandFloat(const CompiledOperand *operand, const char *data) {
+  float value;
+  if (operand->kind != CO_ATTR)
+    return operand->cons.floatV;
+  memcpy(&value, data + operand->offset, sizeof(float));
+  return value;
+}
+
+// Start of a string operand and the most bytes it can span
+static const char *operandString(const CompiledOperand *operand, const char *data, int *length) {
+  if (operand->kind != CO_ATTR) {
+    *length = (int) strlen(operand->cons.stringV);
+    return operand->cons.stringV;
+  }
+  *length = operand->length;
+  return data + operand->offset;
+}
+
+// Three-way comparison of two operands of type dt
+static int compareOperands(CompiledExpr *prog, DataType dt, const CompiledOperand *l,
+                           const CompiledOperand *r, const char *data) {
+  switch (dt) {
+    case DT_INT: {
+      int lv = operandInt(l, data);
+      int rv = operandInt(r, data);
+      return (lv > rv) - (lv < rv);
+    }
+    case DT_FLOAT: {
+      float lv = operandFloat(l, data);
+      float rv = operandFloat(r, data);
+      return (lv > rv) - (lv < rv);
+    }
+    case DT_BOOL:
+      return operandBool(prog, l, data) - operandBool(prog, r, data);
+    case DT_STRING: {
+      int lLen, rLen;
+      const char *lv = operandString(l, data, &lLen);
+      const char *rv = operandString(r, data, &rLen);
+      return compareBoundedStrings(lv, lLen, rv, rLen);
+    }
+  }
+  return 0;
+}
+
+static unsigned int hashBytes(const void *bytes, int length) {
+  const unsigned char *p = (const unsigned char *) bytes;
+  unsigned int hash = 2166136261u;     // FNV-1a
+  for (int i = 0; i < length; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Hash an operand so that operands comparing equal hash equally
+static unsigned int hashOperand(CompiledExpr *prog, DataType dt, const CompiledOperand *operand,
+                                const char *data) {
+  switch (dt) {
+    case DT_INT: {
+      int value = operandInt(operand, data);
+      return hashBytes(&value, sizeof(int));
+    }
+    case DT_FLOAT: {
+      float value = operandFloat(operand, data);
+      if (value == 0.0f)
+        value = 0.0f;                  // -0.0 equals 0.0
+      return hashBytes(&value, sizeof(float));
+    }
+    case DT_BOOL:
+      return (unsigned int) operandBool(prog, operand, data);
+    case DT_STRING: {
+      int length;
+      const char *value = operandString(operand, data, &length);
+      const char *end = memchr(value, '\0', length);
+      return hashBytes(value, end ? (int) (end - value) : length);
+    }
+  }
+  return 0;
+}
+
+// Whether two operands are equal; floats compare directly, so NaN
+// equals nothing
+static int operandsEqual(CompiledExpr *prog, DataType dt, const CompiledOperand *l,
+                         const CompiledOperand *r, const char *data) {
+  if (dt == DT_FLOAT)
+    return operandFloat(l, data) == operandFloat(r, data);
+  return compareOperands(prog, dt, l, r, data) == 0;
+}
+
+// Floats are compared directly rather than through compareOperands, whose
+// three-way result cannot express NaN: every comparison with it is false
+// except <>, as in evalExpr and the batch kernels
+static int evalFloatCompare(OpType op, float lv, float rv) {
+  switch (op) {
+    case OP_COMP_EQUAL:
+      return lv == rv;
+    case OP_COMP_SMALLER:
+      return lv < rv;
+    case OP_COMP_GREATER:
+      return lv > rv;
+    case OP_COMP_SMALLER_EQUAL:
+      return lv <= rv;
+    case OP_COMP_GREATER_EQUAL:
+      return lv >= rv;
+    case OP_COMP_NOT_EQUAL:
+      return lv != rv;
+    default:
+      return 0;
+  }
+}
+
+static int evalCompare(CompiledExpr *prog, const CompiledNode *node, const char *data) {
+  if (node->dt == DT_FLOAT)
+    return evalFloatCompare(node->op, operandFloat(&node->args[0], data),
+                            operandFloat(&node->args[1], data));
+
+  int cmp = compareOperands(prog, node->dt, &node->args[0], &node->args[1], data);
+
+  switch (node->op) {
+    case OP_COMP_EQUAL:
+      return cmp == 0;
+    case OP_COMP_SMALLER:
+      return cmp < 0;
+    case OP_COMP_GREATER:
+      return cmp > 0;
+    case OP_COMP_SMALLER_EQUAL:
+      return cmp <= 0;
+    case OP_COMP_GREATER_EQUAL:
+      return cmp >= 0;
+    case OP_COMP_NOT_EQUAL:
+      return cmp != 0;
+    default:
+      return 0;
+  }
+}
+
+static int evalBetween(CompiledExpr *prog, const CompiledNode *node, const char *data) {
+  if (node->dt == DT_FLOAT) {
+    float value = operandFloat(&node->args[0], data);
+    return value >= operandFloat(&node->args[1], data) && value <= operandFloat(&node->args[2], data);
+  }
+  return compareOperands(prog, node->dt, &node->args[0], &node->args[1], data) >= 0
+      && compareOperands(prog, node->dt, &node->args[0], &node->args[2], data) <= 0;
+}
+
+static int evalIn(CompiledExpr *prog, const CompiledNode *node, const char *data) {
+  const CompiledInList *in = node->in;
+
+  if (in->numBuckets == 0) {
+    for (int i = 0; i < in->numValues; i++) {
+      if (operandsEqual(prog, node->dt, &node->args[0], &in->values[i], data))
+        return 1;
+    }
+    return 0;
+  }
+
+  unsigned int mask = (unsigned int) in->numBuckets - 1;
+  unsigned int bucket = hashOperand(prog, node->dt, &node->args[0], data) & mask;
+  while (in->buckets[bucket] >= 0) {
+    if (operandsEqual(prog, node->dt, &node->args[0], &in->values[in->buckets[bucket]], data))
+      return 1;
+    bucket = (bucket + 1) & mask;
+  }
+  return 0;
+}
+
+// Count rows evaluated by an AND/OR node and re-sort its children every
+// REORDER_INTERVAL rows
+static void noteEvaluations(CompiledExpr *prog, CompiledNode *node, int rows) {
+  node->sinceReorder += rows;
+  if (node->sinceReorder < REORDER_INTERVAL)
+    return;
+
+  sortChildren(prog, node);
+  node->sinceReorder = 0;
+
+  // Halve the counters so the order follows recent rows
+  for (int i = 0; i < node->count; i++) {
+    CompiledNode *child = &prog->nodes[prog->children[node->first + i]];
+    child->evaluated /= 2;
+    child->passed /= 2;
+  }
+}
+
+// Evaluate the children of an AND/OR node until one decides the result
+static int evalChildren(CompiledExpr *prog, CompiledNode *node, const char *data) {
+  int decider = (node->kind == CN_OR);
+  int result = !decider;
+
+  for (int i = 0; i < node->count; i++) {
+    int index = prog->children[node->first + i];
+    CompiledNode *child = &prog->nodes[index];
+    int value = evalCompiledNode(prog, index, data);
+
+    child->evaluated++;
+    child->passed += value;
+    if (value == decider) {
+      result = decider;
+      break;
+    }
+  }
+
+  noteEvaluations(prog, node, 1);
+  return result;
+}
+
+static int evalCompiledNode(CompiledExpr *prog, int index, const char *data) {
+  CompiledNode *node = &prog->nodes[index];
+
+  switch (node->kind) {
+    case CN_AND:
+    case CN_OR:
+      return evalChildren(prog, node, data);
+    case CN_NOT:
+      return !evalCompiledNode(prog, node->left, data);
+    case CN_CMP:
+      return evalCompare(prog, node, data);
+    case CN_BETWEEN:
+      return evalBetween(prog, node, data);
+    case CN_IN:
+      return evalIn(prog, node, data);
+    case CN_BOOL:
+      return operandBool(prog, &node->args[0], data);
+  }
+  return 0;
+}
+
+RC evalCompiledExpr(CompiledExpr *prog, const char *recordData, int *result) {
+  if (prog == NULL || result == NULL)
+    return RC_FILE_HANDLE_NOT_INIT;
+
+  *result = evalCompiledNode(prog, prog->root, recordData);
+  return RC_OK;
+}
+
+// ================== Batch Evaluation ==================
+// evalCompiledBatch evaluates a program over many records at once. The
+// records lie stride bytes apart from base (the first slot of a page, or
+// RecordBatch->data) and a selection vector lists, in ascending order, the
+// record positions to look at. Every node maps its input selection to the
+// positions that pass: comparisons and BETWEEN of an INT or FLOAT attribute
+// against constants run as tight type-specialized loops, AND narrows the
+// selection one child at a time, OR only hands each child the rows no
+// earlier child accepted, and NOT keeps what its child rejects. Other
+// nodes fall back to evaluating row by row.
+
+// A node needs at most this many selection vectors while its children run
+#define SCRATCH_VECTORS_PER_NODE 3
+
+static int *pushScratch(CompiledExpr *prog, int count) {
+  int *vector = prog->scratch + prog->scratchTop;
+  prog->scratchTop += count;
+  return vector;
+}
+
+static void popScratch(CompiledExpr *prog, int count) {
+  prog->scratchTop -= count;
+}
+
+// out = a minus b, for ascending a and a subset b of it; out may be a
+static int differenceSorted(const int *a, int numA, const int *b, int numB, int *out) {
+  int count = 0;
+  int j = 0;
+  for (int i = 0; i < numA; i++) {
+    if (j < numB && b[j] == a[i])
+      j++;
+    else
+      out[count++] = a[i];
+  }
+  return count;
+}
+
+// out = union of two disjoint ascending vectors
+static int mergeSorted(const int *a, int numA, const int *b, int numB, int *out) {
+  int i = 0, j = 0, count = 0;
+  while (i < numA && j < numB)
+    out[count++] = (a[i] < b[j]) ? a[i++] : b[j++];
+  while (i < numA)
+    out[count++] = a[i++];
+  while (j < numB)
+    out[count++] = b[j++];
+  return count;
+}
+
+// A comparison or BETWEEN of an INT/FLOAT attribute against constants,
+// normalized to "attribute op low" or "low <= attribute <= high"
+typedef struct NumericFilter {
+  DataType dt;
+  OpType op;       // one of the OP_COMP_* operators, or OP_BETWEEN
+  int offset;      // offset of the attribute in the record
+  union {
+    int intV;
+    float floatV;
+  } low, high;
+} NumericFilter;
+
+// The operator that gives the same result with its operands swapped
+static OpType mirrorOp(OpType op) {
+  switch (op) {
+    case OP_COMP_SMALLER:       return OP_COMP_GREATER;
+    case OP_COMP_GREATER:       return OP_COMP_SMALLER;
+    case OP_COMP_SMALLER_EQUAL: return OP_COMP_GREATER_EQUAL;
+    case OP_COMP_GREATER_EQUAL: return OP_COMP_SMALLER_EQUAL;
+    default:                    return op;
+  }
+}
+
+static bool getNumericFilter(const CompiledNode *node, NumericFilter *filter) {
+  const CompiledOperand *args = node->args;
+
+  if (node->dt != DT_INT && node->dt != DT_FLOAT)
+    return false;
+
+  filter->dt = node->dt;
+  if (node->kind == CN_BETWEEN) {
+    if (args[0].kind != CO_ATTR || args[1].kind != CO_CONST || args[2].kind != CO_CONST)
+      return false;
+    filter->op = OP_BETWEEN;
+    filter->offset = args[0].offset;
+    memcpy(&filter->low, &args[1].cons, sizeof(filter->low));
+    memcpy(&filter->high, &args[2].cons, sizeof(filter->high));
+    return true;
+  }
+
+  if (node->kind != CN_CMP)
+    return false;
+
+  if (args[0].kind == CO_ATTR && args[1].kind == CO_CONST) {
+    filter->op = node->op;
+    filter->offset = args[0].offset;
+    memcpy(&filter->low, &args[1].cons, sizeof(filter->low));
+    return true;
+  }
+  if (args[0].kind == CO_CONST && args[1].kind == CO_ATTR) {
+    filter->op = mirrorOp(node->op);
+    filter->offset = args[1].offset;
+    memcpy(&filter->low, &args[0].cons, sizeof(filter->low));
+    return true;
+  }
+  return false;
+}
+
+#define NUMERIC_TEST(_v, _low, _high, _op)				\
+  ((_op) == OP_COMP_EQUAL ? (_v) == (_low) :				\
+   (_op) == OP_COMP_SMALLER ? (_v) < (_low) :				\
+   (_op) == OP_COMP_GREATER ? (_v) > (_low) :				\
+   (_op) == OP_COMP_SMALLER_EQUAL ? (_v) <= (_low) :			\
+   (_op) == OP_COMP_GREATER_EQUAL ? (_v) >= (_low) :			\
+   (_op) == OP_COMP_NOT_EQUAL ? (_v) != (_low) :			\
+   ((_v) >= (_low)) & ((_v) <= (_high)))
+
+// Test one record against a numeric filter
+static int numericFilterRow(const NumericFilter *filter, const char *record) {
+  if (filter->dt == DT_INT) {
+    int v;
+    memcpy(&v, record + filter->offset, sizeof(int));
+    return NUMERIC_TEST(v, filter->low.intV, filter->high.intV, filter->op);
+  }
+  float v;
+  memcpy(&v, record + filter->offset, sizeof(float));
+  return NUMERIC_TEST(v, filter->low.floatV, filter->high.floatV, filter->op);
+}
+
+// Keep the selected rows for which _cond holds on the attribute value v.
+// The loop is branch-free: every row is written and only passing rows
+// advance the output position.
+#define FILTER_LOOP(_type, _cond)					\
+  do {									\
+    for (int _i = 0; _i < numSel; _i++) {				\
+      _type v;								\
+      memcpy(&v, base + (long) sel[_i] * stride + offset, sizeof(_type)); \
+      out[count] = sel[_i];						\
+      count += (_cond);							\
+    }									\
+  } while (0)
+
+#define FILTER_NUMERIC(_type, _low, _high)				\
+  do {									\
+    _type low = (_low);							\
+    _type high = (_high);						\
+    switch (filter->op) {						\
+      case OP_COMP_EQUAL:         FILTER_LOOP(_type, v == low); break;	\
+      case OP_COMP_SMALLER:       FILTER_LOOP(_type, v < low); break;	\
+      case OP_COMP_GREATER:       FILTER_LOOP(_type, v > low); break;	\
+      case OP_COMP_SMALLER_EQUAL: FILTER_LOOP(_type, v <= low); break;	\
+      case OP_COMP_GREATER_EQUAL: FILTER_LOOP(_type, v >= low); break;	\
+      case OP_COMP_NOT_EQUAL:     FILTER_LOOP(_type, v != low); break;	\
+      default: FILTER_LOOP(_type, (v >= low) & (v <= high)); break;	\
+    }									\
+  } while (0)
+
+// Scalar kernel over a selection vector
+static int filterNumericScalar(const NumericFilter *filter, const char *base, int stride,
+                               const int *sel, int numSel, int *out) {
+  int offset = filter->offset;
+  int count = 0;
+
+  if (filter->dt == DT_INT)
+    FILTER_NUMERIC(int, filter->low.intV, filter->high.intV);
+  else
+    FILTER_NUMERIC(float, filter->low.floatV, filter->high.floatV);
+  return count;
+}
+
+// Scalar kernel over records 0..numRecords-1, visiting only the records
+// whose bit is set in the occupancy bitmap, a 64-bit word at a time
+static int pageNumericScalar(const NumericFilter *filter, const char *base, int stride,
+                             int numRecords, const uint64_t *occupied, int *out) {
+  int count = 0;
+
+  for (int word = 0; word * 64 < numRecords; word++) {
+    uint64_t bits = occupied[word];
+    while (bits != 0) {
+      int slot = word * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      if (slot >= numRecords)
+        break;
+      out[count] = slot;
+      count += numericFilterRow(filter, base + (long) slot * stride);
+    }
+  }
+  return count;
+}
+
+#ifdef EXPR_AVX2
+// AVX2 kernels: gather the attribute of 8 records at once (the records
+// are stride bytes apart, so a plain vector load cannot be used), compare
+// all lanes with the constant and turn the lanes that pass into an 8-bit
+// mask. The mask of 8 consecutive slots lines up with one byte of a word
+// of the page's occupancy bitmap, so the two are simply ANDed.
+
+__attribute__((target("avx2")))
+static unsigned int avx2FilterMask(const NumericFilter *filter, const char *base, __m256i offsets) {
+  const char *attr = base + filter->offset;
+  __m256i cmp;
+  bool negate = false;
+
+  if (filter->dt == DT_INT) {
+    __m256i v = _mm256_i32gather_epi32((const int *) attr, offsets, 1);
+    __m256i low = _mm256_set1_epi32(filter->low.intV);
+
+    switch (filter->op) {
+      case OP_COMP_EQUAL:         cmp = _mm256_cmpeq_epi32(v, low); break;
+      case OP_COMP_NOT_EQUAL:     cmp = _mm256_cmpeq_epi32(v, low); negate = true; break;
+      case OP_COMP_SMALLER:       cmp = _mm256_cmpgt_epi32(low, v); break;
+      case OP_COMP_GREATER_EQUAL: cmp = _mm256_cmpgt_epi32(low, v); negate = true; break;
+      case OP_COMP_GREATER:       cmp = _mm256_cmpgt_epi32(v, low); break;
+      case OP_COMP_SMALLER_EQUAL: cmp = _mm256_cmpgt_epi32(v, low); negate = true; break;
+      default: {
+        __m256i high = _mm256_set1_epi32(filter->high.intV);
+        // outside the range: below low or above high
+        cmp = _mm256_or_si256(_mm256_cmpgt_epi32(low, v), _mm256_cmpgt_epi32(v, high));
+        negate = true;
+        break;
+      }
+    }
+    unsigned int mask = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+    return negate ? mask ^ 0xFF : mask;
+  }
+
+  __m256 v = _mm256_i32gather_ps((const float *) attr, offsets, 1);
+  __m256 low = _mm256_set1_ps(filter->low.floatV);
+  __m256 fcmp;
+
+  switch (filter->op) {
+    case OP_COMP_EQUAL:         fcmp = _mm256_cmp_ps(v, low, _CMP_EQ_OQ); break;
+    case OP_COMP_NOT_EQUAL:     fcmp = _mm256_cmp_ps(v, low, _CMP_NEQ_UQ); break;
+    case OP_COMP_SMALLER:       fcmp = _mm256_cmp_ps(v, low, _CMP_LT_OQ); break;
+    case OP_COMP_GREATER:       fcmp = _mm256_cmp_ps(v, low, _CMP_GT_OQ); break;
+    case OP_COMP_SMALLER_EQUAL: fcmp = _mm256_cmp_ps(v, low, _CMP_LE_OQ); break;
+    case OP_COMP_GREATER_EQUAL: fcmp = _mm256_cmp_ps(v, low, _CMP_GE_OQ); break;
+    default:
+      fcmp = _mm256_and_ps(_mm256_cmp_ps(v, low, _CMP_GE_OQ),
+                           _mm256_cmp_ps(v, _mm256_set1_ps(filter->high.floatV), _CMP_LE_OQ));
+      break;
+  }
+  return (unsigned int) _mm256_movemask_ps(fcmp);
+}
+
+__attribute__((target("avx2")))
+static int filterNumericAvx2(const NumericFilter *filter, const char *base, int stride,
+                             const int *sel, int numSel, int *out) {
+  __m256i strides = _mm256_set1_epi32(stride);
+  int count = 0;
+  int i = 0;
+
+  for (; i + 8 <= numSel; i += 8) {
+    __m256i slots = _mm256_loadu_si256((const __m256i *) (sel + i));
+    unsigned int mask = avx2FilterMask(filter, base, _mm256_mullo_epi32(slots, strides));
+    while (mask != 0) {
+      out[count++] = sel[i + __builtin_ctz(mask)];
+      mask &= mask - 1;
+    }
+  }
+  return count + filterNumericScalar(filter, base, stride, sel + i, numSel - i, out + count);
+}
+
+__attribute__((target("avx2")))
+static int pageNumericAvx2(const NumericFilter *filter, const char *base, int stride,
+                           int numRecords, const uint64_t *occupied, int *out) {
+  __m256i strides = _mm256_set1_epi32(stride);
+  __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  int count = 0;
+  int chunk = 0;
+
+  // Whole bitmap words, 8 slots per step; empty words are skipped outright
+  for (; chunk + 64 <= numRecords; chunk += 64) {
+    uint64_t word = occupied[chunk / 64];
+    for (int shift = 0; word != 0; shift += 8, word >>= 8) {
+      unsigned int bits = (unsigned int) (word & 0xFF);
+      if (bits == 0)
+        continue;
+
+      __m256i slots = _mm256_add_epi32(_mm256_set1_epi32(chunk + shift), lanes);
+      unsigned int mask = avx2FilterMask(filter, base, _mm256_mullo_epi32(slots, strides)) & bits;
+      while (mask != 0) {
+        out[count++] = chunk + shift + __builtin_ctz(mask);
+        mask &= mask - 1;
+      }
+    }
+  }
+
+  if (chunk < numRecords) {
+    // Rebase so the scalar kernel sees the tail as records 0..n-1
+    int tail = pageNumericScalar(filter, base + (long) chunk * stride, stride,
+                                 numRecords - chunk, occupied + chunk / 64, out + count);
+    for (int i = 0; i < tail; i++)
+      out[count + i] += chunk;
+    count += tail;
+  }
+  return count;
+}
+#endif
+
+static int filterNumeric(CompiledExpr *prog, const NumericFilter *filter, const char *base, int stride,
+                         const int *sel, int numSel, int *out) {
+#ifdef EXPR_AVX2
+  if (prog->useAvx2)
+    return filterNumericAvx2(filter, base, stride, sel, numSel, out);
+#endif
+  (void) prog;
+  return filterNumericScalar(filter, base, stride, sel, numSel, out);
+}
+
+static int pageNumeric(CompiledExpr *prog, const NumericFilter *filter, const char *base, int stride,
+                       int numRecords, const uint64_t *occupied, int *out) {
+#ifdef EXPR_AVX2
+  if (prog->useAvx2)
+    return pageNumericAvx2(filter, base, stride, numRecords, occupied, out);
+#endif
+  (void) prog;
+  return pageNumericScalar(filter, base, stride, numRecords, occupied, out);
+}
+
+static int evalBatchNode(CompiledExpr *prog, int index, const char *base, int stride,
+                         const int *sel, int numSel, int *out);
+
+// Row-at-a-time fallback for nodes without a batch kernel
+static int batchRows(CompiledExpr *prog, int index, const char *base, int stride,
+                     const int *sel, int numSel, int *out) {
+  int count = 0;
+  for (int i = 0; i < numSel; i++) {
+    out[count] = sel[i];
+    count += evalCompiledNode(prog, index, base + (long) sel[i] * stride);
+  }
+  return count;
+}
+
+// AND: each child from start on only sees the rows every earlier child
+// accepted. sel may be the same vector as out.
+static int batchAndFrom(CompiledExpr *prog, CompiledNode *node, int start, const char *base,
+                        int stride, const int *sel, int numSel, int *out) {
+  int *passed = pushScratch(prog, numSel);
+  const int *in = sel;
+  int count = numSel;
+
+  for (int i = start; i < node->count && count > 0; i++) {
+    int index = prog->children[node->first + i];
+    CompiledNode *child = &prog->nodes[index];
+    int numPassed = evalBatchNode(prog, index, base, stride, in, count, passed);
+
+    child->evaluated += count;
+    child->passed += numPassed;
+    memcpy(out, passed, sizeof(int) * numPassed);
+    in = out;
+    count = numPassed;
+  }
+
+  // Nothing ran: everything selected passes
+  if (in != out)
+    memmove(out, in, sizeof(int) * count);
+
+  popScratch(prog, numSel);
+  return count;
+}
+
+// OR: each child only sees the rows no earlier child accepted
+static int batchOr(CompiledExpr *prog, CompiledNode *node, const char *base, int stride,
+                   const int *sel, int numSel, int *out) {
+  int *remaining = pushScratch(prog, numSel);
+  int *passed = pushScratch(prog, numSel);
+  int *merged = pushScratch(prog, numSel);
+  int numRemaining = numSel;
+  int count = 0;
+
+  memcpy(remaining, sel, sizeof(int) * numSel);
+  for (int i = 0; i < node->count && numRemaining > 0; i++) {
+    int index = prog->children[node->first + i];
+    CompiledNode *child = &prog->nodes[index];
+    int numPassed = evalBatchNode(prog, index, base, stride, remaining, numRemaining, passed);
+
+    child->evaluated += numRemaining;
+    child->passed += numPassed;
+    if (numPassed == 0)
+      continue;
+
+    count = mergeSorted(out, count, passed, numPassed, merged);
+    memcpy(out, merged, sizeof(int) * count);
+    numRemaining = differenceSorted(remaining, numRemaining, passed, numPassed, remaining);
+  }
+
+  popScratch(prog, 3 * numSel);
+  noteEvaluations(prog, node, numSel);
+  return count;
+}
+
+static int evalBatchNode(CompiledExpr *prog, int index, const char *base, int stride,
+                         const int *sel, int numSel, int *out) {
+  CompiledNode *node = &prog->nodes[index];
+
+  switch (node->kind) {
+    case CN_AND:
+    {
+      int count = batchAndFrom(prog, node, 0, base, stride, sel, numSel, out);
+      noteEvaluations(prog, node, numSel);
+      return count;
+    }
+    case CN_OR:
+      return batchOr(prog, node, base, stride, sel, numSel, out);
+    case CN_NOT: {
+      int *passed = pushScratch(prog, numSel);
+      int numPassed = evalBatchNode(prog, node->left, base, stride, sel, numSel, passed);
+      int count = differenceSorted(sel, numSel, passed, numPassed, out);
+      popScratch(prog, numSel);
+      return count;
+    }
+    case CN_CMP:
+    case CN_BETWEEN: {
+      NumericFilter filter;
+      if (getNumericFilter(node, &filter))
+        return filterNumeric(prog, &filter, base, stride, sel, numSel, out);
+      return batchRows(prog, index, base, stride, sel, numSel, out);
+    }
+    default:
+      return batchRows(prog, index, base, stride, sel, numSel, out);
+  }
+}
+
+// Nested nodes stack their selection vectors, never more than
+// SCRATCH_VECTORS_PER_NODE per node, plus one vector for the caller
+static RC reserveScratch(CompiledExpr *prog, int numRows) {
+  int needed = (prog->numNodes * SCRATCH_VECTORS_PER_NODE + 1) * numRows;
+  if (needed > prog->scratchSize) {
+    int *scratch = (int *) realloc(prog->scratch, sizeof(int) * needed);
+    if (scratch == NULL)
+      return RC_MEM_ALLOC_FAILED;
+    prog->scratch = scratch;
+    prog->scratchSize = needed;
+  }
+  prog->scratchTop = 0;
+  return RC_OK;
+}
+
+RC evalCompiledBatch(CompiledExpr *prog, const char *base, int stride,
+                     const int *sel, int numSel, int *out, int *numOut) {
+  if (prog == NULL || sel == NULL || out == NULL || numOut == NULL)
+    return RC_FILE_HANDLE_NOT_INIT;
+
+  EXPR_CHECK(reserveScratch(prog, numSel));
+  *numOut = evalBatchNode(prog, prog->root, base, stride, sel, numSel, out);
+  return RC_OK;
+}
+
+static int countOccupied(const uint64_t *occupied, int numRecords) {
+  int count = 0;
+  for (int i = 0; i < (numRecords + 63) / 64; i++)
+    count += __builtin_popcountll(occupied[i]);
+  return count;
+}
+
+RC evalCompiledPage(CompiledExpr *prog, const char *base, int stride, int numRecords,
+                    const uint64_t *occupied, int *out, int *numOut) {
+  if (prog == NULL || occupied == NULL || out == NULL || numOut == NULL)
+    return RC_FILE_HANDLE_NOT_INIT;
+
+  EXPR_CHECK(reserveScratch(prog, numRecords));
+
+  // A numeric filter at the root, or as the first conjunct of an AND at
+  // the root, reads the occupancy bitmap itself
+  CompiledNode *root = &prog->nodes[prog->root];
+  CompiledNode *first = (root->kind == CN_AND) ? &prog->nodes[prog->children[root->first]] : root;
+  NumericFilter filter;
+  if (getNumericFilter(first, &filter)) {
+    int count = pageNumeric(prog, &filter, base, stride, numRecords, occupied, out);
+    if (first != root) {
+      int numOccupied = countOccupied(occupied, numRecords);
+      first->evaluated += numOccupied;
+      first->passed += count;
+      count = batchAndFrom(prog, root, 1, base, stride, out, count, out);
+      noteEvaluations(prog, root, numOccupied);
+    }
+    *numOut = count;
+    return RC_OK;
+  }
+
+  // Otherwise list the occupied records and evaluate them as a batch
+  int *sel = pushScratch(prog, numRecords);
+  int numSel = 0;
+  for (int word = 0; word * 64 < numRecords; word++) {
+    uint64_t bits = occupied[word];
+    while (bits != 0) {
+      int slot = word * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      if (slot < numRecords)
+        sel[numSel++] = slot;
+    }
+  }
+  *numOut = evalBatchNode(prog, prog->root, base, stride, sel, numSel, out);
+  return RC_OK;
+}
+
+static void freeCompiledOperand(CompiledOperand *operand) {
+  if (operand->kind == CO_CONST && operand->dt == DT_STRING)
+    free(operand->cons.stringV);
+}
+
+RC freeCompiledExpr(CompiledExpr *prog) {
+  if (!prog) return RC_OK;
+
+  for (int i = 0; i < prog->numNodes; i++) {
+    CompiledNode *node = &prog->nodes[i];
+    for (int j = 0; j < 3; j++)
+      freeCompiledOperand(&node->args[j]);
+    if (node->in != NULL) {
+      for (int j = 0; j < node->in->numValues; j++)
+        freeCompiledOperand(&node->in->values[j]);
+      free(node->in->values);
+      free(node->in->buckets);
+      free(node->in);
+    }
+  }
+  free(prog->nodes);
+  free(prog->children);
+  free(prog->scratch);
+  free(prog);
+  return RC_OK;
+}
+
+
 // ================== Memory Management ==================
 RC freeExpr(Expr *expr) {
     if (!expr) return RC_OK;
@@ -166,15 +1594,8 @@ RC freeExpr(Expr *expr) {
     switch (expr->type) {
         case EXPR_OP: {
             Operator *op = expr->expr.op;
-            switch (op->type) {
-                case OP_BOOL_NOT:
-                    freeExpr(op->args[0]);
-                    break;
-                default:
-                    freeExpr(op->args[0]);
-                    freeExpr(op->args[1]);
-                    break;
-            }
+            for (int i = 0; i < op->numArgs; i++)
+                freeExpr(op->args[i]);
             free(op->args);
             free(op);
             break;
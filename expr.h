@@ -1,6 +1,7 @@
 #ifndef EXPR_H
 #define EXPR_H
 
+#include <stdint.h>
 #include "dberror.h"
 #include "tables.h"
 
@@ -26,11 +27,18 @@ typedef enum OpType {
   OP_BOOL_OR,
   OP_BOOL_NOT,
   OP_COMP_EQUAL,
-  OP_COMP_SMALLER
+  OP_COMP_SMALLER,
+  OP_COMP_GREATER,
+  OP_COMP_SMALLER_EQUAL,
+  OP_COMP_GREATER_EQUAL,
+  OP_COMP_NOT_EQUAL,
+  OP_BETWEEN,     // args[0] BETWEEN args[1] AND args[2], bounds inclusive
+  OP_IN           // args[0] IN (args[1], ..., args[numArgs - 1])
 } OpType;
 
 typedef struct Operator {
   OpType type;
+  int numArgs;
   Expr **args;
 } Operator;
 
@@ -44,6 +52,30 @@ extern RC evalExpr (Record *record, Schema *schema, Expr *expr, Value **result);
 extern RC freeExpr (Expr *expr);
 extern void freeVal(Value *val);
 
+// returns a constant-folded copy of expr that the caller must free
+extern RC optimizeExpr (Expr *expr, Expr **result);
+
+// compiled expressions: an Expr lowered once against a schema and then
+// evaluated on raw record bytes without allocating. A compiled program
+// reorders its AND/OR children as it runs, so use one per thread.
+typedef struct CompiledExpr CompiledExpr;
+
+extern RC compileExpr (Expr *expr, Schema *schema, CompiledExpr **result);
+extern RC evalCompiledExpr (CompiledExpr *prog, const char *recordData, int *result);
+extern RC freeCompiledExpr (CompiledExpr *prog);
+
+// batch evaluation over records laid out stride bytes apart from base
+// (e.g. RecordBatch->data and recordSize): sel lists the numSel record
+// positions to test in ascending order, the ones that match are written
+// to out (which must not overlap sel) and counted in numOut
+extern RC evalCompiledBatch (CompiledExpr *prog, const char *base, int stride,
+                             const int *sel, int numSel, int *out, int *numOut);
+
+// like evalCompiledBatch over records 0..numRecords-1, but only for those
+// whose bit is set in the occupancy bitmap (bit i%64 of word i/64)
+extern RC evalCompiledPage (CompiledExpr *prog, const char *base, int stride, int numRecords,
+                            const uint64_t *occupied, int *out, int *numOut);
+
 
 #define CPVAL(_result,_input)						\
   do {									\
@@ -73,6 +105,7 @@ extern void freeVal(Value *val);
       _result->type = EXPR_OP;						\
       _result->expr.op = _op;						\
       _op->type = _optype;						\
+      _op->numArgs = 2;							\
       _op->args = (Expr **) malloc(2 * sizeof(Expr*));			\
       _op->args[0] = _left;						\
       _op->args[1] = _right;						\
@@ -85,10 +118,42 @@ extern void freeVal(Value *val);
     _result->type = EXPR_OP;						\
     _result->expr.op = _op;						\
     _op->type = _optype;						\
+    _op->numArgs = 1;							\
     _op->args = (Expr **) malloc(sizeof(Expr*));			\
     _op->args[0] = _input;						\
   } while (0)
 
+#define MAKE_BETWEEN_EXPR(_result,_input,_low,_high)			\
+  do {									\
+    Operator *_op = (Operator *) malloc(sizeof(Operator));		\
+    _result = (Expr *) malloc(sizeof(Expr));				\
+    _result->type = EXPR_OP;						\
+    _result->expr.op = _op;						\
+    _op->type = OP_BETWEEN;						\
+    _op->numArgs = 3;							\
+    _op->args = (Expr **) malloc(3 * sizeof(Expr*));			\
+    _op->args[0] = _input;						\
+    _op->args[1] = _low;						\
+    _op->args[2] = _high;						\
+  } while (0)
+
+// _list is an array of _count expressions; the operator takes them over
+// but not the array itself
+#define MAKE_IN_EXPR(_result,_input,_list,_count)			\
+  do {									\
+    Operator *_op = (Operator *) malloc(sizeof(Operator));		\
+    int _i;								\
+    _result = (Expr *) malloc(sizeof(Expr));				\
+    _result->type = EXPR_OP;						\
+    _result->expr.op = _op;						\
+    _op->type = OP_IN;							\
+    _op->numArgs = (_count) + 1;					\
+    _op->args = (Expr **) malloc(_op->numArgs * sizeof(Expr*));		\
+    _op->args[0] = _input;						\
+    for (_i = 0; _i < (_count); _i++)					\
+      _op->args[_i + 1] = (_list)[_i];					\
+  } while (0)
+
 #define MAKE_ATTRREF(_result,_attr)					\
   do {									\
     _result = (Expr *) malloc(sizeof(Expr));				\
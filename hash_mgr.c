@@ -0,0 +1,944 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hash_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "tables.h"
+
+// Define constants
+#define META_PAGE 0
+#define HASH_POOL_SIZE 64
+#define HASH_MAGIC 0x48415348 // "HASH"
+#define DIR_ENTRIES_PER_PAGE (PAGE_SIZE / (int)sizeof(int))
+#define HASH_MAX_DEPTH 19
+
+// Index file layout (extendible hashing):
+// Page 0 holds the HashMeta below followed by the page numbers of the
+// directory pages. The directory maps the low globalDepth bits of a key's
+// hash to a bucket page; it is kept in memory while the index is open and
+// written back on close. Every other page is a bucket page:
+// [BucketHeader][Entry 0]...[Entry maxEntries-1]
+// An entry is a RID followed by keyLength key bytes, in no particular order.
+// A full bucket splits in two on the next bit of the hash, doubling the
+// directory when its local depth reaches the global depth. Only a bucket
+// whose entries all share one hash value (duplicates of one key) cannot
+// split; it grows a chain of overflow pages instead. Pages released by a
+// split go on a free list for later overflow pages and buckets.
+
+typedef struct HashMeta {
+    int magic;          // HASH_MAGIC
+    DataType keyType;   // Type of the keys
+    int keyLength;      // Bytes per key
+    int globalDepth;    // Hash bits used by the directory
+    int numBuckets;     // Buckets in the index
+    int numEntries;     // Entries in the buckets
+    int numPages;       // Pages in the file (next new page goes here)
+    int freePage;       // First page of the free list, NO_PAGE if empty
+    int numDirPages;    // Directory pages listed after this header
+} HashMeta;
+
+#define MAX_DIR_PAGES ((PAGE_SIZE - (int)sizeof(HashMeta)) / (int)sizeof(int))
+
+typedef struct BucketHeader {
+    int localDepth;     // Hash bits shared by every key of the bucket
+    int numEntries;     // Entries in use on this page
+    int overflow;       // Next page of the bucket, NO_PAGE at the end
+    int reserved;
+} BucketHeader;
+
+typedef struct HashManager {
+    BM_BufferPool *bufferPool;
+    HashMeta meta;      // Cached copy of page 0, written on close
+    int *dirPages;      // Pages holding the directory
+    int *directory;     // Bucket page of each of the 2^globalDepth slots
+    int entrySize;      // sizeof(RID) + keyLength
+    int maxEntries;     // Entries per bucket page
+    int metaDirty;      // Whether meta or directory differ from the file
+    char *keyBuffer;    // Encoded key of the current operation
+} HashManager;
+
+typedef struct HashScanManager {
+    RID *rids;          // RIDs of the key, collected when the scan opens
+    int count;          // Number of RIDs
+    int pos;            // Next RID to return
+} HashScanManager;
+
+// Helper functions for bucket layout
+static BucketHeader *getBucketHeader(char *page) {
+    return (BucketHeader *)page;
+}
+
+static char *getEntry(HashManager *mgr, char *page, int i) {
+    return page + sizeof(BucketHeader) + (size_t)i * mgr->entrySize;
+}
+
+static char *getEntryKey(HashManager *mgr, char *page, int i) {
+    return getEntry(mgr, page, i) + sizeof(RID);
+}
+
+static RID getEntryRID(HashManager *mgr, char *page, int i) {
+    RID rid;
+    memcpy(&rid, getEntry(mgr, page, i), sizeof(RID));
+    return rid;
+}
+
+// Encode a key value the way a record stores it (strings NUL-padded)
+static RC encodeKey(HashManager *mgr, Value *key, char *dest) {
+    if (key == NULL || key->dt != mgr->meta.keyType) {
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    }
+
+    switch (key->dt) {
+        case DT_INT:
+            memcpy(dest, &key->v.intV, sizeof(int));
+            break;
+        case DT_FLOAT: {
+            // -0.0 and 0.0 are equal, so they must hash alike
+            float f = (key->v.floatV == 0.0f) ? 0.0f : key->v.floatV;
+            memcpy(dest, &f, sizeof(float));
+            break;
+        }
+        case DT_BOOL:
+            // One byte, as setAttr stores it, normalized to 0 or 1
+            memcpy(dest, &key->v.boolV, 1);
+            dest[0] = (dest[0] != 0);
+            memset(dest + 1, 0, mgr->meta.keyLength - 1);
+            break;
+        case DT_STRING: {
+            int len = strlen(key->v.stringV);
+            if (len > mgr->meta.keyLength) {
+                len = mgr->meta.keyLength;
+            }
+            memcpy(dest, key->v.stringV, len);
+            memset(dest + len, 0, mgr->meta.keyLength - len);
+            break;
+        }
+        default:
+            return RC_RM_UNKOWN_DATATYPE;
+    }
+    return RC_OK;
+}
+
+static int sameKey(HashManager *mgr, const char *left, const char *right) {
+    if (mgr->meta.keyType == DT_FLOAT) {
+        float l, r;
+        memcpy(&l, left, sizeof(float));
+        memcpy(&r, right, sizeof(float));
+        return l == r;
+    }
+    return memcmp(left, right, mgr->meta.keyLength) == 0;
+}
+
+// FNV-1a over the encoded key
+static uint32_t hashKey(HashManager *mgr, const char *key) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < mgr->meta.keyLength; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int getBucket(HashManager *mgr, uint32_t hash) {
+    return mgr->directory[hash & ((1u << mgr->meta.globalDepth) - 1)];
+}
+
+// Pin a fresh bucket page, reusing a page of the free list if there is one
+static RC allocPage(HashManager *mgr, BM_PageHandle *page, int localDepth) {
+    int pageNum = mgr->meta.freePage;
+    int reused = (pageNum != NO_PAGE);
+    if (!reused) {
+        pageNum = mgr->meta.numPages;
+    }
+
+    RC rc = pinPage(mgr->bufferPool, page, pageNum);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    if (reused) {
+        mgr->meta.freePage = getBucketHeader(page->data)->overflow;
+    } else {
+        mgr->meta.numPages++;
+    }
+    mgr->metaDirty = 1;
+
+    memset(page->data, 0, PAGE_SIZE);
+    BucketHeader *header = getBucketHeader(page->data);
+    header->localDepth = localDepth;
+    header->numEntries = 0;
+    header->overflow = NO_PAGE;
+    return markDirty(mgr->bufferPool, page);
+}
+
+// Put a page on the free list
+static RC releasePage(HashManager *mgr, int pageNum) {
+    BM_PageHandle page;
+    RC rc = pinPage(mgr->bufferPool, &page, pageNum);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    BucketHeader *header = getBucketHeader(page.data);
+    header->numEntries = 0;
+    header->overflow = mgr->meta.freePage;
+    mgr->meta.freePage = pageNum;
+    mgr->metaDirty = 1;
+
+    rc = markDirty(mgr->bufferPool, &page);
+    RC unpinResult = unpinPage(mgr->bufferPool, &page);
+    return (rc != RC_OK) ? rc : unpinResult;
+}
+
+// Write the meta page and the directory
+static RC writeMeta(HashManager *mgr) {
+    int needed = ((1 << mgr->meta.globalDepth) + DIR_ENTRIES_PER_PAGE - 1) / DIR_ENTRIES_PER_PAGE;
+    BM_PageHandle page;
+    RC rc = RC_OK;
+
+    for (int i = 0; i < needed && rc == RC_OK; i++) {
+        if (i >= mgr->meta.numDirPages) {
+            rc = allocPage(mgr, &page, 0);
+            if (rc == RC_OK) {
+                mgr->dirPages[mgr->meta.numDirPages++] = page.pageNum;
+            }
+        } else {
+            rc = pinPage(mgr->bufferPool, &page, mgr->dirPages[i]);
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        int first = i * DIR_ENTRIES_PER_PAGE;
+        int count = (1 << mgr->meta.globalDepth) - first;
+        if (count > DIR_ENTRIES_PER_PAGE) {
+            count = DIR_ENTRIES_PER_PAGE;
+        }
+        memcpy(page.data, mgr->directory + first, (size_t)count * sizeof(int));
+        rc = markDirty(mgr->bufferPool, &page);
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    rc = pinPage(mgr->bufferPool, &page, META_PAGE);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    memcpy(page.data, &mgr->meta, sizeof(HashMeta));
+    memcpy(page.data + sizeof(HashMeta), mgr->dirPages, (size_t)mgr->meta.numDirPages * sizeof(int));
+    rc = markDirty(mgr->bufferPool, &page);
+    RC unpinResult = unpinPage(mgr->bufferPool, &page);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (unpinResult == RC_OK) {
+        mgr->metaDirty = 0;
+    }
+    return unpinResult;
+}
+
+// Read the directory pages listed in the meta page
+static RC readDirectory(HashManager *mgr) {
+    int size = 1 << mgr->meta.globalDepth;
+    BM_PageHandle page;
+
+    for (int i = 0; i < mgr->meta.numDirPages; i++) {
+        int first = i * DIR_ENTRIES_PER_PAGE;
+        int count = size - first;
+        if (count <= 0) {
+            break;
+        }
+        if (count > DIR_ENTRIES_PER_PAGE) {
+            count = DIR_ENTRIES_PER_PAGE;
+        }
+
+        RC rc = pinPage(mgr->bufferPool, &page, mgr->dirPages[i]);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        memcpy(mgr->directory + first, page.data, (size_t)count * sizeof(int));
+        rc = unpinPage(mgr->bufferPool, &page);
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
+// Create a hash index in its own page file
+RC createHashIndex(char *idxId, DataType keyType, int keyLength) {
+    if (idxId == NULL || keyLength <= 0) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (keyType != DT_INT && keyType != DT_FLOAT && keyType != DT_BOOL && keyType != DT_STRING) {
+        return RC_RM_UNKOWN_DATATYPE;
+    }
+    if ((int)sizeof(BucketHeader) + 2 * ((int)sizeof(RID) + keyLength) > PAGE_SIZE) {
+        return RC_IM_N_TO_LAGE;
+    }
+
+    RC rc = createPageFile(idxId);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    HashManager mgr;
+    int directory[1];
+    int dirPages[MAX_DIR_PAGES];
+    memset(&mgr, 0, sizeof(HashManager));
+    mgr.bufferPool = MAKE_POOL();
+    mgr.directory = directory;
+    mgr.dirPages = dirPages;
+    rc = initBufferPool(mgr.bufferPool, idxId, HASH_POOL_SIZE, RS_LRU, NULL);
+    if (rc != RC_OK) {
+        free(mgr.bufferPool);
+        return rc;
+    }
+
+    // Meta page plus a single empty bucket of depth 0
+    mgr.meta.magic = HASH_MAGIC;
+    mgr.meta.keyType = keyType;
+    mgr.meta.keyLength = keyLength;
+    mgr.meta.globalDepth = 0;
+    mgr.meta.numBuckets = 1;
+    mgr.meta.numEntries = 0;
+    mgr.meta.numPages = 1;
+    mgr.meta.freePage = NO_PAGE;
+    mgr.meta.numDirPages = 0;
+
+    BM_PageHandle page;
+    rc = allocPage(&mgr, &page, 0);
+    if (rc == RC_OK) {
+        directory[0] = page.pageNum;
+        rc = unpinPage(mgr.bufferPool, &page);
+    }
+    if (rc == RC_OK) {
+        rc = writeMeta(&mgr);
+    }
+
+    RC shutdownResult = shutdownBufferPool(mgr.bufferPool);
+    free(mgr.bufferPool);
+    return (rc != RC_OK) ? rc : shutdownResult;
+}
+
+// Open a hash index
+RC openHashIndex(HashIndexHandle **index, char *idxId) {
+    if (index == NULL || idxId == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // Check the file exists before the buffer pool creates it
+    FILE *file = fopen(idxId, "rb");
+    if (file == NULL) {
+        return RC_FILE_NOT_FOUND;
+    }
+    fclose(file);
+
+    HashManager *mgr = (HashManager *)calloc(1, sizeof(HashManager));
+    HashIndexHandle *handle = (HashIndexHandle *)malloc(sizeof(HashIndexHandle));
+    BM_BufferPool *bm = MAKE_POOL();
+    if (mgr == NULL || handle == NULL || bm == NULL) {
+        free(mgr);
+        free(handle);
+        free(bm);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RC rc = initBufferPool(bm, idxId, HASH_POOL_SIZE, RS_LRU, NULL);
+    if (rc != RC_OK) {
+        free(mgr);
+        free(handle);
+        free(bm);
+        return rc;
+    }
+    mgr->bufferPool = bm;
+
+    BM_PageHandle page;
+    rc = pinPage(bm, &page, META_PAGE);
+    if (rc == RC_OK) {
+        memcpy(&mgr->meta, page.data, sizeof(HashMeta));
+        if (mgr->meta.magic != HASH_MAGIC || mgr->meta.globalDepth < 0 ||
+                mgr->meta.globalDepth > HASH_MAX_DEPTH ||
+                mgr->meta.numDirPages < 0 || mgr->meta.numDirPages > MAX_DIR_PAGES ||
+                mgr->meta.numDirPages * DIR_ENTRIES_PER_PAGE < (1 << mgr->meta.globalDepth)) {
+            rc = RC_FILE_HANDLE_NOT_INIT;
+        } else {
+            mgr->dirPages = (int *)malloc(sizeof(int) * MAX_DIR_PAGES);
+            mgr->directory = (int *)malloc(sizeof(int) * ((size_t)1 << mgr->meta.globalDepth));
+            mgr->keyBuffer = (char *)malloc(mgr->meta.keyLength);
+            if (mgr->dirPages == NULL || mgr->directory == NULL || mgr->keyBuffer == NULL) {
+                rc = RC_MEM_ALLOC_FAILED;
+            } else {
+                memcpy(mgr->dirPages, page.data + sizeof(HashMeta),
+                       (size_t)mgr->meta.numDirPages * sizeof(int));
+            }
+        }
+        RC unpinResult = unpinPage(bm, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+    if (rc == RC_OK) {
+        rc = readDirectory(mgr);
+    }
+    if (rc != RC_OK) {
+        shutdownBufferPool(bm);
+        free(bm);
+        free(mgr->dirPages);
+        free(mgr->directory);
+        free(mgr->keyBuffer);
+        free(mgr);
+        free(handle);
+        return rc;
+    }
+
+    mgr->entrySize = (int)sizeof(RID) + mgr->meta.keyLength;
+    mgr->maxEntries = (PAGE_SIZE - (int)sizeof(BucketHeader)) / mgr->entrySize;
+
+    handle->keyType = mgr->meta.keyType;
+    handle->idxId = (char *)malloc(strlen(idxId) + 1);
+    if (handle->idxId != NULL) {
+        strcpy(handle->idxId, idxId);
+    }
+    handle->mgmtData = mgr;
+
+    *index = handle;
+    return RC_OK;
+}
+
+// Close a hash index, writing back its directory and pages
+RC closeHashIndex(HashIndexHandle *index) {
+    if (index == NULL || index->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashManager *mgr = (HashManager *)index->mgmtData;
+    RC rc = mgr->metaDirty ? writeMeta(mgr) : RC_OK;
+    RC shutdownResult = shutdownBufferPool(mgr->bufferPool);
+
+    free(mgr->bufferPool);
+    free(mgr->dirPages);
+    free(mgr->directory);
+    free(mgr->keyBuffer);
+    free(mgr);
+    free(index->idxId);
+    free(index);
+    return (rc != RC_OK) ? rc : shutdownResult;
+}
+
+// Delete a hash index
+RC deleteHashIndex(char *idxId) {
+    return destroyPageFile(idxId);
+}
+
+// Access information about a hash index
+RC getNumBuckets(HashIndexHandle *index, int *result) {
+    if (index == NULL || index->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    *result = ((HashManager *)index->mgmtData)->meta.numBuckets;
+    return RC_OK;
+}
+
+RC getNumHashEntries(HashIndexHandle *index, int *result) {
+    if (index == NULL || index->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    *result = ((HashManager *)index->mgmtData)->meta.numEntries;
+    return RC_OK;
+}
+
+// Find the first entry of the bucket chain starting at pageNum that has
+// the given key (and rid, unless rid is NULL). *found is NO_PAGE if none.
+static RC seekEntry(HashManager *mgr, int pageNum, const char *key, const RID *rid,
+                    int *found, int *pos) {
+    BM_PageHandle page;
+
+    *found = NO_PAGE;
+    while (pageNum != NO_PAGE) {
+        RC rc = pinPage(mgr->bufferPool, &page, pageNum);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        BucketHeader *header = getBucketHeader(page.data);
+        for (int i = 0; i < header->numEntries; i++) {
+            if (!sameKey(mgr, getEntryKey(mgr, page.data, i), key)) {
+                continue;
+            }
+            RID entryRid = getEntryRID(mgr, page.data, i);
+            if (rid == NULL || (entryRid.page == rid->page && entryRid.slot == rid->slot)) {
+                *found = pageNum;
+                *pos = i;
+                return unpinPage(mgr->bufferPool, &page);
+            }
+        }
+
+        int next = header->overflow;
+        rc = unpinPage(mgr->bufferPool, &page);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        pageNum = next;
+    }
+    return RC_OK;
+}
+
+// Find the RID of an entry of a key
+RC findHashKey(HashIndexHandle *index, Value *key, RID *result) {
+    if (index == NULL || index->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashManager *mgr = (HashManager *)index->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    int found, pos;
+    rc = seekEntry(mgr, getBucket(mgr, hashKey(mgr, mgr->keyBuffer)), mgr->keyBuffer, NULL, &found, &pos);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (found == NO_PAGE) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    BM_PageHandle page;
+    rc = pinPage(mgr->bufferPool, &page, found);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    *result = getEntryRID(mgr, page.data, pos);
+    return unpinPage(mgr->bufferPool, &page);
+}
+
+// Read every entry of a bucket chain into one array, and put its
+// overflow pages on the free list
+static RC drainChain(HashManager *mgr, int bucket, char **entries, int *count) {
+    BM_PageHandle page;
+    int capacity = mgr->maxEntries;
+    int pageNum = bucket;
+
+    *count = 0;
+    *entries = (char *)malloc((size_t)capacity * mgr->entrySize);
+    if (*entries == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    while (pageNum != NO_PAGE) {
+        RC rc = pinPage(mgr->bufferPool, &page, pageNum);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        BucketHeader *header = getBucketHeader(page.data);
+        if (*count + header->numEntries > capacity) {
+            capacity = 2 * capacity + header->numEntries;
+            char *grown = (char *)realloc(*entries, (size_t)capacity * mgr->entrySize);
+            if (grown == NULL) {
+                unpinPage(mgr->bufferPool, &page);
+                return RC_MEM_ALLOC_FAILED;
+            }
+            *entries = grown;
+        }
+        memcpy(*entries + (size_t)*count * mgr->entrySize, getEntry(mgr, page.data, 0),
+               (size_t)header->numEntries * mgr->entrySize);
+        *count += header->numEntries;
+
+        int next = header->overflow;
+        if (pageNum == bucket) {
+            header->numEntries = 0;
+            header->overflow = NO_PAGE;
+            rc = markDirty(mgr->bufferPool, &page);
+        }
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+        if (rc == RC_OK && pageNum != bucket) {
+            rc = releasePage(mgr, pageNum);
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+        pageNum = next;
+    }
+    return RC_OK;
+}
+
+// Write entries into the empty bucket page pageNum, chaining overflow
+// pages as they fill up
+static RC fillChain(HashManager *mgr, int pageNum, int localDepth, const char *entries, int count) {
+    BM_PageHandle page;
+    RC rc = pinPage(mgr->bufferPool, &page, pageNum);
+
+    while (rc == RC_OK) {
+        int n = (count < mgr->maxEntries) ? count : mgr->maxEntries;
+        BucketHeader *header = getBucketHeader(page.data);
+        header->localDepth = localDepth;
+        header->numEntries = n;
+        memcpy(getEntry(mgr, page.data, 0), entries, (size_t)n * mgr->entrySize);
+        entries += (size_t)n * mgr->entrySize;
+        count -= n;
+
+        BM_PageHandle next;
+        RC nextResult = RC_OK;
+        if (count > 0) {
+            nextResult = allocPage(mgr, &next, localDepth);
+            header->overflow = (nextResult == RC_OK) ? next.pageNum : NO_PAGE;
+        }
+
+        rc = markDirty(mgr->bufferPool, &page);
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (rc == RC_OK) {
+            rc = (nextResult != RC_OK) ? nextResult : unpinResult;
+        }
+        if (count == 0 || nextResult != RC_OK) {
+            break;
+        }
+        if (rc != RC_OK) {
+            unpinPage(mgr->bufferPool, &next);
+            break;
+        }
+        page = next;
+    }
+    return rc;
+}
+
+// Split a full bucket of the given local depth on the next hash bit
+static RC splitBucket(HashManager *mgr, int bucket, int localDepth) {
+    // Double the directory when it has no bit left to tell the halves apart
+    if (localDepth == mgr->meta.globalDepth) {
+        size_t size = (size_t)1 << mgr->meta.globalDepth;
+        int *grown = (int *)realloc(mgr->directory, 2 * size * sizeof(int));
+        if (grown == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        memcpy(grown + size, grown, size * sizeof(int));
+        mgr->directory = grown;
+        mgr->meta.globalDepth++;
+        mgr->metaDirty = 1;
+    }
+
+    char *entries = NULL;
+    int count;
+    RC rc = drainChain(mgr, bucket, &entries, &count);
+
+    // Partition the entries on bit localDepth of their hash
+    char *upper = NULL;
+    int lowerCount = 0, upperCount = 0;
+    if (rc == RC_OK) {
+        upper = (char *)malloc((size_t)(count > 0 ? count : 1) * mgr->entrySize);
+        if (upper == NULL) {
+            rc = RC_MEM_ALLOC_FAILED;
+        }
+    }
+    if (rc == RC_OK) {
+        for (int i = 0; i < count; i++) {
+            char *entry = entries + (size_t)i * mgr->entrySize;
+            if ((hashKey(mgr, entry + sizeof(RID)) >> localDepth) & 1u) {
+                memcpy(upper + (size_t)upperCount++ * mgr->entrySize, entry, mgr->entrySize);
+            } else {
+                memmove(entries + (size_t)lowerCount++ * mgr->entrySize, entry, mgr->entrySize);
+            }
+        }
+    }
+
+    BM_PageHandle page;
+    int sibling = NO_PAGE;
+    if (rc == RC_OK) {
+        rc = allocPage(mgr, &page, localDepth + 1);
+    }
+    if (rc == RC_OK) {
+        sibling = page.pageNum;
+        rc = unpinPage(mgr->bufferPool, &page);
+    }
+    if (rc == RC_OK) {
+        rc = fillChain(mgr, bucket, localDepth + 1, entries, lowerCount);
+    }
+    if (rc == RC_OK) {
+        rc = fillChain(mgr, sibling, localDepth + 1, upper, upperCount);
+    }
+    free(entries);
+    free(upper);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    // Directory slots of the old bucket with the new bit set move over
+    int size = 1 << mgr->meta.globalDepth;
+    for (int i = 0; i < size; i++) {
+        if (mgr->directory[i] == bucket && ((i >> localDepth) & 1)) {
+            mgr->directory[i] = sibling;
+        }
+    }
+    mgr->meta.numBuckets++;
+    mgr->metaDirty = 1;
+    return RC_OK;
+}
+
+// Whether every entry of a bucket chain has the given hash, so that no
+// split could separate them
+static RC isUniformChain(HashManager *mgr, int pageNum, uint32_t hash, int *uniform) {
+    BM_PageHandle page;
+
+    *uniform = 1;
+    while (pageNum != NO_PAGE && *uniform) {
+        RC rc = pinPage(mgr->bufferPool, &page, pageNum);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        BucketHeader *header = getBucketHeader(page.data);
+        for (int i = 0; i < header->numEntries && *uniform; i++) {
+            *uniform = hashKey(mgr, getEntryKey(mgr, page.data, i)) == hash;
+        }
+
+        int next = header->overflow;
+        rc = unpinPage(mgr->bufferPool, &page);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        pageNum = next;
+    }
+    return RC_OK;
+}
+
+// Insert the entry (key, rid)
+RC insertHashKey(HashIndexHandle *index, Value *key, RID rid) {
+    if (index == NULL || index->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashManager *mgr = (HashManager *)index->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    uint32_t hash = hashKey(mgr, mgr->keyBuffer);
+
+    int found, pos;
+    rc = seekEntry(mgr, getBucket(mgr, hash), mgr->keyBuffer, &rid, &found, &pos);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (found != NO_PAGE) {
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    BM_PageHandle page;
+    while (1) {
+        int bucket = getBucket(mgr, hash);
+        int pageNum = bucket, localDepth = 0;
+
+        // Take the first page of the chain with room left
+        while (1) {
+            rc = pinPage(mgr->bufferPool, &page, pageNum);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            BucketHeader *header = getBucketHeader(page.data);
+            if (pageNum == bucket) {
+                localDepth = header->localDepth;
+            }
+            if (header->numEntries < mgr->maxEntries || header->overflow == NO_PAGE) {
+                break;
+            }
+            int next = header->overflow;
+            rc = unpinPage(mgr->bufferPool, &page);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            pageNum = next;
+        }
+
+        BucketHeader *header = getBucketHeader(page.data);
+        if (header->numEntries < mgr->maxEntries) {
+            char *entry = getEntry(mgr, page.data, header->numEntries);
+            memcpy(entry, &rid, sizeof(RID));
+            memcpy(entry + sizeof(RID), mgr->keyBuffer, mgr->meta.keyLength);
+            header->numEntries++;
+            mgr->meta.numEntries++;
+            mgr->metaDirty = 1;
+
+            rc = markDirty(mgr->bufferPool, &page);
+            RC unpinResult = unpinPage(mgr->bufferPool, &page);
+            return (rc != RC_OK) ? rc : unpinResult;
+        }
+
+        // The whole chain is full: split it, unless splitting cannot help
+        int uniform = 1;
+        if (localDepth < HASH_MAX_DEPTH) {
+            rc = isUniformChain(mgr, bucket, hash, &uniform);
+        }
+        if (rc == RC_OK && !uniform) {
+            rc = unpinPage(mgr->bufferPool, &page);
+            if (rc == RC_OK) {
+                rc = splitBucket(mgr, bucket, localDepth);
+            }
+            if (rc != RC_OK) {
+                return rc;
+            }
+            continue;
+        }
+
+        BM_PageHandle overflow;
+        if (rc == RC_OK) {
+            rc = allocPage(mgr, &overflow, localDepth);
+        }
+        if (rc == RC_OK) {
+            header->overflow = overflow.pageNum;
+            rc = markDirty(mgr->bufferPool, &page);
+            unpinPage(mgr->bufferPool, &overflow);
+        }
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+}
+
+// Delete the entry (key, rid)
+RC deleteHashEntry(HashIndexHandle *index, Value *key, RID rid) {
+    if (index == NULL || index->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashManager *mgr = (HashManager *)index->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    int found, pos;
+    rc = seekEntry(mgr, getBucket(mgr, hashKey(mgr, mgr->keyBuffer)), mgr->keyBuffer, &rid, &found, &pos);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (found == NO_PAGE) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    // Entries are unordered, so the last one of the page fills the gap
+    BM_PageHandle page;
+    rc = pinPage(mgr->bufferPool, &page, found);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    BucketHeader *header = getBucketHeader(page.data);
+    header->numEntries--;
+    if (pos != header->numEntries) {
+        memcpy(getEntry(mgr, page.data, pos), getEntry(mgr, page.data, header->numEntries), mgr->entrySize);
+    }
+    mgr->meta.numEntries--;
+    mgr->metaDirty = 1;
+
+    rc = markDirty(mgr->bufferPool, &page);
+    RC unpinResult = unpinPage(mgr->bufferPool, &page);
+    return (rc != RC_OK) ? rc : unpinResult;
+}
+
+// Collect the RIDs of every entry of a key
+RC openHashScan(HashIndexHandle *index, Value *key, HI_ScanHandle **handle) {
+    if (index == NULL || index->mgmtData == NULL || handle == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashManager *mgr = (HashManager *)index->mgmtData;
+    RC rc = encodeKey(mgr, key, mgr->keyBuffer);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    HI_ScanHandle *scan = (HI_ScanHandle *)malloc(sizeof(HI_ScanHandle));
+    HashScanManager *scanMgr = (HashScanManager *)calloc(1, sizeof(HashScanManager));
+    if (scan == NULL || scanMgr == NULL) {
+        free(scan);
+        free(scanMgr);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    BM_PageHandle page;
+    int capacity = 0;
+    int pageNum = getBucket(mgr, hashKey(mgr, mgr->keyBuffer));
+    while (rc == RC_OK && pageNum != NO_PAGE) {
+        rc = pinPage(mgr->bufferPool, &page, pageNum);
+        if (rc != RC_OK) {
+            break;
+        }
+
+        BucketHeader *header = getBucketHeader(page.data);
+        for (int i = 0; i < header->numEntries && rc == RC_OK; i++) {
+            if (!sameKey(mgr, getEntryKey(mgr, page.data, i), mgr->keyBuffer)) {
+                continue;
+            }
+            if (scanMgr->count == capacity) {
+                capacity = (capacity == 0) ? 8 : 2 * capacity;
+                RID *grown = (RID *)realloc(scanMgr->rids, (size_t)capacity * sizeof(RID));
+                if (grown == NULL) {
+                    rc = RC_MEM_ALLOC_FAILED;
+                    break;
+                }
+                scanMgr->rids = grown;
+            }
+            scanMgr->rids[scanMgr->count++] = getEntryRID(mgr, page.data, i);
+        }
+
+        pageNum = header->overflow;
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+    if (rc != RC_OK) {
+        free(scanMgr->rids);
+        free(scanMgr);
+        free(scan);
+        return rc;
+    }
+
+    scan->index = index;
+    scan->mgmtData = scanMgr;
+    *handle = scan;
+    return RC_OK;
+}
+
+RC nextHashEntry(HI_ScanHandle *handle, RID *result) {
+    if (handle == NULL || handle->mgmtData == NULL || result == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashScanManager *scanMgr = (HashScanManager *)handle->mgmtData;
+    if (scanMgr->pos >= scanMgr->count) {
+        return RC_IM_NO_MORE_ENTRIES;
+    }
+    *result = scanMgr->rids[scanMgr->pos++];
+    return RC_OK;
+}
+
+RC closeHashScan(HI_ScanHandle *handle) {
+    if (handle == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    HashScanManager *scanMgr = (HashScanManager *)handle->mgmtData;
+    if (scanMgr != NULL) {
+        free(scanMgr->rids);
+        free(scanMgr);
+    }
+    free(handle);
+    return RC_OK;
+}
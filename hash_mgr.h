@@ -0,0 +1,44 @@
+#ifndef HASH_MGR_H
+#define HASH_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// structure for accessing hash indexes
+typedef struct HashIndexHandle {
+	DataType keyType;
+	char *idxId;
+	void *mgmtData;
+} HashIndexHandle;
+
+typedef struct HI_ScanHandle {
+	HashIndexHandle *index;
+	void *mgmtData;
+} HI_ScanHandle;
+
+// create, destroy, open, and close an extendible hash index
+// keyLength is the size of a key in bytes (typeLength for DT_STRING keys);
+// INT, FLOAT, BOOL and STRING keys are supported
+extern RC createHashIndex (char *idxId, DataType keyType, int keyLength);
+extern RC openHashIndex (HashIndexHandle **index, char *idxId);
+extern RC closeHashIndex (HashIndexHandle *index);
+extern RC deleteHashIndex (char *idxId);
+
+// access information about a hash index
+extern RC getNumBuckets (HashIndexHandle *index, int *result);
+extern RC getNumHashEntries (HashIndexHandle *index, int *result);
+
+// index access: entries are unordered (key, RID) pairs, and a key may
+// occur with several RIDs. findHashKey returns the RID of one entry of a
+// key, deleteHashEntry removes one exact pair.
+extern RC findHashKey (HashIndexHandle *index, Value *key, RID *result);
+extern RC insertHashKey (HashIndexHandle *index, Value *key, RID rid);
+extern RC deleteHashEntry (HashIndexHandle *index, Value *key, RID rid);
+
+// iterate over the RIDs of all entries of one key; nextHashEntry returns
+// RC_IM_NO_MORE_ENTRIES after the last one
+extern RC openHashScan (HashIndexHandle *index, Value *key, HI_ScanHandle **handle);
+extern RC nextHashEntry (HI_ScanHandle *handle, RID *result);
+extern RC closeHashScan (HI_ScanHandle *handle);
+
+#endif // HASH_MGR_H
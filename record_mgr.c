@@ -2,22 +2,104 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include "record_mgr.h"
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include "dberror.h"
 #include "expr.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
 #include "tables.h"
 
 // Define constants
 #define PAGE_SIZE 4096
 #define HEADER_PAGE 0
 #define DATA_START_PAGE 1
+#define TABLE_POOL_SIZE 10000
+#define BULK_EXTENT_PAGES 64
+#define PARALLEL_MORSEL_PAGES 16
+#define INDEX_SCAN_SELECTIVITY 10
+#define ZONE_STRING_MAX 15
+#define ZONE_MAP_MAGIC 0x5A4D4150 // "ZMAP"
+#define ZONE_MAP_SUFFIX ".zm"
+#define PRIMARY_INDEX_SUFFIX ".pk"
+#define HASH_INDEX_SUFFIX ".hx"
+#define BLOOM_MAGIC 0x424C4F4D // "BLOM"
+#define BLOOM_SUFFIX ".bf"
+#define BLOOM_BITS_PER_KEY 10
+#define BLOOM_NUM_HASHES 7
+#define BLOOM_MIN_KEYS 1024
+#define BLOOM_MAX_KEYS (INT_MAX / 64 * 64 / BLOOM_BITS_PER_KEY)
+#define FORWARD_MAGIC 0x46574D50 // "FWMP"
+#define FORWARD_SUFFIX ".fw"
+
+// Zone maps:
+// For every data page, the smallest and largest value of each INT, FLOAT
+// and short STRING attribute stored on it. Bounds only ever widen (a
+// delete leaves them as they are), so they may be loose but never wrong.
+typedef union ZoneValue {
+    int intV;
+    float floatV;
+    char stringV[ZONE_STRING_MAX + 1]; // NUL-terminated
+} ZoneValue;
+
+typedef struct ZoneEntry {
+    ZoneValue min;
+    ZoneValue max;
+} ZoneEntry;
+
+typedef struct ZoneMap {
+    int numAttrs;         // Number of summarized attributes
+    int *attrs;           // Schema positions of the summarized attributes
+    int numPages;         // Pages covered (indexed by page number)
+    int capacity;         // Pages allocated
+    int *populated;       // Whether a record was ever stored on the page
+    ZoneEntry *entries;   // numAttrs entries per page
+} ZoneMap;
+
+// Bloom filter:
+// Every table with a key keeps a Bloom filter over the key values of its
+// records, so that probing for a key that is not there (a uniqueness
+// check, lookupRecord() or a scan with key = constant) reads no page.
+// Keys are only ever added: a delete leaves its bits set, so the filter
+// may answer "maybe" for an absent key but never "no" for a present one.
+// Once more keys were added than it was sized for, the filter is rebuilt
+// from the pages at twice the table's size, up to BLOOM_MAX_KEYS keys so
+// that numBits fits an int; a filter of that size is kept however many
+// keys it gets. It is saved to <table>.bf on close, like the zone map.
+typedef struct BloomFilter {
+    int numBits;          // Size of the bit array (a multiple of 64)
+    int capacity;         // Keys the filter was sized for
+    int numKeys;          // Keys added since the filter was built
+    uint64_t *bits;       // numBits / 64 words
+} BloomFilter;
+
+// RID forwarding:
+// vacuumTable() moves records to other slots. The old RID of a moved
+// record keeps resolving to it through a forwarding entry until the
+// record is deleted or a new record is stored in its old slot. The
+// entries are kept in <table>.fw.
+typedef struct RIDForward {
+    RID from;             // Where the record was
+    RID to;               // Where it is now
+} RIDForward;
 
 // Record Manager data structures
 typedef struct RecordManager {
     BM_BufferPool *bufferPool;
     int numTuples;
+    ZoneMap *zoneMap;     // Per-page min/max summaries (NULL: none)
+    BloomFilter *bloom;   // Filter over the key values (NULL: none)
+    RIDForward *forwards; // Forwarding entries, sorted by from
+    int numForwards;      // Number of entries in forwards
+    BTreeHandle *primaryIndex; // B+-tree on the key attribute (NULL: none)
+    HashIndexHandle **hashIndexes; // Hash index per attribute (NULL: none)
+    char *keyString;      // Buffer for string keys passed to the indexes
+    int openScans;        // Scans and parallel scans started and not closed
 } RecordManager;
 
 typedef struct TableMetadata {
@@ -31,48 +113,169 @@ typedef struct TableMetadata {
 typedef struct ScanManager {
     RID currentRID;      // Current record being scanned
     Expr *condition;     // Scan condition
+    Expr *optimized;     // Optimized copy of the condition owned by the scan
+    CompiledExpr *program; // Compiled condition (NULL: interpret condition)
     bool scanActive;     // Indicates if scan is active
     int currentPage;     // Current page being scanned
     int currentSlot;     // Current slot being scanned
     int totalPages;      // Total pages in the table
     int slotsPerPage;    // Slots per page
+    int recordSize;      // Size of each record
+    int mapSize;         // Size of the slot bitmap on each page
+    BM_PageHandle page;  // Page the cursor is positioned on
+    bool pagePinned;     // Whether page is currently pinned
+    bool zeroCopy;       // Return records pointing into the pinned page
+    Schema *projSchema;  // Schema of projected records (NULL: whole records)
+    int *projOffsets;    // Offset of each projected attribute in the full record
+    int *projSizes;      // Size of each projected attribute
+    int projRecordSize;  // Size of a projected record
+    int *selection;      // Slots of the pinned page that match the condition
+    int selCount;        // Number of entries in selection
+    int selPos;          // Next entry of selection to return
+    RID *indexRids;      // Candidates from an index, in page order (NULL: heap scan)
+    int indexCount;      // Number of entries in indexRids
+    int indexPos;        // Next entry of indexRids to visit
+    int limit;           // Most records to return (0: no limit)
+    int returned;        // Records returned so far
+    int topK;            // Return only the topK best records by orderAttr (0: all)
+    int orderAttr;       // Attribute ranking records for topK
+    bool descending;     // Largest values rank first
+    char *topEntries;    // Best candidates, each a RID followed by the record
+    int topCount;        // Number of entries in topEntries
+    int topCapacity;     // Entries allocated
+    int topPos;          // Next entry of topEntries to return (-1: not collected yet)
 } ScanManager;
 
+typedef struct BulkLoadManager {
+    SM_FileHandle fileHandle; // Direct handle on the page file, bypassing the pool
+    TableMetadata metadata;   // Header contents, written once on finish
+    char *staging;            // BULK_EXTENT_PAGES pages being filled
+    int extentStart;          // Page number of the first staged page
+    int stagedPages;          // Pages in use in the staging buffer
+    int currentSlot;          // Next free slot on the last staged page
+    int numLoaded;            // Records loaded so far
+    char *keys;               // Key attributes of each loaded record, packed (NULL: not kept)
+    uint64_t *keyHashes;      // hashRecordKey() of each loaded key
+    int keyLength;            // Bytes per packed key
+    int keyCapacity;          // Keys allocated
+    int *keySlots;            // Open addressing table of key numbers (-1: empty)
+    int numKeySlots;          // Power of two, more than twice numLoaded
+} BulkLoadManager;
+
 // Page Layout:
 // Each data page has the following structure:
-// [SlotBitmap][Record1][Record2]...[RecordN]
-// SlotBitmap: Bit array to track occupied slots (1=occupied, 0=free)
+// [PageHeader][SlotBitmap][Record1][Record2]...[RecordN]
+// PageHeader: occupancy count and next-free hint of the page
+// SlotBitmap: Bit array to track occupied slots (1=occupied, 0=free),
+// stored as 64-bit words so slots are searched a word at a time
+typedef struct PageHeader {
+    int numOccupied;      // Number of occupied slots on the page
+    int nextFreeHint;     // Every slot below this one is occupied
+} PageHeader;
+
+#define PAGE_HEADER_SIZE ((int)sizeof(PageHeader))
 
 // Helper functions for page operations
 static int getSlotMapSize(int slotsPerPage) {
-    // Calculate size of bitmap in bytes (rounded up to nearest byte)
-    return (slotsPerPage + 7) / 8;
+    // Calculate size of bitmap in bytes (rounded up to whole 64-bit words)
+    return ((slotsPerPage + 63) / 64) * (int)sizeof(uint64_t);
 }
 
 static int getRecordOffset(int slotNum, int recordSize, int mapSize) {
     // Calculate offset of a record in a page
-    return mapSize + (slotNum * recordSize);
+    return PAGE_HEADER_SIZE + mapSize + (slotNum * recordSize);
+}
+
+static PageHeader *getPageHeader(char *pageData) {
+    return (PageHeader *)pageData;
+}
+
+static uint64_t *getSlotMap(char *pageData) {
+    return (uint64_t *)(pageData + PAGE_HEADER_SIZE);
 }
 
 static bool isSlotOccupied(char *pageData, int slotNum) {
     // Check if a slot is marked as occupied in the bitmap
-    int bytePos = slotNum / 8;
-    int bitPos = slotNum % 8;
-    return (pageData[bytePos] & (1 << bitPos)) != 0;
+    uint64_t word = getSlotMap(pageData)[slotNum / 64];
+    return (word >> (slotNum % 64)) & 1;
 }
 
 static void markSlotOccupied(char *pageData, int slotNum) {
-    // Mark a slot as occupied in the bitmap
-    int bytePos = slotNum / 8;
-    int bitPos = slotNum % 8;
-    pageData[bytePos] |= (1 << bitPos);
+    // Mark a slot as occupied in the bitmap and count it
+    PageHeader *header = getPageHeader(pageData);
+    getSlotMap(pageData)[slotNum / 64] |= (uint64_t)1 << (slotNum % 64);
+    header->numOccupied++;
+    if (header->nextFreeHint == slotNum) {
+        header->nextFreeHint = slotNum + 1;
+    }
 }
 
 static void markSlotFree(char *pageData, int slotNum) {
-    // Mark a slot as free in the bitmap
-    int bytePos = slotNum / 8;
-    int bitPos = slotNum % 8;
-    pageData[bytePos] &= ~(1 << bitPos);
+    // Mark a slot as free in the bitmap and lower the hint to it
+    PageHeader *header = getPageHeader(pageData);
+    getSlotMap(pageData)[slotNum / 64] &= ~((uint64_t)1 << (slotNum % 64));
+    header->numOccupied--;
+    if (slotNum < header->nextFreeHint) {
+        header->nextFreeHint = slotNum;
+    }
+}
+
+// First free slot of a page, or -1 when the page is full
+static int findFreeSlotInPage(char *pageData, int slotsPerPage) {
+    PageHeader *header = getPageHeader(pageData);
+    if (header->numOccupied >= slotsPerPage) {
+        return -1;
+    }
+
+    uint64_t *map = getSlotMap(pageData);
+    int start = header->nextFreeHint;
+    for (int w = start / 64; w * 64 < slotsPerPage; w++) {
+        uint64_t vacant = ~map[w];
+        if (w == start / 64) {
+            vacant &= ~(uint64_t)0 << (start % 64);
+        }
+        if (vacant != 0) {
+            int slot = w * 64 + __builtin_ctzll(vacant);
+            return (slot < slotsPerPage) ? slot : -1;
+        }
+    }
+    return -1;
+}
+
+// First occupied slot at or after fromSlot, or -1 when there is none
+static int nextOccupiedSlot(char *pageData, int slotsPerPage, int fromSlot) {
+    uint64_t *map = getSlotMap(pageData);
+    for (int w = fromSlot / 64; w * 64 < slotsPerPage; w++) {
+        uint64_t used = map[w];
+        if (w == fromSlot / 64) {
+            used &= ~(uint64_t)0 << (fromSlot % 64);
+        }
+        if (used != 0) {
+            int slot = w * 64 + __builtin_ctzll(used);
+            return (slot < slotsPerPage) ? slot : -1;
+        }
+    }
+    return -1;
+}
+
+// Helper functions for attribute layout
+static int getAttrSize(Schema *schema, int attrNum) {
+    switch (schema->dataTypes[attrNum]) {
+        case DT_INT:
+            return sizeof(int);
+        case DT_FLOAT:
+            return sizeof(float);
+        case DT_BOOL:
+            return sizeof(bool);
+        case DT_STRING:
+            return schema->typeLength[attrNum];
+    }
+    return 0;
+}
+
+// Offset of an attribute within a record
+int getAttrOffset(Schema *schema, int attrNum) {
+    return schema->attrOffsets[attrNum];
 }
 
 // Helper functions for metadata operations
@@ -213,15 +416,12 @@ static RC findFreeSlot(BM_BufferPool *bm, TableMetadata *metadata, RID *rid) {
             return pinResult;
         }
         
-        // Check each slot in the page
-        for (int i = 0; i < metadata->slotsPerPage; i++) {
-            if (!isSlotOccupied(pageHandle->data, i)) {
-                // Found a free slot
-                rid->page = currentPage;
-                rid->slot = i;
-                found = true;
-                break;
-            }
+        // A full page is skipped on its occupancy count alone
+        int slot = findFreeSlotInPage(pageHandle->data, metadata->slotsPerPage);
+        if (slot >= 0) {
+            rid->page = currentPage;
+            rid->slot = slot;
+            found = true;
         }
         
         RC unpinResult = unpinPage(bm, pageHandle);
@@ -234,6 +434,11 @@ static RC findFreeSlot(BM_BufferPool *bm, TableMetadata *metadata, RID *rid) {
             currentPage++;
         }
     }
+
+    // Every page before the one found is full
+    if (found) {
+        metadata->firstFreePage = currentPage;
+    }
     
     // If no free slot found, create a new page
     if (!found) {
@@ -299,326 +504,3691 @@ static RC findFreeSlot(BM_BufferPool *bm, TableMetadata *metadata, RID *rid) {
     return RC_OK;
 }
 
-// Initialize Record Manager
-RC initRecordManager(void *mgmtData) {
-    // Initialize storage manager
-    (void)mgmtData; // Suppress unused parameter warning
-    initStorageManager();
-    return RC_OK;
+// Zone map maintenance
+static bool isZoneAttr(Schema *schema, int attrNum) {
+    switch (schema->dataTypes[attrNum]) {
+        case DT_INT:
+        case DT_FLOAT:
+            return true;
+        case DT_STRING:
+            return schema->typeLength[attrNum] <= ZONE_STRING_MAX;
+        default:
+            return false;
+    }
 }
 
-// Shutdown Record Manager
-RC shutdownRecordManager() {
-    // Clean up any global resources if needed
-    return RC_OK;
+static void freeZoneMap(ZoneMap *zoneMap) {
+    if (zoneMap == NULL) {
+        return;
+    }
+    free(zoneMap->attrs);
+    free(zoneMap->populated);
+    free(zoneMap->entries);
+    free(zoneMap);
 }
 
-// Create a new table in a page file
-RC createTable(char *name, Schema *schema) {
-    // Create page file using storage manager
-    RC result = createPageFile(name);
-    if (result != RC_OK) {
-        return result;
+static ZoneMap *createZoneMap(Schema *schema) {
+    ZoneMap *zoneMap = (ZoneMap *)calloc(1, sizeof(ZoneMap));
+    if (zoneMap == NULL) {
+        return NULL;
     }
-    
-    // Initialize buffer pool
-    BM_BufferPool *bm = (BM_BufferPool *)malloc(sizeof(BM_BufferPool));
-    RC initResult = initBufferPool(bm, name, 10000, RS_LRU, NULL);
-    if (initResult != RC_OK) {
-        free(bm);
-        return initResult;
+
+    zoneMap->attrs = (int *)malloc(sizeof(int) * (schema->numAttr + 1));
+    if (zoneMap->attrs == NULL) {
+        free(zoneMap);
+        return NULL;
     }
-    
-    // Calculate record size and slots per page
-    int recordSize = getRecordSize(schema);
-    int slotsPerPage;
-    int slotMapSize;
+    for (int i = 0; i < schema->numAttr; i++) {
+        if (isZoneAttr(schema, i)) {
+            zoneMap->attrs[zoneMap->numAttrs++] = i;
+        }
+    }
+    return zoneMap;
+}
 
-    // Iterate to find the maximum slotsPerPage that fits in PAGE_SIZE
-    slotsPerPage = PAGE_SIZE / recordSize; // Initial maximum possible
-    do {
-        slotMapSize = (slotsPerPage + 7) / 8; // Slot map size in bytes
-        if (slotMapSize + (slotsPerPage * recordSize) <= PAGE_SIZE) {
-            break;
+// Make room for pages 0..numPages-1; new pages start out empty
+static RC reserveZonePages(ZoneMap *zoneMap, int numPages) {
+    if (numPages > zoneMap->capacity) {
+        int capacity = (zoneMap->capacity > 0) ? zoneMap->capacity : 16;
+        while (capacity < numPages) {
+            capacity *= 2;
         }
-        slotsPerPage--;
-    } while (slotsPerPage > 0);
 
-    // Check if valid slotsPerPage was found
-    if (slotsPerPage <= 0) {
-        return RC_INVALID_RECORD_SIZE; // Handle error appropriately
+        int *populated = (int *)realloc(zoneMap->populated, sizeof(int) * capacity);
+        if (populated == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        zoneMap->populated = populated;
+
+        size_t entrySize = sizeof(ZoneEntry) * (zoneMap->numAttrs + 1);
+        ZoneEntry *entries = (ZoneEntry *)realloc(zoneMap->entries, entrySize * capacity);
+        if (entries == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        zoneMap->entries = entries;
+        zoneMap->capacity = capacity;
     }
 
-    // Initialize table metadata with the correct values
-    TableMetadata metadata;
-    metadata.numTuples = 0;
-    metadata.firstFreePage = DATA_START_PAGE;
-    metadata.numPages = DATA_START_PAGE + 1; // Header page + first data page
-    metadata.recordSize = recordSize;
-    metadata.slotsPerPage = slotsPerPage;
-    
-    // Write metadata and schema to header page
-    RC headerResult = initializeHeader(bm, schema, &metadata);
-    if (headerResult != RC_OK) {
-        shutdownBufferPool(bm);
-        free(bm);
-        return headerResult;
+    for (int page = zoneMap->numPages; page < numPages; page++) {
+        zoneMap->populated[page] = 0;
     }
-    
-    // Shutdown buffer pool
-    RC shutdownResult = shutdownBufferPool(bm);
-    if (shutdownResult != RC_OK) {
-        free(bm);
-        return shutdownResult;
+    if (numPages > zoneMap->numPages) {
+        zoneMap->numPages = numPages;
     }
-    
-    free(bm);
     return RC_OK;
 }
 
-// Open an existing table
-RC openTable(RM_TableData *rel, char *name) {
-    // Initialize buffer pool
-    BM_BufferPool *bm = (BM_BufferPool *)malloc(sizeof(BM_BufferPool));
-    RC initResult = initBufferPool(bm, name, 10000, RS_LRU, NULL);
-    if (initResult != RC_OK) {
-        free(bm);
-        return initResult;
-    }
-    
-    // Initialize table metadata
-    TableMetadata *metadata = (TableMetadata *)malloc(sizeof(TableMetadata));
-    RC metadataResult = readHeader(bm, metadata);
-    if (metadataResult != RC_OK) {
-        shutdownBufferPool(bm);
-        free(bm);
-        free(metadata);
-        return metadataResult;
-    }
-    
-    // Read schema from header page
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    RC pinResult = pinPage(bm, pageHandle, HEADER_PAGE);
-    if (pinResult != RC_OK) {
-        shutdownBufferPool(bm);
-        free(bm);
-        free(metadata);
-        free(pageHandle);
-        return pinResult;
+static void readZoneValue(Schema *schema, int attrNum, const char *recordData, ZoneValue *value) {
+    const char *data = recordData + schema->attrOffsets[attrNum];
+    switch (schema->dataTypes[attrNum]) {
+        case DT_INT:
+            memcpy(&value->intV, data, sizeof(int));
+            break;
+        case DT_FLOAT:
+            memcpy(&value->floatV, data, sizeof(float));
+            break;
+        default:
+            memcpy(value->stringV, data, schema->typeLength[attrNum]);
+            value->stringV[schema->typeLength[attrNum]] = '\0';
+            break;
     }
-    
-    // Skip metadata at beginning of header page
-    char *schemaData = pageHandle->data + sizeof(TableMetadata);
-    
-    // Read schema fields
-    int numAttr, keySize;
-    memcpy(&numAttr, schemaData, sizeof(int));
-    schemaData += sizeof(int);
-    
-    // Allocate arrays for schema info
-    char **attrNames = (char **)malloc(sizeof(char *) * numAttr);
-    DataType *dataTypes = (DataType *)malloc(sizeof(DataType) * numAttr);
-    int *typeLength = (int *)malloc(sizeof(int) * numAttr);
-    
-    // Read attribute information
-    for (int i = 0; i < numAttr; i++) {
-        // Read attribute name (null-terminated string)
-        int nameLength;
-        memcpy(&nameLength, schemaData, sizeof(int));
-        schemaData += sizeof(int);
-        
-        attrNames[i] = (char *)malloc(nameLength + 1);
-        memcpy(attrNames[i], schemaData, nameLength);
-        attrNames[i][nameLength] = '\0';
-        schemaData += nameLength;
-        
-        // Read data type
-        memcpy(&dataTypes[i], schemaData, sizeof(DataType));
-        schemaData += sizeof(DataType);
-        
-        // Read type length
-        memcpy(&typeLength[i], schemaData, sizeof(int));
-        schemaData += sizeof(int);
+}
+
+static int compareZoneValues(DataType dt, const ZoneValue *left, const ZoneValue *right) {
+    switch (dt) {
+        case DT_INT:
+            return (left->intV > right->intV) - (left->intV < right->intV);
+        case DT_FLOAT:
+            return (left->floatV > right->floatV) - (left->floatV < right->floatV);
+        default:
+            return strcmp(left->stringV, right->stringV);
     }
-    
-    // Read key information
-    memcpy(&keySize, schemaData, sizeof(int));
-    schemaData += sizeof(int);
-    
-    int *keyAttrs = (int *)malloc(sizeof(int) * keySize);
-    memcpy(keyAttrs, schemaData, sizeof(int) * keySize);
-    
-    // Create schema
-    Schema *schema = createSchema(numAttr, attrNames, dataTypes, typeLength, keySize, keyAttrs);
-    
-    // Set table data
-    rel->name = strdup(name);
-    rel->schema = schema;
-    
-    // Create record manager instance
-    RecordManager *mgr = (RecordManager *)malloc(sizeof(RecordManager));
-    mgr->bufferPool = bm;
-    mgr->numTuples = metadata->numTuples;
-    
-    rel->mgmtData = mgr;
-    
-    // Clean up
-    RC unpinResult = unpinPage(bm, pageHandle);
-    free(pageHandle);
-    free(metadata);
-    
-    return unpinResult;
 }
 
-// Close a table
-RC closeTable(RM_TableData *rel) {
-    if (rel == NULL || rel->mgmtData == NULL) {
-        return RC_FILE_HANDLE_NOT_INIT;
+// Widen the bounds of a page to cover a record stored on it
+static RC addToZoneMap(ZoneMap *zoneMap, Schema *schema, int page, const char *recordData) {
+    if (zoneMap == NULL) {
+        return RC_OK;
     }
-    
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
-    BM_BufferPool *bm = mgr->bufferPool;
-    
-    if (bm == NULL) {
-        //free(mgr);
-        if (rel->schema != NULL) {
-            //freeSchema(rel->schema);
+
+    RC reserveResult = reserveZonePages(zoneMap, page + 1);
+    if (reserveResult != RC_OK) {
+        return reserveResult;
+    }
+
+    ZoneEntry *entries = zoneMap->entries + (size_t)page * zoneMap->numAttrs;
+    for (int i = 0; i < zoneMap->numAttrs; i++) {
+        int attrNum = zoneMap->attrs[i];
+        DataType dt = schema->dataTypes[attrNum];
+        ZoneValue value;
+
+        readZoneValue(schema, attrNum, recordData, &value);
+        if (dt == DT_FLOAT && isnan(value.floatV)) {
+            // NaN is unordered; stop the page from being pruned on it
+            entries[i].min.floatV = -INFINITY;
+            entries[i].max.floatV = INFINITY;
+            continue;
         }
-        if (rel->name != NULL) {
-           // free(rel->name);
+        if (!zoneMap->populated[page] || compareZoneValues(dt, &value, &entries[i].min) < 0) {
+            entries[i].min = value;
+        }
+        if (!zoneMap->populated[page] || compareZoneValues(dt, &value, &entries[i].max) > 0) {
+            entries[i].max = value;
         }
-        rel->mgmtData = NULL;
-        return RC_OK;
     }
-    
-    // Force all dirty pages to disk
-    RC forceResult = forceFlushPool(bm);
-    if (forceResult != RC_OK) {
-        // Even if force flush fails, we should still try to clean up resources
-        free(bm);
-        free(mgr);
-        if (rel->schema != NULL) {
-            freeSchema(rel->schema);
+    zoneMap->populated[page] = 1;
+    return RC_OK;
+}
+
+// Recompute the zone map from the records on every data page
+static RC rebuildZoneMap(ZoneMap *zoneMap, BM_BufferPool *bm, Schema *schema, TableMetadata *metadata) {
+    zoneMap->numPages = 0;
+    RC reserveResult = reserveZonePages(zoneMap, metadata->numPages);
+    if (reserveResult != RC_OK) {
+        return reserveResult;
+    }
+
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    BM_PageHandle page;
+    for (int pageNum = DATA_START_PAGE; pageNum < metadata->numPages; pageNum++) {
+        RC pinResult = pinPage(bm, &page, pageNum);
+        if (pinResult != RC_OK) {
+            return pinResult;
         }
-        if (rel->name != NULL) {
-            free(rel->name);
+
+        for (int slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, 0); slot >= 0;
+             slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, slot + 1)) {
+            char *recordData = page.data + getRecordOffset(slot, metadata->recordSize, mapSize);
+            RC addResult = addToZoneMap(zoneMap, schema, pageNum, recordData);
+            if (addResult != RC_OK) {
+                unpinPage(bm, &page);
+                return addResult;
+            }
         }
-        rel->mgmtData = NULL;
-        return forceResult;
-    }
+
+        RC unpinResult = unpinPage(bm, &page);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+    }
+    return RC_OK;
+}
+
+// Files kept next to the page file are named <table><suffix>
+static char *getSideFileName(const char *tableName, const char *suffix) {
+    char *fileName = (char *)malloc(strlen(tableName) + strlen(suffix) + 1);
+    if (fileName != NULL) {
+        strcpy(fileName, tableName);
+        strcat(fileName, suffix);
+    }
+    return fileName;
+}
+
+static void removeSideFile(const char *tableName, const char *suffix) {
+    char *fileName = getSideFileName(tableName, suffix);
+    if (fileName != NULL) {
+        remove(fileName);
+        free(fileName);
+    }
+}
+
+static RC saveZoneMap(ZoneMap *zoneMap, const char *tableName, TableMetadata *metadata) {
+    char *fileName = getSideFileName(tableName, ZONE_MAP_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    RC reserveResult = reserveZonePages(zoneMap, metadata->numPages);
+    if (reserveResult != RC_OK) {
+        free(fileName);
+        return reserveResult;
+    }
+
+    FILE *file = fopen(fileName, "wb");
+    free(fileName);
+    if (file == NULL) {
+        return RC_WRITE_FAILED;
+    }
+
+    int header[4] = { ZONE_MAP_MAGIC, metadata->numPages, metadata->numTuples, zoneMap->numAttrs };
+    size_t numEntries = (size_t)metadata->numPages * zoneMap->numAttrs;
+    bool written = fwrite(header, sizeof(int), 4, file) == 4 &&
+        fwrite(zoneMap->attrs, sizeof(int), zoneMap->numAttrs, file) == (size_t)zoneMap->numAttrs &&
+        fwrite(zoneMap->populated, sizeof(int), metadata->numPages, file) == (size_t)metadata->numPages &&
+        fwrite(zoneMap->entries, sizeof(ZoneEntry), numEntries, file) == numEntries;
+
+    if (fclose(file) != 0 || !written) {
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// Load the zone map saved when the table was last closed. The file is
+// removed once read, so after a crash it is rebuilt rather than trusted.
+static RC loadZoneMap(ZoneMap *zoneMap, const char *tableName, TableMetadata *metadata) {
+    char *fileName = getSideFileName(tableName, ZONE_MAP_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        free(fileName);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    RC result = RC_FILE_HANDLE_NOT_INIT;
+    int header[4];
+    if (fread(header, sizeof(int), 4, file) == 4 && header[0] == ZONE_MAP_MAGIC &&
+        header[1] == metadata->numPages && header[2] == metadata->numTuples &&
+        header[3] == zoneMap->numAttrs) {
+        int *attrs = (int *)malloc(sizeof(int) * (zoneMap->numAttrs + 1));
+        size_t numEntries = (size_t)metadata->numPages * zoneMap->numAttrs;
+
+        if (attrs != NULL && reserveZonePages(zoneMap, metadata->numPages) == RC_OK &&
+            fread(attrs, sizeof(int), zoneMap->numAttrs, file) == (size_t)zoneMap->numAttrs &&
+            memcmp(attrs, zoneMap->attrs, sizeof(int) * zoneMap->numAttrs) == 0 &&
+            fread(zoneMap->populated, sizeof(int), metadata->numPages, file) == (size_t)metadata->numPages &&
+            fread(zoneMap->entries, sizeof(ZoneEntry), numEntries, file) == numEntries) {
+            result = RC_OK;
+        }
+        free(attrs);
+    }
+
+    fclose(file);
+    remove(fileName);
+    free(fileName);
+    return result;
+}
+
+// Whether a page may hold a record for which the comparison holds, given
+// the bounds of attribute attrNum on it; cons is the constant side
+static bool zoneMayCompare(DataType dt, const ZoneEntry *entry, OpType op, const ZoneValue *cons) {
+    int minCmp = compareZoneValues(dt, &entry->min, cons);
+    int maxCmp = compareZoneValues(dt, &entry->max, cons);
+
+    switch (op) {
+        case OP_COMP_EQUAL:         return minCmp <= 0 && maxCmp >= 0;
+        case OP_COMP_NOT_EQUAL:     return minCmp != 0 || maxCmp != 0;
+        case OP_COMP_SMALLER:       return minCmp < 0;
+        case OP_COMP_SMALLER_EQUAL: return minCmp <= 0;
+        case OP_COMP_GREATER:       return maxCmp > 0;
+        case OP_COMP_GREATER_EQUAL: return maxCmp >= 0;
+        default:                    return true;
+    }
+}
+
+// Find the zone entry for an attribute reference on a page
+static const ZoneEntry *getZoneEntry(ZoneMap *zoneMap, Expr *expr, int page) {
+    if (expr->type != EXPR_ATTRREF) {
+        return NULL;
+    }
+    for (int i = 0; i < zoneMap->numAttrs; i++) {
+        if (zoneMap->attrs[i] == expr->expr.attrRef) {
+            return zoneMap->entries + (size_t)page * zoneMap->numAttrs + i;
+        }
+    }
+    return NULL;
+}
+
+// Convert a constant of the attribute's type to a zone value. A NaN
+// constant is not used: bounds cannot order it, and comparisons with it
+// are false except <>.
+static bool getZoneConstant(Schema *schema, int attrNum, Expr *expr, ZoneValue *value) {
+    if (expr->type != EXPR_CONST || expr->expr.cons->dt != schema->dataTypes[attrNum]) {
+        return false;
+    }
+    switch (expr->expr.cons->dt) {
+        case DT_INT:
+            value->intV = expr->expr.cons->v.intV;
+            return true;
+        case DT_FLOAT:
+            value->floatV = expr->expr.cons->v.floatV;
+            return !isnan(value->floatV);
+        default:
+            // Constants too long for a zone value are not used for pruning
+            if (strlen(expr->expr.cons->v.stringV) > ZONE_STRING_MAX) {
+                return false;
+            }
+            strcpy(value->stringV, expr->expr.cons->v.stringV);
+            return true;
+    }
+}
+
+static OpType negateComparison(OpType op) {
+    switch (op) {
+        case OP_COMP_EQUAL:         return OP_COMP_NOT_EQUAL;
+        case OP_COMP_NOT_EQUAL:     return OP_COMP_EQUAL;
+        case OP_COMP_SMALLER:       return OP_COMP_GREATER_EQUAL;
+        case OP_COMP_SMALLER_EQUAL: return OP_COMP_GREATER;
+        case OP_COMP_GREATER:       return OP_COMP_SMALLER_EQUAL;
+        case OP_COMP_GREATER_EQUAL: return OP_COMP_SMALLER;
+        default:                    return op;
+    }
+}
+
+static OpType mirrorComparison(OpType op) {
+    switch (op) {
+        case OP_COMP_SMALLER:       return OP_COMP_GREATER;
+        case OP_COMP_SMALLER_EQUAL: return OP_COMP_GREATER_EQUAL;
+        case OP_COMP_GREATER:       return OP_COMP_SMALLER;
+        case OP_COMP_GREATER_EQUAL: return OP_COMP_SMALLER_EQUAL;
+        default:                    return op;
+    }
+}
+
+// Whether any record on the page can satisfy cond, judged from the zone
+// map alone (false only when that is certain). negated is set below a NOT.
+static bool zoneMayMatch(ZoneMap *zoneMap, Schema *schema, int page, Expr *cond, bool negated) {
+    if (cond->type != EXPR_OP) {
+        return true;
+    }
+
+    Operator *op = cond->expr.op;
+    switch (op->type) {
+        case OP_BOOL_AND:
+        case OP_BOOL_OR: {
+            // Under a NOT, AND and OR swap roles (De Morgan)
+            bool all = (op->type == OP_BOOL_AND) != negated;
+            for (int i = 0; i < op->numArgs; i++) {
+                bool may = zoneMayMatch(zoneMap, schema, page, op->args[i], negated);
+                if (all && !may) {
+                    return false;
+                }
+                if (!all && may) {
+                    return true;
+                }
+            }
+            return all;
+        }
+        case OP_BOOL_NOT:
+            return zoneMayMatch(zoneMap, schema, page, op->args[0], !negated);
+        case OP_BETWEEN:
+        case OP_IN: {
+            const ZoneEntry *entry = getZoneEntry(zoneMap, op->args[0], page);
+            if (entry == NULL || negated) {
+                return true;
+            }
+            int attrNum = op->args[0]->expr.attrRef;
+            DataType dt = schema->dataTypes[attrNum];
+            ZoneValue low, high;
+            if (op->type == OP_BETWEEN) {
+                if (!getZoneConstant(schema, attrNum, op->args[1], &low) ||
+                    !getZoneConstant(schema, attrNum, op->args[2], &high)) {
+                    return true;
+                }
+                return zoneMayCompare(dt, entry, OP_COMP_GREATER_EQUAL, &low) &&
+                       zoneMayCompare(dt, entry, OP_COMP_SMALLER_EQUAL, &high);
+            }
+            for (int i = 1; i < op->numArgs; i++) {
+                if (!getZoneConstant(schema, attrNum, op->args[i], &low) ||
+                    zoneMayCompare(dt, entry, OP_COMP_EQUAL, &low)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default: {
+            if (op->numArgs != 2) {
+                return true;
+            }
+            // attr op const, or const op attr with the operator mirrored
+            OpType cmp = op->type;
+            Expr *attr = op->args[0];
+            Expr *cons = op->args[1];
+            if (attr->type != EXPR_ATTRREF) {
+                attr = op->args[1];
+                cons = op->args[0];
+                cmp = mirrorComparison(cmp);
+            }
+
+            const ZoneEntry *entry = getZoneEntry(zoneMap, attr, page);
+            ZoneValue value;
+            if (entry == NULL || !getZoneConstant(schema, attr->expr.attrRef, cons, &value)) {
+                return true;
+            }
+            if (negated) {
+                cmp = negateComparison(cmp);
+            }
+            return zoneMayCompare(schema->dataTypes[attr->expr.attrRef], entry, cmp, &value);
+        }
+    }
+}
+
+// Whether a scan with condition cond has to look at a data page at all
+static bool zoneMapAdmitsPage(ZoneMap *zoneMap, Schema *schema, int page, Expr *cond) {
+    if (zoneMap == NULL || page >= zoneMap->numPages) {
+        return true;
+    }
+    if (!zoneMap->populated[page]) {
+        return false;
+    }
+    return cond == NULL || zoneMayMatch(zoneMap, schema, page, cond, false);
+}
+
+// Whether every value within the bounds satisfies the comparison
+static bool zoneMustCompare(DataType dt, const ZoneEntry *entry, OpType op, const ZoneValue *cons) {
+    int minCmp = compareZoneValues(dt, &entry->min, cons);
+    int maxCmp = compareZoneValues(dt, &entry->max, cons);
+
+    switch (op) {
+        case OP_COMP_EQUAL:         return minCmp == 0 && maxCmp == 0;
+        case OP_COMP_NOT_EQUAL:     return minCmp > 0 || maxCmp < 0;
+        case OP_COMP_SMALLER:       return maxCmp < 0;
+        case OP_COMP_SMALLER_EQUAL: return maxCmp <= 0;
+        case OP_COMP_GREATER:       return minCmp > 0;
+        case OP_COMP_GREATER_EQUAL: return minCmp >= 0;
+        default:                    return false;
+    }
+}
+
+// The zone entry for an attribute reference on a page, if its bounds can
+// prove a comparison true for every record: INT bounds always, FLOAT
+// bounds while finite (a NaN, which compares false to everything, makes
+// them infinite), STRING bounds never
+static const ZoneEntry *getExactZoneEntry(ZoneMap *zoneMap, Schema *schema, Expr *expr, int page) {
+    const ZoneEntry *entry = getZoneEntry(zoneMap, expr, page);
+    if (entry == NULL) {
+        return NULL;
+    }
+    switch (schema->dataTypes[expr->expr.attrRef]) {
+        case DT_INT:
+            return entry;
+        case DT_FLOAT:
+            return (isfinite(entry->min.floatV) && isfinite(entry->max.floatV)) ? entry : NULL;
+        default:
+            return NULL;
+    }
+}
+
+// Whether every record on the page satisfies cond, judged from the zone
+// map alone (true only when that is certain). negated is set below a NOT.
+static bool zoneMustMatch(ZoneMap *zoneMap, Schema *schema, int page, Expr *cond, bool negated) {
+    if (cond->type != EXPR_OP) {
+        return false;
+    }
+
+    Operator *op = cond->expr.op;
+    switch (op->type) {
+        case OP_BOOL_AND:
+        case OP_BOOL_OR: {
+            bool all = (op->type == OP_BOOL_AND) != negated;
+            for (int i = 0; i < op->numArgs; i++) {
+                bool must = zoneMustMatch(zoneMap, schema, page, op->args[i], negated);
+                if (all && !must) {
+                    return false;
+                }
+                if (!all && must) {
+                    return true;
+                }
+            }
+            return all;
+        }
+        case OP_BOOL_NOT:
+            return zoneMustMatch(zoneMap, schema, page, op->args[0], !negated);
+        case OP_BETWEEN: {
+            const ZoneEntry *entry = getExactZoneEntry(zoneMap, schema, op->args[0], page);
+            ZoneValue low, high;
+            if (entry == NULL) {
+                return false;
+            }
+            int attrNum = op->args[0]->expr.attrRef;
+            DataType dt = schema->dataTypes[attrNum];
+            if (!getZoneConstant(schema, attrNum, op->args[1], &low) ||
+                !getZoneConstant(schema, attrNum, op->args[2], &high)) {
+                return false;
+            }
+            if (negated) {
+                return zoneMustCompare(dt, entry, OP_COMP_SMALLER, &low) ||
+                       zoneMustCompare(dt, entry, OP_COMP_GREATER, &high);
+            }
+            return zoneMustCompare(dt, entry, OP_COMP_GREATER_EQUAL, &low) &&
+                   zoneMustCompare(dt, entry, OP_COMP_SMALLER_EQUAL, &high);
+        }
+        case OP_IN:
+            return false;
+        default: {
+            if (op->numArgs != 2) {
+                return false;
+            }
+            OpType cmp = op->type;
+            Expr *attr = op->args[0];
+            Expr *cons = op->args[1];
+            if (attr->type != EXPR_ATTRREF) {
+                attr = op->args[1];
+                cons = op->args[0];
+                cmp = mirrorComparison(cmp);
+            }
+
+            const ZoneEntry *entry = getExactZoneEntry(zoneMap, schema, attr, page);
+            ZoneValue value;
+            if (entry == NULL || !getZoneConstant(schema, attr->expr.attrRef, cons, &value)) {
+                return false;
+            }
+            if (negated) {
+                cmp = negateComparison(cmp);
+            }
+            return zoneMustCompare(schema->dataTypes[attr->expr.attrRef], entry, cmp, &value);
+        }
+    }
+}
+
+// Whether every record on a data page matches cond, so that its
+// occupancy count is its number of matches
+static bool zoneMapCoversPage(ZoneMap *zoneMap, Schema *schema, int page, Expr *cond) {
+    if (zoneMap == NULL || page >= zoneMap->numPages || !zoneMap->populated[page]) {
+        return false;
+    }
+    return zoneMustMatch(zoneMap, schema, page, cond, false);
+}
+
+// Bloom filter maintenance
+static void freeBloomFilter(BloomFilter *bloom) {
+    if (bloom != NULL) {
+        free(bloom->bits);
+        free(bloom);
+    }
+}
+
+// Bits of a filter sized for capacity keys, at most BLOOM_MAX_KEYS
+static int bloomBitsFor(int capacity) {
+    return (int)(((int64_t)capacity * BLOOM_BITS_PER_KEY + 63) / 64 * 64);
+}
+
+// An empty filter sized for expectedKeys keys, within BLOOM_MIN_KEYS and
+// BLOOM_MAX_KEYS (NULL if out of memory)
+static BloomFilter *createBloomFilter(int64_t expectedKeys) {
+    BloomFilter *bloom = (BloomFilter *)malloc(sizeof(BloomFilter));
+    if (bloom == NULL) {
+        return NULL;
+    }
+
+    if (expectedKeys < BLOOM_MIN_KEYS) {
+        expectedKeys = BLOOM_MIN_KEYS;
+    } else if (expectedKeys > BLOOM_MAX_KEYS) {
+        expectedKeys = BLOOM_MAX_KEYS;
+    }
+    bloom->capacity = (int)expectedKeys;
+    bloom->numBits = bloomBitsFor(bloom->capacity);
+    bloom->numKeys = 0;
+    bloom->bits = (uint64_t *)calloc(bloom->numBits / 64, sizeof(uint64_t));
+    if (bloom->bits == NULL) {
+        free(bloom);
+        return NULL;
+    }
+    return bloom;
+}
+
+static uint64_t hashKeyBytes(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Hash the key attributes of a record. Keys that compare equal hash
+// alike: -0.0 is hashed as 0.0 and strings only up to their end.
+static uint64_t hashRecordKey(Schema *schema, const char *recordData) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        const char *data = recordData + schema->attrOffsets[attrNum];
+        switch (schema->dataTypes[attrNum]) {
+            case DT_FLOAT:
+                {
+                    float floatV;
+                    memcpy(&floatV, data, sizeof(float));
+                    if (floatV == 0.0f) {
+                        floatV = 0.0f;
+                    }
+                    hash = hashKeyBytes(hash, &floatV, sizeof(float));
+                }
+                break;
+            case DT_BOOL:
+                {
+                    unsigned char boolV = (data[0] != 0);
+                    hash = hashKeyBytes(hash, &boolV, 1);
+                }
+                break;
+            case DT_STRING:
+                {
+                    const char *end = (const char *)memchr(data, '\0', schema->typeLength[attrNum]);
+                    size_t length = (end != NULL) ? (size_t)(end - data) : (size_t)schema->typeLength[attrNum];
+                    hash = hashKeyBytes(hash, data, length);
+                    hash = hashKeyBytes(hash, "", 1);
+                }
+                break;
+            default:
+                hash = hashKeyBytes(hash, data, sizeof(int));
+                break;
+        }
+    }
+
+    // Mix the high bits down; both halves pick bit positions
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Bit positions are h1 + i * h2 for the two halves of the key's hash
+static void addToBloomFilter(BloomFilter *bloom, Schema *schema, const char *recordData) {
+    if (bloom == NULL) {
+        return;
+    }
+
+    uint64_t hash = hashRecordKey(schema, recordData);
+    uint64_t h1 = hash & 0xFFFFFFFFULL, h2 = (hash >> 32) | 1;
+    for (int i = 0; i < BLOOM_NUM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % (uint64_t)bloom->numBits;
+        bloom->bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+    bloom->numKeys++;
+}
+
+// Whether a record with the key of recordData may be in the table
+static bool bloomMayContain(BloomFilter *bloom, Schema *schema, const char *recordData) {
+    if (bloom == NULL) {
+        return true;
+    }
+
+    uint64_t hash = hashRecordKey(schema, recordData);
+    uint64_t h1 = hash & 0xFFFFFFFFULL, h2 = (hash >> 32) | 1;
+    for (int i = 0; i < BLOOM_NUM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % (uint64_t)bloom->numBits;
+        if (!(bloom->bits[bit / 64] & ((uint64_t)1 << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether a record may exist whose key attributes equal keyValues
+// (one per key attribute, in key order)
+static bool bloomMayContainValues(BloomFilter *bloom, Schema *schema, Value **keyValues) {
+    if (bloom == NULL) {
+        return true;
+    }
+    char *recordData = (char *)calloc(1, getRecordSize(schema));
+    if (recordData == NULL) {
+        return true;
+    }
+
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        char *data = recordData + schema->attrOffsets[attrNum];
+        Value *value = keyValues[i];
+        switch (value->dt) {
+            case DT_INT:
+                memcpy(data, &value->v.intV, sizeof(int));
+                break;
+            case DT_FLOAT:
+                memcpy(data, &value->v.floatV, sizeof(float));
+                break;
+            case DT_BOOL:
+                data[0] = (value->v.boolV != 0);
+                break;
+            case DT_STRING:
+                {
+                    // A longer string matches no stored value; "maybe" is still right
+                    size_t length = strlen(value->v.stringV);
+                    if (length > (size_t)schema->typeLength[attrNum]) {
+                        length = schema->typeLength[attrNum];
+                    }
+                    memcpy(data, value->v.stringV, length);
+                }
+                break;
+        }
+    }
+
+    bool mayContain = bloomMayContain(bloom, schema, recordData);
+    free(recordData);
+    return mayContain;
+}
+
+// Add the key of every record on the data pages
+static RC rebuildBloomFilter(BloomFilter *bloom, BM_BufferPool *bm, Schema *schema, TableMetadata *metadata) {
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    BM_PageHandle page;
+    for (int pageNum = DATA_START_PAGE; pageNum < metadata->numPages; pageNum++) {
+        RC pinResult = pinPage(bm, &page, pageNum);
+        if (pinResult != RC_OK) {
+            return pinResult;
+        }
+
+        for (int slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, 0); slot >= 0;
+             slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, slot + 1)) {
+            addToBloomFilter(bloom, schema, page.data + getRecordOffset(slot, metadata->recordSize, mapSize));
+        }
+
+        RC unpinResult = unpinPage(bm, &page);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+    }
+    return RC_OK;
+}
+
+// A filter built from the pages, sized for twice the records there are
+static BloomFilter *buildBloomFilter(BM_BufferPool *bm, Schema *schema, TableMetadata *metadata) {
+    BloomFilter *bloom = createBloomFilter(2 * (int64_t)metadata->numTuples);
+    if (bloom != NULL && rebuildBloomFilter(bloom, bm, schema, metadata) != RC_OK) {
+        freeBloomFilter(bloom);
+        return NULL;
+    }
+    return bloom;
+}
+
+// Replace a filter that holds more keys than it was sized for, unless it
+// is as large as it gets. If that fails the old one stays; it still never
+// misses a key.
+static void resizeBloomFilter(RecordManager *mgr, Schema *schema, TableMetadata *metadata) {
+    if (mgr->bloom == NULL || mgr->bloom->numKeys <= mgr->bloom->capacity ||
+        mgr->bloom->capacity >= BLOOM_MAX_KEYS) {
+        return;
+    }
+    BloomFilter *bloom = buildBloomFilter(mgr->bufferPool, schema, metadata);
+    if (bloom != NULL) {
+        freeBloomFilter(mgr->bloom);
+        mgr->bloom = bloom;
+    }
+}
+
+static RC saveBloomFilter(BloomFilter *bloom, const char *tableName, TableMetadata *metadata) {
+    char *fileName = getSideFileName(tableName, BLOOM_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    FILE *file = fopen(fileName, "wb");
+    free(fileName);
+    if (file == NULL) {
+        return RC_WRITE_FAILED;
+    }
+
+    int header[5] = { BLOOM_MAGIC, metadata->numTuples, bloom->numBits, bloom->capacity, bloom->numKeys };
+    size_t numWords = bloom->numBits / 64;
+    bool written = fwrite(header, sizeof(int), 5, file) == 5 &&
+        fwrite(bloom->bits, sizeof(uint64_t), numWords, file) == numWords;
+
+    if (fclose(file) != 0 || !written) {
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// Load the filter saved when the table was last closed (NULL if there is
+// none, it does not belong to the table as it is, or its size is not one
+// createBloomFilter() makes). The file is removed once read, so after a
+// crash the filter is rebuilt rather than trusted.
+static BloomFilter *loadBloomFilter(const char *tableName, TableMetadata *metadata) {
+    char *fileName = getSideFileName(tableName, BLOOM_SUFFIX);
+    if (fileName == NULL) {
+        return NULL;
+    }
+
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        free(fileName);
+        return NULL;
+    }
+
+    BloomFilter *bloom = NULL;
+    int header[5];
+    if (fread(header, sizeof(int), 5, file) == 5 && header[0] == BLOOM_MAGIC &&
+        header[1] == metadata->numTuples && header[3] >= BLOOM_MIN_KEYS &&
+        header[3] <= BLOOM_MAX_KEYS && header[2] == bloomBitsFor(header[3]) && header[4] >= 0) {
+        bloom = (BloomFilter *)malloc(sizeof(BloomFilter));
+        size_t numWords = (size_t)header[2] / 64;
+        uint64_t *bits = (uint64_t *)malloc(numWords * sizeof(uint64_t));
+
+        if (bloom != NULL && bits != NULL && fread(bits, sizeof(uint64_t), numWords, file) == numWords) {
+            bloom->numBits = header[2];
+            bloom->capacity = header[3];
+            bloom->numKeys = header[4];
+            bloom->bits = bits;
+        } else {
+            free(bloom);
+            free(bits);
+            bloom = NULL;
+        }
+    }
+
+    fclose(file);
+    remove(fileName);
+    free(fileName);
+    return bloom;
+}
+
+// Collect into keyValues the constants of key = constant conjuncts of cond
+static void collectKeyEqualities(Schema *schema, Expr *cond, Value **keyValues) {
+    if (cond == NULL || cond->type != EXPR_OP) {
+        return;
+    }
+
+    Operator *op = cond->expr.op;
+    if (op->type == OP_BOOL_AND) {
+        for (int i = 0; i < op->numArgs; i++) {
+            collectKeyEqualities(schema, op->args[i], keyValues);
+        }
+        return;
+    }
+    if (op->type != OP_COMP_EQUAL || op->numArgs != 2) {
+        return;
+    }
+
+    Expr *attr = op->args[0], *constant = op->args[1];
+    if (attr->type != EXPR_ATTRREF) {
+        attr = op->args[1];
+        constant = op->args[0];
+    }
+    if (attr->type != EXPR_ATTRREF || constant->type != EXPR_CONST) {
+        return;
+    }
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        if (attrNum == attr->expr.attrRef && constant->expr.cons->dt == schema->dataTypes[attrNum]) {
+            keyValues[i] = constant->expr.cons;
+        }
+    }
+}
+
+// Whether cond fixes every key attribute to a key the filter rules out,
+// so that no record can match it
+static bool bloomExcludesCondition(BloomFilter *bloom, Schema *schema, Expr *cond) {
+    if (bloom == NULL || schema->keySize <= 0) {
+        return false;
+    }
+    Value **keyValues = (Value **)calloc(schema->keySize, sizeof(Value *));
+    if (keyValues == NULL) {
+        return false;
+    }
+
+    collectKeyEqualities(schema, cond, keyValues);
+    bool allFixed = true;
+    for (int i = 0; i < schema->keySize; i++) {
+        allFixed = allFixed && keyValues[i] != NULL;
+    }
+    bool excluded = allFixed && !bloomMayContainValues(bloom, schema, keyValues);
+    free(keyValues);
+    return excluded;
+}
+
+// RID forwarding maintenance
+static int compareRIDs(const void *a, const void *b) {
+    const RID *left = (const RID *)a;
+    const RID *right = (const RID *)b;
+    if (left->page != right->page) {
+        return (left->page > right->page) - (left->page < right->page);
+    }
+    return (left->slot > right->slot) - (left->slot < right->slot);
+}
+
+// Compare a RID with the target of a forwarding entry
+static int compareForwardTarget(const void *key, const void *entry) {
+    return compareRIDs(key, &((const RIDForward *)entry)->to);
+}
+
+static int compareForwardTargets(const void *a, const void *b) {
+    return compareRIDs(&((const RIDForward *)a)->to, &((const RIDForward *)b)->to);
+}
+
+// Where the record with RID id is now (entries sort on from, their first
+// member, so RIDs can be searched for directly)
+static RID forwardRID(RecordManager *mgr, RID id) {
+    if (mgr->numForwards > 0) {
+        RIDForward *entry = (RIDForward *)bsearch(&id, mgr->forwards, mgr->numForwards,
+                                                  sizeof(RIDForward), compareRIDs);
+        if (entry != NULL) {
+            return entry->to;
+        }
+    }
+    return id;
+}
+
+// A record was stored in slot id, so id names it from now on
+static void dropForwardFrom(RecordManager *mgr, RID id) {
+    if (mgr->numForwards == 0) {
+        return;
+    }
+    RIDForward *entry = (RIDForward *)bsearch(&id, mgr->forwards, mgr->numForwards,
+                                              sizeof(RIDForward), compareRIDs);
+    if (entry != NULL) {
+        size_t after = mgr->forwards + mgr->numForwards - (entry + 1);
+        memmove(entry, entry + 1, after * sizeof(RIDForward));
+        mgr->numForwards--;
+    }
+}
+
+// The record at id was deleted; the RIDs forwarding to it must not
+// resolve to whatever is stored in the slot next. This is a pass over
+// all entries, but only tables that were vacuumed have any.
+static void dropForwardsTo(RecordManager *mgr, RID id) {
+    int kept = 0;
+    for (int i = 0; i < mgr->numForwards; i++) {
+        if (compareRIDs(&mgr->forwards[i].to, &id) != 0) {
+            mgr->forwards[kept++] = mgr->forwards[i];
+        }
+    }
+    mgr->numForwards = kept;
+}
+
+// Add the moves of a vacuum. A move is never from a slot that has an
+// entry, since that slot held a record; entries from a slot a move
+// filled are void, and entries to a moved record follow it.
+static RC addForwards(RecordManager *mgr, RIDForward *moves, int numMoves) {
+    if (numMoves == 0) {
+        return RC_OK;
+    }
+
+    qsort(moves, numMoves, sizeof(RIDForward), compareForwardTargets);
+    int kept = 0;
+    for (int i = 0; i < mgr->numForwards; i++) {
+        if (bsearch(&mgr->forwards[i].from, moves, numMoves, sizeof(RIDForward), compareForwardTarget) == NULL) {
+            mgr->forwards[kept++] = mgr->forwards[i];
+        }
+    }
+
+    qsort(moves, numMoves, sizeof(RIDForward), compareRIDs);
+    for (int i = 0; i < kept; i++) {
+        RIDForward *move = (RIDForward *)bsearch(&mgr->forwards[i].to, moves, numMoves,
+                                                 sizeof(RIDForward), compareRIDs);
+        if (move != NULL) {
+            mgr->forwards[i].to = move->to;
+        }
+    }
+
+    RIDForward *forwards = (RIDForward *)realloc(mgr->forwards, sizeof(RIDForward) * (kept + numMoves));
+    if (forwards == NULL) {
+        mgr->numForwards = kept;
+        return RC_MEM_ALLOC_FAILED;
+    }
+    memcpy(forwards + kept, moves, sizeof(RIDForward) * numMoves);
+    mgr->forwards = forwards;
+    mgr->numForwards = kept + numMoves;
+    qsort(mgr->forwards, mgr->numForwards, sizeof(RIDForward), compareRIDs);
+    return RC_OK;
+}
+
+static RC saveForwards(RecordManager *mgr, const char *tableName) {
+    char *fileName = getSideFileName(tableName, FORWARD_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    if (mgr->numForwards == 0) {
+        remove(fileName);
+        free(fileName);
+        return RC_OK;
+    }
+
+    FILE *file = fopen(fileName, "wb");
+    free(fileName);
+    if (file == NULL) {
+        return RC_WRITE_FAILED;
+    }
+
+    int header[2] = { FORWARD_MAGIC, mgr->numForwards };
+    bool written = fwrite(header, sizeof(int), 2, file) == 2 &&
+        fwrite(mgr->forwards, sizeof(RIDForward), mgr->numForwards, file) == (size_t)mgr->numForwards;
+
+    if (fclose(file) != 0 || !written) {
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// Unlike the zone map, the entries cannot be rebuilt, so the file stays
+static RC loadForwards(RecordManager *mgr, const char *tableName) {
+    mgr->forwards = NULL;
+    mgr->numForwards = 0;
+
+    char *fileName = getSideFileName(tableName, FORWARD_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    FILE *file = fopen(fileName, "rb");
+    free(fileName);
+    if (file == NULL) {
+        return RC_OK;
+    }
+
+    RC result = RC_FILE_HANDLE_NOT_INIT;
+    int header[2];
+    if (fread(header, sizeof(int), 2, file) == 2 && header[0] == FORWARD_MAGIC && header[1] > 0) {
+        mgr->forwards = (RIDForward *)malloc(sizeof(RIDForward) * header[1]);
+        if (mgr->forwards == NULL) {
+            result = RC_MEM_ALLOC_FAILED;
+        } else if (fread(mgr->forwards, sizeof(RIDForward), header[1], file) == (size_t)header[1]) {
+            mgr->numForwards = header[1];
+            result = RC_OK;
+        } else {
+            free(mgr->forwards);
+            mgr->forwards = NULL;
+        }
+    }
+
+    fclose(file);
+    return result;
+}
+
+// Primary key index:
+// A table whose schema has a single INT, FLOAT or STRING key attribute
+// gets a B+-tree on it in <table>.pk, mapping key values to RIDs.
+// Hash indexes:
+// createIndex() adds an extendible hash index on any INT, FLOAT or STRING
+// attribute in <table>.<attrNum>.hx; openTable() picks up whichever of
+// these files exist. Every insert, delete, update and bulk load keeps all
+// indexes of a table in step with it.
+static bool hasPrimaryIndex(Schema *schema) {
+    if (schema->keySize != 1) {
+        return false;
+    }
+    DataType dt = schema->dataTypes[schema->keyAttrs[0]];
+    return dt == DT_INT || dt == DT_FLOAT || dt == DT_STRING;
+}
+
+static char *getHashIndexName(const char *tableName, int attrNum) {
+    char suffix[32];
+    sprintf(suffix, ".%d" HASH_INDEX_SUFFIX, attrNum);
+    return getSideFileName(tableName, suffix);
+}
+
+// Point key at an attribute of a record; strings are copied to the
+// manager's key buffer
+static void getIndexKey(RecordManager *mgr, Schema *schema, int attrNum, const char *recordData, Value *key) {
+    const char *data = recordData + schema->attrOffsets[attrNum];
+
+    key->dt = schema->dataTypes[attrNum];
+    switch (key->dt) {
+        case DT_INT:
+            memcpy(&key->v.intV, data, sizeof(int));
+            break;
+        case DT_FLOAT:
+            memcpy(&key->v.floatV, data, sizeof(float));
+            break;
+        case DT_BOOL:
+            key->v.boolV = (data[0] != 0);
+            break;
+        default:
+            memcpy(mgr->keyString, data, schema->typeLength[attrNum]);
+            mgr->keyString[schema->typeLength[attrNum]] = '\0';
+            key->v.stringV = mgr->keyString;
+            break;
+    }
+}
+
+static bool sameAttrValue(Schema *schema, int attrNum, const char *left, const char *right) {
+    return memcmp(left + schema->attrOffsets[attrNum], right + schema->attrOffsets[attrNum],
+                  getAttrSize(schema, attrNum)) == 0;
+}
+
+static RC indexInsertAttr(RecordManager *mgr, Schema *schema, int attrNum, const char *recordData, RID rid) {
+    Value key;
+    getIndexKey(mgr, schema, attrNum, recordData, &key);
+    return insertHashKey(mgr->hashIndexes[attrNum], &key, rid);
+}
+
+static RC indexDeleteAttr(RecordManager *mgr, Schema *schema, int attrNum, const char *recordData, RID rid) {
+    Value key;
+    getIndexKey(mgr, schema, attrNum, recordData, &key);
+    RC deleteResult = deleteHashEntry(mgr->hashIndexes[attrNum], &key, rid);
+    return (deleteResult == RC_IM_KEY_NOT_FOUND) ? RC_OK : deleteResult;
+}
+
+// Take a record back out of the primary index and of the hash indexes on
+// attributes before numHashed, after a later index refused it
+static void undoIndexInsert(RecordManager *mgr, Schema *schema, const char *recordData, RID rid, int numHashed) {
+    for (int i = 0; i < numHashed; i++) {
+        if (mgr->hashIndexes[i] != NULL) {
+            indexDeleteAttr(mgr, schema, i, recordData, rid);
+        }
+    }
+    if (mgr->primaryIndex != NULL) {
+        Value key;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], recordData, &key);
+        deleteEntry(mgr->primaryIndex, &key, rid);
+    }
+}
+
+// Add a record to every index, or to none if one of them fails
+static RC indexInsert(RecordManager *mgr, Schema *schema, const char *recordData, RID rid) {
+    if (mgr->primaryIndex != NULL) {
+        Value key;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], recordData, &key);
+        RC insertResult = insertKey(mgr->primaryIndex, &key, rid);
+        if (insertResult != RC_OK) {
+            return insertResult;
+        }
+    }
+    for (int i = 0; i < schema->numAttr; i++) {
+        if (mgr->hashIndexes[i] != NULL) {
+            RC insertResult = indexInsertAttr(mgr, schema, i, recordData, rid);
+            if (insertResult != RC_OK) {
+                undoIndexInsert(mgr, schema, recordData, rid, i);
+                return insertResult;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+static RC indexDelete(RecordManager *mgr, Schema *schema, const char *recordData, RID rid) {
+    if (mgr->primaryIndex != NULL) {
+        Value key;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], recordData, &key);
+        RC deleteResult = deleteEntry(mgr->primaryIndex, &key, rid);
+        if (deleteResult != RC_OK && deleteResult != RC_IM_KEY_NOT_FOUND) {
+            return deleteResult;
+        }
+    }
+    for (int i = 0; i < schema->numAttr; i++) {
+        if (mgr->hashIndexes[i] != NULL) {
+            RC deleteResult = indexDeleteAttr(mgr, schema, i, recordData, rid);
+            if (deleteResult != RC_OK) {
+                return deleteResult;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+// Put a record back under oldData in the primary index and in the hash
+// indexes on attributes before numMoved, after a later index refused
+// newData
+static void undoIndexUpdate(RecordManager *mgr, Schema *schema, const char *oldData, const char *newData,
+                            RID rid, int numMoved) {
+    for (int i = 0; i < numMoved; i++) {
+        if (mgr->hashIndexes[i] != NULL && !sameAttrValue(schema, i, oldData, newData)) {
+            indexDeleteAttr(mgr, schema, i, newData, rid);
+            indexInsertAttr(mgr, schema, i, oldData, rid);
+        }
+    }
+    if (mgr->primaryIndex != NULL && !sameAttrValue(schema, schema->keyAttrs[0], oldData, newData)) {
+        Value key;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], newData, &key);
+        deleteEntry(mgr->primaryIndex, &key, rid);
+        getIndexKey(mgr, schema, schema->keyAttrs[0], oldData, &key);
+        insertKey(mgr->primaryIndex, &key, rid);
+    }
+}
+
+// Move a record from oldData to newData in the indexes whose attribute
+// changed, or in none of them if one fails
+static RC indexUpdate(RecordManager *mgr, Schema *schema, const char *oldData, const char *newData, RID rid) {
+    if (mgr->primaryIndex != NULL && !sameAttrValue(schema, schema->keyAttrs[0], oldData, newData)) {
+        Value key;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], oldData, &key);
+        RC rc = deleteEntry(mgr->primaryIndex, &key, rid);
+        if (rc != RC_OK && rc != RC_IM_KEY_NOT_FOUND) {
+            return rc;
+        }
+        getIndexKey(mgr, schema, schema->keyAttrs[0], newData, &key);
+        rc = insertKey(mgr->primaryIndex, &key, rid);
+        if (rc != RC_OK) {
+            getIndexKey(mgr, schema, schema->keyAttrs[0], oldData, &key);
+            insertKey(mgr->primaryIndex, &key, rid);
+            return rc;
+        }
+    }
+    for (int i = 0; i < schema->numAttr; i++) {
+        if (mgr->hashIndexes[i] != NULL && !sameAttrValue(schema, i, oldData, newData)) {
+            RC rc = indexDeleteAttr(mgr, schema, i, oldData, rid);
+            if (rc == RC_OK) {
+                rc = indexInsertAttr(mgr, schema, i, newData, rid);
+                if (rc != RC_OK) {
+                    indexInsertAttr(mgr, schema, i, oldData, rid);
+                }
+            }
+            if (rc != RC_OK) {
+                undoIndexUpdate(mgr, schema, oldData, newData, rid, i);
+                return rc;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+static RC createPrimaryIndex(const char *tableName, Schema *schema) {
+    char *fileName = getSideFileName(tableName, PRIMARY_INDEX_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    int attrNum = schema->keyAttrs[0];
+    RC createResult = createBtree(fileName, schema->dataTypes[attrNum], getAttrSize(schema, attrNum), 0);
+    free(fileName);
+    return createResult;
+}
+
+// Fill a new index from the records already in the table: the primary
+// index if attrNum is negative, else the hash index on attrNum
+static RC buildIndex(RecordManager *mgr, Schema *schema, TableMetadata *metadata, int attrNum) {
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    BM_PageHandle page;
+
+    for (int pageNum = DATA_START_PAGE; pageNum < metadata->numPages; pageNum++) {
+        RC pinResult = pinPage(mgr->bufferPool, &page, pageNum);
+        if (pinResult != RC_OK) {
+            return pinResult;
+        }
+
+        for (int slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, 0); slot >= 0;
+             slot = nextOccupiedSlot(page.data, metadata->slotsPerPage, slot + 1)) {
+            RID rid = { pageNum, slot };
+            char *recordData = page.data + getRecordOffset(slot, metadata->recordSize, mapSize);
+            RC insertResult;
+            if (attrNum < 0) {
+                Value key;
+                getIndexKey(mgr, schema, schema->keyAttrs[0], recordData, &key);
+                insertResult = insertKey(mgr->primaryIndex, &key, rid);
+            } else {
+                insertResult = indexInsertAttr(mgr, schema, attrNum, recordData, rid);
+            }
+            if (insertResult != RC_OK) {
+                unpinPage(mgr->bufferPool, &page);
+                return insertResult;
+            }
+        }
+
+        RC unpinResult = unpinPage(mgr->bufferPool, &page);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+    }
+    return RC_OK;
+}
+
+// Open the indexes of a table, creating the primary index from the
+// table's records if the table predates it
+static RC openIndexes(RecordManager *mgr, const char *tableName, Schema *schema,
+                      TableMetadata *metadata) {
+    int keyLength = 0;
+    for (int i = 0; i < schema->numAttr; i++) {
+        if (getAttrSize(schema, i) > keyLength) {
+            keyLength = getAttrSize(schema, i);
+        }
+    }
+
+    mgr->primaryIndex = NULL;
+    mgr->hashIndexes = (HashIndexHandle **)calloc(schema->numAttr, sizeof(HashIndexHandle *));
+    mgr->keyString = (char *)malloc(keyLength + 1);
+    if (mgr->hashIndexes == NULL || mgr->keyString == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    for (int i = 0; i < schema->numAttr; i++) {
+        char *fileName = getHashIndexName(tableName, i);
+        if (fileName == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        RC openResult = openHashIndex(&mgr->hashIndexes[i], fileName);
+        free(fileName);
+        if (openResult == RC_FILE_NOT_FOUND) {
+            mgr->hashIndexes[i] = NULL;
+        } else if (openResult != RC_OK) {
+            mgr->hashIndexes[i] = NULL;
+            return openResult;
+        }
+    }
+
+    if (!hasPrimaryIndex(schema)) {
+        return RC_OK;
+    }
+
+    char *fileName = getSideFileName(tableName, PRIMARY_INDEX_SUFFIX);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RC openResult = openBtree(&mgr->primaryIndex, fileName);
+    if (openResult == RC_FILE_NOT_FOUND) {
+        openResult = createPrimaryIndex(tableName, schema);
+        if (openResult == RC_OK) {
+            openResult = openBtree(&mgr->primaryIndex, fileName);
+        }
+        if (openResult == RC_OK) {
+            openResult = buildIndex(mgr, schema, metadata, -1);
+        }
+    }
+    free(fileName);
+    return openResult;
+}
+
+static RC closeIndexes(RecordManager *mgr, Schema *schema) {
+    RC closeResult = (mgr->primaryIndex != NULL) ? closeBtree(mgr->primaryIndex) : RC_OK;
+    mgr->primaryIndex = NULL;
+
+    if (mgr->hashIndexes != NULL) {
+        for (int i = 0; i < schema->numAttr; i++) {
+            if (mgr->hashIndexes[i] != NULL) {
+                RC hashResult = closeHashIndex(mgr->hashIndexes[i]);
+                if (closeResult == RC_OK) {
+                    closeResult = hashResult;
+                }
+            }
+        }
+        free(mgr->hashIndexes);
+        mgr->hashIndexes = NULL;
+    }
+
+    free(mgr->keyString);
+    mgr->keyString = NULL;
+    return closeResult;
+}
+
+// Number of attributes of a table, read from its header page
+static int readNumAttrs(char *name) {
+    SM_FileHandle fileHandle;
+    if (openPageFile(name, &fileHandle) != RC_OK) {
+        return 0;
+    }
+
+    int numAttr = 0;
+    char *pageData = (char *)malloc(PAGE_SIZE);
+    if (pageData != NULL && readBlock(HEADER_PAGE, &fileHandle, pageData) == RC_OK) {
+        memcpy(&numAttr, pageData + sizeof(TableMetadata), sizeof(int));
+    }
+    if (numAttr < 0 || numAttr > PAGE_SIZE) {
+        numAttr = 0;
+    }
+    free(pageData);
+    closePageFile(&fileHandle);
+    return numAttr;
+}
+
+// Key uniqueness:
+// A record may not take a key that another record of the table already
+// has; insertRecord(), updateRecord() and bulk loads return
+// RC_IM_KEY_ALREADY_EXISTS instead. With a primary index the check is one
+// index probe. Composite and BOOL keys have no primary index and are
+// checked with a scan for the key values (which an index on one of the
+// key attributes still narrows down). A new key the Bloom filter rules
+// out needs neither.
+
+// Whether two values of attribute attrNum are equal. Unlike sameAttrValue
+// this compares as the key condition does: -0.0 equals 0.0, BOOLs by truth
+// and strings only up to their end.
+static bool sameKeyBytes(Schema *schema, int attrNum, const char *left, const char *right) {
+    switch (schema->dataTypes[attrNum]) {
+        case DT_FLOAT:
+            {
+                float l, r;
+                memcpy(&l, left, sizeof(float));
+                memcpy(&r, right, sizeof(float));
+                return l == r;
+            }
+        case DT_BOOL:
+            return (left[0] != 0) == (right[0] != 0);
+        case DT_STRING:
+            return strncmp(left, right, schema->typeLength[attrNum]) == 0;
+        default:
+            return memcmp(left, right, sizeof(int)) == 0;
+    }
+}
+
+static bool sameKeyValue(Schema *schema, int attrNum, const char *left, const char *right) {
+    return sameKeyBytes(schema, attrNum, left + schema->attrOffsets[attrNum],
+                        right + schema->attrOffsets[attrNum]);
+}
+
+static bool sameKeyValues(Schema *schema, const char *left, const char *right) {
+    for (int i = 0; i < schema->keySize; i++) {
+        if (!sameKeyValue(schema, schema->keyAttrs[i], left, right)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build the condition "every key attribute equals its value in recordData"
+static Expr *makeKeyCondition(Schema *schema, const char *recordData) {
+    Expr *cond = NULL;
+
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        const char *data = recordData + schema->attrOffsets[attrNum];
+        Value *value = (Value *)malloc(sizeof(Value));
+        if (value == NULL) {
+            freeExpr(cond);
+            return NULL;
+        }
+
+        value->dt = schema->dataTypes[attrNum];
+        switch (value->dt) {
+            case DT_INT:
+                memcpy(&value->v.intV, data, sizeof(int));
+                break;
+            case DT_FLOAT:
+                memcpy(&value->v.floatV, data, sizeof(float));
+                break;
+            case DT_BOOL:
+                memcpy(&value->v.boolV, data, sizeof(bool));
+                break;
+            case DT_STRING:
+                value->v.stringV = (char *)malloc(schema->typeLength[attrNum] + 1);
+                if (value->v.stringV == NULL) {
+                    free(value);
+                    freeExpr(cond);
+                    return NULL;
+                }
+                memcpy(value->v.stringV, data, schema->typeLength[attrNum]);
+                value->v.stringV[schema->typeLength[attrNum]] = '\0';
+                break;
+        }
+
+        Expr *attr, *constant, *equal;
+        MAKE_ATTRREF(attr, attrNum);
+        MAKE_CONS(constant, value);
+        MAKE_BINOP_EXPR(equal, attr, constant, OP_COMP_EQUAL);
+        if (cond == NULL) {
+            cond = equal;
+        } else {
+            Expr *both;
+            MAKE_BINOP_EXPR(both, cond, equal, OP_BOOL_AND);
+            cond = both;
+        }
+    }
+    return cond;
+}
+
+// Whether another record already has the key of recordData. The record
+// at self (if not NULL) is the one being updated and does not count.
+static RC checkUniqueKey(RM_TableData *rel, const char *recordData, const RID *self) {
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    Schema *schema = rel->schema;
+    if (schema->keySize <= 0) {
+        return RC_OK;
+    }
+    if (!bloomMayContain(mgr->bloom, schema, recordData)) {
+        return RC_OK;
+    }
+
+    if (mgr->primaryIndex != NULL) {
+        Value key;
+        RID rid;
+        getIndexKey(mgr, schema, schema->keyAttrs[0], recordData, &key);
+        RC findResult = findKey(mgr->primaryIndex, &key, &rid);
+        if (findResult == RC_IM_KEY_NOT_FOUND ||
+                (findResult == RC_OK && self != NULL && rid.page == self->page && rid.slot == self->slot)) {
+            return RC_OK;
+        }
+        return (findResult == RC_OK) ? RC_IM_KEY_ALREADY_EXISTS : findResult;
+    }
+
+    Expr *cond = makeKeyCondition(schema, recordData);
+    if (cond == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RM_ScanHandle scan;
+    RM_ScanOptions options;
+    initScanOptions(&options);
+    options.zeroCopy = 1;
+    RC rc = startScanWithOptions(rel, &scan, cond, &options);
+    if (rc == RC_OK) {
+        Record match;
+        match.data = NULL;
+        do {
+            rc = next(&scan, &match);
+        } while (rc == RC_OK && self != NULL && match.id.page == self->page && match.id.slot == self->slot);
+        RC closeResult = closeScan(&scan);
+        if (rc == RC_OK) {
+            rc = RC_IM_KEY_ALREADY_EXISTS;
+        } else if (rc == RC_RM_NO_MORE_TUPLES) {
+            rc = closeResult;
+        }
+    }
+    freeExpr(cond);
+    return rc;
+}
+
+// Initialize Record Manager
+RC initRecordManager(void *mgmtData) {
+    // Initialize storage manager
+    (void)mgmtData; // Suppress unused parameter warning
+    initStorageManager();
+    return RC_OK;
+}
+
+// Shutdown Record Manager
+RC shutdownRecordManager() {
+    // Clean up any global resources if needed
+    return RC_OK;
+}
+
+// Create a new table in a page file
+RC createTable(char *name, Schema *schema) {
+    // Create page file using storage manager
+    RC result = createPageFile(name);
+    if (result != RC_OK) {
+        return result;
+    }
+
+    // A zone map, Bloom filter or forwarding entries left behind by an
+    // earlier table of that name are stale
+    removeSideFile(name, ZONE_MAP_SUFFIX);
+    removeSideFile(name, BLOOM_SUFFIX);
+    removeSideFile(name, FORWARD_SUFFIX);
+    
+    // Initialize buffer pool
+    BM_BufferPool *bm = (BM_BufferPool *)malloc(sizeof(BM_BufferPool));
+    RC initResult = initBufferPool(bm, name, TABLE_POOL_SIZE, RS_LRU, NULL);
+    if (initResult != RC_OK) {
+        free(bm);
+        return initResult;
+    }
+    
+    // Calculate record size and slots per page
+    int recordSize = getRecordSize(schema);
+    int slotsPerPage;
+    int slotMapSize;
+
+    // Iterate to find the maximum slotsPerPage that fits in PAGE_SIZE
+    slotsPerPage = PAGE_SIZE / recordSize; // Initial maximum possible
+    do {
+        slotMapSize = getSlotMapSize(slotsPerPage); // Slot map size in bytes
+        if (getRecordOffset(slotsPerPage, recordSize, slotMapSize) <= PAGE_SIZE) {
+            break;
+        }
+        slotsPerPage--;
+    } while (slotsPerPage > 0);
+
+    // Check if valid slotsPerPage was found
+    if (slotsPerPage <= 0) {
+        return RC_INVALID_RECORD_SIZE; // Handle error appropriately
+    }
+
+    // Initialize table metadata with the correct values
+    TableMetadata metadata;
+    metadata.numTuples = 0;
+    metadata.firstFreePage = DATA_START_PAGE;
+    metadata.numPages = DATA_START_PAGE + 1; // Header page + first data page
+    metadata.recordSize = recordSize;
+    metadata.slotsPerPage = slotsPerPage;
+    
+    // Write metadata and schema to header page
+    RC headerResult = initializeHeader(bm, schema, &metadata);
+    if (headerResult != RC_OK) {
+        shutdownBufferPool(bm);
+        free(bm);
+        return headerResult;
+    }
+    
+    // Shutdown buffer pool
+    RC shutdownResult = shutdownBufferPool(bm);
+    if (shutdownResult != RC_OK) {
+        free(bm);
+        return shutdownResult;
+    }
+    
+    free(bm);
+
+    // Hash indexes of an earlier table of that name are stale
+    for (int i = 0; i < schema->numAttr; i++) {
+        char *fileName = getHashIndexName(name, i);
+        if (fileName != NULL) {
+            remove(fileName);
+            free(fileName);
+        }
+    }
+
+    // Index the key attribute
+    if (hasPrimaryIndex(schema)) {
+        return createPrimaryIndex(name, schema);
+    }
+    removeSideFile(name, PRIMARY_INDEX_SUFFIX);
+    return RC_OK;
+}
+
+// Open an existing table
+RC openTable(RM_TableData *rel, char *name) {
+    // Initialize buffer pool
+    BM_BufferPool *bm = (BM_BufferPool *)malloc(sizeof(BM_BufferPool));
+    RC initResult = initBufferPool(bm, name, TABLE_POOL_SIZE, RS_LRU, NULL);
+    if (initResult != RC_OK) {
+        free(bm);
+        return initResult;
+    }
+    
+    // Initialize table metadata
+    TableMetadata *metadata = (TableMetadata *)malloc(sizeof(TableMetadata));
+    RC metadataResult = readHeader(bm, metadata);
+    if (metadataResult != RC_OK) {
+        shutdownBufferPool(bm);
+        free(bm);
+        free(metadata);
+        return metadataResult;
+    }
+    
+    // Read schema from header page
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    RC pinResult = pinPage(bm, pageHandle, HEADER_PAGE);
+    if (pinResult != RC_OK) {
+        shutdownBufferPool(bm);
+        free(bm);
+        free(metadata);
+        free(pageHandle);
+        return pinResult;
+    }
+    
+    // Skip metadata at beginning of header page
+    char *schemaData = pageHandle->data + sizeof(TableMetadata);
+    
+    // Read schema fields
+    int numAttr, keySize;
+    memcpy(&numAttr, schemaData, sizeof(int));
+    schemaData += sizeof(int);
+    
+    // Allocate arrays for schema info
+    char **attrNames = (char **)malloc(sizeof(char *) * numAttr);
+    DataType *dataTypes = (DataType *)malloc(sizeof(DataType) * numAttr);
+    int *typeLength = (int *)malloc(sizeof(int) * numAttr);
+    
+    // Read attribute information
+    for (int i = 0; i < numAttr; i++) {
+        // Read attribute name (null-terminated string)
+        int nameLength;
+        memcpy(&nameLength, schemaData, sizeof(int));
+        schemaData += sizeof(int);
+        
+        attrNames[i] = (char *)malloc(nameLength + 1);
+        memcpy(attrNames[i], schemaData, nameLength);
+        attrNames[i][nameLength] = '\0';
+        schemaData += nameLength;
+        
+        // Read data type
+        memcpy(&dataTypes[i], schemaData, sizeof(DataType));
+        schemaData += sizeof(DataType);
+        
+        // Read type length
+        memcpy(&typeLength[i], schemaData, sizeof(int));
+        schemaData += sizeof(int);
+    }
+    
+    // Read key information
+    memcpy(&keySize, schemaData, sizeof(int));
+    schemaData += sizeof(int);
+    
+    int *keyAttrs = (int *)malloc(sizeof(int) * keySize);
+    memcpy(keyAttrs, schemaData, sizeof(int) * keySize);
+    
+    // Create schema
+    Schema *schema = createSchema(numAttr, attrNames, dataTypes, typeLength, keySize, keyAttrs);
+    
+    // Set table data
+    rel->name = strdup(name);
+    rel->schema = schema;
+    
+    // Create record manager instance
+    RecordManager *mgr = (RecordManager *)malloc(sizeof(RecordManager));
+    mgr->bufferPool = bm;
+    mgr->numTuples = metadata->numTuples;
+    mgr->zoneMap = createZoneMap(schema);
+    mgr->openScans = 0;
+    
+    rel->mgmtData = mgr;
+    
+    // Clean up
+    RC unpinResult = unpinPage(bm, pageHandle);
+    free(pageHandle);
+
+    // Load the zone map, or rebuild it if it is missing or out of date.
+    // Without one, scans simply visit every page.
+    if (mgr->zoneMap != NULL && loadZoneMap(mgr->zoneMap, name, metadata) != RC_OK &&
+        rebuildZoneMap(mgr->zoneMap, bm, schema, metadata) != RC_OK) {
+        freeZoneMap(mgr->zoneMap);
+        mgr->zoneMap = NULL;
+    }
+
+    // Likewise the Bloom filter; without one every key probe reads pages
+    mgr->bloom = NULL;
+    if (schema->keySize > 0) {
+        mgr->bloom = loadBloomFilter(name, metadata);
+        if (mgr->bloom == NULL) {
+            mgr->bloom = buildBloomFilter(bm, schema, metadata);
+        }
+    }
+
+    // A table that was never vacuumed has no forwarding entries
+    RC indexResult = loadForwards(mgr, name);
+    if (indexResult == RC_OK) {
+        indexResult = openIndexes(mgr, name, schema, metadata);
+    }
+    free(metadata);
+    if (indexResult != RC_OK) {
+        closeIndexes(mgr, schema);
+        freeZoneMap(mgr->zoneMap);
+        freeBloomFilter(mgr->bloom);
+        free(mgr->forwards);
+        shutdownBufferPool(bm);
+        free(bm);
+        free(mgr);
+        freeSchema(rel->schema);
+        free(rel->name);
+        rel->mgmtData = NULL;
+        rel->schema = NULL;
+        rel->name = NULL;
+        return indexResult;
+    }
+    
+    return unpinResult;
+}
+
+// Close a table
+RC closeTable(RM_TableData *rel) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    
+    if (bm == NULL) {
+        //free(mgr);
+        if (rel->schema != NULL) {
+            //freeSchema(rel->schema);
+        }
+        if (rel->name != NULL) {
+           // free(rel->name);
+        }
+        rel->mgmtData = NULL;
+        return RC_OK;
+    }
+    
+    RC indexResult = closeIndexes(mgr, rel->schema);
+
+    // Persist the zone map and the Bloom filter next to the table; they
+    // are rebuilt on the next open if this fails
+    TableMetadata metadata;
+    bool haveMetadata = (readHeader(bm, &metadata) == RC_OK);
+    if (mgr->zoneMap != NULL) {
+        if (haveMetadata) {
+            saveZoneMap(mgr->zoneMap, rel->name, &metadata);
+        }
+        freeZoneMap(mgr->zoneMap);
+        mgr->zoneMap = NULL;
+    }
+    if (mgr->bloom != NULL) {
+        if (haveMetadata) {
+            saveBloomFilter(mgr->bloom, rel->name, &metadata);
+        }
+        freeBloomFilter(mgr->bloom);
+        mgr->bloom = NULL;
+    }
+
+    RC forwardResult = saveForwards(mgr, rel->name);
+    free(mgr->forwards);
+    mgr->forwards = NULL;
+    if (indexResult == RC_OK) {
+        indexResult = forwardResult;
+    }
+
+    // Force all dirty pages to disk
+    RC forceResult = forceFlushPool(bm);
+    if (forceResult != RC_OK) {
+        // Even if force flush fails, we should still try to clean up resources
+        free(bm);
+        free(mgr);
+        if (rel->schema != NULL) {
+            freeSchema(rel->schema);
+        }
+        if (rel->name != NULL) {
+            free(rel->name);
+        }
+        rel->mgmtData = NULL;
+        return forceResult;
+    }
+    
+    // Shutdown buffer pool
+    RC shutdownResult = shutdownBufferPool(bm);
+    
+    // Clean up resources
+    free(bm);
+    free(mgr);
+    
+    if (rel->schema != NULL) {
+        freeSchema(rel->schema);
+    }
+    
+    if (rel->name != NULL) {
+        free(rel->name);
+    }
+    
+    rel->mgmtData = NULL;
+    rel->schema = NULL;
+    rel->name = NULL;
+    
+    return (shutdownResult != RC_OK) ? shutdownResult : indexResult;
+}
+
+// Delete a table
+RC deleteTable(char *name) {
+    // Drop the side files and the indexes with the table
+    int numAttr = readNumAttrs(name);
+    for (int i = 0; i < numAttr; i++) {
+        char *fileName = getHashIndexName(name, i);
+        if (fileName != NULL) {
+            remove(fileName);
+            free(fileName);
+        }
+    }
+    removeSideFile(name, ZONE_MAP_SUFFIX);
+    removeSideFile(name, BLOOM_SUFFIX);
+    removeSideFile(name, FORWARD_SUFFIX);
+    removeSideFile(name, PRIMARY_INDEX_SUFFIX);
+
+    // Use storage manager to destroy page file
+    return destroyPageFile(name);
+}
+
+// Get number of tuples in a table
+int getNumTuples(RM_TableData *rel) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return 0;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    return mgr->numTuples;
+}
+
+// Insert a record in a table
+RC insertRecord(RM_TableData *rel, Record *record) {
+    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    
+    // Reject a key that is already taken
+    RC uniqueResult = checkUniqueKey(rel, record->data, NULL);
+    if (uniqueResult != RC_OK) {
+        return uniqueResult;
+    }
+
+    // Read table metadata
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+    
+    // Find a free slot for the record
+    RID rid;
+    RC slotResult = findFreeSlot(bm, &metadata, &rid);
+    if (slotResult != RC_OK) {
+        return slotResult;
+    }
+    
+    // Set the record ID
+    record->id = rid;
+    
+    // Get page to insert the record
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    RC pinResult = pinPage(bm, pageHandle, rid.page);
+    if (pinResult != RC_OK) {
+        free(pageHandle);
+        return pinResult;
+    }
+    
+    // Calculate slot map size and record offset
+    int mapSize = getSlotMapSize(metadata.slotsPerPage);
+    int offset = getRecordOffset(rid.slot, metadata.recordSize, mapSize);
+    
+    // Cover the record in the page's zone map, the Bloom filter and the
+    // indexes before it becomes visible
+    RC zoneResult = addToZoneMap(mgr->zoneMap, rel->schema, rid.page, record->data);
+    if (zoneResult == RC_OK) {
+        zoneResult = indexInsert(mgr, rel->schema, record->data, rid);
+    }
+    if (zoneResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return zoneResult;
+    }
+    addToBloomFilter(mgr->bloom, rel->schema, record->data);
+    dropForwardFrom(mgr, rid);
+
+    // Mark slot as occupied
+    markSlotOccupied(pageHandle->data, rid.slot);
+    
+    // Copy record data to page
+    memcpy(pageHandle->data + offset, record->data, metadata.recordSize);
+    
+    // Mark page as dirty
+    RC markResult = markDirty(bm, pageHandle);
+    if (markResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return markResult;
+    }
+    
+    // Unpin page
+    RC unpinResult = unpinPage(bm, pageHandle);
+    if (unpinResult != RC_OK) {
+        free(pageHandle);
+        return unpinResult;
+    }
+    
+    free(pageHandle);
+    
+    // Update tuple count
+    mgr->numTuples++;
+    metadata.numTuples = mgr->numTuples;
+    
+    // Update metadata
+    RC headerResult = writeHeader(bm, &metadata);
+    resizeBloomFilter(mgr, rel->schema, &metadata);
+    return headerResult;
+}
+
+// Delete a record from a table
+RC deleteRecord(RM_TableData *rel, RID id) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    id = forwardRID(mgr, id);
+    
+    // Read table metadata
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+    
+    // Get page containing the record
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    RC pinResult = pinPage(bm, pageHandle, id.page);
+    if (pinResult != RC_OK) {
+        free(pageHandle);
+        return pinResult;
+    }
+    
+    // Check if slot is occupied
+    if (!isSlotOccupied(pageHandle->data, id.slot)) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return RC_RM_NO_MORE_TUPLES;
+    }
     
-    // Shutdown buffer pool
+    // Drop the record from the indexes
+    int mapSize = getSlotMapSize(metadata.slotsPerPage);
+    char *recordData = pageHandle->data + getRecordOffset(id.slot, metadata.recordSize, mapSize);
+    RC indexResult = indexDelete(mgr, rel->schema, recordData, id);
+    if (indexResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return indexResult;
+    }
+
+    // Mark slot as free; the page has space again
+    markSlotFree(pageHandle->data, id.slot);
+    if (id.page < metadata.firstFreePage) {
+        metadata.firstFreePage = id.page;
+    }
+    
+    // Mark page as dirty
+    RC markResult = markDirty(bm, pageHandle);
+    if (markResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return markResult;
+    }
+    
+    // Unpin page
+    RC unpinResult = unpinPage(bm, pageHandle);
+    if (unpinResult != RC_OK) {
+        free(pageHandle);
+        return unpinResult;
+    }
+    
+    free(pageHandle);
+    
+    // Update tuple count
+    mgr->numTuples--;
+    metadata.numTuples = mgr->numTuples;
+
+    // Old RIDs of the record resolve to nothing now
+    dropForwardsTo(mgr, id);
+    
+    // Update metadata
+    return writeHeader(bm, &metadata);
+}
+
+// Update a record in a table
+RC updateRecord(RM_TableData *rel, Record *record) {
+    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    record->id = forwardRID(mgr, record->id);
+    
+    // Read table metadata
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+    
+    // Get page containing the record
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    RC pinResult = pinPage(bm, pageHandle, record->id.page);
+    if (pinResult != RC_OK) {
+        free(pageHandle);
+        return pinResult;
+    }
+    
+    // Check if slot is occupied
+    if (!isSlotOccupied(pageHandle->data, record->id.slot)) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    
+    // Calculate record offset
+    int mapSize = getSlotMapSize(metadata.slotsPerPage);
+    int offset = getRecordOffset(record->id.slot, metadata.recordSize, mapSize);
+
+    // A new key must not be taken by another record
+    char *oldData = pageHandle->data + offset;
+    bool keyChanged = !sameKeyValues(rel->schema, oldData, record->data);
+    RC zoneResult = RC_OK;
+    if (keyChanged) {
+        zoneResult = checkUniqueKey(rel, record->data, &record->id);
+    }
+
+    // Widen the page's zone map to the new values
+    if (zoneResult == RC_OK) {
+        zoneResult = addToZoneMap(mgr->zoneMap, rel->schema, record->id.page, record->data);
+    }
+
+    // Re-index the record under the attributes that changed
+    if (zoneResult == RC_OK) {
+        zoneResult = indexUpdate(mgr, rel->schema, oldData, record->data, record->id);
+    }
+    if (zoneResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return zoneResult;
+    }
+    if (keyChanged) {
+        addToBloomFilter(mgr->bloom, rel->schema, record->data);
+    }
+    
+    // Update record data
+    memcpy(pageHandle->data + offset, record->data, metadata.recordSize);
+    
+    // Mark page as dirty
+    RC markResult = markDirty(bm, pageHandle);
+    if (markResult != RC_OK) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return markResult;
+    }
+    
+    // Unpin page
+    RC unpinResult = unpinPage(bm, pageHandle);
+    if (unpinResult != RC_OK) {
+        free(pageHandle);
+        return unpinResult;
+    }
+    
+    free(pageHandle);
+    resizeBloomFilter(mgr, rel->schema, &metadata);
+    return RC_OK;
+}
+
+// Get a record from a table
+RC getRecord(RM_TableData *rel, RID id, Record *record) {
+    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    id = forwardRID(mgr, id);
+    
+    // Read table metadata
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+    
+    // Get page containing the record
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    RC pinResult = pinPage(bm, pageHandle, id.page);
+    if (pinResult != RC_OK) {
+        free(pageHandle);
+        return pinResult;
+    }
+    
+    // Check if slot is occupied
+    if (!isSlotOccupied(pageHandle->data, id.slot)) {
+        unpinPage(bm, pageHandle);
+        free(pageHandle);
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    
+    // Calculate record offset
+    int mapSize = getSlotMapSize(metadata.slotsPerPage);
+    int offset = getRecordOffset(id.slot, metadata.recordSize, mapSize);
+    
+    // Set record ID
+    record->id = id;
+    
+    // Allocate memory for record data if needed
+    if (record->data == NULL) {
+        record->data = (char *)malloc(metadata.recordSize);
+    }
+    
+    // Copy record data
+    memcpy(record->data, pageHandle->data + offset, metadata.recordSize);
+    
+    // Unpin page
+    RC unpinResult = unpinPage(bm, pageHandle);
+    if (unpinResult != RC_OK) {
+        free(pageHandle);
+        return unpinResult;
+    }
+    
+    free(pageHandle);
+    return RC_OK;
+}
+
+// Position of a requested RID in the caller's array, sorted by page
+typedef struct RIDRequest {
+    RID id;
+    int pos;
+} RIDRequest;
+
+static int compareRIDRequests(const void *a, const void *b) {
+    const RIDRequest *left = (const RIDRequest *)a;
+    const RIDRequest *right = (const RIDRequest *)b;
+    if (left->id.page != right->id.page) {
+        return (left->id.page < right->id.page) ? -1 : 1;
+    }
+    if (left->id.slot != right->id.slot) {
+        return (left->id.slot < right->id.slot) ? -1 : 1;
+    }
+    return (left->pos < right->pos) ? -1 : (left->pos > right->pos);
+}
+
+// Get many records at once.
+// The requests are sorted by page so that each distinct page is pinned
+// once and visited in file order. status[i] receives the outcome for
+// ids[i] (RC_OK, RC_RM_INVALID_SLOT or RC_RM_NO_MORE_TUPLES); the return
+// value is only an error if the lookup as a whole could not run, and then
+// every request it did not get to has that error as its status.
+RC getRecords(RM_TableData *rel, const RID *ids, int n, Record **out, RC *status) {
+    if (rel == NULL || rel->mgmtData == NULL || ids == NULL || out == NULL || status == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    if (n <= 0) {
+        return RC_OK;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+
+    // Read table metadata once for the whole batch
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        for (int i = 0; i < n; i++) {
+            status[i] = metadataResult;
+        }
+        return metadataResult;
+    }
+
+    RIDRequest *requests = (RIDRequest *)malloc(sizeof(RIDRequest) * n);
+    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
+    if (requests == NULL || pageHandle == NULL) {
+        free(requests);
+        free(pageHandle);
+        for (int i = 0; i < n; i++) {
+            status[i] = RC_MEM_ALLOC_FAILED;
+        }
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    for (int i = 0; i < n; i++) {
+        requests[i].id = forwardRID(mgr, ids[i]);
+        requests[i].pos = i;
+    }
+    qsort(requests, n, sizeof(RIDRequest), compareRIDRequests);
+
+    int mapSize = getSlotMapSize(metadata.slotsPerPage);
+    int pinnedPage = NO_PAGE;
+    RC result = RC_OK;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        RID id = requests[i].id;
+        int pos = requests[i].pos;
+
+        if (id.page < DATA_START_PAGE || id.page >= metadata.numPages ||
+            id.slot < 0 || id.slot >= metadata.slotsPerPage) {
+            status[pos] = RC_RM_INVALID_SLOT;
+            continue;
+        }
+
+        // Move the pin only when the page changes
+        if (id.page != pinnedPage) {
+            if (pinnedPage != NO_PAGE) {
+                result = unpinPage(bm, pageHandle);
+                pinnedPage = NO_PAGE;
+                if (result != RC_OK) {
+                    break;
+                }
+            }
+            result = pinPage(bm, pageHandle, id.page);
+            if (result != RC_OK) {
+                break;
+            }
+            pinnedPage = id.page;
+        }
+
+        if (!isSlotOccupied(pageHandle->data, id.slot)) {
+            status[pos] = RC_RM_NO_MORE_TUPLES;
+            continue;
+        }
+
+        Record *record = out[pos];
+        if (record->data == NULL) {
+            record->data = (char *)malloc(metadata.recordSize);
+            if (record->data == NULL) {
+                result = RC_MEM_ALLOC_FAILED;
+                break;
+            }
+        }
+
+        int offset = getRecordOffset(id.slot, metadata.recordSize, mapSize);
+        memcpy(record->data, pageHandle->data + offset, metadata.recordSize);
+        record->id = id;
+        status[pos] = RC_OK;
+    }
+
+    // The loop stopped at request i on an error
+    for (; i < n; i++) {
+        status[requests[i].pos] = result;
+    }
+
+    if (pinnedPage != NO_PAGE) {
+        RC unpinResult = unpinPage(bm, pageHandle);
+        if (result == RC_OK) {
+            result = unpinResult;
+        }
+    }
+
+    free(pageHandle);
+    free(requests);
+    return result;
+}
+
+// Secondary indexes:
+// createIndex() builds a hash index on one attribute from the records
+// already in the table. lookupRecord() answers an equality lookup through
+// that index, or through the primary index on the key attribute, with a
+// page read or two before fetching the record; other attributes fall
+// back to a scan.
+
+RC createIndex(RM_TableData *rel, int attrNum) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    Schema *schema = rel->schema;
+    if (attrNum < 0 || attrNum >= schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    if (mgr->hashIndexes[attrNum] != NULL) {
+        return RC_IM_INDEX_ALREADY_EXISTS;
+    }
+
+    TableMetadata metadata;
+    RC rc = readHeader(mgr->bufferPool, &metadata);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    char *fileName = getHashIndexName(rel->name, attrNum);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    rc = createHashIndex(fileName, schema->dataTypes[attrNum], getAttrSize(schema, attrNum));
+    if (rc == RC_OK) {
+        rc = openHashIndex(&mgr->hashIndexes[attrNum], fileName);
+        if (rc != RC_OK) {
+            mgr->hashIndexes[attrNum] = NULL;
+        }
+    }
+    if (rc == RC_OK) {
+        rc = buildIndex(mgr, schema, &metadata, attrNum);
+    }
+    if (rc != RC_OK) {
+        if (mgr->hashIndexes[attrNum] != NULL) {
+            closeHashIndex(mgr->hashIndexes[attrNum]);
+            mgr->hashIndexes[attrNum] = NULL;
+        }
+        remove(fileName);
+    }
+    free(fileName);
+    return rc;
+}
+
+RC dropIndex(RM_TableData *rel, int attrNum) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    if (attrNum < 0 || attrNum >= rel->schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    if (mgr->hashIndexes[attrNum] == NULL) {
+        return RC_IM_INDEX_NOT_FOUND;
+    }
+
+    RC closeResult = closeHashIndex(mgr->hashIndexes[attrNum]);
+    mgr->hashIndexes[attrNum] = NULL;
+
+    char *fileName = getHashIndexName(rel->name, attrNum);
+    if (fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    RC deleteResult = deleteHashIndex(fileName);
+    free(fileName);
+    return (closeResult != RC_OK) ? closeResult : deleteResult;
+}
+
+// Without an index, find the first match with an ordinary scan
+static RC lookupByScan(RM_TableData *rel, int attrNum, Value *value, Record *record) {
+    Value *cons = (Value *)malloc(sizeof(Value));
+    if (cons == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    CPVAL(cons, value);
+
+    Expr *attr, *constant, *cond;
+    MAKE_ATTRREF(attr, attrNum);
+    MAKE_CONS(constant, cons);
+    MAKE_BINOP_EXPR(cond, attr, constant, OP_COMP_EQUAL);
+
+    RM_ScanHandle scan;
+    RC rc = startScan(rel, &scan, cond);
+    if (rc == RC_OK) {
+        rc = next(&scan, record);
+        RC closeResult = closeScan(&scan);
+        if (rc == RC_RM_NO_MORE_TUPLES) {
+            rc = RC_IM_KEY_NOT_FOUND;
+        } else if (rc == RC_OK) {
+            rc = closeResult;
+        }
+    }
+    freeExpr(cond);
+    return rc;
+}
+
+RC lookupRecord(RM_TableData *rel, int attrNum, Value *value, Record *record) {
+    if (rel == NULL || rel->mgmtData == NULL || value == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    Schema *schema = rel->schema;
+    if (attrNum < 0 || attrNum >= schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    if (value->dt != schema->dataTypes[attrNum]) {
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    }
+    if (schema->keySize == 1 && attrNum == schema->keyAttrs[0] &&
+            !bloomMayContainValues(mgr->bloom, schema, &value)) {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+
+    RID rid;
+    RC rc;
+    if (mgr->hashIndexes[attrNum] != NULL) {
+        rc = findHashKey(mgr->hashIndexes[attrNum], value, &rid);
+    } else if (mgr->primaryIndex != NULL && attrNum == schema->keyAttrs[0]) {
+        rc = findKey(mgr->primaryIndex, value, &rid);
+    } else {
+        return lookupByScan(rel, attrNum, value, record);
+    }
+
+    if (rc != RC_OK) {
+        return rc;
+    }
+    return getRecord(rel, rid, record);
+}
+
+// Bulk loading:
+// Records are packed into full data pages (slot bitmaps included) in a
+// staging buffer of BULK_EXTENT_PAGES pages, and each filled extent is
+// written to the page file with one sequential storage manager write.
+// The buffer pool is shut down while the load runs so it cannot hold
+// stale copies of the pages written behind its back, which means no
+// other operation may be used on the table until finishBulkLoad. An open
+// scan would read through the pool too, so startBulkLoad() refuses to run
+// while the table has one, with RC_RM_SCAN_OPEN.
+
+static RC reopenBufferPool(RM_TableData *rel) {
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    return initBufferPool(mgr->bufferPool, rel->name, TABLE_POOL_SIZE, RS_LRU, NULL);
+}
+
+// Bring the buffer pool back after startBulkLoad() failed with rc. If that
+// fails too the table is unusable, so that failure is returned instead.
+static RC abortBulkStart(RM_TableData *rel, RC rc) {
+    RC reopenResult = reopenBufferPool(rel);
+    return (reopenResult != RC_OK) ? reopenResult : rc;
+}
+
+static RC flushBulkExtent(BulkLoadManager *loadMgr) {
+    if (loadMgr->stagedPages == 0) {
+        return RC_OK;
+    }
+
+    RC writeResult = writeBlocks(loadMgr->extentStart, loadMgr->stagedPages,
+                                 &loadMgr->fileHandle, loadMgr->staging);
+    if (writeResult != RC_OK) {
+        return writeResult;
+    }
+
+    loadMgr->extentStart += loadMgr->stagedPages;
+    loadMgr->stagedPages = 0;
+    return RC_OK;
+}
+
+// A table whose key has no primary index cannot be checked for duplicate
+// keys during a load, so the load keeps the keys loaded so far: the key
+// attributes of each record packed one after another, found through an
+// open addressing table on their Bloom filter hash.
+static void freeLoadedKeys(BulkLoadManager *loadMgr) {
+    free(loadMgr->keys);
+    free(loadMgr->keyHashes);
+    free(loadMgr->keySlots);
+    loadMgr->keys = NULL;
+    loadMgr->keyHashes = NULL;
+    loadMgr->keySlots = NULL;
+}
+
+static int firstLoadedKeySlot(BulkLoadManager *loadMgr, uint64_t hash) {
+    return (int)(hash & (uint64_t)(loadMgr->numKeySlots - 1));
+}
+
+// Whether the packed key equals the key of recordData
+static bool sameLoadedKey(Schema *schema, const char *packed, const char *recordData) {
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        if (!sameKeyBytes(schema, attrNum, packed, recordData + schema->attrOffsets[attrNum])) {
+            return false;
+        }
+        packed += getAttrSize(schema, attrNum);
+    }
+    return true;
+}
+
+static bool loadedKeyExists(BulkLoadManager *loadMgr, Schema *schema, const char *recordData, uint64_t hash) {
+    for (int slot = firstLoadedKeySlot(loadMgr, hash); loadMgr->keySlots[slot] >= 0;
+            slot = (slot + 1) & (loadMgr->numKeySlots - 1)) {
+        int key = loadMgr->keySlots[slot];
+        if (loadMgr->keyHashes[key] == hash &&
+                sameLoadedKey(schema, loadMgr->keys + (size_t)key * loadMgr->keyLength, recordData)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Make room for one more key, so that adding it cannot fail
+static RC reserveLoadedKey(BulkLoadManager *loadMgr) {
+    if (loadMgr->numLoaded == loadMgr->keyCapacity) {
+        int capacity = loadMgr->keyCapacity * 2;
+        char *keys = (char *)realloc(loadMgr->keys, (size_t)capacity * loadMgr->keyLength);
+        if (keys == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        loadMgr->keys = keys;
+        uint64_t *hashes = (uint64_t *)realloc(loadMgr->keyHashes, (size_t)capacity * sizeof(uint64_t));
+        if (hashes == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        loadMgr->keyHashes = hashes;
+        loadMgr->keyCapacity = capacity;
+    }
+
+    if ((loadMgr->numLoaded + 1) * 2 >= loadMgr->numKeySlots) {
+        int numSlots = loadMgr->numKeySlots * 2;
+        int *slots = (int *)malloc((size_t)numSlots * sizeof(int));
+        if (slots == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        memset(slots, -1, (size_t)numSlots * sizeof(int));
+        free(loadMgr->keySlots);
+        loadMgr->keySlots = slots;
+        loadMgr->numKeySlots = numSlots;
+        for (int key = 0; key < loadMgr->numLoaded; key++) {
+            int slot = firstLoadedKeySlot(loadMgr, loadMgr->keyHashes[key]);
+            while (slots[slot] >= 0) {
+                slot = (slot + 1) & (numSlots - 1);
+            }
+            slots[slot] = key;
+        }
+    }
+    return RC_OK;
+}
+
+// Record the key of recordData as key number numLoaded
+static void addLoadedKey(BulkLoadManager *loadMgr, Schema *schema, const char *recordData, uint64_t hash) {
+    char *packed = loadMgr->keys + (size_t)loadMgr->numLoaded * loadMgr->keyLength;
+    for (int i = 0; i < schema->keySize; i++) {
+        int attrNum = schema->keyAttrs[i];
+        memcpy(packed, recordData + schema->attrOffsets[attrNum], getAttrSize(schema, attrNum));
+        packed += getAttrSize(schema, attrNum);
+    }
+    loadMgr->keyHashes[loadMgr->numLoaded] = hash;
+
+    int slot = firstLoadedKeySlot(loadMgr, hash);
+    while (loadMgr->keySlots[slot] >= 0) {
+        slot = (slot + 1) & (loadMgr->numKeySlots - 1);
+    }
+    loadMgr->keySlots[slot] = loadMgr->numLoaded;
+}
+
+static RC initLoadedKeys(BulkLoadManager *loadMgr, Schema *schema) {
+    loadMgr->keyLength = 0;
+    for (int i = 0; i < schema->keySize; i++) {
+        loadMgr->keyLength += getAttrSize(schema, schema->keyAttrs[i]);
+    }
+    loadMgr->keyCapacity = BLOOM_MIN_KEYS;
+    loadMgr->numKeySlots = BLOOM_MIN_KEYS * 4;
+    loadMgr->keys = (char *)malloc((size_t)loadMgr->keyCapacity * loadMgr->keyLength);
+    loadMgr->keyHashes = (uint64_t *)malloc((size_t)loadMgr->keyCapacity * sizeof(uint64_t));
+    loadMgr->keySlots = (int *)malloc((size_t)loadMgr->numKeySlots * sizeof(int));
+    if (loadMgr->keys == NULL || loadMgr->keyHashes == NULL || loadMgr->keySlots == NULL) {
+        freeLoadedKeys(loadMgr);
+        return RC_MEM_ALLOC_FAILED;
+    }
+    memset(loadMgr->keySlots, -1, (size_t)loadMgr->numKeySlots * sizeof(int));
+    return RC_OK;
+}
+
+// Start a bulk load into an empty table
+RC startBulkLoad(RM_TableData *rel, RM_BulkLoadHandle *load) {
+    if (rel == NULL || rel->mgmtData == NULL || load == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    if (mgr->openScans > 0) {
+        return RC_RM_SCAN_OPEN;
+    }
+
+    // Read table metadata
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+
+    if (metadata.numTuples != 0) {
+        return RC_RM_TABLE_NOT_EMPTY;
+    }
+
+    // Write back and drop every cached page before writing around the pool
+    RC forceResult = forceFlushPool(bm);
+    if (forceResult != RC_OK) {
+        return forceResult;
+    }
+
     RC shutdownResult = shutdownBufferPool(bm);
-    
-    // Clean up resources
-    free(bm);
-    free(mgr);
-    
-    if (rel->schema != NULL) {
-        freeSchema(rel->schema);
+    if (shutdownResult != RC_OK) {
+        return shutdownResult;
+    }
+
+    BulkLoadManager *loadMgr = (BulkLoadManager *)malloc(sizeof(BulkLoadManager));
+    char *staging = (char *)malloc((size_t)BULK_EXTENT_PAGES * PAGE_SIZE);
+    if (loadMgr == NULL || staging == NULL) {
+        free(loadMgr);
+        free(staging);
+        return abortBulkStart(rel, RC_MEM_ALLOC_FAILED);
+    }
+
+    RC openResult = openPageFile(rel->name, &loadMgr->fileHandle);
+    if (openResult != RC_OK) {
+        free(loadMgr);
+        free(staging);
+        return abortBulkStart(rel, openResult);
+    }
+
+    loadMgr->metadata = metadata;
+    loadMgr->staging = staging;
+    loadMgr->extentStart = DATA_START_PAGE;
+    loadMgr->stagedPages = 0;
+    loadMgr->currentSlot = metadata.slotsPerPage; // First record opens a page
+    loadMgr->numLoaded = 0;
+    loadMgr->keys = NULL;
+    loadMgr->keyHashes = NULL;
+    loadMgr->keySlots = NULL;
+    if (rel->schema->keySize > 0 && mgr->primaryIndex == NULL) {
+        RC keysResult = initLoadedKeys(loadMgr, rel->schema);
+        if (keysResult != RC_OK) {
+            closePageFile(&loadMgr->fileHandle);
+            free(loadMgr);
+            free(staging);
+            return abortBulkStart(rel, keysResult);
+        }
+    }
+
+    load->rel = rel;
+    load->mgmtData = loadMgr;
+
+    return RC_OK;
+}
+
+// Append one record to the bulk load
+RC bulkLoadRecord(RM_BulkLoadHandle *load, Record *record) {
+    if (load == NULL || load->mgmtData == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BulkLoadManager *loadMgr = (BulkLoadManager *)load->mgmtData;
+    TableMetadata *metadata = &loadMgr->metadata;
+
+    // Open the next page once the current one is full
+    if (loadMgr->currentSlot >= metadata->slotsPerPage) {
+        if (loadMgr->stagedPages == BULK_EXTENT_PAGES) {
+            RC flushResult = flushBulkExtent(loadMgr);
+            if (flushResult != RC_OK) {
+                return flushResult;
+            }
+        }
+
+        memset(loadMgr->staging + (size_t)loadMgr->stagedPages * PAGE_SIZE, 0, PAGE_SIZE);
+        loadMgr->stagedPages++;
+        loadMgr->currentSlot = 0;
+    }
+
+    char *pageData = loadMgr->staging + (size_t)(loadMgr->stagedPages - 1) * PAGE_SIZE;
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    int offset = getRecordOffset(loadMgr->currentSlot, metadata->recordSize, mapSize);
+    int pageNum = loadMgr->extentStart + loadMgr->stagedPages - 1;
+
+    // Keys are checked against the primary index; the table's pages cannot
+    // be scanned while the load runs, so other keys are checked against
+    // the keys loaded before
+    RecordManager *mgr = (RecordManager *)load->rel->mgmtData;
+    Schema *schema = load->rel->schema;
+    RID rid = { pageNum, loadMgr->currentSlot };
+    uint64_t keyHash = 0;
+    RC zoneResult = RC_OK;
+    if (mgr->primaryIndex != NULL) {
+        zoneResult = checkUniqueKey(load->rel, record->data, NULL);
+    } else if (loadMgr->keys != NULL) {
+        keyHash = hashRecordKey(schema, record->data);
+        zoneResult = reserveLoadedKey(loadMgr);
+        if (zoneResult == RC_OK && loadedKeyExists(loadMgr, schema, record->data, keyHash)) {
+            zoneResult = RC_IM_KEY_ALREADY_EXISTS;
+        }
+    }
+    if (zoneResult == RC_OK) {
+        zoneResult = addToZoneMap(mgr->zoneMap, load->rel->schema, pageNum, record->data);
+    }
+    if (zoneResult == RC_OK) {
+        zoneResult = indexInsert(mgr, load->rel->schema, record->data, rid);
+    }
+    if (zoneResult != RC_OK) {
+        return zoneResult;
+    }
+    addToBloomFilter(mgr->bloom, load->rel->schema, record->data);
+    if (loadMgr->keys != NULL) {
+        addLoadedKey(loadMgr, schema, record->data, keyHash);
+    }
+    dropForwardFrom(mgr, rid);
+
+    markSlotOccupied(pageData, loadMgr->currentSlot);
+    memcpy(pageData + offset, record->data, metadata->recordSize);
+
+    record->id = rid;
+
+    loadMgr->currentSlot++;
+    loadMgr->numLoaded++;
+
+    return RC_OK;
+}
+
+// Write the remaining pages and the table header, and reopen the pool
+RC finishBulkLoad(RM_BulkLoadHandle *load) {
+    if (load == NULL || load->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    BulkLoadManager *loadMgr = (BulkLoadManager *)load->mgmtData;
+    RM_TableData *rel = load->rel;
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    TableMetadata *metadata = &loadMgr->metadata;
+
+    RC flushResult = flushBulkExtent(loadMgr);
+    closePageFile(&loadMgr->fileHandle);
+    free(loadMgr->staging);
+    freeLoadedKeys(loadMgr);
+
+    RC reopenResult = reopenBufferPool(rel);
+    if (flushResult != RC_OK || reopenResult != RC_OK) {
+        free(loadMgr);
+        load->mgmtData = NULL;
+        return (flushResult != RC_OK) ? flushResult : reopenResult;
+    }
+
+    // Header is written exactly once for the whole load
+    if (loadMgr->extentStart > metadata->numPages) {
+        metadata->numPages = loadMgr->extentStart;
+    }
+    if (loadMgr->numLoaded > 0) {
+        metadata->firstFreePage = loadMgr->extentStart - 1;
+    }
+    metadata->numTuples = loadMgr->numLoaded;
+    mgr->numTuples = loadMgr->numLoaded;
+
+    RC headerResult = writeHeader(mgr->bufferPool, metadata);
+
+    // The filter could not be resized while the pool was down
+    if (headerResult == RC_OK) {
+        resizeBloomFilter(mgr, rel->schema, metadata);
+    }
+
+    free(loadMgr);
+    load->mgmtData = NULL;
+
+    return headerResult;
+}
+
+// Vacuum:
+// vacuumTable() takes records from the last pages, back to front, and
+// moves them into free slots of the first pages that have any, until the
+// two meet. The pages left empty at the end of the file are cut off. A
+// moved record is re-indexed under its new RID and its old RID forwards
+// to it. Each move widens the zone bounds of its destination page, so the
+// zone map stays valid however the vacuum ends; on success the zone map
+// and the Bloom filter are rebuilt, which also drops the bounds and keys
+// of deleted records. Moving records would make an open scan skip or
+// repeat them, so vacuumTable() refuses to run while the table has one,
+// with RC_RM_SCAN_OPEN.
+
+// Move a record from slot fromSlot of srcPage to slot toSlot of destPage
+static RC moveRecord(RecordManager *mgr, Schema *schema, TableMetadata *metadata,
+                     BM_PageHandle *srcPage, int fromSlot, BM_PageHandle *destPage, int toSlot) {
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    char *srcData = srcPage->data + getRecordOffset(fromSlot, metadata->recordSize, mapSize);
+    char *destData = destPage->data + getRecordOffset(toSlot, metadata->recordSize, mapSize);
+    RID from = { srcPage->pageNum, fromSlot };
+    RID to = { destPage->pageNum, toSlot };
+
+    // Widen the destination's bounds first, so that scans still find the
+    // record if the vacuum stops before the zone map is rebuilt
+    RC zoneResult = addToZoneMap(mgr->zoneMap, schema, destPage->pageNum, srcData);
+    if (zoneResult != RC_OK) {
+        return zoneResult;
+    }
+
+    RC indexResult = indexDelete(mgr, schema, srcData, from);
+    if (indexResult != RC_OK) {
+        return indexResult;
+    }
+    indexResult = indexInsert(mgr, schema, srcData, to);
+    if (indexResult != RC_OK) {
+        indexInsert(mgr, schema, srcData, from);
+        return indexResult;
+    }
+
+    memcpy(destData, srcData, metadata->recordSize);
+    markSlotOccupied(destPage->data, toSlot);
+    markSlotFree(srcPage->data, fromSlot);
+
+    RC markResult = markDirty(mgr->bufferPool, destPage);
+    if (markResult != RC_OK) {
+        return markResult;
+    }
+    return markDirty(mgr->bufferPool, srcPage);
+}
+
+// Fill free slots at the front of the table with records from the back;
+// every move made is appended to *moves
+static RC compactPages(RecordManager *mgr, Schema *schema, TableMetadata *metadata,
+                       RIDForward **moves, int *numMoves, int *firstOpenPage) {
+    BM_BufferPool *bm = mgr->bufferPool;
+    BM_PageHandle srcPage, destPage;
+    bool destPinned = false;
+    int dest = DATA_START_PAGE;
+    int capacity = 0;
+    RC rc = RC_OK;
+
+    for (int src = metadata->numPages - 1; src > dest && rc == RC_OK; src--) {
+        rc = pinPage(bm, &srcPage, src);
+        if (rc != RC_OK) {
+            break;
+        }
+
+        for (int slot = nextOccupiedSlot(srcPage.data, metadata->slotsPerPage, 0); slot >= 0;
+             slot = nextOccupiedSlot(srcPage.data, metadata->slotsPerPage, slot + 1)) {
+            // First free slot on a page before the source page
+            int freeSlot = -1;
+            while (dest < src) {
+                if (!destPinned) {
+                    rc = pinPage(bm, &destPage, dest);
+                    if (rc != RC_OK) {
+                        break;
+                    }
+                    destPinned = true;
+                }
+                freeSlot = findFreeSlotInPage(destPage.data, metadata->slotsPerPage);
+                if (freeSlot >= 0) {
+                    break;
+                }
+                destPinned = false;
+                rc = unpinPage(bm, &destPage);
+                if (rc != RC_OK) {
+                    break;
+                }
+                dest++;
+            }
+            if (rc != RC_OK || freeSlot < 0) {
+                break;
+            }
+
+            if (*numMoves == capacity) {
+                capacity = (capacity == 0) ? 256 : 2 * capacity;
+                RIDForward *grown = (RIDForward *)realloc(*moves, sizeof(RIDForward) * capacity);
+                if (grown == NULL) {
+                    rc = RC_MEM_ALLOC_FAILED;
+                    break;
+                }
+                *moves = grown;
+            }
+
+            rc = moveRecord(mgr, schema, metadata, &srcPage, slot, &destPage, freeSlot);
+            if (rc != RC_OK) {
+                break;
+            }
+            RIDForward move = { { src, slot }, { dest, freeSlot } };
+            (*moves)[(*numMoves)++] = move;
+        }
+
+        RC unpinResult = unpinPage(bm, &srcPage);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+
+    if (destPinned) {
+        RC unpinResult = unpinPage(bm, &destPage);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+
+    // Every page before dest is full
+    *firstOpenPage = dest;
+    return rc;
+}
+
+// Number of pages left once the empty ones at the end are dropped
+static RC countUsedPages(BM_BufferPool *bm, TableMetadata *metadata, int *numPages) {
+    BM_PageHandle page;
+    *numPages = metadata->numPages;
+    while (*numPages > DATA_START_PAGE + 1) {
+        RC pinResult = pinPage(bm, &page, *numPages - 1);
+        if (pinResult != RC_OK) {
+            return pinResult;
+        }
+        bool empty = getPageHeader(page.data)->numOccupied == 0;
+        RC unpinResult = unpinPage(bm, &page);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+        if (!empty) {
+            break;
+        }
+        (*numPages)--;
+    }
+    return RC_OK;
+}
+
+// Cut the page file down to numPages pages around the buffer pool
+static RC truncateTableFile(RM_TableData *rel, int numPages) {
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+
+    // Write back and drop every cached page before the file shrinks
+    RC forceResult = forceFlushPool(mgr->bufferPool);
+    if (forceResult != RC_OK) {
+        return forceResult;
+    }
+    RC shutdownResult = shutdownBufferPool(mgr->bufferPool);
+    if (shutdownResult != RC_OK) {
+        return shutdownResult;
+    }
+
+    SM_FileHandle fileHandle;
+    RC truncateResult = openPageFile(rel->name, &fileHandle);
+    if (truncateResult == RC_OK) {
+        truncateResult = truncatePageFile(numPages, &fileHandle);
+        closePageFile(&fileHandle);
+    }
+
+    RC reopenResult = reopenBufferPool(rel);
+    return (truncateResult != RC_OK) ? truncateResult : reopenResult;
+}
+
+RC vacuumTable(RM_TableData *rel) {
+    if (rel == NULL || rel->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+    Schema *schema = rel->schema;
+    if (mgr->openScans > 0) {
+        return RC_RM_SCAN_OPEN;
+    }
+
+    TableMetadata metadata;
+    RC metadataResult = readHeader(bm, &metadata);
+    if (metadataResult != RC_OK) {
+        return metadataResult;
+    }
+
+    // The moves made are recorded even if compaction stops part way
+    RIDForward *moves = NULL;
+    int numMoves = 0, firstOpenPage;
+    RC rc = compactPages(mgr, schema, &metadata, &moves, &numMoves, &firstOpenPage);
+    RC forwardResult = addForwards(mgr, moves, numMoves);
+    free(moves);
+    if (rc == RC_OK) {
+        rc = forwardResult;
+    }
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    int numPages;
+    rc = countUsedPages(bm, &metadata, &numPages);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (firstOpenPage > metadata.firstFreePage) {
+        metadata.firstFreePage = firstOpenPage;
+    }
+    if (metadata.firstFreePage >= numPages) {
+        metadata.firstFreePage = numPages - 1;
+    }
+    int oldNumPages = metadata.numPages;
+    metadata.numPages = numPages;
+    rc = writeHeader(bm, &metadata);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    // Pages first, then the forwarding entries that point into them
+    rc = (numPages < oldNumPages) ? truncateTableFile(rel, numPages) : forceFlushPool(bm);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    rc = saveForwards(mgr, rel->name);
+
+    // Tighten the zone map and the Bloom filter to the records left
+    if (mgr->zoneMap != NULL && rebuildZoneMap(mgr->zoneMap, bm, schema, &metadata) != RC_OK) {
+        freeZoneMap(mgr->zoneMap);
+        mgr->zoneMap = NULL;
+    }
+    if (mgr->bloom != NULL) {
+        BloomFilter *bloom = buildBloomFilter(bm, schema, &metadata);
+        if (bloom != NULL) {
+            freeBloomFilter(mgr->bloom);
+            mgr->bloom = bloom;
+        }
+    }
+    return rc;
+}
+
+// Scan cursor:
+// The scan keeps the page it is positioned on pinned between calls and
+// only moves the pin when it crosses a page boundary (or on closeScan),
+// so consecutive matches on one page cost a single pin. Conditions are
+// evaluated directly against the record bytes in the pinned frame; only
+// matching records are copied out. When the condition compiles, it is
+// evaluated for all occupied slots of a page at once as soon as the page
+// is pinned, and the cursor then walks the resulting selection vector.
+
+// Optimize a scan condition into a copy owned by the scan. If that fails
+// the caller keeps using the original condition.
+static Expr *optimizeScanCondition(Expr *cond) {
+    Expr *optimized = NULL;
+    if (cond == NULL || optimizeExpr(cond, &optimized) != RC_OK) {
+        return NULL;
+    }
+    return optimized;
+}
+
+// Compile a scan condition once. Conditions the compiler rejects (type
+// errors, unknown operators) fall back to evalExpr so they fail the same
+// way they always have.
+static CompiledExpr *compileScanCondition(Expr *cond, Schema *schema) {
+    CompiledExpr *program = NULL;
+    if (cond == NULL || compileExpr(cond, schema, &program) != RC_OK) {
+        return NULL;
     }
-    
-    if (rel->name != NULL) {
-        free(rel->name);
+    return program;
+}
+
+// Test a candidate record against the scan condition
+static RC matchCondition(Expr *cond, CompiledExpr *program, Record *candidate, Schema *schema, bool *matches) {
+    if (cond == NULL) {
+        *matches = true;
+        return RC_OK;
     }
-    
-    rel->mgmtData = NULL;
-    rel->schema = NULL;
-    rel->name = NULL;
-    
-    return shutdownResult;
+
+    if (program != NULL) {
+        int result;
+        RC evalResult = evalCompiledExpr(program, candidate->data, &result);
+        *matches = (result != 0);
+        return evalResult;
+    }
+
+    Value *result = NULL;
+    RC evalResult = evalExpr(candidate, schema, cond, &result);
+    if (evalResult != RC_OK) {
+        return evalResult;
+    }
+
+    *matches = (result != NULL && result->v.boolV);
+    freeVal(result);
+    return RC_OK;
 }
 
-// Delete a table
-RC deleteTable(char *name) {
-    // Use storage manager to destroy page file
-    return destroyPageFile(name);
+static RC scanUnpinPage(BM_BufferPool *bm, ScanManager *scanMgr) {
+    if (!scanMgr->pagePinned) {
+        return RC_OK;
+    }
+    scanMgr->pagePinned = false;
+    return unpinPage(bm, &scanMgr->page);
 }
 
-// Get number of tuples in a table
-int getNumTuples(RM_TableData *rel) {
-    if (rel == NULL || rel->mgmtData == NULL) {
-        return 0;
+// Build the compact schema and copy plan for a projected scan
+static RC scanSetupProjection(Schema *schema, ScanManager *scanMgr, int numAttrs, int *attrs) {
+    for (int i = 0; i < numAttrs; i++) {
+        if (attrs[i] < 0 || attrs[i] >= schema->numAttr) {
+            return RC_RM_INVALID_ATTRIBUTE;
+        }
     }
-    
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
-    return mgr->numTuples;
+
+    char **attrNames = (char **)malloc(sizeof(char *) * numAttrs);
+    DataType *dataTypes = (DataType *)malloc(sizeof(DataType) * numAttrs);
+    int *typeLength = (int *)malloc(sizeof(int) * numAttrs);
+    scanMgr->projOffsets = (int *)malloc(sizeof(int) * numAttrs);
+    scanMgr->projSizes = (int *)malloc(sizeof(int) * numAttrs);
+    if (attrNames == NULL || dataTypes == NULL || typeLength == NULL ||
+        scanMgr->projOffsets == NULL || scanMgr->projSizes == NULL) {
+        free(attrNames);
+        free(dataTypes);
+        free(typeLength);
+        free(scanMgr->projOffsets);
+        free(scanMgr->projSizes);
+        scanMgr->projOffsets = NULL;
+        scanMgr->projSizes = NULL;
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    scanMgr->projRecordSize = 0;
+    for (int i = 0; i < numAttrs; i++) {
+        int attr = attrs[i];
+        attrNames[i] = (char *)malloc(strlen(schema->attrNames[attr]) + 1);
+        strcpy(attrNames[i], schema->attrNames[attr]);
+        dataTypes[i] = schema->dataTypes[attr];
+        typeLength[i] = schema->typeLength[attr];
+        scanMgr->projOffsets[i] = getAttrOffset(schema, attr);
+        scanMgr->projSizes[i] = getAttrSize(schema, attr);
+        scanMgr->projRecordSize += scanMgr->projSizes[i];
+    }
+
+    scanMgr->projSchema = createSchema(numAttrs, attrNames, dataTypes, typeLength, 0, NULL);
+    return RC_OK;
 }
 
-// Insert a record in a table
-RC insertRecord(RM_TableData *rel, Record *record) {
-    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
-        return RC_FILE_HANDLE_NOT_INIT;
+// Copy the scan's output form of a record: whole, or only projected attributes
+static void scanCopyRecord(ScanManager *scanMgr, const char *recordData, char *dest) {
+    if (scanMgr->projSchema == NULL) {
+        memcpy(dest, recordData, scanMgr->recordSize);
+        return;
     }
-    
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+
+    for (int i = 0; i < scanMgr->projSchema->numAttr; i++) {
+        memcpy(dest, recordData + scanMgr->projOffsets[i], scanMgr->projSizes[i]);
+        dest += scanMgr->projSizes[i];
+    }
+}
+
+// Evaluate the compiled condition for every occupied slot of the pinned page
+static RC scanSelectPage(ScanManager *scanMgr) {
+    scanMgr->selPos = 0;
+    if (getPageHeader(scanMgr->page.data)->numOccupied == 0) {
+        scanMgr->selCount = 0;
+        return RC_OK;
+    }
+    return evalCompiledPage(scanMgr->program,
+                            scanMgr->page.data + getRecordOffset(0, scanMgr->recordSize, scanMgr->mapSize),
+                            scanMgr->recordSize, scanMgr->slotsPerPage,
+                            getSlotMap(scanMgr->page.data),
+                            scanMgr->selection, &scanMgr->selCount);
+}
+
+// Index scans:
+// startScan() looks for a conjunct of the condition that an index can
+// answer: attr = constant on an attribute with a hash index or the
+// primary index, else range comparisons or BETWEEN on the primary key.
+// The index yields candidate RIDs, which are sorted into page order so
+// each data page is pinned once, and the whole condition is re-checked
+// on every candidate. If the index turns up more than 1/INDEX_SCAN_SELECTIVITY
+// of the table's records, the heap scan is cheaper and is used instead.
+
+typedef struct IndexPlan {
+    int attrNum;          // Indexed attribute (-1: no usable conjunct)
+    Value *equal;         // attr = equal
+    Value *low;           // attr >= low (NULL: unbounded)
+    Value *high;          // attr <= high (NULL: unbounded)
+} IndexPlan;
+
+// Whether expr is a constant the indexes on attrNum can look up
+static bool isIndexConstant(Schema *schema, int attrNum, Expr *expr) {
+    if (expr->type != EXPR_CONST || expr->expr.cons->dt != schema->dataTypes[attrNum]) {
+        return false;
+    }
+    Value *value = expr->expr.cons;
+    switch (value->dt) {
+        case DT_INT:
+            return true;
+        case DT_FLOAT:
+            return value->v.floatV == value->v.floatV; // not NaN
+        case DT_STRING:
+            return (int)strlen(value->v.stringV) <= schema->typeLength[attrNum];
+        default:
+            return false;
+    }
+}
+
+// Collect the conjuncts of cond that an index can serve into plan
+static void planIndexScan(RecordManager *mgr, Schema *schema, Expr *cond, IndexPlan *plan) {
+    if (cond == NULL || cond->type != EXPR_OP) {
+        return;
+    }
+
+    Operator *op = cond->expr.op;
+    if (op->type == OP_BOOL_AND) {
+        for (int i = 0; i < op->numArgs; i++) {
+            planIndexScan(mgr, schema, op->args[i], plan);
+        }
+        return;
+    }
+
+    int keyAttr = (mgr->primaryIndex != NULL) ? schema->keyAttrs[0] : -1;
+    if (op->type == OP_BETWEEN) {
+        Expr *attr = op->args[0];
+        if (attr->type == EXPR_ATTRREF && attr->expr.attrRef == keyAttr && plan->equal == NULL &&
+                isIndexConstant(schema, keyAttr, op->args[1]) &&
+                isIndexConstant(schema, keyAttr, op->args[2])) {
+            plan->attrNum = keyAttr;
+            plan->low = op->args[1]->expr.cons;
+            plan->high = op->args[2]->expr.cons;
+        }
+        return;
+    }
+    if (op->numArgs != 2) {
+        return;
+    }
+
+    // Normalize to attr <op> constant
+    Expr *attr = op->args[0], *constant = op->args[1];
+    OpType type = op->type;
+    if (attr->type != EXPR_ATTRREF) {
+        attr = op->args[1];
+        constant = op->args[0];
+        type = mirrorComparison(type);
+    }
+    if (attr->type != EXPR_ATTRREF || attr->expr.attrRef < 0 || attr->expr.attrRef >= schema->numAttr) {
+        return;
+    }
+    int attrNum = attr->expr.attrRef;
+    if (!isIndexConstant(schema, attrNum, constant)) {
+        return;
+    }
+
+    if (type == OP_COMP_EQUAL) {
+        // Equality beats ranges; a hash index beats the primary index
+        if ((mgr->hashIndexes[attrNum] != NULL || attrNum == keyAttr) &&
+                (plan->equal == NULL || (mgr->hashIndexes[attrNum] != NULL &&
+                                         mgr->hashIndexes[plan->attrNum] == NULL))) {
+            plan->attrNum = attrNum;
+            plan->equal = constant->expr.cons;
+        }
+        return;
+    }
+    if (attrNum != keyAttr || plan->equal != NULL) {
+        return;
+    }
+
+    // Strict bounds become inclusive; the condition re-check drops the ends
+    if (type == OP_COMP_GREATER || type == OP_COMP_GREATER_EQUAL) {
+        plan->attrNum = attrNum;
+        plan->low = constant->expr.cons;
+    } else if (type == OP_COMP_SMALLER || type == OP_COMP_SMALLER_EQUAL) {
+        plan->attrNum = attrNum;
+        plan->high = constant->expr.cons;
+    }
+}
+
+// Append rid to a growing array; false once more than limit RIDs came up
+static bool addIndexRID(RID **rids, int *count, int *capacity, int limit, RID rid, RC *rc) {
+    if (*count >= limit) {
+        return false;
+    }
+    if (*count == *capacity) {
+        *capacity = (*capacity == 0) ? 64 : 2 * *capacity;
+        RID *grown = (RID *)realloc(*rids, (size_t)*capacity * sizeof(RID));
+        if (grown == NULL) {
+            *rc = RC_MEM_ALLOC_FAILED;
+            return false;
+        }
+        *rids = grown;
+    }
+    (*rids)[(*count)++] = rid;
+    return true;
+}
+
+// Fetch the RIDs the plan selects from its index, sorted into page
+// order. *rids stays NULL if there is no plan or the index is not
+// selective enough.
+static RC runIndexPlan(RecordManager *mgr, IndexPlan *plan, RID **rids, int *count) {
+    int limit = mgr->numTuples / INDEX_SCAN_SELECTIVITY;
+    int capacity = 0;
+    bool withinLimit = true;
+    RC rc = RC_OK;
+    RID rid;
+
+    *rids = NULL;
+    *count = 0;
+    if (plan->attrNum < 0 || limit == 0) {
+        return RC_OK;
+    }
+
+    if (plan->equal != NULL && mgr->hashIndexes[plan->attrNum] != NULL) {
+        HI_ScanHandle *hashScan;
+        rc = openHashScan(mgr->hashIndexes[plan->attrNum], plan->equal, &hashScan);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        while (withinLimit && (rc = nextHashEntry(hashScan, &rid)) == RC_OK) {
+            withinLimit = addIndexRID(rids, count, &capacity, limit, rid, &rc);
+        }
+        closeHashScan(hashScan);
+    } else {
+        BT_ScanHandle *treeScan;
+        Value *low = (plan->equal != NULL) ? plan->equal : plan->low;
+        Value *high = (plan->equal != NULL) ? plan->equal : plan->high;
+        rc = openTreeRangeScan(mgr->primaryIndex, low, high, &treeScan);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        while (withinLimit && (rc = nextEntry(treeScan, &rid)) == RC_OK) {
+            withinLimit = addIndexRID(rids, count, &capacity, limit, rid, &rc);
+        }
+        closeTreeScan(treeScan);
+    }
+
+    if (rc == RC_IM_NO_MORE_ENTRIES || (rc == RC_OK && !withinLimit)) {
+        rc = RC_OK;
+    }
+    if (rc != RC_OK || !withinLimit) {
+        free(*rids);
+        *rids = NULL;
+        *count = 0;
+        return rc;
+    }
+
+    // An empty result still takes the index path: there is nothing to visit
+    if (*rids == NULL) {
+        *rids = (RID *)malloc(sizeof(RID));
+        if (*rids == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+    }
+    qsort(*rids, *count, sizeof(RID), compareRIDs);
+    return RC_OK;
+}
+
+// Advance the cursor to the next candidate RID of an index scan that
+// matches the scan condition
+static RC scanNextIndexMatch(RM_ScanHandle *scan, ScanManager *scanMgr, char **recordData, RID *rid) {
+    RecordManager *mgr = (RecordManager *)scan->rel->mgmtData;
     BM_BufferPool *bm = mgr->bufferPool;
-    
-    // Read table metadata
-    TableMetadata metadata;
-    RC metadataResult = readHeader(bm, &metadata);
-    if (metadataResult != RC_OK) {
-        return metadataResult;
+
+    while (scanMgr->indexPos < scanMgr->indexCount) {
+        RID candidateId = scanMgr->indexRids[scanMgr->indexPos++];
+
+        // Candidates are sorted, so each page is pinned once
+        if (!scanMgr->pagePinned || scanMgr->page.pageNum != candidateId.page) {
+            RC unpinResult = scanUnpinPage(bm, scanMgr);
+            if (unpinResult != RC_OK) {
+                return unpinResult;
+            }
+            RC pinResult = pinPage(bm, &scanMgr->page, candidateId.page);
+            if (pinResult != RC_OK) {
+                return pinResult;
+            }
+            scanMgr->pagePinned = true;
+            scanMgr->currentPage = candidateId.page;
+        }
+
+        // The record may have been deleted since the index was read
+        if (candidateId.slot < 0 || candidateId.slot >= scanMgr->slotsPerPage ||
+                !isSlotOccupied(scanMgr->page.data, candidateId.slot)) {
+            continue;
+        }
+
+        Record candidate;
+        candidate.id = candidateId;
+        candidate.data = scanMgr->page.data +
+            getRecordOffset(candidateId.slot, scanMgr->recordSize, scanMgr->mapSize);
+
+        bool matches;
+        RC evalResult = matchCondition(scanMgr->condition, scanMgr->program,
+                                       &candidate, scan->rel->schema, &matches);
+        if (evalResult != RC_OK) {
+            return evalResult;
+        }
+        if (matches) {
+            *recordData = candidate.data;
+            *rid = candidateId;
+            return RC_OK;
+        }
     }
-    
-    // Find a free slot for the record
+
+    scanMgr->scanActive = false;
+    RC unpinResult = scanUnpinPage(bm, scanMgr);
+    return (unpinResult != RC_OK) ? unpinResult : RC_RM_NO_MORE_TUPLES;
+}
+
+// Advance the cursor to the next record matching the scan condition.
+// On RC_OK, *recordData points into the pinned page and *rid is set.
+static RC scanNextMatch(RM_ScanHandle *scan, ScanManager *scanMgr, char **recordData, RID *rid) {
+    RecordManager *mgr = (RecordManager *)scan->rel->mgmtData;
+    BM_BufferPool *bm = mgr->bufferPool;
+
+    if (!scanMgr->scanActive) {
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    if (scanMgr->indexRids != NULL) {
+        return scanNextIndexMatch(scan, scanMgr, recordData, rid);
+    }
+
+    while (scanMgr->currentPage < scanMgr->totalPages) {
+        // Pin current page if the cursor just arrived on it, unless its
+        // zone map rules out every record on it
+        if (!scanMgr->pagePinned) {
+            if (!zoneMapAdmitsPage(mgr->zoneMap, scan->rel->schema,
+                                   scanMgr->currentPage, scanMgr->condition)) {
+                scanMgr->currentPage++;
+                scanMgr->currentSlot = 0;
+                continue;
+            }
+
+            RC pinResult = pinPage(bm, &scanMgr->page, scanMgr->currentPage);
+            if (pinResult != RC_OK) {
+                return pinResult;
+            }
+            scanMgr->pagePinned = true;
+
+            if (scanMgr->selection != NULL) {
+                RC selectResult = scanSelectPage(scanMgr);
+                if (selectResult != RC_OK) {
+                    return selectResult;
+                }
+            }
+        }
+
+        // Walk the matches selected for this page
+        if (scanMgr->selection != NULL && scanMgr->selPos < scanMgr->selCount) {
+            rid->page = scanMgr->currentPage;
+            rid->slot = scanMgr->selection[scanMgr->selPos++];
+            *recordData = scanMgr->page.data +
+                getRecordOffset(rid->slot, scanMgr->recordSize, scanMgr->mapSize);
+            return RC_OK;
+        }
+
+        // Scan through slots in current page
+        while (scanMgr->selection == NULL && scanMgr->currentSlot < scanMgr->slotsPerPage) {
+            // Jump to the next occupied slot a bitmap word at a time
+            int slot = nextOccupiedSlot(scanMgr->page.data, scanMgr->slotsPerPage, scanMgr->currentSlot);
+            if (slot < 0) {
+                break;
+            }
+            scanMgr->currentSlot = slot + 1;
+
+            Record candidate;
+            candidate.id.page = scanMgr->currentPage;
+            candidate.id.slot = slot;
+            candidate.data = scanMgr->page.data +
+                getRecordOffset(slot, scanMgr->recordSize, scanMgr->mapSize);
+
+            // Check condition if present
+            bool matches;
+            RC evalResult = matchCondition(scanMgr->condition, scanMgr->program,
+                                           &candidate, scan->rel->schema, &matches);
+            if (evalResult != RC_OK) {
+                return evalResult;
+            }
+            if (!matches) {
+                continue;
+            }
+
+            *recordData = candidate.data;
+            *rid = candidate.id;
+            return RC_OK;
+        }
+
+        // Unpin current page before moving to next page
+        RC unpinResult = scanUnpinPage(bm, scanMgr);
+        if (unpinResult != RC_OK) {
+            return unpinResult;
+        }
+
+        // Move to next page
+        scanMgr->currentPage++;
+        scanMgr->currentSlot = 0;
+    }
+
+    // No more matching records
+    scanMgr->scanActive = false;
+    return RC_RM_NO_MORE_TUPLES;
+}
+
+// LIMIT and top-K:
+// A scan with a limit stops and unpins its page as soon as it has
+// returned that many records. A top-K scan reads the matching records
+// when the first one is asked for and keeps the K that rank first on one
+// attribute in a heap whose root is the worst of them, so that a record
+// replaces the root only when it ranks before it and the K candidates
+// are all it ever holds. The heap is then sorted in place and returned in
+// rank order. Equal values rank in RID order, which is the order the
+// scan found them in; NaN ranks last either way.
+
+// Whether top-K entry a ranks after entry b
+static bool topEntryAfter(ScanManager *scanMgr, Schema *schema, const char *a, const char *b) {
+    const char *x = a + sizeof(RID) + getAttrOffset(schema, scanMgr->orderAttr);
+    const char *y = b + sizeof(RID) + getAttrOffset(schema, scanMgr->orderAttr);
+    int cmp;
+
+    switch (schema->dataTypes[scanMgr->orderAttr]) {
+        case DT_INT: {
+            int u, v;
+            memcpy(&u, x, sizeof(int));
+            memcpy(&v, y, sizeof(int));
+            cmp = (u > v) - (u < v);
+            break;
+        }
+        case DT_FLOAT: {
+            float u, v;
+            memcpy(&u, x, sizeof(float));
+            memcpy(&v, y, sizeof(float));
+            if (isnan(u) || isnan(v)) {
+                if (isnan(u) != isnan(v)) {
+                    return isnan(u) != 0;
+                }
+                cmp = 0;
+            } else {
+                cmp = (u > v) - (u < v);
+            }
+            break;
+        }
+        case DT_STRING:
+            cmp = strncmp(x, y, schema->typeLength[scanMgr->orderAttr]);
+            cmp = (cmp > 0) - (cmp < 0);
+            break;
+        default:
+            cmp = (x[0] != 0) - (y[0] != 0);
+            break;
+    }
+
+    if (cmp != 0) {
+        return scanMgr->descending ? cmp < 0 : cmp > 0;
+    }
+
+    // Entries are packed, so their RIDs may be unaligned
+    RID ridA, ridB;
+    memcpy(&ridA, a, sizeof(RID));
+    memcpy(&ridB, b, sizeof(RID));
+    return compareRIDs(&ridA, &ridB) > 0;
+}
+
+static char *topEntry(ScanManager *scanMgr, int i) {
+    return scanMgr->topEntries + (size_t)i * (sizeof(RID) + scanMgr->recordSize);
+}
+
+static void swapTopEntries(ScanManager *scanMgr, int i, int j, char *scratch) {
+    size_t entrySize = sizeof(RID) + scanMgr->recordSize;
+    memcpy(scratch, topEntry(scanMgr, i), entrySize);
+    memcpy(topEntry(scanMgr, i), topEntry(scanMgr, j), entrySize);
+    memcpy(topEntry(scanMgr, j), scratch, entrySize);
+}
+
+// Restore the heap below pos among the first count entries, worst first
+static void siftTopEntry(ScanManager *scanMgr, Schema *schema, int pos, int count, char *scratch) {
+    while (2 * pos + 1 < count) {
+        int child = 2 * pos + 1;
+        if (child + 1 < count &&
+                topEntryAfter(scanMgr, schema, topEntry(scanMgr, child + 1), topEntry(scanMgr, child))) {
+            child++;
+        }
+        if (!topEntryAfter(scanMgr, schema, topEntry(scanMgr, child), topEntry(scanMgr, pos))) {
+            break;
+        }
+        swapTopEntries(scanMgr, pos, child, scratch);
+        pos = child;
+    }
+}
+
+// Read every match of the scan into the top-K heap and sort it
+static RC collectTopEntries(RM_ScanHandle *scan, ScanManager *scanMgr) {
+    Schema *schema = scan->rel->schema;
+    size_t entrySize = sizeof(RID) + scanMgr->recordSize;
+    char *scratch = (char *)malloc(entrySize);
+    if (scratch == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    RC rc;
+    char *recordData;
     RID rid;
-    RC slotResult = findFreeSlot(bm, &metadata, &rid);
-    if (slotResult != RC_OK) {
-        return slotResult;
+    while ((rc = scanNextMatch(scan, scanMgr, &recordData, &rid)) == RC_OK) {
+        if (scanMgr->topCount < scanMgr->topK) {
+            // Filling up: append and sift up
+            if (scanMgr->topCount == scanMgr->topCapacity) {
+                int capacity = (scanMgr->topCapacity > 0) ? 2 * scanMgr->topCapacity : 64;
+                if (capacity > scanMgr->topK) {
+                    capacity = scanMgr->topK;
+                }
+                char *grown = (char *)realloc(scanMgr->topEntries, capacity * entrySize);
+                if (grown == NULL) {
+                    rc = RC_MEM_ALLOC_FAILED;
+                    break;
+                }
+                scanMgr->topEntries = grown;
+                scanMgr->topCapacity = capacity;
+            }
+            int pos = scanMgr->topCount++;
+            memcpy(topEntry(scanMgr, pos), &rid, sizeof(RID));
+            memcpy(topEntry(scanMgr, pos) + sizeof(RID), recordData, scanMgr->recordSize);
+            while (pos > 0 && topEntryAfter(scanMgr, schema, topEntry(scanMgr, pos),
+                                            topEntry(scanMgr, (pos - 1) / 2))) {
+                swapTopEntries(scanMgr, pos, (pos - 1) / 2, scratch);
+                pos = (pos - 1) / 2;
+            }
+            continue;
+        }
+
+        // Full: the record only gets in if it ranks before the worst
+        memcpy(scratch, &rid, sizeof(RID));
+        memcpy(scratch + sizeof(RID), recordData, scanMgr->recordSize);
+        if (topEntryAfter(scanMgr, schema, topEntry(scanMgr, 0), scratch)) {
+            memcpy(topEntry(scanMgr, 0), scratch, entrySize);
+            siftTopEntry(scanMgr, schema, 0, scanMgr->topCount, scratch);
+        }
     }
-    
-    // Set the record ID
-    record->id = rid;
-    
-    // Get page to insert the record
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    RC pinResult = pinPage(bm, pageHandle, rid.page);
-    if (pinResult != RC_OK) {
-        free(pageHandle);
-        return pinResult;
+
+    if (rc == RC_RM_NO_MORE_TUPLES) {
+        // Heap sort: move the worst remaining entry behind the heap
+        for (int end = scanMgr->topCount - 1; end > 0; end--) {
+            swapTopEntries(scanMgr, 0, end, scratch);
+            siftTopEntry(scanMgr, schema, 0, end, scratch);
+        }
+        scanMgr->topPos = 0;
+        rc = RC_OK;
     }
-    
-    // Calculate slot map size and record offset
-    int mapSize = getSlotMapSize(metadata.slotsPerPage);
-    int offset = getRecordOffset(rid.slot, metadata.recordSize, mapSize);
-    
-    // Mark slot as occupied
-    markSlotOccupied(pageHandle->data, rid.slot);
-    
-    // Copy record data to page
-    memcpy(pageHandle->data + offset, record->data, metadata.recordSize);
-    
-    // Mark page as dirty
-    RC markResult = markDirty(bm, pageHandle);
-    if (markResult != RC_OK) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return markResult;
+    free(scratch);
+    return rc;
+}
+
+// Advance to the next record the scan returns, applying top-K and limit
+static RC scanNextOutput(RM_ScanHandle *scan, ScanManager *scanMgr, char **recordData, RID *rid) {
+    if (scanMgr->limit > 0 && scanMgr->returned >= scanMgr->limit) {
+        // Enough: release the page now rather than at closeScan
+        RecordManager *mgr = (RecordManager *)scan->rel->mgmtData;
+        scanMgr->scanActive = false;
+        RC unpinResult = scanUnpinPage(mgr->bufferPool, scanMgr);
+        return (unpinResult != RC_OK) ? unpinResult : RC_RM_NO_MORE_TUPLES;
     }
-    
-    // Unpin page
-    RC unpinResult = unpinPage(bm, pageHandle);
-    if (unpinResult != RC_OK) {
-        free(pageHandle);
-        return unpinResult;
+
+    if (scanMgr->topK > 0) {
+        if (scanMgr->topPos < 0) {
+            RC collectResult = collectTopEntries(scan, scanMgr);
+            if (collectResult != RC_OK) {
+                return collectResult;
+            }
+        }
+        if (scanMgr->topPos >= scanMgr->topCount) {
+            return RC_RM_NO_MORE_TUPLES;
+        }
+        char *entry = topEntry(scanMgr, scanMgr->topPos++);
+        memcpy(rid, entry, sizeof(RID));
+        *recordData = entry + sizeof(RID);
+    } else {
+        RC matchResult = scanNextMatch(scan, scanMgr, recordData, rid);
+        if (matchResult != RC_OK) {
+            return matchResult;
+        }
+    }
+
+    scanMgr->returned++;
+    return RC_OK;
+}
+
+// Reset scan options to a plain copying scan
+RC initScanOptions(RM_ScanOptions *options) {
+    if (options == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
     
-    free(pageHandle);
-    
-    // Update tuple count
-    mgr->numTuples++;
-    metadata.numTuples = mgr->numTuples;
-    
-    // Update metadata
-    return writeHeader(bm, &metadata);
+    memset(options, 0, sizeof(RM_ScanOptions));
+    return RC_OK;
 }
 
-// Delete a record from a table
-RC deleteRecord(RM_TableData *rel, RID id) {
-    if (rel == NULL || rel->mgmtData == NULL) {
+// Start a scan operation
+RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
+    return startScanWithOptions(rel, scan, cond, NULL);
+}
+
+// Start a scan operation with non-default options
+RC startScanWithOptions(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, RM_ScanOptions *options) {
+    if (rel == NULL || rel->mgmtData == NULL || scan == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
+    if (options != NULL && options->topK > 0 &&
+            (options->orderAttr < 0 || options->orderAttr >= rel->schema->numAttr)) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
     
     RecordManager *mgr = (RecordManager *)rel->mgmtData;
     BM_BufferPool *bm = mgr->bufferPool;
@@ -630,334 +4200,671 @@ RC deleteRecord(RM_TableData *rel, RID id) {
         return metadataResult;
     }
     
-    // Get page containing the record
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    RC pinResult = pinPage(bm, pageHandle, id.page);
-    if (pinResult != RC_OK) {
-        free(pageHandle);
-        return pinResult;
+    // Initialize scan manager
+    ScanManager *scanMgr = (ScanManager *)malloc(sizeof(ScanManager));
+    if (scanMgr == NULL) {
+        return RC_MEM_ALLOC_FAILED;
     }
-    
-    // Check if slot is occupied
-    if (!isSlotOccupied(pageHandle->data, id.slot)) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return RC_RM_NO_MORE_TUPLES;
+    scanMgr->optimized = optimizeScanCondition(cond);
+    scanMgr->condition = (scanMgr->optimized != NULL) ? scanMgr->optimized : cond;
+    scanMgr->program = compileScanCondition(scanMgr->condition, rel->schema);
+    scanMgr->scanActive = true;
+    scanMgr->currentPage = DATA_START_PAGE;  // Start scan from first data page
+    scanMgr->currentSlot = 0;                // Start from first slot
+    scanMgr->totalPages = metadata.numPages;
+    scanMgr->slotsPerPage = metadata.slotsPerPage;
+    scanMgr->recordSize = metadata.recordSize;
+    scanMgr->mapSize = getSlotMapSize(metadata.slotsPerPage);
+    scanMgr->page.pageNum = NO_PAGE;
+    scanMgr->page.data = NULL;
+    scanMgr->pagePinned = false;
+    scanMgr->zeroCopy = (options != NULL && options->zeroCopy);
+    scanMgr->projSchema = NULL;
+    scanMgr->projOffsets = NULL;
+    scanMgr->projSizes = NULL;
+    scanMgr->projRecordSize = metadata.recordSize;
+    scanMgr->selection = NULL;
+    scanMgr->selCount = 0;
+    scanMgr->selPos = 0;
+    scanMgr->indexPos = 0;
+    scanMgr->limit = (options != NULL && options->limit > 0) ? options->limit : 0;
+    scanMgr->returned = 0;
+    scanMgr->topK = (options != NULL && options->topK > 0) ? options->topK : 0;
+    scanMgr->orderAttr = (scanMgr->topK > 0) ? options->orderAttr : 0;
+    scanMgr->descending = (scanMgr->topK > 0 && options->descending);
+    scanMgr->topEntries = NULL;
+    scanMgr->topCount = 0;
+    scanMgr->topCapacity = 0;
+    scanMgr->topPos = -1;
+
+    // A key the Bloom filter rules out leaves no candidates at all;
+    // otherwise let an index narrow the scan down to candidate RIDs if it can
+    RC planResult = RC_OK;
+    if (bloomExcludesCondition(mgr->bloom, rel->schema, scanMgr->condition)) {
+        scanMgr->indexRids = (RID *)malloc(sizeof(RID));
+        scanMgr->indexCount = 0;
+        if (scanMgr->indexRids == NULL) {
+            planResult = RC_MEM_ALLOC_FAILED;
+        }
+    } else {
+        IndexPlan plan = { -1, NULL, NULL, NULL };
+        planIndexScan(mgr, rel->schema, scanMgr->condition, &plan);
+        planResult = runIndexPlan(mgr, &plan, &scanMgr->indexRids, &scanMgr->indexCount);
+    }
+    if (planResult != RC_OK) {
+        freeCompiledExpr(scanMgr->program);
+        freeExpr(scanMgr->optimized);
+        free(scanMgr);
+        return planResult;
     }
     
-    // Mark slot as free
-    markSlotFree(pageHandle->data, id.slot);
-    
-    // Mark page as dirty
-    RC markResult = markDirty(bm, pageHandle);
-    if (markResult != RC_OK) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return markResult;
+    // Compiled conditions are evaluated a page at a time by heap scans
+    if (scanMgr->program != NULL && scanMgr->indexRids == NULL) {
+        scanMgr->selection = (int *)malloc(sizeof(int) * metadata.slotsPerPage);
     }
     
-    // Unpin page
-    RC unpinResult = unpinPage(bm, pageHandle);
-    if (unpinResult != RC_OK) {
-        free(pageHandle);
-        return unpinResult;
+    // Projected scans return compact records and always copy
+    if (options != NULL && options->numProjAttrs > 0) {
+        RC projResult = scanSetupProjection(rel->schema, scanMgr,
+                                            options->numProjAttrs, options->projAttrs);
+        if (projResult != RC_OK) {
+            freeCompiledExpr(scanMgr->program);
+            freeExpr(scanMgr->optimized);
+            free(scanMgr->selection);
+            free(scanMgr->indexRids);
+            free(scanMgr);
+            return projResult;
+        }
+        scanMgr->zeroCopy = false;
     }
     
-    free(pageHandle);
+    // Initialize scan handle
+    scan->rel = rel;
+    scan->mgmtData = scanMgr;
+    mgr->openScans++;
     
-    // Update tuple count
-    mgr->numTuples--;
-    metadata.numTuples = mgr->numTuples;
+    return RC_OK;
+}
+
+// Start a scan that returns only the given attributes, in that order
+RC startProjectedScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs) {
+    RM_ScanOptions options;
+    initScanOptions(&options);
+    options.numProjAttrs = numAttrs;
+    options.projAttrs = attrs;
+    return startScanWithOptions(rel, scan, cond, &options);
+}
+
+// Schema of the records returned by a scan
+Schema *getScanSchema(RM_ScanHandle *scan) {
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return NULL;
+    }
     
-    // Update metadata
-    return writeHeader(bm, &metadata);
+    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
+    return (scanMgr->projSchema != NULL) ? scanMgr->projSchema : scan->rel->schema;
 }
 
-// Update a record in a table
-RC updateRecord(RM_TableData *rel, Record *record) {
-    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
+// Get next record that satisfies the scan condition
+RC next(RM_ScanHandle *scan, Record *record) {
+    if (scan == NULL || scan->mgmtData == NULL || record == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
     
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
-    BM_BufferPool *bm = mgr->bufferPool;
+    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
+    char *recordData;
+    RID rid;
     
-    // Read table metadata
-    TableMetadata metadata;
-    RC metadataResult = readHeader(bm, &metadata);
-    if (metadataResult != RC_OK) {
-        return metadataResult;
+    RC matchResult = scanNextOutput(scan, scanMgr, &recordData, &rid);
+    if (matchResult != RC_OK) {
+        return matchResult;
     }
     
-    // Get page containing the record
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    RC pinResult = pinPage(bm, pageHandle, record->id.page);
-    if (pinResult != RC_OK) {
-        free(pageHandle);
-        return pinResult;
-    }
+    record->id = rid;
     
-    // Check if slot is occupied
-    if (!isSlotOccupied(pageHandle->data, record->id.slot)) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return RC_RM_NO_MORE_TUPLES;
+    // Hand out the frame bytes; valid until the cursor leaves this page
+    if (scanMgr->zeroCopy) {
+        record->data = recordData;
+        return RC_OK;
     }
     
-    // Calculate record offset
-    int mapSize = getSlotMapSize(metadata.slotsPerPage);
-    int offset = getRecordOffset(record->id.slot, metadata.recordSize, mapSize);
-    
-    // Update record data
-    memcpy(pageHandle->data + offset, record->data, metadata.recordSize);
-    
-    // Mark page as dirty
-    RC markResult = markDirty(bm, pageHandle);
-    if (markResult != RC_OK) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return markResult;
+    // Allocate memory for record data if needed
+    if (record->data == NULL) {
+        record->data = (char *)malloc(scanMgr->projRecordSize);
+        if (record->data == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
     }
     
-    // Unpin page
-    RC unpinResult = unpinPage(bm, pageHandle);
-    if (unpinResult != RC_OK) {
-        free(pageHandle);
-        return unpinResult;
-    }
+    // Copy record data
+    scanCopyRecord(scanMgr, recordData, record->data);
     
-    free(pageHandle);
     return RC_OK;
 }
 
-// Get a record from a table
-RC getRecord(RM_TableData *rel, RID id, Record *record) {
-    if (rel == NULL || rel->mgmtData == NULL || record == NULL) {
+// Fill a batch with up to maxRows records that satisfy the scan condition
+RC nextBatch(RM_ScanHandle *scan, RecordBatch *batch, int maxRows) {
+    if (scan == NULL || scan->mgmtData == NULL || batch == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
     
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
-    BM_BufferPool *bm = mgr->bufferPool;
+    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
+    if (batch->recordSize != scanMgr->projRecordSize) {
+        return RC_INVALID_RECORD_SIZE;
+    }
     
-    // Read table metadata
-    TableMetadata metadata;
-    RC metadataResult = readHeader(bm, &metadata);
-    if (metadataResult != RC_OK) {
-        return metadataResult;
+    if (maxRows > batch->capacity) {
+        maxRows = batch->capacity;
     }
     
-    // Get page containing the record
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    RC pinResult = pinPage(bm, pageHandle, id.page);
-    if (pinResult != RC_OK) {
-        free(pageHandle);
-        return pinResult;
+    batch->numRecords = 0;
+    while (batch->numRecords < maxRows) {
+        char *recordData;
+        RID rid;
+        
+        RC matchResult = scanNextOutput(scan, scanMgr, &recordData, &rid);
+        if (matchResult == RC_RM_NO_MORE_TUPLES) {
+            break;
+        }
+        if (matchResult != RC_OK) {
+            return matchResult;
+        }
+        
+        batch->ids[batch->numRecords] = rid;
+        scanCopyRecord(scanMgr, recordData,
+                       batch->data + (size_t)batch->numRecords * batch->recordSize);
+        batch->numRecords++;
     }
     
-    // Check if slot is occupied
-    if (!isSlotOccupied(pageHandle->data, id.slot)) {
-        unpinPage(bm, pageHandle);
-        free(pageHandle);
-        return RC_RM_NO_MORE_TUPLES;
+    return (batch->numRecords > 0) ? RC_OK : RC_RM_NO_MORE_TUPLES;
+}
+
+// Close a scan operation
+RC closeScan(RM_ScanHandle *scan) {
+    if (scan == NULL || scan->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
     }
     
-    // Calculate record offset
-    int mapSize = getSlotMapSize(metadata.slotsPerPage);
-    int offset = getRecordOffset(id.slot, metadata.recordSize, mapSize);
+    // Release the page the cursor was positioned on
+    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
+    RecordManager *mgr = (RecordManager *)scan->rel->mgmtData;
+    RC unpinResult = scanUnpinPage(mgr->bufferPool, scanMgr);
     
-    // Set record ID
-    record->id = id;
+    // Free scan manager
+    freeCompiledExpr(scanMgr->program);
+    freeExpr(scanMgr->optimized);
+    free(scanMgr->selection);
+    free(scanMgr->indexRids);
+    free(scanMgr->topEntries);
+    freeSchema(scanMgr->projSchema);
+    free(scanMgr->projOffsets);
+    free(scanMgr->projSizes);
+    free(scanMgr);
+    scan->mgmtData = NULL;
+    mgr->openScans--;
     
-    // Allocate memory for record data if needed
-    if (record->data == NULL) {
-        record->data = (char *)malloc(metadata.recordSize);
+    return unpinResult;
+}
+
+// Counting:
+// countMatching() counts the records that match a condition without
+// copying any of them out. No condition, or one that folds to a constant,
+// is answered from the tuple count, and a key the Bloom filter rules out
+// counts 0. A condition that is just attr = constant on an index that
+// finds few enough records counts the RIDs the index holds for it, unless
+// the attribute is a FLOAT: NaN and -0.0 make the indexes' key equality
+// differ from =, so those candidates, like those of other index plans,
+// are counted only if they pass the condition. Otherwise
+// every data page is looked at once: pages the zone map rules out are
+// skipped, pages on which it proves every record matches add their
+// occupancy count, and on the rest the compiled condition is evaluated
+// for the whole page at once.
+
+// Count the candidate RIDs of an index plan that match cond
+static RC countIndexMatches(RecordManager *mgr, Schema *schema, TableMetadata *metadata, Expr *cond,
+                            CompiledExpr *program, RID *rids, int numRids, int *count) {
+    BM_BufferPool *bm = mgr->bufferPool;
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+    BM_PageHandle page;
+    bool pinned = false;
+    RC rc = RC_OK;
+
+    for (int i = 0; i < numRids && rc == RC_OK; i++) {
+        RID rid = rids[i];
+        if (!pinned || page.pageNum != rid.page) {
+            if (pinned) {
+                rc = unpinPage(bm, &page);
+                pinned = false;
+            }
+            if (rc == RC_OK) {
+                rc = pinPage(bm, &page, rid.page);
+                pinned = (rc == RC_OK);
+            }
+            if (rc != RC_OK) {
+                break;
+            }
+        }
+        if (rid.slot < 0 || rid.slot >= metadata->slotsPerPage || !isSlotOccupied(page.data, rid.slot)) {
+            continue;
+        }
+
+        Record candidate;
+        bool matches;
+        candidate.id = rid;
+        candidate.data = page.data + getRecordOffset(rid.slot, metadata->recordSize, mapSize);
+        rc = matchCondition(cond, program, &candidate, schema, &matches);
+        if (rc == RC_OK && matches) {
+            (*count)++;
+        }
+    }
+
+    if (pinned) {
+        RC unpinResult = unpinPage(bm, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+    return rc;
+}
+
+// Count the matching records of one pinned data page
+static RC countPageMatches(RecordManager *mgr, Schema *schema, TableMetadata *metadata, Expr *cond,
+                           CompiledExpr *program, int *selection, BM_PageHandle *page, int *count) {
+    int numOccupied = getPageHeader(page->data)->numOccupied;
+    int mapSize = getSlotMapSize(metadata->slotsPerPage);
+
+    if (numOccupied == 0) {
+        return RC_OK;
+    }
+    if (zoneMapCoversPage(mgr->zoneMap, schema, page->pageNum, cond)) {
+        *count += numOccupied;
+        return RC_OK;
+    }
+
+    if (selection != NULL) {
+        int selCount;
+        RC evalResult = evalCompiledPage(program, page->data + getRecordOffset(0, metadata->recordSize, mapSize),
+                                         metadata->recordSize, metadata->slotsPerPage,
+                                         getSlotMap(page->data), selection, &selCount);
+        if (evalResult == RC_OK) {
+            *count += selCount;
+        }
+        return evalResult;
+    }
+
+    for (int slot = nextOccupiedSlot(page->data, metadata->slotsPerPage, 0); slot >= 0;
+         slot = nextOccupiedSlot(page->data, metadata->slotsPerPage, slot + 1)) {
+        Record candidate;
+        bool matches;
+        candidate.id.page = page->pageNum;
+        candidate.id.slot = slot;
+        candidate.data = page->data + getRecordOffset(slot, metadata->recordSize, mapSize);
+        RC evalResult = matchCondition(cond, program, &candidate, schema, &matches);
+        if (evalResult != RC_OK) {
+            return evalResult;
+        }
+        if (matches) {
+            (*count)++;
+        }
+    }
+    return RC_OK;
+}
+
+// Count the records of every data page that match cond
+static RC countHeapMatches(RecordManager *mgr, Schema *schema, TableMetadata *metadata, Expr *cond,
+                           CompiledExpr *program, int *count) {
+    BM_BufferPool *bm = mgr->bufferPool;
+    int *selection = NULL;
+    if (program != NULL) {
+        selection = (int *)malloc(sizeof(int) * metadata->slotsPerPage);
+        if (selection == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+    }
+
+    RC rc = RC_OK;
+    BM_PageHandle page;
+    for (int pageNum = DATA_START_PAGE; pageNum < metadata->numPages && rc == RC_OK; pageNum++) {
+        if (!zoneMapAdmitsPage(mgr->zoneMap, schema, pageNum, cond)) {
+            continue;
+        }
+        rc = pinPage(bm, &page, pageNum);
+        if (rc != RC_OK) {
+            break;
+        }
+        rc = countPageMatches(mgr, schema, metadata, cond, program, selection, &page, count);
+        RC unpinResult = unpinPage(bm, &page);
+        if (rc == RC_OK) {
+            rc = unpinResult;
+        }
+    }
+
+    free(selection);
+    return rc;
+}
+
+// Count the records of a table that match cond
+RC countMatching(RM_TableData *rel, Expr *cond, int *count) {
+    if (rel == NULL || rel->mgmtData == NULL || count == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+    Schema *schema = rel->schema;
+    TableMetadata metadata;
+    RC rc = readHeader(mgr->bufferPool, &metadata);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    *count = 0;
+    Expr *optimized = optimizeScanCondition(cond);
+    Expr *condition = (optimized != NULL) ? optimized : cond;
+    if (condition == NULL || (condition->type == EXPR_CONST && condition->expr.cons->dt == DT_BOOL)) {
+        if (condition == NULL || condition->expr.cons->v.boolV) {
+            *count = mgr->numTuples;
+        }
+        freeExpr(optimized);
+        return RC_OK;
+    }
+    if (bloomExcludesCondition(mgr->bloom, schema, condition)) {
+        freeExpr(optimized);
+        return RC_OK;
+    }
+
+    CompiledExpr *program = compileScanCondition(condition, schema);
+    IndexPlan plan = { -1, NULL, NULL, NULL };
+    RID *rids;
+    int numRids;
+    planIndexScan(mgr, schema, condition, &plan);
+    rc = runIndexPlan(mgr, &plan, &rids, &numRids);
+    if (rc == RC_OK && rids != NULL) {
+        // The plan's conjunct is the whole condition: the index has the answer
+        if (plan.equal != NULL && plan.equal->dt != DT_FLOAT && condition->type == EXPR_OP &&
+                condition->expr.op->type == OP_COMP_EQUAL) {
+            *count = numRids;
+        } else {
+            rc = countIndexMatches(mgr, schema, &metadata, condition, program, rids, numRids, count);
+        }
+    } else if (rc == RC_OK) {
+        rc = countHeapMatches(mgr, schema, &metadata, condition, program, count);
+    }
+
+    free(rids);
+    freeCompiledExpr(program);
+    freeExpr(optimized);
+    if (rc != RC_OK) {
+        *count = 0;
+    }
+    return rc;
+}
+
+// Parallel scans:
+// The data page range [DATA_START_PAGE, numPages) is cut into morsels of
+// PARALLEL_MORSEL_PAGES pages that worker threads claim one at a time,
+// so fast workers simply take more morsels. Each worker runs its own
+// cursor over the pages of its morsel with the scan condition and hands
+// matches to the callback. The buffer pool is not thread-safe, so pins
+// and unpins go through a lock; reading a pinned frame does not. Compiled
+// conditions adapt their evaluation order as they run, so every worker
+// compiles its own copy.
+
+typedef struct ParallelScanManager ParallelScanManager;
+
+typedef struct ParallelWorker {
+    ParallelScanManager *scanMgr; // Shared scan state
+    int workerId;                 // Index passed to the callback
+    CompiledExpr *program;        // Compiled condition private to this worker
+    int *selection;               // Matching slots of the current page
+    RC result;                    // First error seen by this worker
+} ParallelWorker;
+
+struct ParallelScanManager {
+    RM_TableData *rel;            // Table being scanned
+    Expr *condition;              // Scan condition, shared read-only
+    Expr *optimized;              // Optimized copy of the condition owned by the scan
+    RM_ScanCallback callback;     // Receives matching records
+    void *context;                // Passed through to the callback
+    int endPage;                  // One past the last data page
+    int slotsPerPage;             // Slots per page
+    int recordSize;               // Size of each record
+    int mapSize;                  // Size of the slot bitmap on each page
+    int nextPage;                 // First page of the next unclaimed morsel
+    bool stop;                    // Set once any worker fails
+    pthread_mutex_t morselLock;   // Guards nextPage and stop
+    pthread_mutex_t poolLock;     // Serializes buffer pool calls
+    int numWorkers;               // Number of worker threads
+    pthread_t *threads;           // Worker threads
+    ParallelWorker *workers;      // Per-worker state
+};
+
+// Claim the next morsel; returns false when the table is exhausted
+static bool claimMorsel(ParallelScanManager *scanMgr, int *firstPage, int *lastPage) {
+    bool claimed = false;
+
+    pthread_mutex_lock(&scanMgr->morselLock);
+    if (!scanMgr->stop && scanMgr->nextPage < scanMgr->endPage) {
+        *firstPage = scanMgr->nextPage;
+        *lastPage = scanMgr->nextPage + PARALLEL_MORSEL_PAGES;
+        if (*lastPage > scanMgr->endPage) {
+            *lastPage = scanMgr->endPage;
+        }
+        scanMgr->nextPage = *lastPage;
+        claimed = true;
+    }
+    pthread_mutex_unlock(&scanMgr->morselLock);
+
+    return claimed;
+}
+
+// Scan one pinned page, passing matches to the callback
+static RC parallelScanPage(ParallelWorker *worker, int pageNum, char *pageData) {
+    ParallelScanManager *scanMgr = worker->scanMgr;
+
+    // With a compiled condition, select the whole page at once
+    if (worker->selection != NULL) {
+        int numSelected;
+        RC selectResult = evalCompiledPage(worker->program,
+                                           pageData + getRecordOffset(0, scanMgr->recordSize, scanMgr->mapSize),
+                                           scanMgr->recordSize, scanMgr->slotsPerPage,
+                                           getSlotMap(pageData),
+                                           worker->selection, &numSelected);
+        if (selectResult != RC_OK) {
+            return selectResult;
+        }
+
+        for (int i = 0; i < numSelected; i++) {
+            Record match;
+            match.id.page = pageNum;
+            match.id.slot = worker->selection[i];
+            match.data = pageData + getRecordOffset(match.id.slot, scanMgr->recordSize, scanMgr->mapSize);
+
+            RC callbackResult = scanMgr->callback(worker->workerId, &match, scanMgr->context);
+            if (callbackResult != RC_OK) {
+                return callbackResult;
+            }
+        }
+        return RC_OK;
     }
-    
-    // Copy record data
-    memcpy(record->data, pageHandle->data + offset, metadata.recordSize);
-    
-    // Unpin page
-    RC unpinResult = unpinPage(bm, pageHandle);
-    if (unpinResult != RC_OK) {
-        free(pageHandle);
-        return unpinResult;
+
+    for (int slot = nextOccupiedSlot(pageData, scanMgr->slotsPerPage, 0); slot >= 0;
+         slot = nextOccupiedSlot(pageData, scanMgr->slotsPerPage, slot + 1)) {
+        Record candidate;
+        candidate.id.page = pageNum;
+        candidate.id.slot = slot;
+        candidate.data = pageData + getRecordOffset(slot, scanMgr->recordSize, scanMgr->mapSize);
+
+        bool matches;
+        RC evalResult = matchCondition(scanMgr->condition, worker->program,
+                                       &candidate, scanMgr->rel->schema, &matches);
+        if (evalResult != RC_OK) {
+            return evalResult;
+        }
+        if (!matches) {
+            continue;
+        }
+
+        RC callbackResult = scanMgr->callback(worker->workerId, &candidate, scanMgr->context);
+        if (callbackResult != RC_OK) {
+            return callbackResult;
+        }
     }
-    
-    free(pageHandle);
+
     return RC_OK;
 }
 
-// Start a scan operation
-RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
-    if (rel == NULL || rel->mgmtData == NULL || scan == NULL) {
-        return RC_FILE_HANDLE_NOT_INIT;
-    }
-    
-    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+static void *parallelScanWorker(void *arg) {
+    ParallelWorker *worker = (ParallelWorker *)arg;
+    ParallelScanManager *scanMgr = worker->scanMgr;
+    RecordManager *mgr = (RecordManager *)scanMgr->rel->mgmtData;
     BM_BufferPool *bm = mgr->bufferPool;
-    
-    // Read table metadata
-    TableMetadata metadata;
-    RC metadataResult = readHeader(bm, &metadata);
-    if (metadataResult != RC_OK) {
-        return metadataResult;
+    BM_PageHandle page;
+    int firstPage, lastPage;
+
+    while (worker->result == RC_OK && claimMorsel(scanMgr, &firstPage, &lastPage)) {
+        for (int pageNum = firstPage; pageNum < lastPage; pageNum++) {
+            if (!zoneMapAdmitsPage(mgr->zoneMap, scanMgr->rel->schema, pageNum, scanMgr->condition)) {
+                continue;
+            }
+
+            pthread_mutex_lock(&scanMgr->poolLock);
+            RC pinResult = pinPage(bm, &page, pageNum);
+            pthread_mutex_unlock(&scanMgr->poolLock);
+            if (pinResult != RC_OK) {
+                worker->result = pinResult;
+                break;
+            }
+
+            RC pageResult = parallelScanPage(worker, pageNum, page.data);
+
+            pthread_mutex_lock(&scanMgr->poolLock);
+            RC unpinResult = unpinPage(bm, &page);
+            pthread_mutex_unlock(&scanMgr->poolLock);
+
+            worker->result = (pageResult != RC_OK) ? pageResult : unpinResult;
+            if (worker->result != RC_OK) {
+                break;
+            }
+        }
     }
-    
-    // Initialize scan manager
-    ScanManager *scanMgr = (ScanManager *)malloc(sizeof(ScanManager));
-    scanMgr->condition = cond;
-    scanMgr->scanActive = true;
-    scanMgr->currentPage = DATA_START_PAGE;  // Start scan from first data page
-    scanMgr->currentSlot = 0;                // Start from first slot
-    scanMgr->totalPages = metadata.numPages;
-    scanMgr->slotsPerPage = metadata.slotsPerPage;
-    
-    // Initialize scan handle
-    scan->rel = rel;
-    scan->mgmtData = scanMgr;
-    
-    return RC_OK;
+
+    // Tell the other workers to stop claiming morsels
+    if (worker->result != RC_OK) {
+        pthread_mutex_lock(&scanMgr->morselLock);
+        scanMgr->stop = true;
+        pthread_mutex_unlock(&scanMgr->morselLock);
+    }
+
+    return NULL;
 }
 
-// Get next record that satisfies the scan condition
-RC next(RM_ScanHandle *scan, Record *record) {
-    if (scan == NULL || scan->mgmtData == NULL || record == NULL) {
+// Start a scan split across numWorkers threads
+RC startParallelScan(RM_TableData *rel, RM_ParallelScanHandle *scan, Expr *cond, int numWorkers,
+                     RM_ScanCallback callback, void *context) {
+    if (rel == NULL || rel->mgmtData == NULL || scan == NULL || callback == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
-    
-    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
-    
-    // Check if scan is active
-    if (!scanMgr->scanActive) {
-        return RC_RM_NO_MORE_TUPLES;
+
+    if (numWorkers < 1) {
+        numWorkers = 1;
     }
-    
-    RecordManager *mgr = (RecordManager *)scan->rel->mgmtData;
-    BM_BufferPool *bm = mgr->bufferPool;
-    
+
+    RecordManager *mgr = (RecordManager *)rel->mgmtData;
+
     // Read table metadata
     TableMetadata metadata;
-    RC metadataResult = readHeader(bm, &metadata);
+    RC metadataResult = readHeader(mgr->bufferPool, &metadata);
     if (metadataResult != RC_OK) {
         return metadataResult;
     }
-    
-    BM_PageHandle *pageHandle = (BM_PageHandle *)malloc(sizeof(BM_PageHandle));
-    if (pageHandle == NULL) {
+
+    ParallelScanManager *scanMgr = (ParallelScanManager *)malloc(sizeof(ParallelScanManager));
+    if (scanMgr == NULL) {
         return RC_MEM_ALLOC_FAILED;
     }
-    
-    RC pinResult;
-    bool found = false;
-    
-    // Scan through pages and slots
-    while (scanMgr->currentPage < scanMgr->totalPages) {
-        // Pin current page
-        pinResult = pinPage(bm, pageHandle, scanMgr->currentPage);
-        if (pinResult != RC_OK) {
-            free(pageHandle);
-            return pinResult;
-        }
-        
-        // Scan through slots in current page
-        while (scanMgr->currentSlot < scanMgr->slotsPerPage) {
-            // Check if slot is occupied
-            if (isSlotOccupied(pageHandle->data, scanMgr->currentSlot)) {
-                // Set up RID for the current record
-                RID rid;
-                rid.page = scanMgr->currentPage;
-                rid.slot = scanMgr->currentSlot;
-                
-                // Move to next slot for next iteration
-                scanMgr->currentSlot++;
-                
-                // Get the record
-                record->id = rid;
-                int mapSize = getSlotMapSize(metadata.slotsPerPage);
-                int offset = getRecordOffset(rid.slot, metadata.recordSize, mapSize);
-                
-                // Allocate memory for record data if needed
-                if (record->data == NULL) {
-                    record->data = (char *)malloc(metadata.recordSize);
-                    if (record->data == NULL) {
-                        unpinPage(bm, pageHandle);
-                        free(pageHandle);
-                        return RC_MEM_ALLOC_FAILED;
-                    }
-                }
-                
-                // Copy record data
-                memcpy(record->data, pageHandle->data + offset, metadata.recordSize);
-                
-                // Check condition if present
-                if (scanMgr->condition != NULL) {
-                    Value *result = NULL;
-                    RC evalResult = evalExpr(record, scan->rel->schema, scanMgr->condition, &result);
-                    if (evalResult != RC_OK) {
-                        unpinPage(bm, pageHandle);
-                        free(pageHandle);
-                        return evalResult;
-                    }
-                    
-                    if (result != NULL && result->v.boolV) {
-                        found = true;
-                        freeVal(result);
-                        break;
-                    }
-                    
-                    if (result != NULL) {
-                        freeVal(result);
-                    }
-                } else {
-                    // No condition means all records match
-                    found = true;
-                    break;
-                }
-            } else {
-                // Skip empty slot
-                scanMgr->currentSlot++;
-            }
-        }
-        
-        // Unpin current page before moving to next page or returning
-        RC unpinResult = unpinPage(bm, pageHandle);
-        if (unpinResult != RC_OK) {
-            free(pageHandle);
-            return unpinResult;
+    scanMgr->threads = (pthread_t *)malloc(sizeof(pthread_t) * numWorkers);
+    scanMgr->workers = (ParallelWorker *)malloc(sizeof(ParallelWorker) * numWorkers);
+    if (scanMgr->threads == NULL || scanMgr->workers == NULL) {
+        free(scanMgr->threads);
+        free(scanMgr->workers);
+        free(scanMgr);
+        return RC_MEM_ALLOC_FAILED;
+    }
+
+    scanMgr->rel = rel;
+    scanMgr->optimized = optimizeScanCondition(cond);
+    scanMgr->condition = (scanMgr->optimized != NULL) ? scanMgr->optimized : cond;
+    scanMgr->callback = callback;
+    scanMgr->context = context;
+    scanMgr->endPage = metadata.numPages;
+    scanMgr->slotsPerPage = metadata.slotsPerPage;
+    scanMgr->recordSize = metadata.recordSize;
+    scanMgr->mapSize = getSlotMapSize(metadata.slotsPerPage);
+    scanMgr->nextPage = DATA_START_PAGE;
+    scanMgr->stop = false;
+    scanMgr->numWorkers = 0;
+    pthread_mutex_init(&scanMgr->morselLock, NULL);
+    pthread_mutex_init(&scanMgr->poolLock, NULL);
+
+    scan->rel = rel;
+    scan->mgmtData = scanMgr;
+    mgr->openScans++;
+
+    // Launch workers; if a thread cannot be created, run with the ones we have
+    for (int i = 0; i < numWorkers; i++) {
+        ParallelWorker *worker = &scanMgr->workers[i];
+        worker->scanMgr = scanMgr;
+        worker->workerId = i;
+        worker->program = compileScanCondition(scanMgr->condition, rel->schema);
+        worker->selection = NULL;
+        worker->result = RC_OK;
+        if (worker->program != NULL) {
+            worker->selection = (int *)malloc(sizeof(int) * metadata.slotsPerPage);
         }
-        
-        if (found) {
+        if (pthread_create(&scanMgr->threads[i], NULL, parallelScanWorker, worker) != 0) {
+            freeCompiledExpr(worker->program);
+            free(worker->selection);
             break;
         }
-        
-        // Move to next page
-        scanMgr->currentPage++;
-        scanMgr->currentSlot = 0;
+        scanMgr->numWorkers++;
     }
-    
-    free(pageHandle);
-    
-    // If no more matching records
-    if (!found) {
-        scanMgr->scanActive = false;
-        return RC_RM_NO_MORE_TUPLES;
+
+    if (scanMgr->numWorkers == 0) {
+        closeParallelScan(scan);
+        return RC_MEM_ALLOC_FAILED;
     }
-    
+
     return RC_OK;
 }
 
-// Close a scan operation
-RC closeScan(RM_ScanHandle *scan) {
+// Wait for all workers of a parallel scan and release it
+RC closeParallelScan(RM_ParallelScanHandle *scan) {
     if (scan == NULL || scan->mgmtData == NULL) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
-    
-    // Free scan manager
-    ScanManager *scanMgr = (ScanManager *)scan->mgmtData;
+
+    ParallelScanManager *scanMgr = (ParallelScanManager *)scan->mgmtData;
+    RC result = RC_OK;
+
+    for (int i = 0; i < scanMgr->numWorkers; i++) {
+        pthread_join(scanMgr->threads[i], NULL);
+        freeCompiledExpr(scanMgr->workers[i].program);
+        free(scanMgr->workers[i].selection);
+        if (result == RC_OK) {
+            result = scanMgr->workers[i].result;
+        }
+    }
+
+    pthread_mutex_destroy(&scanMgr->morselLock);
+    pthread_mutex_destroy(&scanMgr->poolLock);
+    freeExpr(scanMgr->optimized);
+    free(scanMgr->threads);
+    free(scanMgr->workers);
     free(scanMgr);
     scan->mgmtData = NULL;
-    
-    return RC_OK;
+    ((RecordManager *)scan->rel->mgmtData)->openScans--;
+
+    return result;
 }
 
 // Get the size of a record for a given schema
@@ -996,6 +4903,14 @@ Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *ty
     schema->keySize = keySize;
     schema->keyAttrs = keys;
     
+    // Lay out the record once so attribute access never walks the schema
+    schema->attrOffsets = (int *)malloc(sizeof(int) * (numAttr > 0 ? numAttr : 1));
+    int offset = 0;
+    for (int i = 0; i < numAttr; i++) {
+        schema->attrOffsets[i] = offset;
+        offset += getAttrSize(schema, i);
+    }
+    
     return schema;
 }
 
@@ -1014,6 +4929,7 @@ RC freeSchema(Schema *schema) {
     free(schema->dataTypes);
     free(schema->typeLength);
     free(schema->keyAttrs);
+    free(schema->attrOffsets);
     free(schema);
     
     return RC_OK;
@@ -1051,6 +4967,47 @@ RC freeRecord(Record *record) {
     return RC_OK;
 }
 
+// Create a batch that can hold capacity records of the given schema
+RC createRecordBatch(RecordBatch **batch, Schema *schema, int capacity) {
+    if (batch == NULL || schema == NULL || capacity <= 0) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    
+    *batch = (RecordBatch *)malloc(sizeof(RecordBatch));
+    if (*batch == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    
+    int recordSize = getRecordSize(schema);
+    (*batch)->numRecords = 0;
+    (*batch)->capacity = capacity;
+    (*batch)->recordSize = recordSize;
+    (*batch)->ids = (RID *)malloc(sizeof(RID) * capacity);
+    (*batch)->data = (char *)malloc((size_t)recordSize * capacity);
+    if ((*batch)->ids == NULL || (*batch)->data == NULL) {
+        free((*batch)->ids);
+        free((*batch)->data);
+        free(*batch);
+        *batch = NULL;
+        return RC_MEM_ALLOC_FAILED;
+    }
+    
+    return RC_OK;
+}
+
+// Free batch resources
+RC freeRecordBatch(RecordBatch *batch) {
+    if (batch == NULL) {
+        return RC_OK;
+    }
+    
+    free(batch->ids);
+    free(batch->data);
+    free(batch);
+    
+    return RC_OK;
+}
+
 // Get attribute value from a record
 RC getAttr(const Record *record, Schema *schema, int attrNum, Value **value) {
     if (record == NULL || schema == NULL || attrNum < 0 || attrNum >= schema->numAttr) {
@@ -1071,24 +5028,8 @@ RC getAttr(const Record *record, Schema *schema, int attrNum, Value **value) {
     // Set value data type
     (*value)->dt = schema->dataTypes[attrNum];
     
-    // Calculate offset for the attribute in the record
-    int offset = 0;
-    for (int i = 0; i < attrNum; i++) {
-        switch (schema->dataTypes[i]) {
-            case DT_INT:
-                offset += sizeof(int);
-                break;
-            case DT_FLOAT:
-                offset += sizeof(float);
-                break;
-            case DT_BOOL:
-                offset += sizeof(bool);
-                break;
-            case DT_STRING:
-                offset += schema->typeLength[i];
-                break;
-        }
-    }
+    // Offset for the attribute in the record
+    int offset = schema->attrOffsets[attrNum];
     
     // Extract value based on data type
     switch (schema->dataTypes[attrNum]) {
@@ -1141,24 +5082,8 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value) {
         return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
     }
     
-    // Calculate offset for the attribute in the record
-    int offset = 0;
-    for (int i = 0; i < attrNum; i++) {
-        switch (schema->dataTypes[i]) {
-            case DT_INT:
-                offset += sizeof(int);
-                break;
-            case DT_FLOAT:
-                offset += sizeof(float);
-                break;
-            case DT_BOOL:
-                offset += sizeof(bool);
-                break;
-            case DT_STRING:
-                offset += schema->typeLength[i];
-                break;
-        }
-    }
+    // Offset for the attribute in the record
+    int offset = schema->attrOffsets[attrNum];
     
     // Set value based on data type
     switch (schema->dataTypes[attrNum]) {
@@ -1193,4 +5118,118 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value) {
     }
     
     return RC_OK;
-}
\ No newline at end of file
+}
+
+// Allocation-free typed accessors:
+// These read straight from the record bytes through the schema's offset
+// table and never allocate. Asking for the wrong type returns
+// RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE.
+
+static RC checkAttr(const Record *record, Schema *schema, int attrNum, DataType dt) {
+    if (record == NULL || schema == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (attrNum < 0 || attrNum >= schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    if (schema->dataTypes[attrNum] != dt) {
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    }
+    return RC_OK;
+}
+
+// Get an integer attribute
+RC getAttrInt(const Record *record, Schema *schema, int attrNum, int *value) {
+    RC rc = checkAttr(record, schema, attrNum, DT_INT);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    
+    memcpy(value, record->data + schema->attrOffsets[attrNum], sizeof(int));
+    return RC_OK;
+}
+
+// Get a float attribute
+RC getAttrFloat(const Record *record, Schema *schema, int attrNum, float *value) {
+    RC rc = checkAttr(record, schema, attrNum, DT_FLOAT);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    
+    memcpy(value, record->data + schema->attrOffsets[attrNum], sizeof(float));
+    return RC_OK;
+}
+
+// Get a boolean attribute as 0 or 1
+RC getAttrBool(const Record *record, Schema *schema, int attrNum, int *value) {
+    RC rc = checkAttr(record, schema, attrNum, DT_BOOL);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    
+    bool boolVal;
+    memcpy(&boolVal, record->data + schema->attrOffsets[attrNum], sizeof(bool));
+    *value = boolVal ? 1 : 0;
+    return RC_OK;
+}
+
+// Get a string attribute as a pointer into the record and its length.
+// The string is not NUL-terminated when it fills the whole attribute.
+RC getAttrString(const Record *record, Schema *schema, int attrNum, const char **str, int *length) {
+    RC rc = checkAttr(record, schema, attrNum, DT_STRING);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    
+    const char *data = record->data + schema->attrOffsets[attrNum];
+    int maxLen = schema->typeLength[attrNum];
+    int len = 0;
+    while (len < maxLen && data[len] != '\0') {
+        len++;
+    }
+    
+    *str = data;
+    *length = len;
+    return RC_OK;
+}
+
+// Get an attribute into a caller-owned Value.
+// For DT_STRING, value->v.stringV must point to a buffer of at least
+// typeLength + 1 bytes; the string is copied there and NUL-terminated.
+RC getAttrInto(const Record *record, Schema *schema, int attrNum, Value *value) {
+    if (record == NULL || schema == NULL || value == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (attrNum < 0 || attrNum >= schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    
+    const char *data = record->data + schema->attrOffsets[attrNum];
+    value->dt = schema->dataTypes[attrNum];
+    
+    switch (schema->dataTypes[attrNum]) {
+        case DT_INT:
+            memcpy(&value->v.intV, data, sizeof(int));
+            break;
+        case DT_FLOAT:
+            memcpy(&value->v.floatV, data, sizeof(float));
+            break;
+        case DT_BOOL: {
+            bool boolVal;
+            memcpy(&boolVal, data, sizeof(bool));
+            value->v.boolV = boolVal;
+            break;
+        }
+        case DT_STRING: {
+            if (value->v.stringV == NULL) {
+                return RC_FILE_HANDLE_NOT_INIT;
+            }
+            int strLen = schema->typeLength[attrNum];
+            memcpy(value->v.stringV, data, strLen);
+            value->v.stringV[strLen] = '\0';
+            break;
+        }
+    }
+    
+    return RC_OK;
+}
@@ -12,6 +12,55 @@ typedef struct RM_ScanHandle
 	void *mgmtData;
 } RM_ScanHandle;
 
+// Options for startScanWithOptions
+// zeroCopy: next() sets record->data to point straight into the pinned
+//   buffer frame instead of copying. The pointer is read-only and stays
+//   valid until the scan moves on to the next page or is closed, so the
+//   record passed to next() must not own its data (do not use one made
+//   by createRecord). nextBatch always copies.
+// numProjAttrs/projAttrs: when numProjAttrs > 0, records are returned
+//   with only the listed attributes, packed in list order. Their schema is
+//   getScanSchema(scan); size records and batches with it. Projected
+//   scans always copy, whatever zeroCopy says.
+// limit: when > 0, the scan returns at most this many records and
+//   releases its page as soon as it has.
+// topK/orderAttr/descending: when topK > 0, the scan returns only the
+//   topK matching records with the smallest (descending: largest) values
+//   of attribute orderAttr, best first, with ties in RID order and NaN
+//   last. They are collected through a heap of topK records on the first
+//   call to next() or nextBatch(); zero-copy records then point into it
+//   and stay valid until the scan is closed. limit applies on top.
+typedef struct RM_ScanOptions
+{
+	int zeroCopy;
+	int numProjAttrs;
+	int *projAttrs;
+	int limit;
+	int topK;
+	int orderAttr;
+	int descending;
+} RM_ScanOptions;
+
+// Bookkeeping for parallel scans
+typedef struct RM_ParallelScanHandle
+{
+	RM_TableData *rel;
+	void *mgmtData;
+} RM_ParallelScanHandle;
+
+// Called by parallel scan worker workerId for every matching record.
+// record->data points into a pinned page and is only valid during the
+// call. Returning anything but RC_OK stops that worker; the code is
+// reported by closeParallelScan.
+typedef RC (*RM_ScanCallback) (int workerId, Record *record, void *context);
+
+// Bookkeeping for bulk loads
+typedef struct RM_BulkLoadHandle
+{
+	RM_TableData *rel;
+	void *mgmtData;
+} RM_BulkLoadHandle;
+
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
@@ -21,17 +70,52 @@ extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
 
+// number of records matching cond (NULL: all), counted in place without
+// copying records or allocating values; answered from the tuple count,
+// the Bloom filter, an index or the zone map where they can
+extern RC countMatching (RM_TableData *rel, Expr *cond, int *count);
+
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
 extern RC deleteRecord (RM_TableData *rel, RID id);
 extern RC updateRecord (RM_TableData *rel, Record *record);
 extern RC getRecord (RM_TableData *rel, RID id, Record *record);
+extern RC getRecords (RM_TableData *rel, const RID *ids, int n, Record **out, RC *status);
+
+// secondary hash indexes on single INT, FLOAT or STRING attributes;
+// lookupRecord fetches the first record whose attribute equals value
+// (RC_IM_KEY_NOT_FOUND if none), through an index where there is one
+extern RC createIndex (RM_TableData *rel, int attrNum);
+extern RC dropIndex (RM_TableData *rel, int attrNum);
+extern RC lookupRecord (RM_TableData *rel, int attrNum, Value *value, Record *record);
+
+// compacting a table after deletes: records are moved out of the last
+// pages into free slots of earlier ones and the file is truncated; the
+// old RID of a moved record keeps resolving to it in getRecord(s),
+// updateRecord and deleteRecord. Returns RC_RM_SCAN_OPEN while a scan or
+// parallel scan of the table is open.
+extern RC vacuumTable (RM_TableData *rel);
+
+// bulk loading an empty table; startBulkLoad returns RC_RM_SCAN_OPEN while
+// a scan or parallel scan of the table is open
+extern RC startBulkLoad (RM_TableData *rel, RM_BulkLoadHandle *load);
+extern RC bulkLoadRecord (RM_BulkLoadHandle *load, Record *record);
+extern RC finishBulkLoad (RM_BulkLoadHandle *load);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC initScanOptions (RM_ScanOptions *options);
+extern RC startScanWithOptions (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, RM_ScanOptions *options);
+extern RC startProjectedScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs);
+extern Schema *getScanSchema (RM_ScanHandle *scan);
 extern RC next (RM_ScanHandle *scan, Record *record);
+extern RC nextBatch (RM_ScanHandle *scan, RecordBatch *batch, int maxRows);
 extern RC closeScan (RM_ScanHandle *scan);
 
+// parallel scans: the table must not be used by other code until closeParallelScan
+extern RC startParallelScan (RM_TableData *rel, RM_ParallelScanHandle *scan, Expr *cond, int numWorkers, RM_ScanCallback callback, void *context);
+extern RC closeParallelScan (RM_ParallelScanHandle *scan);
+
 // dealing with schemas
 extern int getRecordSize (Schema *schema);
 extern Schema *createSchema (int numAttr, char **attrNames, DataType *dataTypes, int *typeLength, int keySize, int *keys);
@@ -40,7 +124,17 @@ extern RC freeSchema (Schema *schema);
 // dealing with records and attribute values
 extern RC createRecord (Record **record, Schema *schema);
 extern RC freeRecord (Record *record);
+extern RC createRecordBatch (RecordBatch **batch, Schema *schema, int capacity);
+extern RC freeRecordBatch (RecordBatch *batch);
 extern RC getAttr (const Record *record, Schema *schema, int attrNum, Value **value);
 extern RC setAttr (Record *record, Schema *schema, int attrNum, Value *value);
+extern int getAttrOffset (Schema *schema, int attrNum);
+
+// allocation-free attribute access
+extern RC getAttrInt (const Record *record, Schema *schema, int attrNum, int *value);
+extern RC getAttrFloat (const Record *record, Schema *schema, int attrNum, float *value);
+extern RC getAttrBool (const Record *record, Schema *schema, int attrNum, int *value);
+extern RC getAttrString (const Record *record, Schema *schema, int attrNum, const char **str, int *length);
+extern RC getAttrInto (const Record *record, Schema *schema, int attrNum, Value *value);
 
 #endif // RECORD_MGR_H
@@ -0,0 +1,1741 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include "rm_operators.h"
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "tables.h"
+
+// Define constants
+#define MIN_MEMORY_PAGES 3
+
+// Operators that spill keep their data in a temporary page file next to
+// the table they read, named <table>.<operator><n>, and remove it when
+// they are closed.
+
+static int tempFileCounter = 0;
+
+static RC openTempFile(const char *tableName, const char *kind, char **fileName, SM_FileHandle *file) {
+    *fileName = (char *)malloc(strlen(tableName) + strlen(kind) + 32);
+    if (*fileName == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    sprintf(*fileName, "%s.%s%d", tableName, kind, tempFileCounter++);
+
+    RC createResult = createPageFile(*fileName);
+    if (createResult == RC_OK) {
+        createResult = openPageFile(*fileName, file);
+        if (createResult != RC_OK) {
+            destroyPageFile(*fileName);
+        }
+    }
+    if (createResult != RC_OK) {
+        free(*fileName);
+        *fileName = NULL;
+    }
+    return createResult;
+}
+
+static void removeTempFile(char *fileName, SM_FileHandle *file) {
+    if (fileName != NULL) {
+        closePageFile(file);
+        destroyPageFile(fileName);
+        free(fileName);
+    }
+}
+
+// External merge sort:
+// A sort entry is the RID of a record followed by its bytes. startSort()
+// fills the memory budget, less one page for output, with entries and
+// sorts them; if the scan has more to give, they are written out as a
+// sorted run and the next run is started. All runs go into one temporary
+// page file, entries packed PAGE_SIZE / entrySize to a page and every run
+// starting on a new page. While there are more runs than can be merged
+// with one page of memory each, groups of them are merged into longer
+// runs; the last ones are merged as nextSorted() asks for records, using
+// a heap of run cursors. Ties go to the earlier run, so the sort is
+// stable.
+
+typedef struct SortKeyInfo {
+    int offset;         // Offset of the attribute in an entry
+    DataType dt;        // Type of the attribute
+    int length;         // typeLength of STRING attributes
+    int descending;     // Largest values first
+} SortKeyInfo;
+
+typedef struct SortRun {
+    int firstPage;      // Page of the temporary file the run starts on
+    int numEntries;     // Entries in the run
+} SortRun;
+
+typedef struct RunCursor {
+    SortRun run;        // Run being read
+    int nextEntry;      // Entries of the run consumed so far
+    char *page;         // Page holding the current entry
+} RunCursor;
+
+typedef struct SortManager {
+    int numKeys;
+    SortKeyInfo *keys;
+    int recordSize;     // Size of the sorted records
+    int entrySize;      // sizeof(RID) + recordSize
+    int entriesPerPage; // Entries per page of the temporary file
+    int fanIn;          // Runs merged at once
+
+    // In-memory sort: the entries, in order
+    char *buffer;       // Entries in scan order
+    char **sorted;      // Entries of buffer in sorted order
+    int numSorted;      // Number of entries
+    int pos;            // Next entry to return
+
+    // Spilled sort
+    char *fileName;     // Temporary page file (NULL: nothing spilled)
+    SM_FileHandle file;
+    int filePages;      // Pages written to the file so far
+    SortRun *runs;      // Runs still to be merged
+    int numRuns;
+    RunCursor *cursors; // fanIn cursors, each with a page of memory
+    int *heap;          // Cursors that have entries left, smallest first
+    int heapSize;
+} SortManager;
+
+static int compareEntries(SortManager *mgr, const char *left, const char *right) {
+    for (int k = 0; k < mgr->numKeys; k++) {
+        SortKeyInfo *key = &mgr->keys[k];
+        const char *l = left + key->offset;
+        const char *r = right + key->offset;
+        int cmp;
+
+        switch (key->dt) {
+            case DT_INT:
+                {
+                    int a, b;
+                    memcpy(&a, l, sizeof(int));
+                    memcpy(&b, r, sizeof(int));
+                    cmp = (a > b) - (a < b);
+                }
+                break;
+            case DT_FLOAT:
+                {
+                    // NaN sorts after every number
+                    float a, b;
+                    memcpy(&a, l, sizeof(float));
+                    memcpy(&b, r, sizeof(float));
+                    if (isnan(a) || isnan(b)) {
+                        cmp = (isnan(a) != 0) - (isnan(b) != 0);
+                    } else {
+                        cmp = (a > b) - (a < b);
+                    }
+                }
+                break;
+            case DT_STRING:
+                cmp = strncmp(l, r, key->length);
+                cmp = (cmp > 0) - (cmp < 0);
+                break;
+            default:
+                cmp = (l[0] != 0) - (r[0] != 0);
+                break;
+        }
+
+        if (cmp != 0) {
+            return key->descending ? -cmp : cmp;
+        }
+    }
+    return 0;
+}
+
+// Stable bottom-up merge sort; scratch has room for n pointers
+static void sortEntries(SortManager *mgr, char **entries, char **scratch, int n) {
+    char **from = entries;
+    char **to = scratch;
+
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = (lo + width < n) ? lo + width : n;
+            int hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                to[k++] = (compareEntries(mgr, from[j], from[i]) < 0) ? from[j++] : from[i++];
+            }
+            while (i < mid) {
+                to[k++] = from[i++];
+            }
+            while (j < hi) {
+                to[k++] = from[j++];
+            }
+        }
+        char **swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != entries) {
+        memcpy(entries, from, sizeof(char *) * n);
+    }
+}
+
+// Entries of a run are appended through outPage, which is written to the
+// file whenever it fills up and by flushEntries at the end of the run
+static RC appendEntry(SortManager *mgr, char *outPage, int *inPage, const char *entry) {
+    memcpy(outPage + (size_t)*inPage * mgr->entrySize, entry, mgr->entrySize);
+    if (++*inPage < mgr->entriesPerPage) {
+        return RC_OK;
+    }
+    *inPage = 0;
+    return writeBlocks(mgr->filePages++, 1, &mgr->file, outPage);
+}
+
+static RC flushEntries(SortManager *mgr, char *outPage, int inPage) {
+    if (inPage == 0) {
+        return RC_OK;
+    }
+    return writeBlocks(mgr->filePages++, 1, &mgr->file, outPage);
+}
+
+static RC addRun(SortRun **runs, int *numRuns, SortRun run) {
+    SortRun *grown = (SortRun *)realloc(*runs, sizeof(SortRun) * (*numRuns + 1));
+    if (grown == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    grown[(*numRuns)++] = run;
+    *runs = grown;
+    return RC_OK;
+}
+
+// Write sorted entries to the file as a new run
+static RC spillRun(SortManager *mgr, char **entries, int count, char *outPage) {
+    SortRun run = { mgr->filePages, count };
+    int inPage = 0;
+    RC rc = RC_OK;
+
+    for (int i = 0; i < count && rc == RC_OK; i++) {
+        rc = appendEntry(mgr, outPage, &inPage, entries[i]);
+    }
+    if (rc == RC_OK) {
+        rc = flushEntries(mgr, outPage, inPage);
+    }
+    if (rc == RC_OK) {
+        rc = addRun(&mgr->runs, &mgr->numRuns, run);
+    }
+    return rc;
+}
+
+static char *cursorEntry(SortManager *mgr, RunCursor *cursor) {
+    return cursor->page + (size_t)(cursor->nextEntry % mgr->entriesPerPage) * mgr->entrySize;
+}
+
+// Whether cursor a comes before cursor b in the heap
+static int cursorBefore(SortManager *mgr, int a, int b) {
+    int cmp = compareEntries(mgr, cursorEntry(mgr, &mgr->cursors[a]), cursorEntry(mgr, &mgr->cursors[b]));
+    return (cmp != 0) ? cmp < 0 : a < b;
+}
+
+static void siftDown(SortManager *mgr, int pos) {
+    int *heap = mgr->heap;
+    while (2 * pos + 1 < mgr->heapSize) {
+        int child = 2 * pos + 1;
+        if (child + 1 < mgr->heapSize && cursorBefore(mgr, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!cursorBefore(mgr, heap[child], heap[pos])) {
+            break;
+        }
+        int swap = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = swap;
+        pos = child;
+    }
+}
+
+// Point the cursors at the first entries of count runs and heap them up
+static RC openRuns(SortManager *mgr, SortRun *runs, int count) {
+    mgr->heapSize = 0;
+    for (int i = 0; i < count; i++) {
+        RunCursor *cursor = &mgr->cursors[i];
+        cursor->run = runs[i];
+        cursor->nextEntry = 0;
+        if (cursor->run.numEntries > 0) {
+            RC readResult = readBlock(cursor->run.firstPage, &mgr->file, cursor->page);
+            if (readResult != RC_OK) {
+                return readResult;
+            }
+            mgr->heap[mgr->heapSize++] = i;
+        }
+    }
+    for (int i = mgr->heapSize / 2 - 1; i >= 0; i--) {
+        siftDown(mgr, i);
+    }
+    return RC_OK;
+}
+
+// Move the cursor at the top of the heap past its current entry
+static RC popEntry(SortManager *mgr) {
+    RunCursor *cursor = &mgr->cursors[mgr->heap[0]];
+    cursor->nextEntry++;
+
+    if (cursor->nextEntry == cursor->run.numEntries) {
+        mgr->heap[0] = mgr->heap[--mgr->heapSize];
+    } else if (cursor->nextEntry % mgr->entriesPerPage == 0) {
+        int pageNum = cursor->run.firstPage + cursor->nextEntry / mgr->entriesPerPage;
+        RC readResult = readBlock(pageNum, &mgr->file, cursor->page);
+        if (readResult != RC_OK) {
+            return readResult;
+        }
+    }
+
+    if (mgr->heapSize > 0) {
+        siftDown(mgr, 0);
+    }
+    return RC_OK;
+}
+
+// Merge count runs into one new run at the end of the file
+static RC mergeRuns(SortManager *mgr, SortRun *runs, int count, char *outPage, SortRun *merged) {
+    merged->firstPage = mgr->filePages;
+    merged->numEntries = 0;
+
+    RC rc = openRuns(mgr, runs, count);
+    int inPage = 0;
+    while (rc == RC_OK && mgr->heapSize > 0) {
+        rc = appendEntry(mgr, outPage, &inPage, cursorEntry(mgr, &mgr->cursors[mgr->heap[0]]));
+        if (rc == RC_OK) {
+            merged->numEntries++;
+            rc = popEntry(mgr);
+        }
+    }
+    if (rc == RC_OK) {
+        rc = flushEntries(mgr, outPage, inPage);
+    }
+    return rc;
+}
+
+// Merge groups of fanIn runs until the rest can be merged in one go
+static RC mergePasses(SortManager *mgr, char *outPage) {
+    while (mgr->numRuns > mgr->fanIn) {
+        SortRun *merged = NULL;
+        int numMerged = 0;
+        RC rc = RC_OK;
+
+        for (int first = 0; first < mgr->numRuns && rc == RC_OK; first += mgr->fanIn) {
+            int count = (mgr->numRuns - first < mgr->fanIn) ? mgr->numRuns - first : mgr->fanIn;
+            SortRun run = mgr->runs[first];
+            if (count > 1) {
+                rc = mergeRuns(mgr, mgr->runs + first, count, outPage, &run);
+            }
+            if (rc == RC_OK) {
+                rc = addRun(&merged, &numMerged, run);
+            }
+        }
+
+        free(mgr->runs);
+        mgr->runs = merged;
+        mgr->numRuns = numMerged;
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    return RC_OK;
+}
+
+static void freeSortManager(SortManager *mgr) {
+    removeTempFile(mgr->fileName, &mgr->file);
+    if (mgr->cursors != NULL) {
+        for (int i = 0; i < mgr->fanIn; i++) {
+            free(mgr->cursors[i].page);
+        }
+    }
+    free(mgr->cursors);
+    free(mgr->heap);
+    free(mgr->runs);
+    free(mgr->sorted);
+    free(mgr->buffer);
+    free(mgr->keys);
+    free(mgr);
+}
+
+// Sort the records of a scan
+RC startSort(RM_ScanHandle *scan, int numKeys, RM_SortKey *keys, int memoryPages, RM_SortHandle *sort) {
+    if (scan == NULL || scan->mgmtData == NULL || sort == NULL || numKeys < 0 ||
+        (numKeys > 0 && keys == NULL)) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    Schema *schema = getScanSchema(scan);
+    for (int k = 0; k < numKeys; k++) {
+        if (keys[k].attrNum < 0 || keys[k].attrNum >= schema->numAttr) {
+            return RC_RM_INVALID_ATTRIBUTE;
+        }
+    }
+    if (memoryPages < MIN_MEMORY_PAGES) {
+        memoryPages = MIN_MEMORY_PAGES;
+    }
+
+    SortManager *mgr = (SortManager *)calloc(1, sizeof(SortManager));
+    if (mgr == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    mgr->recordSize = getRecordSize(schema);
+    mgr->entrySize = (int)sizeof(RID) + mgr->recordSize;
+    mgr->entriesPerPage = PAGE_SIZE / mgr->entrySize;
+    mgr->fanIn = memoryPages - 1;
+    if (mgr->entriesPerPage == 0) {
+        free(mgr);
+        return RC_INVALID_RECORD_SIZE;
+    }
+
+    // One page of the budget is kept for writing runs
+    int capacity = (memoryPages - 1) * mgr->entriesPerPage;
+    mgr->numKeys = numKeys;
+    mgr->keys = (SortKeyInfo *)malloc(sizeof(SortKeyInfo) * (numKeys + 1));
+    mgr->buffer = (char *)malloc((size_t)capacity * mgr->entrySize);
+    mgr->sorted = (char **)malloc(sizeof(char *) * capacity);
+    char **scratch = (char **)malloc(sizeof(char *) * capacity);
+    char *outPage = (char *)malloc(PAGE_SIZE);
+    if (mgr->keys == NULL || mgr->buffer == NULL || mgr->sorted == NULL || scratch == NULL || outPage == NULL) {
+        free(scratch);
+        free(outPage);
+        freeSortManager(mgr);
+        return RC_MEM_ALLOC_FAILED;
+    }
+    for (int k = 0; k < numKeys; k++) {
+        int attrNum = keys[k].attrNum;
+        mgr->keys[k].offset = (int)sizeof(RID) + getAttrOffset(schema, attrNum);
+        mgr->keys[k].dt = schema->dataTypes[attrNum];
+        mgr->keys[k].length = schema->typeLength[attrNum];
+        mgr->keys[k].descending = keys[k].descending;
+    }
+
+    // Read the scan into sorted runs. A copying scan writes each record
+    // straight into its entry; a zero-copy one hands back a pointer.
+    RC rc = RC_OK;
+    int count = 0;
+    Record record;
+    while (rc == RC_OK) {
+        char *entry = mgr->buffer + (size_t)count * mgr->entrySize;
+        record.data = entry + sizeof(RID);
+        rc = next(scan, &record);
+        if (rc != RC_OK) {
+            break;
+        }
+        if (record.data != entry + sizeof(RID)) {
+            memcpy(entry + sizeof(RID), record.data, mgr->recordSize);
+        }
+        memcpy(entry, &record.id, sizeof(RID));
+        mgr->sorted[count++] = entry;
+
+        if (count == capacity) {
+            sortEntries(mgr, mgr->sorted, scratch, count);
+            if (mgr->fileName == NULL) {
+                rc = openTempFile(scan->rel->name, "sort", &mgr->fileName, &mgr->file);
+            }
+            if (rc == RC_OK) {
+                rc = spillRun(mgr, mgr->sorted, count, outPage);
+            }
+            count = 0;
+        }
+    }
+    if (rc == RC_RM_NO_MORE_TUPLES) {
+        rc = RC_OK;
+    }
+
+    if (rc == RC_OK) {
+        sortEntries(mgr, mgr->sorted, scratch, count);
+        mgr->numSorted = count;
+    }
+
+    // Spilled: write the last run and merge down to fanIn runs
+    if (rc == RC_OK && mgr->fileName != NULL) {
+        if (count > 0) {
+            rc = spillRun(mgr, mgr->sorted, count, outPage);
+        }
+        free(mgr->buffer);
+        free(mgr->sorted);
+        mgr->buffer = NULL;
+        mgr->sorted = NULL;
+
+        mgr->cursors = (RunCursor *)calloc(mgr->fanIn, sizeof(RunCursor));
+        mgr->heap = (int *)malloc(sizeof(int) * mgr->fanIn);
+        if (rc == RC_OK && (mgr->cursors == NULL || mgr->heap == NULL)) {
+            rc = RC_MEM_ALLOC_FAILED;
+        }
+        for (int i = 0; rc == RC_OK && i < mgr->fanIn; i++) {
+            mgr->cursors[i].page = (char *)malloc(PAGE_SIZE);
+            if (mgr->cursors[i].page == NULL) {
+                rc = RC_MEM_ALLOC_FAILED;
+            }
+        }
+
+        if (rc == RC_OK) {
+            rc = mergePasses(mgr, outPage);
+        }
+        if (rc == RC_OK) {
+            rc = openRuns(mgr, mgr->runs, mgr->numRuns);
+        }
+    }
+
+    free(scratch);
+    free(outPage);
+    if (rc != RC_OK) {
+        freeSortManager(mgr);
+        return rc;
+    }
+
+    sort->mgmtData = mgr;
+    return RC_OK;
+}
+
+// Return the next record in sorted order
+RC nextSorted(RM_SortHandle *sort, Record *record) {
+    if (sort == NULL || sort->mgmtData == NULL || record == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    SortManager *mgr = (SortManager *)sort->mgmtData;
+    const char *entry;
+    if (mgr->fileName == NULL) {
+        if (mgr->pos >= mgr->numSorted) {
+            return RC_RM_NO_MORE_TUPLES;
+        }
+        entry = mgr->sorted[mgr->pos++];
+    } else {
+        if (mgr->heapSize == 0) {
+            return RC_RM_NO_MORE_TUPLES;
+        }
+        entry = cursorEntry(mgr, &mgr->cursors[mgr->heap[0]]);
+    }
+
+    if (record->data == NULL) {
+        record->data = (char *)malloc(mgr->recordSize);
+        if (record->data == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+    }
+    memcpy(&record->id, entry, sizeof(RID));
+    memcpy(record->data, entry + sizeof(RID), mgr->recordSize);
+
+    // The merge moves on only once the entry has been copied out
+    return (mgr->fileName != NULL) ? popEntry(mgr) : RC_OK;
+}
+
+// Free a sort and remove its temporary file
+RC closeSort(RM_SortHandle *sort) {
+    if (sort == NULL || sort->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    freeSortManager((SortManager *)sort->mgmtData);
+    sort->mgmtData = NULL;
+    return RC_OK;
+}
+
+// Hash join:
+// A join entry is, as for sorts, a RID followed by the record's bytes.
+// startHashJoin() reads the build scan into memory and chains its entries
+// in a hash table on the join attribute; nextJoined() then reads the probe
+// scan and returns each probe record once for every build record with an
+// equal join value. When the build side does not fit in memoryPages pages,
+// both scans are instead split into memoryPages - 1 partitions on the hash
+// of the join value and written to a temporary page file, one page of
+// memory per partition, and the partitions are joined pair by pair (Grace
+// hash join). A build partition that is still larger than memoryPages is
+// split again with the hash seeded by its level, and so on until it fits.
+// Only a build partition whose entries all hold one join value cannot be
+// split by any hash; it is loaded whole, however large. NaN entries are
+// dropped when partitioning, as they match nothing.
+
+typedef struct JoinPartition {
+    int *pages;         // Pages of the temporary file holding the partition
+    int numPages;
+    int numEntries;
+} JoinPartition;
+
+typedef struct JoinPair {
+    JoinPartition build;
+    JoinPartition probe;
+    int level;          // Seed of the hash that made the pair
+} JoinPair;
+
+typedef struct JoinSide {
+    int offset;         // Offset of the join attribute in an entry
+    DataType dt;
+    int length;         // typeLength of STRING join attributes
+    int recordSize;
+    int entrySize;      // sizeof(RID) + recordSize
+    int entriesPerPage; // Entries per page of the temporary file
+} JoinSide;
+
+typedef struct JoinManager {
+    JoinSide build;
+    JoinSide probe;
+
+    // Hash table over the build entries in memory
+    char *entries;
+    uint32_t *hashes;   // Hash of each entry's join value
+    int *chain;         // Next entry in the same bucket (-1: none)
+    int numEntries;
+    int capacity;       // Entries allocated
+    int budget;         // Entries that fit in memoryPages
+    int *buckets;       // First entry of each bucket (-1: none)
+    int numBuckets;     // A power of two
+
+    // Probe side
+    RM_ScanHandle *scan; // Probe scan, read lazily unless the join spilled
+    char *probeEntry;   // Current probe entry
+    uint32_t probeHash;
+    int match;          // Next build entry to try against it (-1: none)
+    char *page;         // Probe entry buffer, or page of a probe partition
+
+    // Spilled join
+    char *fileName;     // Temporary page file (NULL: nothing spilled)
+    SM_FileHandle file;
+    int filePages;
+    int numPartitions;
+    char **outPages;    // Page being filled for each partition
+    JoinPair *pairs;    // Partition pairs left to join, last one first
+    int numPairs;
+    int pairCapacity;
+    JoinPair current;   // Partition pair being joined
+    int probePos;       // Next entry of the probe partition
+    int pageIndex;      // Page of the probe partition in page (-1: none)
+} JoinManager;
+
+// FNV-1a over the join value, which hashes the values the join treats as
+// equal alike, finished with a mix so that every bit depends on the value.
+// The seed changes the starting state, so values that collide under one
+// seed are split under another.
+static uint32_t hashJoinValue(JoinSide *side, const char *entry, uint32_t seed) {
+    const unsigned char *bytes = (const unsigned char *)entry + side->offset;
+    unsigned char normalized[sizeof(float)];
+    int length;
+
+    switch (side->dt) {
+        case DT_INT:
+            length = sizeof(int);
+            break;
+        case DT_FLOAT:
+            {
+                float value;
+                memcpy(&value, bytes, sizeof(float));
+                if (value == 0.0f) {
+                    value = 0.0f;
+                }
+                memcpy(normalized, &value, sizeof(float));
+                bytes = normalized;
+                length = sizeof(float);
+            }
+            break;
+        case DT_STRING:
+            {
+                const unsigned char *end = memchr(bytes, '\0', side->length);
+                length = (end != NULL) ? (int)(end - bytes) : side->length;
+            }
+            break;
+        default:
+            normalized[0] = bytes[0] != 0;
+            bytes = normalized;
+            length = 1;
+            break;
+    }
+
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static int joinValuesEqual(JoinSide *left, const char *leftEntry, JoinSide *right, const char *rightEntry) {
+    const char *b = leftEntry + left->offset;
+    const char *p = rightEntry + right->offset;
+
+    switch (left->dt) {
+        case DT_INT:
+            return memcmp(b, p, sizeof(int)) == 0;
+        case DT_FLOAT:
+            {
+                // NaN equals nothing
+                float x, y;
+                memcpy(&x, b, sizeof(float));
+                memcpy(&y, p, sizeof(float));
+                return x == y;
+            }
+        case DT_STRING:
+            {
+                // The two attributes may have different lengths
+                const char *bEnd = memchr(b, '\0', left->length);
+                const char *pEnd = memchr(p, '\0', right->length);
+                int bLength = (bEnd != NULL) ? (int)(bEnd - b) : left->length;
+                int pLength = (pEnd != NULL) ? (int)(pEnd - p) : right->length;
+                return bLength == pLength && memcmp(b, p, bLength) == 0;
+            }
+        default:
+            return (b[0] != 0) == (p[0] != 0);
+    }
+}
+
+// Read the next record of a scan into entry
+static RC scanEntry(RM_ScanHandle *scan, JoinSide *side, char *entry) {
+    Record record;
+    record.data = entry + sizeof(RID);
+    RC rc = next(scan, &record);
+    if (rc != RC_OK) {
+        return rc;
+    }
+    if (record.data != entry + sizeof(RID)) {
+        memcpy(entry + sizeof(RID), record.data, side->recordSize);
+    }
+    memcpy(entry, &record.id, sizeof(RID));
+    return RC_OK;
+}
+
+// Make room for count build entries
+static RC reserveEntries(JoinManager *mgr, int count) {
+    if (count <= mgr->capacity) {
+        return RC_OK;
+    }
+    char *entries = (char *)realloc(mgr->entries, (size_t)count * mgr->build.entrySize);
+    if (entries == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    mgr->entries = entries;
+    uint32_t *hashes = (uint32_t *)realloc(mgr->hashes, sizeof(uint32_t) * count);
+    if (hashes == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    mgr->hashes = hashes;
+    int *chain = (int *)realloc(mgr->chain, sizeof(int) * count);
+    if (chain == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    mgr->chain = chain;
+    mgr->capacity = count;
+    return RC_OK;
+}
+
+// Chain the build entries into buckets, each chain in entry order
+static RC buildHashTable(JoinManager *mgr) {
+    int numBuckets = 16;
+    while (numBuckets < mgr->numEntries) {
+        numBuckets *= 2;
+    }
+    if (numBuckets > mgr->numBuckets) {
+        int *buckets = (int *)realloc(mgr->buckets, sizeof(int) * numBuckets);
+        if (buckets == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        mgr->buckets = buckets;
+    }
+    mgr->numBuckets = numBuckets;
+
+    for (int b = 0; b < numBuckets; b++) {
+        mgr->buckets[b] = -1;
+    }
+    for (int i = mgr->numEntries - 1; i >= 0; i--) {
+        int b = (int)(mgr->hashes[i] & (uint32_t)(numBuckets - 1));
+        mgr->chain[i] = mgr->buckets[b];
+        mgr->buckets[b] = i;
+    }
+    return RC_OK;
+}
+
+static RC writePartitionPage(JoinManager *mgr, JoinPartition *part, char *page) {
+    int *pages = (int *)realloc(part->pages, sizeof(int) * (part->numPages + 1));
+    if (pages == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    part->pages = pages;
+    part->pages[part->numPages++] = mgr->filePages;
+    return writeBlocks(mgr->filePages++, 1, &mgr->file, page);
+}
+
+// Number of entries of a partition on its page pageIndex
+static int entriesOnPage(JoinSide *side, JoinPartition *part, int pageIndex) {
+    int count = part->numEntries - pageIndex * side->entriesPerPage;
+    return (count < side->entriesPerPage) ? count : side->entriesPerPage;
+}
+
+// Add an entry to its partition. The partition is picked from the high
+// bits of the hash, leaving the low ones to spread it over the buckets.
+static RC addToPartition(JoinManager *mgr, JoinSide *side, JoinPartition *parts, int level, const char *entry) {
+    if (side->dt == DT_FLOAT) {
+        float value;
+        memcpy(&value, entry + side->offset, sizeof(float));
+        if (isnan(value)) {
+            return RC_OK;
+        }
+    }
+
+    uint32_t hash = hashJoinValue(side, entry, (uint32_t)level);
+    int p = (int)(((uint64_t)hash * (uint64_t)mgr->numPartitions) >> 32);
+    JoinPartition *part = &parts[p];
+    int inPage = part->numEntries % side->entriesPerPage;
+
+    memcpy(mgr->outPages[p] + (size_t)inPage * side->entrySize, entry, side->entrySize);
+    part->numEntries++;
+    if (inPage + 1 < side->entriesPerPage) {
+        return RC_OK;
+    }
+    return writePartitionPage(mgr, part, mgr->outPages[p]);
+}
+
+// Write the partly filled pages of a side's partitions
+static RC flushPartitions(JoinManager *mgr, JoinSide *side, JoinPartition *parts) {
+    for (int p = 0; p < mgr->numPartitions; p++) {
+        JoinPartition *part = &parts[p];
+        if (part->numEntries % side->entriesPerPage != 0) {
+            RC writeResult = writePartitionPage(mgr, part, mgr->outPages[p]);
+            if (writeResult != RC_OK) {
+                return writeResult;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+static void freePartitions(JoinPartition *parts, int numPartitions) {
+    for (int p = 0; parts != NULL && p < numPartitions; p++) {
+        free(parts[p].pages);
+    }
+    free(parts);
+}
+
+// Move the partition pairs with entries on both sides onto the pairs left
+// to join, so that the first one is joined first. The partitions left
+// behind are freed with freePartitions().
+static RC pushPairs(JoinManager *mgr, JoinPartition *build, JoinPartition *probe, int level) {
+    for (int p = mgr->numPartitions - 1; p >= 0; p--) {
+        if (build[p].numEntries == 0 || probe[p].numEntries == 0) {
+            continue;
+        }
+        if (mgr->numPairs == mgr->pairCapacity) {
+            int capacity = (mgr->pairCapacity > 0) ? mgr->pairCapacity * 2 : mgr->numPartitions;
+            JoinPair *pairs = (JoinPair *)realloc(mgr->pairs, sizeof(JoinPair) * capacity);
+            if (pairs == NULL) {
+                return RC_MEM_ALLOC_FAILED;
+            }
+            mgr->pairs = pairs;
+            mgr->pairCapacity = capacity;
+        }
+
+        JoinPair *pair = &mgr->pairs[mgr->numPairs++];
+        pair->build = build[p];
+        pair->probe = probe[p];
+        pair->level = level;
+        build[p].pages = NULL;
+        probe[p].pages = NULL;
+    }
+    return RC_OK;
+}
+
+// Partition both sides: the build entries read so far, then the rest of
+// the build scan (starting with the entry in mgr->page), then the probe
+// scan
+static RC partitionScans(JoinManager *mgr, RM_ScanHandle *build, RM_ScanHandle *probe, int numPartitions) {
+    mgr->numPartitions = numPartitions;
+    JoinPartition *buildParts = (JoinPartition *)calloc(numPartitions, sizeof(JoinPartition));
+    JoinPartition *probeParts = (JoinPartition *)calloc(numPartitions, sizeof(JoinPartition));
+    mgr->outPages = (char **)calloc(numPartitions, sizeof(char *));
+    RC rc = RC_OK;
+    if (buildParts == NULL || probeParts == NULL || mgr->outPages == NULL) {
+        rc = RC_MEM_ALLOC_FAILED;
+    }
+    for (int p = 0; rc == RC_OK && p < numPartitions; p++) {
+        mgr->outPages[p] = (char *)malloc(PAGE_SIZE);
+        if (mgr->outPages[p] == NULL) {
+            rc = RC_MEM_ALLOC_FAILED;
+        }
+    }
+
+    if (rc == RC_OK) {
+        rc = openTempFile(build->rel->name, "join", &mgr->fileName, &mgr->file);
+    }
+    for (int i = 0; rc == RC_OK && i < mgr->numEntries; i++) {
+        rc = addToPartition(mgr, &mgr->build, buildParts, 0, mgr->entries + (size_t)i * mgr->build.entrySize);
+    }
+    mgr->numEntries = 0;
+    if (rc == RC_OK) {
+        rc = addToPartition(mgr, &mgr->build, buildParts, 0, mgr->page);
+    }
+    while (rc == RC_OK && (rc = scanEntry(build, &mgr->build, mgr->page)) == RC_OK) {
+        rc = addToPartition(mgr, &mgr->build, buildParts, 0, mgr->page);
+    }
+    if (rc == RC_RM_NO_MORE_TUPLES) {
+        rc = flushPartitions(mgr, &mgr->build, buildParts);
+    }
+
+    while (rc == RC_OK && (rc = scanEntry(probe, &mgr->probe, mgr->page)) == RC_OK) {
+        rc = addToPartition(mgr, &mgr->probe, probeParts, 0, mgr->page);
+    }
+    if (rc == RC_RM_NO_MORE_TUPLES) {
+        rc = flushPartitions(mgr, &mgr->probe, probeParts);
+    }
+
+    if (rc == RC_OK) {
+        rc = pushPairs(mgr, buildParts, probeParts, 0);
+    }
+    freePartitions(buildParts, numPartitions);
+    freePartitions(probeParts, numPartitions);
+    return rc;
+}
+
+// Split one side of a partition pair with the hash of the given level
+static RC splitPartition(JoinManager *mgr, JoinSide *side, JoinPartition *part, JoinPartition *parts, int level) {
+    for (int i = 0; i < part->numPages; i++) {
+        RC rc = readBlock(part->pages[i], &mgr->file, mgr->page);
+        int count = entriesOnPage(side, part, i);
+        for (int e = 0; rc == RC_OK && e < count; e++) {
+            rc = addToPartition(mgr, side, parts, level, mgr->page + (size_t)e * side->entrySize);
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+    }
+    return flushPartitions(mgr, side, parts);
+}
+
+// Split both sides of a partition pair one level deeper
+static RC repartitionPair(JoinManager *mgr, JoinPair *pair) {
+    int level = pair->level + 1;
+    JoinPartition *buildParts = (JoinPartition *)calloc(mgr->numPartitions, sizeof(JoinPartition));
+    JoinPartition *probeParts = (JoinPartition *)calloc(mgr->numPartitions, sizeof(JoinPartition));
+    RC rc = (buildParts != NULL && probeParts != NULL) ? RC_OK : RC_MEM_ALLOC_FAILED;
+
+    if (rc == RC_OK) {
+        rc = splitPartition(mgr, &mgr->build, &pair->build, buildParts, level);
+    }
+    if (rc == RC_OK) {
+        rc = splitPartition(mgr, &mgr->probe, &pair->probe, probeParts, level);
+    }
+    if (rc == RC_OK) {
+        rc = pushPairs(mgr, buildParts, probeParts, level);
+    }
+    freePartitions(buildParts, mgr->numPartitions);
+    freePartitions(probeParts, mgr->numPartitions);
+    return rc;
+}
+
+// Check whether every entry of a build partition holds the join value of
+// its first one, which is kept at the start of mgr->entries
+static RC holdsOneValue(JoinManager *mgr, JoinPartition *part, int *oneValue) {
+    *oneValue = 1;
+    for (int i = 0; *oneValue && i < part->numPages; i++) {
+        RC rc = readBlock(part->pages[i], &mgr->file, mgr->page);
+        if (rc != RC_OK) {
+            return rc;
+        }
+        if (i == 0) {
+            memcpy(mgr->entries, mgr->page, mgr->build.entrySize);
+        }
+        int count = entriesOnPage(&mgr->build, part, i);
+        for (int e = 0; *oneValue && e < count; e++) {
+            const char *entry = mgr->page + (size_t)e * mgr->build.entrySize;
+            *oneValue = joinValuesEqual(&mgr->build, mgr->entries, &mgr->build, entry);
+        }
+    }
+    return RC_OK;
+}
+
+static void freePair(JoinPair *pair) {
+    free(pair->build.pages);
+    free(pair->probe.pages);
+    pair->build.pages = NULL;
+    pair->probe.pages = NULL;
+}
+
+// Load the build side of the next partition pair and hash it. A build
+// side over the budget is split again unless it holds a single value.
+static RC nextPartition(JoinManager *mgr) {
+    mgr->numEntries = 0;
+    freePair(&mgr->current);
+    while (mgr->numPairs > 0) {
+        mgr->current = mgr->pairs[--mgr->numPairs];
+        JoinPartition *part = &mgr->current.build;
+
+        RC rc;
+        if (part->numEntries > mgr->budget) {
+            int oneValue;
+            rc = holdsOneValue(mgr, part, &oneValue);
+            if (rc == RC_OK && !oneValue) {
+                rc = repartitionPair(mgr, &mgr->current);
+                freePair(&mgr->current);
+                if (rc == RC_OK) {
+                    continue;
+                }
+            }
+            if (rc != RC_OK) {
+                return rc;
+            }
+        }
+
+        rc = reserveEntries(mgr, part->numEntries);
+        for (int i = 0; rc == RC_OK && i < part->numPages; i++) {
+            rc = readBlock(part->pages[i], &mgr->file, mgr->page);
+            if (rc == RC_OK) {
+                int first = i * mgr->build.entriesPerPage;
+                int count = entriesOnPage(&mgr->build, part, i);
+                memcpy(mgr->entries + (size_t)first * mgr->build.entrySize, mgr->page,
+                       (size_t)count * mgr->build.entrySize);
+            }
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+        mgr->numEntries = part->numEntries;
+        for (int i = 0; i < mgr->numEntries; i++) {
+            mgr->hashes[i] = hashJoinValue(&mgr->build, mgr->entries + (size_t)i * mgr->build.entrySize, 0);
+        }
+
+        mgr->probePos = 0;
+        mgr->pageIndex = -1;
+        return buildHashTable(mgr);
+    }
+    return RC_RM_NO_MORE_TUPLES;
+}
+
+// Move to the next probe entry of the scan or of the current partition
+static RC nextProbeEntry(JoinManager *mgr) {
+    if (mgr->numEntries == 0) {
+        // Nothing to match against
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    if (mgr->fileName == NULL) {
+        mgr->probeEntry = mgr->page;
+        return scanEntry(mgr->scan, &mgr->probe, mgr->page);
+    }
+
+    JoinPartition *part = &mgr->current.probe;
+    if (mgr->probePos == part->numEntries) {
+        return RC_RM_NO_MORE_TUPLES;
+    }
+    int pageIndex = mgr->probePos / mgr->probe.entriesPerPage;
+    if (pageIndex != mgr->pageIndex) {
+        RC readResult = readBlock(part->pages[pageIndex], &mgr->file, mgr->page);
+        if (readResult != RC_OK) {
+            return readResult;
+        }
+        mgr->pageIndex = pageIndex;
+    }
+    mgr->probeEntry = mgr->page + (size_t)(mgr->probePos % mgr->probe.entriesPerPage) * mgr->probe.entrySize;
+    mgr->probePos++;
+    return RC_OK;
+}
+
+static void freeJoinManager(JoinManager *mgr) {
+    removeTempFile(mgr->fileName, &mgr->file);
+    for (int p = 0; mgr->outPages != NULL && p < mgr->numPartitions; p++) {
+        free(mgr->outPages[p]);
+    }
+    for (int i = 0; i < mgr->numPairs; i++) {
+        freePair(&mgr->pairs[i]);
+    }
+    freePair(&mgr->current);
+    free(mgr->pairs);
+    free(mgr->outPages);
+    free(mgr->page);
+    free(mgr->buckets);
+    free(mgr->chain);
+    free(mgr->hashes);
+    free(mgr->entries);
+    free(mgr);
+}
+
+static RC initJoinSide(JoinSide *side, RM_ScanHandle *scan, int attrNum) {
+    Schema *schema = getScanSchema(scan);
+    if (attrNum < 0 || attrNum >= schema->numAttr) {
+        return RC_RM_INVALID_ATTRIBUTE;
+    }
+    side->offset = (int)sizeof(RID) + getAttrOffset(schema, attrNum);
+    side->dt = schema->dataTypes[attrNum];
+    side->length = schema->typeLength[attrNum];
+    side->recordSize = getRecordSize(schema);
+    side->entrySize = (int)sizeof(RID) + side->recordSize;
+    side->entriesPerPage = PAGE_SIZE / side->entrySize;
+    return (side->entriesPerPage > 0) ? RC_OK : RC_INVALID_RECORD_SIZE;
+}
+
+// Join the records of two scans on equal attribute values
+RC startHashJoin(RM_ScanHandle *build, int buildAttr, RM_ScanHandle *probe, int probeAttr,
+                 int memoryPages, RM_JoinHandle *join) {
+    if (build == NULL || build->mgmtData == NULL || probe == NULL || probe->mgmtData == NULL || join == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (memoryPages < MIN_MEMORY_PAGES) {
+        memoryPages = MIN_MEMORY_PAGES;
+    }
+
+    JoinManager *mgr = (JoinManager *)calloc(1, sizeof(JoinManager));
+    if (mgr == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    RC rc = initJoinSide(&mgr->build, build, buildAttr);
+    if (rc == RC_OK) {
+        rc = initJoinSide(&mgr->probe, probe, probeAttr);
+    }
+    if (rc == RC_OK && mgr->build.dt != mgr->probe.dt) {
+        rc = RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+    }
+    if (rc != RC_OK) {
+        free(mgr);
+        return rc;
+    }
+
+    mgr->match = -1;
+    mgr->page = (char *)malloc(PAGE_SIZE);
+    mgr->budget = memoryPages * mgr->build.entriesPerPage;
+    rc = (mgr->page != NULL) ? reserveEntries(mgr, mgr->budget) : RC_MEM_ALLOC_FAILED;
+
+    // Read the build scan while it fits in memory
+    while (rc == RC_OK && mgr->numEntries < mgr->budget) {
+        char *entry = mgr->entries + (size_t)mgr->numEntries * mgr->build.entrySize;
+        rc = scanEntry(build, &mgr->build, entry);
+        if (rc == RC_OK) {
+            mgr->hashes[mgr->numEntries++] = hashJoinValue(&mgr->build, entry, 0);
+        }
+    }
+    if (rc == RC_OK) {
+        // The budget is full: spill only if the build scan has more to give
+        rc = scanEntry(build, &mgr->build, mgr->page);
+        if (rc == RC_OK) {
+            rc = partitionScans(mgr, build, probe, memoryPages - 1);
+            if (rc == RC_OK) {
+                rc = nextPartition(mgr);
+            }
+            if (rc == RC_RM_NO_MORE_TUPLES) {
+                rc = RC_OK;
+            }
+        }
+    }
+    if (rc == RC_RM_NO_MORE_TUPLES) {
+        // Everything fit: the probe scan is read as nextJoined() goes
+        rc = buildHashTable(mgr);
+        mgr->scan = probe;
+    }
+
+    if (rc != RC_OK) {
+        freeJoinManager(mgr);
+        return rc;
+    }
+
+    join->mgmtData = mgr;
+    return RC_OK;
+}
+
+// Return the next pair of joined records
+RC nextJoined(RM_JoinHandle *join, Record *buildRecord, Record *probeRecord) {
+    if (join == NULL || join->mgmtData == NULL || buildRecord == NULL || probeRecord == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    JoinManager *mgr = (JoinManager *)join->mgmtData;
+    for (;;) {
+        // Build entries chained with the current probe entry
+        while (mgr->match >= 0) {
+            int m = mgr->match;
+            mgr->match = mgr->chain[m];
+            const char *entry = mgr->entries + (size_t)m * mgr->build.entrySize;
+            if (mgr->hashes[m] != mgr->probeHash || !joinValuesEqual(&mgr->build, entry, &mgr->probe, mgr->probeEntry)) {
+                continue;
+            }
+
+            if (buildRecord->data == NULL) {
+                buildRecord->data = (char *)malloc(mgr->build.recordSize);
+            }
+            if (probeRecord->data == NULL) {
+                probeRecord->data = (char *)malloc(mgr->probe.recordSize);
+            }
+            if (buildRecord->data == NULL || probeRecord->data == NULL) {
+                return RC_MEM_ALLOC_FAILED;
+            }
+            memcpy(&buildRecord->id, entry, sizeof(RID));
+            memcpy(buildRecord->data, entry + sizeof(RID), mgr->build.recordSize);
+            memcpy(&probeRecord->id, mgr->probeEntry, sizeof(RID));
+            memcpy(probeRecord->data, mgr->probeEntry + sizeof(RID), mgr->probe.recordSize);
+            return RC_OK;
+        }
+
+        RC rc = nextProbeEntry(mgr);
+        if (rc == RC_RM_NO_MORE_TUPLES && mgr->fileName != NULL) {
+            rc = nextPartition(mgr);
+            if (rc == RC_OK) {
+                continue;
+            }
+        }
+        if (rc != RC_OK) {
+            return rc;
+        }
+        mgr->probeHash = hashJoinValue(&mgr->probe, mgr->probeEntry, 0);
+        mgr->match = mgr->buckets[mgr->probeHash & (uint32_t)(mgr->numBuckets - 1)];
+    }
+}
+
+// Close the join and free its memory and temporary file
+RC closeHashJoin(RM_JoinHandle *join) {
+    if (join == NULL || join->mgmtData == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    freeJoinManager((JoinManager *)join->mgmtData);
+    join->mgmtData = NULL;
+    return RC_OK;
+}
+
+// Aggregation:
+// aggregate() runs a zero-copy scan, so every matching record is read in
+// place in its buffer frame. Its group-by values are copied into a key,
+// normalized so that equal values have equal bytes, and looked up in an
+// open-addressing hash table (linear probing over {hash, group} slots,
+// at most half full). Each group owns a result record, which starts with
+// the key; MIN/MAX are kept in it in their own type, while COUNT, SUM and
+// AVG run in 64-bit counters and sums that are written out at the end.
+// Groups are returned in the order they were first seen.
+
+typedef enum AggKind {
+    AGG_KIND_COUNT,
+    AGG_KIND_SUM_INT,
+    AGG_KIND_SUM_FLOAT,
+    AGG_KIND_AVG_INT,
+    AGG_KIND_AVG_FLOAT,
+    AGG_KIND_MIN_INT,
+    AGG_KIND_MAX_INT,
+    AGG_KIND_MIN_FLOAT,
+    AGG_KIND_MAX_FLOAT,
+    AGG_KIND_MIN_STRING,
+    AGG_KIND_MAX_STRING
+} AggKind;
+
+typedef struct AggInfo {
+    AggKind kind;
+    int offset;         // Offset of the attribute in a table record
+    int length;         // typeLength of STRING attributes
+    int outOffset;      // Offset of the result in a group record
+} AggInfo;
+
+typedef union AggSum {
+    long long i;
+    double f;
+} AggSum;
+
+typedef struct AggSlot {
+    uint32_t hash;
+    int group;          // -1: empty
+} AggSlot;
+
+typedef struct AggTable {
+    int numGroupAttrs;
+    int *groupOffsets;  // Offsets of the group-by attributes in a table record
+    DataType *groupTypes;
+    int *groupSizes;
+    int keySize;        // Bytes of the group-by attributes
+    int numAggs;
+    AggInfo *aggs;
+    int rowSize;        // Size of a result record
+
+    char *rows;         // Result record of each group
+    AggSum *sums;       // numAggs sums per group
+    long long *counts;  // Records per group
+    int numGroups;
+    int maxGroups;      // Groups allocated
+
+    AggSlot *slots;
+    int numSlots;       // A power of two
+    char *key;          // Key of the record being added
+} AggTable;
+
+// Size of an attribute in a record of the schema
+static int attrSize(Schema *schema, int attrNum) {
+    int end = (attrNum + 1 < schema->numAttr) ? getAttrOffset(schema, attrNum + 1) : getRecordSize(schema);
+    return end - getAttrOffset(schema, attrNum);
+}
+
+// Build the group key of a record: strings are zero-filled after their
+// terminator, -0.0 becomes 0.0 and booleans 0 or 1
+static void makeGroupKey(AggTable *table, const char *data) {
+    char *key = table->key;
+    for (int i = 0; i < table->numGroupAttrs; i++) {
+        const char *value = data + table->groupOffsets[i];
+        int size = table->groupSizes[i];
+
+        switch (table->groupTypes[i]) {
+            case DT_FLOAT:
+                {
+                    float f;
+                    memcpy(&f, value, sizeof(float));
+                    if (f == 0.0f) {
+                        f = 0.0f;
+                    }
+                    memcpy(key, &f, sizeof(float));
+                }
+                break;
+            case DT_STRING:
+                {
+                    const char *end = memchr(value, '\0', size);
+                    int length = (end != NULL) ? (int)(end - value) : size;
+                    memcpy(key, value, length);
+                    memset(key + length, 0, size - length);
+                }
+                break;
+            case DT_BOOL:
+                memset(key, 0, size);
+                key[0] = value[0] != 0;
+                break;
+            default:
+                memcpy(key, value, size);
+                break;
+        }
+        key += size;
+    }
+}
+
+static uint32_t hashGroupKey(const char *key, int keySize) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < keySize; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Double the slots and put the groups back
+static RC growSlots(AggTable *table) {
+    int numSlots = table->numSlots * 2;
+    AggSlot *slots = (AggSlot *)malloc(sizeof(AggSlot) * numSlots);
+    if (slots == NULL) {
+        return RC_MEM_ALLOC_FAILED;
+    }
+    for (int i = 0; i < numSlots; i++) {
+        slots[i].group = -1;
+    }
+    for (int i = 0; i < table->numSlots; i++) {
+        if (table->slots[i].group >= 0) {
+            uint32_t s = table->slots[i].hash & (uint32_t)(numSlots - 1);
+            while (slots[s].group >= 0) {
+                s = (s + 1) & (uint32_t)(numSlots - 1);
+            }
+            slots[s] = table->slots[i];
+        }
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->numSlots = numSlots;
+    return RC_OK;
+}
+
+// Append a group with the key in table->key and zeroed results
+static RC addGroup(AggTable *table, int *group) {
+    if (table->numGroups == table->maxGroups) {
+        int maxGroups = (table->maxGroups > 0) ? table->maxGroups * 2 : 16;
+        char *rows = (char *)realloc(table->rows, (size_t)maxGroups * table->rowSize);
+        if (rows == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        table->rows = rows;
+        AggSum *sums = (AggSum *)realloc(table->sums, sizeof(AggSum) * maxGroups * (table->numAggs + 1));
+        if (sums == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        table->sums = sums;
+        long long *counts = (long long *)realloc(table->counts, sizeof(long long) * maxGroups);
+        if (counts == NULL) {
+            return RC_MEM_ALLOC_FAILED;
+        }
+        table->counts = counts;
+        table->maxGroups = maxGroups;
+    }
+
+    *group = table->numGroups++;
+    char *row = table->rows + (size_t)*group * table->rowSize;
+    memcpy(row, table->key, table->keySize);
+    memset(row + table->keySize, 0, table->rowSize - table->keySize);
+    memset(table->sums + (size_t)*group * table->numAggs, 0, sizeof(AggSum) * table->numAggs);
+    table->counts[*group] = 0;
+    return RC_OK;
+}
+
+// Find or add the group of the key in table->key
+static RC findGroup(AggTable *table, int *group) {
+    uint32_t hash = hashGroupKey(table->key, table->keySize);
+    uint32_t mask = (uint32_t)(table->numSlots - 1);
+
+    for (uint32_t s = hash & mask; ; s = (s + 1) & mask) {
+        AggSlot *slot = &table->slots[s];
+        if (slot->group < 0) {
+            RC rc = addGroup(table, group);
+            if (rc != RC_OK) {
+                return rc;
+            }
+            slot->hash = hash;
+            slot->group = *group;
+            return (table->numGroups * 2 > table->numSlots) ? growSlots(table) : RC_OK;
+        }
+        if (slot->hash == hash &&
+            memcmp(table->rows + (size_t)slot->group * table->rowSize, table->key, table->keySize) == 0) {
+            *group = slot->group;
+            return RC_OK;
+        }
+    }
+}
+
+// Fold a record into the results of its group
+static void accumulate(AggTable *table, int group, const char *data) {
+    char *row = table->rows + (size_t)group * table->rowSize;
+    AggSum *sums = table->sums + (size_t)group * table->numAggs;
+    int first = table->counts[group] == 0;
+
+    for (int j = 0; j < table->numAggs; j++) {
+        AggInfo *agg = &table->aggs[j];
+        const char *value = data + agg->offset;
+        char *out = row + agg->outOffset;
+
+        switch (agg->kind) {
+            case AGG_KIND_COUNT:
+                break;
+            case AGG_KIND_SUM_INT:
+            case AGG_KIND_AVG_INT:
+                {
+                    int x;
+                    memcpy(&x, value, sizeof(int));
+                    sums[j].i += x;
+                }
+                break;
+            case AGG_KIND_SUM_FLOAT:
+            case AGG_KIND_AVG_FLOAT:
+                {
+                    float x;
+                    memcpy(&x, value, sizeof(float));
+                    sums[j].f += x;
+                }
+                break;
+            case AGG_KIND_MIN_INT:
+            case AGG_KIND_MAX_INT:
+                {
+                    int x, current;
+                    memcpy(&x, value, sizeof(int));
+                    memcpy(&current, out, sizeof(int));
+                    if (first || (agg->kind == AGG_KIND_MIN_INT ? x < current : x > current)) {
+                        memcpy(out, &x, sizeof(int));
+                    }
+                }
+                break;
+            case AGG_KIND_MIN_FLOAT:
+            case AGG_KIND_MAX_FLOAT:
+                {
+                    // NaN only stays when nothing else was seen
+                    float x, current;
+                    memcpy(&x, value, sizeof(float));
+                    memcpy(&current, out, sizeof(float));
+                    if (first || isnan(current) || (agg->kind == AGG_KIND_MIN_FLOAT ? x < current : x > current)) {
+                        memcpy(out, &x, sizeof(float));
+                    }
+                }
+                break;
+            case AGG_KIND_MIN_STRING:
+            case AGG_KIND_MAX_STRING:
+                {
+                    int cmp = strncmp(value, out, agg->length);
+                    if (first || (agg->kind == AGG_KIND_MIN_STRING ? cmp < 0 : cmp > 0)) {
+                        memcpy(out, value, agg->length);
+                    }
+                }
+                break;
+        }
+    }
+    table->counts[group]++;
+}
+
+// Write COUNT, SUM and AVG into the result records; an INT sum or count
+// outside the range of an INT is RC_RM_SUM_OVERFLOW
+static RC finishGroups(AggTable *table) {
+    for (int g = 0; g < table->numGroups; g++) {
+        char *row = table->rows + (size_t)g * table->rowSize;
+        AggSum *sums = table->sums + (size_t)g * table->numAggs;
+        long long count = table->counts[g];
+
+        for (int j = 0; j < table->numAggs; j++) {
+            AggInfo *agg = &table->aggs[j];
+            char *out = row + agg->outOffset;
+            int i;
+            float f;
+
+            switch (agg->kind) {
+                case AGG_KIND_COUNT:
+                    if (count > INT_MAX) {
+                        return RC_RM_SUM_OVERFLOW;
+                    }
+                    i = (int)count;
+                    memcpy(out, &i, sizeof(int));
+                    break;
+                case AGG_KIND_SUM_INT:
+                    if (sums[j].i > INT_MAX || sums[j].i < INT_MIN) {
+                        return RC_RM_SUM_OVERFLOW;
+                    }
+                    i = (int)sums[j].i;
+                    memcpy(out, &i, sizeof(int));
+                    break;
+                case AGG_KIND_SUM_FLOAT:
+                    f = (float)sums[j].f;
+                    memcpy(out, &f, sizeof(float));
+                    break;
+                case AGG_KIND_AVG_INT:
+                    f = (count > 0) ? (float)((double)sums[j].i / count) : 0.0f;
+                    memcpy(out, &f, sizeof(float));
+                    break;
+                case AGG_KIND_AVG_FLOAT:
+                    f = (count > 0) ? (float)(sums[j].f / count) : 0.0f;
+                    memcpy(out, &f, sizeof(float));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return RC_OK;
+}
+
+static void freeAggTable(AggTable *table) {
+    free(table->groupOffsets);
+    free(table->groupTypes);
+    free(table->groupSizes);
+    free(table->aggs);
+    free(table->rows);
+    free(table->sums);
+    free(table->counts);
+    free(table->slots);
+    free(table->key);
+}
+
+static char *copyName(const char *name) {
+    char *copy = (char *)malloc(strlen(name) + 1);
+    if (copy != NULL) {
+        strcpy(copy, name);
+    }
+    return copy;
+}
+
+// The schema of the results: the group-by attributes, then one attribute
+// per aggregate named like "sum(a)"; also sets the aggregates' kinds and
+// result offsets
+static Schema *createAggSchema(Schema *schema, int numGroupAttrs, int *groupAttrs,
+                               int numAggs, RM_AggSpec *aggs, AggInfo *info) {
+    static const char *funcNames[] = { "count", "sum", "avg", "min", "max" };
+    int numAttr = numGroupAttrs + numAggs;
+    char **names = (char **)calloc(numAttr > 0 ? numAttr : 1, sizeof(char *));
+    DataType *types = (DataType *)malloc(sizeof(DataType) * (numAttr > 0 ? numAttr : 1));
+    int *lengths = (int *)malloc(sizeof(int) * (numAttr > 0 ? numAttr : 1));
+    int failed = (names == NULL || types == NULL || lengths == NULL);
+
+    for (int i = 0; !failed && i < numGroupAttrs; i++) {
+        names[i] = copyName(schema->attrNames[groupAttrs[i]]);
+        types[i] = schema->dataTypes[groupAttrs[i]];
+        lengths[i] = schema->typeLength[groupAttrs[i]];
+        failed = names[i] == NULL;
+    }
+    for (int j = 0; !failed && j < numAggs; j++) {
+        int i = numGroupAttrs + j;
+        const char *attrName = (aggs[j].func == AGG_COUNT) ? "*" : schema->attrNames[aggs[j].attrNum];
+        names[i] = (char *)malloc(strlen(funcNames[aggs[j].func]) + strlen(attrName) + 3);
+        failed = names[i] == NULL;
+        if (!failed) {
+            sprintf(names[i], "%s(%s)", funcNames[aggs[j].func], attrName);
+        }
+
+        DataType dt = (aggs[j].func == AGG_COUNT) ? DT_INT : schema->dataTypes[aggs[j].attrNum];
+        int isFloat = dt == DT_FLOAT;
+        lengths[i] = 0;
+        switch (aggs[j].func) {
+            case AGG_COUNT:
+                info[j].kind = AGG_KIND_COUNT;
+                types[i] = DT_INT;
+                break;
+            case AGG_SUM:
+                info[j].kind = isFloat ? AGG_KIND_SUM_FLOAT : AGG_KIND_SUM_INT;
+                types[i] = dt;
+                break;
+            case AGG_AVG:
+                info[j].kind = isFloat ? AGG_KIND_AVG_FLOAT : AGG_KIND_AVG_INT;
+                types[i] = DT_FLOAT;
+                break;
+            default:
+                if (dt == DT_STRING) {
+                    info[j].kind = (aggs[j].func == AGG_MIN) ? AGG_KIND_MIN_STRING : AGG_KIND_MAX_STRING;
+                    lengths[i] = schema->typeLength[aggs[j].attrNum];
+                } else if (isFloat) {
+                    info[j].kind = (aggs[j].func == AGG_MIN) ? AGG_KIND_MIN_FLOAT : AGG_KIND_MAX_FLOAT;
+                } else {
+                    info[j].kind = (aggs[j].func == AGG_MIN) ? AGG_KIND_MIN_INT : AGG_KIND_MAX_INT;
+                }
+                types[i] = dt;
+                break;
+        }
+    }
+
+    if (failed) {
+        for (int i = 0; names != NULL && i < numAttr; i++) {
+            free(names[i]);
+        }
+        free(names);
+        free(types);
+        free(lengths);
+        return NULL;
+    }
+
+    Schema *result = createSchema(numAttr, names, types, lengths, 0, NULL);
+    if (result != NULL) {
+        for (int j = 0; j < numAggs; j++) {
+            info[j].outOffset = getAttrOffset(result, numGroupAttrs + j);
+        }
+    }
+    return result;
+}
+
+// Check the group-by attributes and aggregates against the table
+static RC checkAggregate(Schema *schema, int numGroupAttrs, int *groupAttrs, int numAggs, RM_AggSpec *aggs) {
+    for (int i = 0; i < numGroupAttrs; i++) {
+        if (groupAttrs[i] < 0 || groupAttrs[i] >= schema->numAttr) {
+            return RC_RM_INVALID_ATTRIBUTE;
+        }
+    }
+    for (int j = 0; j < numAggs; j++) {
+        if (aggs[j].func < AGG_COUNT || aggs[j].func > AGG_MAX) {
+            return RC_RM_UNKNOWN_OPERATOR;
+        }
+        if (aggs[j].func == AGG_COUNT) {
+            continue;
+        }
+        if (aggs[j].attrNum < 0 || aggs[j].attrNum >= schema->numAttr) {
+            return RC_RM_INVALID_ATTRIBUTE;
+        }
+        DataType dt = schema->dataTypes[aggs[j].attrNum];
+        int numeric = dt == DT_INT || dt == DT_FLOAT;
+        if (dt == DT_BOOL || (!numeric && (aggs[j].func == AGG_SUM || aggs[j].func == AGG_AVG))) {
+            return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+        }
+    }
+    return RC_OK;
+}
+
+// Group the records of a table that match cond and aggregate each group
+RC aggregate(RM_TableData *rel, Expr *cond, int numGroupAttrs, int *groupAttrs, int numAggs, RM_AggSpec *aggs,
+             Schema **resultSchema, RecordBatch **result) {
+    if (rel == NULL || rel->schema == NULL || resultSchema == NULL || result == NULL ||
+        numGroupAttrs < 0 || numAggs < 0 || numGroupAttrs + numAggs == 0 || (numGroupAttrs > 0 && groupAttrs == NULL) ||
+        (numAggs > 0 && aggs == NULL)) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    Schema *schema = rel->schema;
+    RC rc = checkAggregate(schema, numGroupAttrs, groupAttrs, numAggs, aggs);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    AggTable table;
+    memset(&table, 0, sizeof(AggTable));
+    table.numGroupAttrs = numGroupAttrs;
+    table.numAggs = numAggs;
+    table.groupOffsets = (int *)malloc(sizeof(int) * (numGroupAttrs + 1));
+    table.groupTypes = (DataType *)malloc(sizeof(DataType) * (numGroupAttrs + 1));
+    table.groupSizes = (int *)malloc(sizeof(int) * (numGroupAttrs + 1));
+    table.aggs = (AggInfo *)malloc(sizeof(AggInfo) * (numAggs + 1));
+    table.numSlots = 16;
+    table.slots = (AggSlot *)malloc(sizeof(AggSlot) * table.numSlots);
+    if (table.groupOffsets == NULL || table.groupTypes == NULL || table.groupSizes == NULL ||
+        table.aggs == NULL || table.slots == NULL) {
+        freeAggTable(&table);
+        return RC_MEM_ALLOC_FAILED;
+    }
+    for (int s = 0; s < table.numSlots; s++) {
+        table.slots[s].group = -1;
+    }
+    for (int i = 0; i < numGroupAttrs; i++) {
+        table.groupOffsets[i] = getAttrOffset(schema, groupAttrs[i]);
+        table.groupTypes[i] = schema->dataTypes[groupAttrs[i]];
+        table.groupSizes[i] = attrSize(schema, groupAttrs[i]);
+        table.keySize += table.groupSizes[i];
+    }
+    for (int j = 0; j < numAggs; j++) {
+        int attrNum = (aggs[j].func == AGG_COUNT) ? 0 : aggs[j].attrNum;
+        table.aggs[j].offset = getAttrOffset(schema, attrNum);
+        table.aggs[j].length = schema->typeLength[attrNum];
+    }
+
+    Schema *outSchema = createAggSchema(schema, numGroupAttrs, groupAttrs, numAggs, aggs, table.aggs);
+    table.key = (char *)malloc(table.keySize + 1);
+    if (outSchema == NULL || table.key == NULL) {
+        freeSchema(outSchema);
+        freeAggTable(&table);
+        return RC_MEM_ALLOC_FAILED;
+    }
+    table.rowSize = getRecordSize(outSchema);
+
+    // Without group-by attributes there is exactly one group, even for no
+    // records
+    int group = 0;
+    if (numGroupAttrs == 0) {
+        rc = addGroup(&table, &group);
+    }
+
+    RM_ScanHandle scan;
+    RM_ScanOptions options;
+    initScanOptions(&options);
+    options.zeroCopy = 1;
+    if (rc == RC_OK) {
+        rc = startScanWithOptions(rel, &scan, cond, &options);
+    }
+    if (rc == RC_OK) {
+        Record record;
+        record.data = NULL;
+        while ((rc = next(&scan, &record)) == RC_OK) {
+            if (numGroupAttrs > 0) {
+                makeGroupKey(&table, record.data);
+                rc = findGroup(&table, &group);
+                if (rc != RC_OK) {
+                    break;
+                }
+            }
+            accumulate(&table, group, record.data);
+        }
+        RC closeResult = closeScan(&scan);
+        if (rc == RC_RM_NO_MORE_TUPLES) {
+            rc = closeResult;
+        }
+    }
+
+    RecordBatch *batch = NULL;
+    if (rc == RC_OK) {
+        rc = finishGroups(&table);
+    }
+    if (rc == RC_OK) {
+        rc = createRecordBatch(&batch, outSchema, table.numGroups > 0 ? table.numGroups : 1);
+    }
+    if (rc == RC_OK && table.numGroups > 0) {
+        memcpy(batch->data, table.rows, (size_t)table.numGroups * table.rowSize);
+        for (int g = 0; g < table.numGroups; g++) {
+            batch->ids[g].page = -1;
+            batch->ids[g].slot = -1;
+        }
+    }
+    if (rc == RC_OK) {
+        batch->numRecords = table.numGroups;
+    }
+
+    freeAggTable(&table);
+    if (rc != RC_OK) {
+        freeSchema(outSchema);
+        return rc;
+    }
+    *resultSchema = outSchema;
+    *result = batch;
+    return RC_OK;
+}
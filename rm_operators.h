@@ -0,0 +1,80 @@
+#ifndef RM_OPERATORS_H
+#define RM_OPERATORS_H
+
+#include "dberror.h"
+#include "record_mgr.h"
+
+// sort key: an attribute of the scan's records and its direction
+typedef struct RM_SortKey
+{
+	int attrNum;
+	int descending;
+} RM_SortKey;
+
+// Bookkeeping for sorts
+typedef struct RM_SortHandle
+{
+	void *mgmtData;
+} RM_SortHandle;
+
+// external merge sort: startSort reads every record the scan returns and
+// sorts them on keys (earlier keys first; equal records keep scan order)
+// using about memoryPages pages of memory (at least 3). Records that do
+// not fit are sorted in runs spilled to a temporary page file next to the
+// table, which closeSort removes. The caller still closes the scan.
+// nextSorted returns the records, with their RIDs, in the layout of
+// getScanSchema(scan), then RC_RM_NO_MORE_TUPLES.
+extern RC startSort (RM_ScanHandle *scan, int numKeys, RM_SortKey *keys, int memoryPages, RM_SortHandle *sort);
+extern RC nextSorted (RM_SortHandle *sort, Record *record);
+extern RC closeSort (RM_SortHandle *sort);
+
+// Bookkeeping for joins
+typedef struct RM_JoinHandle
+{
+	void *mgmtData;
+} RM_JoinHandle;
+
+// hash join: pairs every record of the probe scan with each record of the
+// build scan whose buildAttr equals its probeAttr (same type; strings
+// compare up to their terminator, NaN matches nothing). The build scan is
+// hashed in memory when it fits in memoryPages pages (at least 3) and
+// probed as nextJoined is called; otherwise both scans are partitioned
+// through a temporary page file next to the build table, which
+// closeHashJoin removes. Filter either side through its scan's condition;
+// the caller still closes both scans. nextJoined returns each pair, with
+// RIDs, in the layouts of the two scans, then RC_RM_NO_MORE_TUPLES.
+extern RC startHashJoin (RM_ScanHandle *build, int buildAttr, RM_ScanHandle *probe, int probeAttr,
+		int memoryPages, RM_JoinHandle *join);
+extern RC nextJoined (RM_JoinHandle *join, Record *buildRecord, Record *probeRecord);
+extern RC closeHashJoin (RM_JoinHandle *join);
+
+// aggregate functions
+typedef enum RM_AggFunc {
+	AGG_COUNT = 0,
+	AGG_SUM = 1,
+	AGG_AVG = 2,
+	AGG_MIN = 3,
+	AGG_MAX = 4
+} RM_AggFunc;
+
+// an aggregate over an attribute (ignored by AGG_COUNT)
+typedef struct RM_AggSpec
+{
+	RM_AggFunc func;
+	int attrNum;
+} RM_AggSpec;
+
+// aggregation: groups the records of rel that match cond (NULL: all) on
+// the groupAttrs and computes the aggs for each group. The results are
+// one record per group, in the order groups were first seen, laid out by
+// *resultSchema: the group-by attributes, then one attribute per
+// aggregate, named like "sum(a)". COUNT is an INT, SUM has the type of
+// its INT or FLOAT attribute (INT sums are added in 64 bits, and one that
+// does not fit an INT fails with RC_RM_SUM_OVERFLOW), AVG is a FLOAT, and MIN/MAX work on INT, FLOAT and STRING
+// attributes. Without group-by attributes there is one result record even
+// when nothing matches; its MIN, MAX and AVG are then 0. Free the results
+// with freeSchema and freeRecordBatch.
+extern RC aggregate (RM_TableData *rel, Expr *cond, int numGroupAttrs, int *groupAttrs,
+		int numAggs, RM_AggSpec *aggs, Schema **resultSchema, RecordBatch **result);
+
+#endif // RM_OPERATORS_H
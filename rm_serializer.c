@@ -61,16 +61,9 @@ static RC attrOffset(Schema *schema, int attrNum, int *result) {
     if (attrNum < 0 || attrNum >= schema->numAttr) 
         return RC_RM_INVALID_ATTRIBUTE;
     
-    int offset = 0;
-    for (int i = 0; i < attrNum; i++) {
-        switch (schema->dataTypes[i]) {
-            case DT_INT:   offset += sizeof(int); break;
-            case DT_FLOAT: offset += sizeof(float); break;
-            case DT_BOOL:  offset += sizeof(bool); break;
-            case DT_STRING: offset += schema->typeLength[i]; break;
-        }
-    }
-    *result = offset;
+    // Offsets are laid out by createSchema with the record manager's
+    // bool size, which need not match sizeof(bool) in this file
+    *result = schema->attrOffsets[attrNum];
     return RC_OK;
 }
 
@@ -182,20 +175,23 @@ char *serializeTableContent(RM_TableData *rel) {
     MAKE_VARSTRING(result);
     
     RM_ScanHandle *scan = malloc(sizeof(RM_ScanHandle));
-    Record *record = malloc(sizeof(Record));
-    createRecord(&record, rel->schema);
+    RM_ScanOptions options;
+    Record record;
+    record.data = NULL;
     
     APPEND(result, "Contents of table %s:\n", rel->name);
     
-    startScan(rel, scan, NULL); // Scan all records
-    while(next(scan, record) == RC_OK) {
-        char *recordStr = serializeRecord(record, rel->schema);
+    // Records are only read, so serialize them in place in the pinned pages
+    initScanOptions(&options);
+    options.zeroCopy = 1;
+    startScanWithOptions(rel, scan, NULL, &options); // Scan all records
+    while(next(scan, &record) == RC_OK) {
+        char *recordStr = serializeRecord(&record, rel->schema);
         APPEND(result, "%s\n", recordStr);
         free(recordStr);
     }
     
     closeScan(scan);
-    freeRecord(record);
     free(scan);
     
     char *output = strdup(result->buf);
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // Initializes the storage manager
 void initStorageManager(void) {
@@ -143,6 +144,32 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
     return RC_OK;
 }
 
+// Write a run of consecutive pages with a single seek and write.
+// The run may extend past the end of the file as long as it starts
+// at or before the current last page + 1, which lets callers append
+// whole extents without pre-filling them with zeros first.
+RC writeBlocks(int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle memPages) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL || memPages == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    if (pageNum < 0 || numPages <= 0 || pageNum > fHandle->totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    FILE *file = (FILE *)fHandle->mgmtInfo;
+    if (fseek(file, (long)pageNum * PAGE_SIZE, SEEK_SET) != 0)
+        return RC_WRITE_FAILED;
+
+    size_t bytes = (size_t)numPages * PAGE_SIZE;
+    if (fwrite(memPages, sizeof(char), bytes, file) != bytes)
+        return RC_WRITE_FAILED;
+
+    fflush(file);
+    if (pageNum + numPages > fHandle->totalNumPages)
+        fHandle->totalNumPages = pageNum + numPages;
+    fHandle->curPagePos = pageNum + numPages - 1;
+    return RC_OK;
+}
+
 // Append empty block (FIXED)
 RC appendEmptyBlock(SM_FileHandle *fHandle) {
     if (fHandle == NULL || fHandle->mgmtInfo == NULL)
@@ -178,6 +205,23 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
     return RC_OK;
 }
 
+// Cut the file down to its first numberOfPages pages
+RC truncatePageFile(int numberOfPages, SM_FileHandle *fHandle) {
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (numberOfPages < 1 || numberOfPages > fHandle->totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+
+    FILE *file = (FILE *)fHandle->mgmtInfo;
+    if (fflush(file) != 0 || ftruncate(fileno(file), (off_t)numberOfPages * PAGE_SIZE) != 0)
+        return RC_WRITE_FAILED;
+
+    fHandle->totalNumPages = numberOfPages;
+    if (fHandle->curPagePos >= numberOfPages)
+        fHandle->curPagePos = numberOfPages - 1;
+    return RC_OK;
+}
+
 // Get current position
 int getBlockPos(SM_FileHandle *fHandle) {
     return (fHandle != NULL) ? fHandle->curPagePos : -1;
@@ -32,7 +32,18 @@ typedef struct Record
 	char *data;
 } Record;
 
-// information of a table schema: its attributes, datatypes, 
+// batch of fixed-size records stored back to back, as filled by nextBatch
+typedef struct RecordBatch
+{
+	int numRecords;
+	int capacity;
+	int recordSize;
+	RID *ids;
+	char *data;
+} RecordBatch;
+
+// information of a table schema: its attributes, datatypes, and the
+// record offset of each attribute (computed once by createSchema)
 typedef struct Schema
 {
 	int numAttr;
@@ -41,6 +52,7 @@ typedef struct Schema
 	int *typeLength;
 	int *keyAttrs;
 	int keySize;
+	int *attrOffsets;
 } Schema;
 
 // TableData: Management Structure for a Record Manager to handle one relation
@@ -1,7 +1,10 @@
 #include <stdlib.h>
 #include "dberror.h"
 #include "expr.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
 #include "record_mgr.h"
+#include "rm_operators.h"
 #include "tables.h"
 #include "test_helper.h"
 
@@ -49,12 +52,32 @@
 
 // test methods
 static void testRecords (void);
+static void testTypedAccessors (void);
 static void testCreateTableAndInsert (void);
 static void testUpdateTable (void);
 static void testScans (void);
 static void testScansTwo (void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testBulkLoad(void);
+static void testGetRecords(void);
+static void testBatchScan(void);
+static void testParallelScan(void);
+static void testSlotReuse(void);
+static void testZoneMaps(void);
+static void testPrimaryIndex(void);
+static void testHashIndex(void);
+static void testIndexScans(void);
+static void testUniqueKeys(void);
+static void testBloomFilter(void);
+static void testVacuum(void);
+static void testExternalSort(void);
+static void testHashJoin(void);
+static void testAggregate(void);
+static void testCountMatching(void);
+static void testLimitAndTopK(void);
+static int countMatches(RM_TableData *table, Expr *cond);
+static long tableFileSize(char *name);
 
 // struct for test records
 typedef struct TestRecord {
@@ -79,11 +102,29 @@ main (void)
 
 	testInsertManyRecords();
 	testRecords();
+	testTypedAccessors();
 	testCreateTableAndInsert();
 	testUpdateTable();
 	testScans();
 	testScansTwo();
 	testMultipleScans();
+	testBulkLoad();
+	testGetRecords();
+	testBatchScan();
+	testParallelScan();
+	testSlotReuse();
+	testZoneMaps();
+	testPrimaryIndex();
+	testHashIndex();
+	testIndexScans();
+	testUniqueKeys();
+	testBloomFilter();
+	testVacuum();
+	testExternalSort();
+	testHashJoin();
+	testAggregate();
+	testCountMatching();
+	testLimitAndTopK();
 
 	return 0;
 }
@@ -126,6 +167,48 @@ testRecords (void)
 	TEST_DONE();
 }
 
+// ************************************************************ 
+void
+testTypedAccessors (void)
+{
+	Schema *schema;
+	Record *r;
+	Value value;
+	char buf[5];
+	const char *str;
+	int intVal, len;
+	float floatVal;
+	testName = "test allocation-free attribute accessors";
+
+	schema = testSchema();
+	r = testRecord(schema, 42, "ab", 7);
+
+	ASSERT_EQUALS_INT(0, getAttrOffset(schema, 0), "offset of a");
+	ASSERT_EQUALS_INT((int) sizeof(int), getAttrOffset(schema, 1), "offset of b");
+	ASSERT_EQUALS_INT((int) sizeof(int) + 4, getAttrOffset(schema, 2), "offset of c");
+
+	TEST_CHECK(getAttrInt(r, schema, 0, &intVal));
+	ASSERT_EQUALS_INT(42, intVal, "getAttrInt a");
+	TEST_CHECK(getAttrInt(r, schema, 2, &intVal));
+	ASSERT_EQUALS_INT(7, intVal, "getAttrInt c");
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, getAttrFloat(r, schema, 0, &floatVal), "wrong type");
+	ASSERT_EQUALS_INT(RC_RM_INVALID_ATTRIBUTE, getAttrInt(r, schema, 3, &intVal), "no such attribute");
+
+	TEST_CHECK(getAttrString(r, schema, 1, &str, &len));
+	ASSERT_EQUALS_INT(2, len, "string length");
+	ASSERT_TRUE(strncmp(str, "ab", 2) == 0, "string points into record");
+	ASSERT_TRUE(str == r->data + getAttrOffset(schema, 1), "string is not copied");
+
+	value.v.stringV = buf;
+	TEST_CHECK(getAttrInto(r, schema, 1, &value));
+	ASSERT_EQUALS_STRING("ab", value.v.stringV, "getAttrInto string");
+	TEST_CHECK(getAttrInto(r, schema, 2, &value));
+	ASSERT_EQUALS_INT(7, value.v.intV, "getAttrInto int");
+
+	freeRecord(r);
+	TEST_DONE();
+}
+
 // ************************************************************ 
 void
 testCreateTableAndInsert (void)
@@ -622,6 +705,2133 @@ void testScansTwo (void)
 	TEST_DONE();
 }
 
+void
+testBulkLoad (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_BulkLoadHandle *load = (RM_BulkLoadHandle *) malloc(sizeof(RM_BulkLoadHandle));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numInserts = 5000, i, count = 0;
+	Record *r;
+	RID *rids;
+	Schema *schema;
+	int rc;
+	testName = "test bulk loading 5000 records into an empty table";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	// an open scan reads through the buffer pool the load shuts down
+	TEST_CHECK(startScan(table, sc, NULL));
+	ASSERT_EQUALS_INT(RC_RM_SCAN_OPEN, startBulkLoad(table, load), "bulk load with an open scan");
+	TEST_CHECK(closeScan(sc));
+
+	TEST_CHECK(startBulkLoad(table, load));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "bulk", i % 7);
+		TEST_CHECK(bulkLoadRecord(load, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	TEST_CHECK(finishBulkLoad(load));
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count after bulk load");
+
+	// a second bulk load is only allowed on an empty table
+	ASSERT_ERROR(startBulkLoad(table, load), "bulk load into non-empty table");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count after reopen");
+
+	createRecord(&r, schema);
+	for(i = 0; i < numInserts; i += 97)
+	{
+		Record *expected = testRecord(schema, i, "bulk", i % 7);
+		TEST_CHECK(getRecord(table, rids[i], r));
+		ASSERT_EQUALS_RECORDS(expected, r, schema, "compare records");
+		freeRecord(expected);
+	}
+
+	TEST_CHECK(startScan(table, sc, NULL));
+	while((rc = next(sc, r)) == RC_OK)
+		count++;
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(numInserts, count, "scan sees all loaded records");
+
+	// regular inserts continue after the loaded pages
+	freeRecord(r);
+	r = testRecord(schema, numInserts, "post", 0);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_EQUALS_INT(numInserts + 1, getNumTuples(table), "tuple count after insert");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	free(rids);
+	free(sc);
+	free(load);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testGetRecords (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+			{1, "aaaa", 3},
+			{2, "bbbb", 2},
+			{3, "cccc", 1},
+			{4, "dddd", 3},
+			{5, "eeee", 5},
+			{6, "ffff", 1},
+	};
+	int numInserts = 6, numLookups = 8, i;
+	Record *r;
+	Record *out[8];
+	RID ids[8];
+	RC status[8];
+	RID *rids;
+	Schema *schema;
+	testName = "test batched record lookup by RID";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table,r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	TEST_CHECK(deleteRecord(table, rids[2]));
+
+	// request in reverse order, with a deleted and an out-of-range RID
+	for(i = 0; i < numInserts; i++)
+		ids[i] = rids[numInserts - 1 - i];
+	ids[6].page = 1000;
+	ids[6].slot = 0;
+	ids[7] = rids[0];
+	for(i = 0; i < numLookups; i++)
+		createRecord(&out[i], schema);
+
+	TEST_CHECK(getRecords(table, ids, numLookups, out, status));
+	for(i = 0; i < numInserts; i++)
+	{
+		int pos = numInserts - 1 - i;
+		if (pos == 2)
+		{
+			ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, status[i], "deleted record");
+			continue;
+		}
+		ASSERT_EQUALS_INT(RC_OK, status[i], "record found");
+		ASSERT_EQUALS_RECORDS(fromTestRecord(schema, inserts[pos]), out[i], schema, "compare records");
+	}
+	ASSERT_EQUALS_INT(RC_RM_INVALID_SLOT, status[6], "RID outside the table");
+	ASSERT_EQUALS_INT(RC_OK, status[7], "repeated RID");
+	ASSERT_EQUALS_RECORDS(fromTestRecord(schema, inserts[0]), out[7], schema, "compare records");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	for(i = 0; i < numLookups; i++)
+		freeRecord(out[i]);
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testBatchScan (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numInserts = 1000, i, count = 0, batches = 0;
+	Record *r;
+	RecordBatch *batch;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	int rc;
+	testName = "test batch, zero-copy and projected scans";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "bbbb", i % 5);
+		TEST_CHECK(insertRecord(table,r));
+		freeRecord(r);
+	}
+
+	// select c = 3 in batches of 64
+	MAKE_CONS(left, stringToValue("i3"));
+	MAKE_ATTRREF(right, 2);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(createRecordBatch(&batch, schema, 64));
+	TEST_CHECK(startScan(table, sc, sel));
+	while((rc = nextBatch(sc, batch, 64)) == RC_OK)
+	{
+		batches++;
+		for(i = 0; i < batch->numRecords; i++)
+		{
+			Record row;
+			Value *value;
+			row.id = batch->ids[i];
+			row.data = batch->data + i * batch->recordSize;
+			getAttr(&row, schema, 2, &value);
+			ASSERT_TRUE(value->v.intV == 3, "batch row matches condition");
+			freeVal(value);
+			count++;
+		}
+	}
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(numInserts / 5, count, "batch scan returned all matches");
+	ASSERT_EQUALS_INT(4, batches, "batches of 64 rows");
+
+	// same condition with records pointing into the pinned pages
+	{
+		RM_ScanOptions options;
+		Record row;
+		char *content, *line;
+		int lines = 0;
+
+		initScanOptions(&options);
+		options.zeroCopy = 1;
+		row.data = NULL;
+		count = 0;
+		TEST_CHECK(startScanWithOptions(table, sc, sel, &options));
+		while((rc = next(sc, &row)) == RC_OK)
+		{
+			Value *value;
+			getAttr(&row, schema, 2, &value);
+			ASSERT_TRUE(value->v.intV == 3, "zero-copy row matches condition");
+			freeVal(value);
+			count++;
+		}
+		if (rc != RC_RM_NO_MORE_TUPLES)
+			TEST_CHECK(rc);
+		TEST_CHECK(closeScan(sc));
+		ASSERT_EQUALS_INT(numInserts / 5, count, "zero-copy scan returned all matches");
+
+		// project c and a only, in that order
+		{
+			int projAttrs[] = { 2, 0 };
+			Schema *projSchema;
+			Record *projected;
+
+			count = 0;
+			TEST_CHECK(startProjectedScan(table, sc, sel, 2, projAttrs));
+			projSchema = getScanSchema(sc);
+			ASSERT_EQUALS_INT(2, projSchema->numAttr, "projected attributes");
+			ASSERT_EQUALS_INT(2 * (int) sizeof(int), getRecordSize(projSchema), "projected record size");
+			ASSERT_EQUALS_STRING("c", projSchema->attrNames[0], "first projected attribute");
+			createRecord(&projected, projSchema);
+			while((rc = next(sc, projected)) == RC_OK)
+			{
+				Value *value;
+				getAttr(projected, projSchema, 0, &value);
+				ASSERT_TRUE(value->v.intV == 3, "projected c");
+				freeVal(value);
+				getAttr(projected, projSchema, 1, &value);
+				ASSERT_TRUE(value->v.intV % 5 == 3, "projected a");
+				freeVal(value);
+				count++;
+			}
+			if (rc != RC_RM_NO_MORE_TUPLES)
+				TEST_CHECK(rc);
+			TEST_CHECK(closeScan(sc));
+			freeRecord(projected);
+			ASSERT_EQUALS_INT(numInserts / 5, count, "projected scan returned all matches");
+		}
+
+		content = serializeTableContent(table);
+		for (line = strchr(content, '\n'); line != NULL; line = strchr(line + 1, '\n'))
+			lines++;
+		ASSERT_EQUALS_INT(numInserts + 1, lines, "serialized table content");
+		free(content);
+	}
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecordBatch(batch);
+	freeExpr(sel);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+// per-worker tallies for testParallelScan
+typedef struct ParallelTally {
+	Schema *schema;
+	int count[4];
+	long sum[4];
+} ParallelTally;
+
+static RC
+tallyRecord (int workerId, Record *record, void *context)
+{
+	ParallelTally *tally = (ParallelTally *) context;
+	Value *value;
+
+	getAttr(record, tally->schema, 0, &value);
+	tally->count[workerId]++;
+	tally->sum[workerId] += value->v.intV;
+	freeVal(value);
+	return RC_OK;
+}
+
+void
+testParallelScan (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_BulkLoadHandle *load = (RM_BulkLoadHandle *) malloc(sizeof(RM_BulkLoadHandle));
+	RM_ParallelScanHandle *psc = (RM_ParallelScanHandle *) malloc(sizeof(RM_ParallelScanHandle));
+	ParallelTally tally;
+	int numInserts = 20000, i, count = 0;
+	long sum = 0, expectedSum = 0;
+	Record *r;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	testName = "test parallel scan over four workers";
+	schema = testSchema();
+	memset(&tally, 0, sizeof(tally));
+	tally.schema = schema;
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	TEST_CHECK(startBulkLoad(table, load));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "para", i % 5);
+		TEST_CHECK(bulkLoadRecord(load, r));
+		freeRecord(r);
+		if (i % 5 == 3)
+			expectedSum += i;
+	}
+	TEST_CHECK(finishBulkLoad(load));
+
+	MAKE_CONS(left, stringToValue("i3"));
+	MAKE_ATTRREF(right, 2);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startParallelScan(table, psc, sel, 4, tallyRecord, &tally));
+	TEST_CHECK(closeParallelScan(psc));
+
+	for(i = 0; i < 4; i++)
+	{
+		count += tally.count[i];
+		sum += tally.sum[i];
+	}
+	ASSERT_EQUALS_INT(numInserts / 5, count, "parallel scan found all matches");
+	ASSERT_TRUE(sum == expectedSum, "each match seen exactly once");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeExpr(sel);
+	free(psc);
+	free(load);
+	free(table);
+	TEST_DONE();
+}
+
+
+void
+testSlotReuse (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numInserts = 2000, i, j, count = 0, lastPage = 0, reused;
+	Record *r;
+	RID *rids;
+	Schema *schema;
+	int rc;
+	testName = "test deleted slots are found again by later inserts";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "fill", i % 7);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		if (r->id.page > lastPage)
+			lastPage = r->id.page;
+		freeRecord(r);
+	}
+
+	// free every third slot, spread over all pages
+	for(i = 0; i < numInserts; i += 3)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+
+	// the inserts that follow must land in exactly those slots
+	reused = 1;
+	for(i = 0; i < numInserts; i += 3)
+	{
+		r = testRecord(schema, -i, "back", 0);
+		TEST_CHECK(insertRecord(table, r));
+		for(j = 0; j < numInserts; j += 3)
+			if (rids[j].page == r->id.page && rids[j].slot == r->id.slot)
+				break;
+		if (j >= numInserts || r->id.page > lastPage)
+			reused = 0;
+		freeRecord(r);
+	}
+	ASSERT_TRUE(reused, "inserts reuse the freed slots");
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count after reuse");
+
+	// only the last page has room left, then the table grows by a page
+	reused = 1;
+	for(i = numInserts; ; i++)
+	{
+		r = testRecord(schema, i, "more", 0);
+		TEST_CHECK(insertRecord(table, r));
+		j = r->id.page;
+		freeRecord(r);
+		if (j != lastPage)
+			break;
+	}
+	ASSERT_EQUALS_INT(lastPage + 1, j, "insert into a full table appends a page");
+
+	createRecord(&r, schema);
+	TEST_CHECK(startScan(table, sc, NULL));
+	while((rc = next(sc, r)) == RC_OK)
+		count++;
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(i + 1, count, "scan sees every record");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	free(rids);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testPrimaryIndex (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	BTreeHandle *index;
+	int numInserts = 1000, i, matches, entries;
+	Record *r;
+	RID *rids;
+	RID rid;
+	Schema *schema;
+	Value *key;
+	testName = "test primary key index maintained by record changes";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "keys", i % 3);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// delete every fifth record and move every seventh to a new key
+	for(i = 0; i < numInserts; i += 5)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	for(i = 1; i < numInserts; i += 7)
+	{
+		if (i % 5 == 0)
+			continue;
+		r = testRecord(schema, numInserts + i, "moved", 0);
+		r->id = rids[i];
+		TEST_CHECK(updateRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(closeTable(table));
+
+	// the index file maps each remaining key to its record
+	TEST_CHECK(openBtree(&index, "test_table_r.pk"));
+	TEST_CHECK(getNumEntries(index, &entries));
+	ASSERT_EQUALS_INT(numInserts - numInserts / 5, entries, "one entry per record");
+
+	matches = 0;
+	for(i = 0; i < numInserts; i++)
+	{
+		int moved = (i % 7 == 1 && i % 5 != 0);
+		MAKE_VALUE(key, DT_INT, moved ? numInserts + i : i);
+		if (i % 5 == 0)
+			matches += (findKey(index, key, &rid) == RC_IM_KEY_NOT_FOUND);
+		else if (findKey(index, key, &rid) == RC_OK)
+			matches += (rid.page == rids[i].page && rid.slot == rids[i].slot);
+		freeVal(key);
+
+		// the old key of a moved record is gone
+		if (moved)
+		{
+			MAKE_VALUE(key, DT_INT, i);
+			if (findKey(index, key, &rid) != RC_IM_KEY_NOT_FOUND)
+				matches--;
+			freeVal(key);
+		}
+	}
+	ASSERT_EQUALS_INT(numInserts, matches, "index agrees with the table");
+	TEST_CHECK(closeBtree(index));
+
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testHashIndex (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	HashIndexHandle *index;
+	HI_ScanHandle *hs;
+	int numInserts = 2000, i, entries, expected, correct;
+	Record *r;
+	RID *rids;
+	RID rid;
+	Schema *schema;
+	Value *value;
+	FILE *indexFile;
+	char **names;
+	DataType *dt;
+	int *sizes;
+	testName = "test hash index lookups maintained by record changes";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	// half of the records are there before the index
+	for(i = 0; i < numInserts; i++)
+	{
+		if (i == numInserts / 2)
+			TEST_CHECK(createIndex(table, 2));
+		r = testRecord(schema, i, "hash", i % 100);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(RC_IM_INDEX_ALREADY_EXISTS, createIndex(table, 2), "one hash index per attribute");
+
+	// delete every fourth record and move every third to a unique value
+	for(i = 0; i < numInserts; i += 4)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	for(i = 1; i < numInserts; i += 3)
+	{
+		if (i % 4 == 0)
+			continue;
+		r = testRecord(schema, i, "hash", 1000 + i);
+		r->id = rids[i];
+		TEST_CHECK(updateRecord(table, r));
+		freeRecord(r);
+	}
+
+	// point lookups of the moved records go through the index
+	TEST_CHECK(createRecord(&r, schema));
+	expected = correct = 0;
+	for(i = 1; i < numInserts; i += 3)
+	{
+		if (i % 4 == 0)
+			continue;
+		expected++;
+		MAKE_VALUE(value, DT_INT, 1000 + i);
+		if (lookupRecord(table, 2, value, r) == RC_OK)
+			correct += (r->id.page == rids[i].page && r->id.slot == rids[i].slot);
+		freeVal(value);
+	}
+	ASSERT_EQUALS_INT(expected, correct, "lookups find the updated records");
+
+	MAKE_VALUE(value, DT_INT, 50);
+	TEST_CHECK(lookupRecord(table, 2, value, r));
+	TEST_CHECK(getAttrInt(r, schema, 2, &correct));
+	ASSERT_EQUALS_INT(50, correct, "lookup of a duplicated value");
+	freeVal(value);
+	MAKE_VALUE(value, DT_INT, 9999);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, lookupRecord(table, 2, value, r), "lookup of a missing value");
+	freeVal(value);
+
+	// an attribute without an index is looked up by a scan
+	MAKE_STRING_VALUE(value, "hash");
+	TEST_CHECK(lookupRecord(table, 1, value, r));
+	freeVal(value);
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+
+	// the index file holds one entry per record, under its current value
+	TEST_CHECK(openHashIndex(&index, "test_table_r.2.hx"));
+	TEST_CHECK(getNumHashEntries(index, &entries));
+	ASSERT_EQUALS_INT(numInserts - numInserts / 4, entries, "one entry per record");
+
+	MAKE_VALUE(value, DT_INT, 7);
+	TEST_CHECK(openHashScan(index, value, &hs));
+	expected = correct = 0;
+	for(i = 7; i < numInserts; i += 100)
+		if (i % 4 != 0 && i % 3 != 1)
+			expected++;
+	while(nextHashEntry(hs, &rid) == RC_OK)
+	{
+		for(i = 0; i < numInserts; i++)
+			if (rids[i].page == rid.page && rids[i].slot == rid.slot)
+				break;
+		correct += (i < numInserts && i % 100 == 7 && i % 4 != 0 && i % 3 != 1);
+	}
+	ASSERT_EQUALS_INT(expected, correct, "all RIDs of a duplicated value");
+	TEST_CHECK(closeHashScan(hs));
+	freeVal(value);
+	TEST_CHECK(closeHashIndex(index));
+
+	// the index comes back with the table and is dropped with it
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_VALUE(value, DT_INT, 1001);
+	TEST_CHECK(lookupRecord(table, 2, value, r));
+	ASSERT_EQUALS_INT(rids[1].slot, r->id.slot, "index reopened with the table");
+	TEST_CHECK(dropIndex(table, 2));
+	ASSERT_EQUALS_INT(RC_IM_INDEX_NOT_FOUND, dropIndex(table, 2), "dropping a missing index");
+	TEST_CHECK(lookupRecord(table, 2, value, r));
+	ASSERT_EQUALS_INT(rids[1].slot, r->id.slot, "lookup without the index");
+	TEST_CHECK(createIndex(table, 2));
+	freeVal(value);
+	freeRecord(r);
+
+	// an insert the hash index refuses leaves no primary index entry:
+	// plant the entry the insert will add, under the slot it will take
+	r = testRecord(schema, numInserts, "hash", 4242);
+	TEST_CHECK(insertRecord(table, r));
+	rid = r->id;
+	TEST_CHECK(deleteRecord(table, rid));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openHashIndex(&index, "test_table_r.2.hx"));
+	MAKE_VALUE(value, DT_INT, 4242);
+	TEST_CHECK(insertHashKey(index, value, rid));
+	freeVal(value);
+	// and the entry an update of rids[1] to c = 4343 will add
+	MAKE_VALUE(value, DT_INT, 4343);
+	TEST_CHECK(insertHashKey(index, value, rids[1]));
+	freeVal(value);
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "insert refused by the hash index");
+	freeRecord(r);
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_VALUE(value, DT_INT, numInserts);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, lookupRecord(table, 0, value, r), "refused insert left the primary index");
+	freeVal(value);
+	freeRecord(r);
+	r = testRecord(schema, numInserts, "hash", 4244);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+
+	// an update the hash index refuses keeps the old index entries
+	r = testRecord(schema, numInserts + 1, "hash", 4343);
+	r->id = rids[1];
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, r), "update refused by the hash index");
+	freeRecord(r);
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_VALUE(value, DT_INT, 1);
+	TEST_CHECK(lookupRecord(table, 0, value, r));
+	ASSERT_EQUALS_INT(rids[1].slot, r->id.slot, "old key kept in the primary index");
+	freeVal(value);
+	MAKE_VALUE(value, DT_INT, numInserts + 1);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, lookupRecord(table, 0, value, r), "new key left out of the primary index");
+	freeVal(value);
+	MAKE_VALUE(value, DT_INT, 1001);
+	TEST_CHECK(lookupRecord(table, 2, value, r));
+	ASSERT_EQUALS_INT(rids[1].slot, r->id.slot, "old value kept in the hash index");
+	freeVal(value);
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+
+	TEST_CHECK(deleteTable("test_table_r"));
+	indexFile = fopen("test_table_r.2.hx", "rb");
+	ASSERT_TRUE(indexFile == NULL, "hash index deleted with the table");
+	if (indexFile != NULL)
+		fclose(indexFile);
+	freeSchema(schema);
+
+	// BOOL attributes are indexed too
+	names = (char **) malloc(sizeof(char*) * 2);
+	dt = (DataType *) malloc(sizeof(DataType) * 2);
+	sizes = (int *) calloc(2, sizeof(int));
+	names[0] = (char *) malloc(2);
+	strcpy(names[0], "a");
+	names[1] = (char *) malloc(2);
+	strcpy(names[1], "f");
+	dt[0] = DT_INT;
+	dt[1] = DT_BOOL;
+	schema = createSchema(2, names, dt, sizes, 0, NULL);
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(createIndex(table, 1));
+	TEST_CHECK(createRecord(&r, schema));
+	for(i = 0; i < 300; i++)
+	{
+		MAKE_VALUE(value, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, value));
+		freeVal(value);
+		MAKE_VALUE(value, DT_BOOL, i % 3 == 0);
+		TEST_CHECK(setAttr(r, schema, 1, value));
+		freeVal(value);
+		TEST_CHECK(insertRecord(table, r));
+	}
+	MAKE_VALUE(value, DT_BOOL, 1);
+	TEST_CHECK(lookupRecord(table, 1, value, r));
+	TEST_CHECK(getAttrInt(r, schema, 0, &correct));
+	ASSERT_TRUE(correct % 3 == 0, "lookup of a BOOL value");
+	freeVal(value);
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openHashIndex(&index, "test_table_r.1.hx"));
+	MAKE_VALUE(value, DT_BOOL, 0);
+	TEST_CHECK(openHashScan(index, value, &hs));
+	for(entries = 0; nextHashEntry(hs, &rid) == RC_OK; entries++)
+		;
+	ASSERT_EQUALS_INT(200, entries, "every false record indexed");
+	TEST_CHECK(closeHashScan(hs));
+	freeVal(value);
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeSchema(schema);
+	free(rids);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testIndexScans (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numInserts = 5000, i, count, ordered, value, rc;
+	Record *r;
+	RID last;
+	Schema *schema;
+	Expr *sel, *left, *right, *low, *high, *inner;
+	testName = "test scans narrowed down by indexes";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(createIndex(table, 2));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "scan", i % 500);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// equality on the hash index attribute, returned in RID order
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i7"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	createRecord(&r, schema);
+	TEST_CHECK(startScan(table, sc, sel));
+	count = 0;
+	ordered = 1;
+	last.page = -1;
+	last.slot = 0;
+	while((rc = next(sc, r)) == RC_OK)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 2, &value));
+		if (value != 7 || r->id.page < last.page || (r->id.page == last.page && r->id.slot <= last.slot))
+			ordered = 0;
+		last = r->id;
+		count++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "index scan ends normally");
+	ASSERT_EQUALS_INT(numInserts / 500, count, "c = 7");
+	ASSERT_TRUE(ordered, "index scan matches come in page order");
+	TEST_CHECK(closeScan(sc));
+	freeRecord(r);
+	freeExpr(sel);
+
+	// key range with a strict bound plus a residual predicate
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(low, left, right, OP_COMP_GREATER_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i200"));
+	MAKE_BINOP_EXPR(high, right, left, OP_COMP_GREATER);
+	MAKE_BINOP_EXPR(inner, low, high, OP_BOOL_AND);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i150"));
+	MAKE_BINOP_EXPR(low, left, right, OP_COMP_NOT_EQUAL);
+	MAKE_BINOP_EXPR(sel, inner, low, OP_BOOL_AND);
+	ASSERT_EQUALS_INT(99, countMatches(table, sel), "100 <= a < 200 AND c <> 150");
+	freeExpr(sel);
+
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(low, stringToValue("i10"));
+	MAKE_CONS(high, stringToValue("i19"));
+	MAKE_BETWEEN_EXPR(sel, left, low, high);
+	ASSERT_EQUALS_INT(10, countMatches(table, sel), "a BETWEEN 10 AND 19");
+	freeExpr(sel);
+
+	// deleted records and moved keys are not returned
+	for(i = 10; i < 15; i++)
+	{
+		RID id;
+		Value *key;
+		MAKE_VALUE(key, DT_INT, i);
+		MAKE_ATTRREF(left, 0);
+		MAKE_CONS(right, key);
+		MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+		createRecord(&r, schema);
+		TEST_CHECK(startScan(table, sc, sel));
+		TEST_CHECK(next(sc, r));
+		id = r->id;
+		TEST_CHECK(closeScan(sc));
+		freeExpr(sel);
+		freeRecord(r);
+		if (i % 2 == 0)
+		{
+			TEST_CHECK(deleteRecord(table, id));
+		}
+		else
+		{
+			r = testRecord(schema, numInserts + i, "scan", i % 500);
+			r->id = id;
+			TEST_CHECK(updateRecord(table, r));
+			freeRecord(r);
+		}
+	}
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(low, stringToValue("i10"));
+	MAKE_CONS(high, stringToValue("i19"));
+	MAKE_BETWEEN_EXPR(sel, left, low, high);
+	ASSERT_EQUALS_INT(5, countMatches(table, sel), "a BETWEEN 10 AND 19 after changes");
+	freeExpr(sel);
+
+	// an unselective equality falls back to the heap scan
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("sscan"));
+	MAKE_BINOP_EXPR(inner, left, right, OP_COMP_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i4000"));
+	MAKE_BINOP_EXPR(low, left, right, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(sel, inner, low, OP_BOOL_AND);
+	ASSERT_EQUALS_INT(4000 - 5, countMatches(table, sel), "b = 'scan' AND a < 4000");
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testUniqueKeys (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_BulkLoadHandle *load = (RM_BulkLoadHandle *) malloc(sizeof(RM_BulkLoadHandle));
+	int numInserts = 100, i, value, numKeys;
+	Record *r, *check;
+	RID *rids;
+	Schema *schema;
+	char **names;
+	DataType *dt;
+	int *sizes, *keys;
+	Value *v;
+	testName = "test key uniqueness on insert and update";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "uniq", i);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// a taken key is refused and nothing is stored
+	r = testRecord(schema, 5, "dupl", 0);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate key insert");
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "no tuple added");
+	freeRecord(r);
+
+	// an update may keep its own key but not take another one
+	r = testRecord(schema, 6, "same", 60);
+	r->id = rids[6];
+	TEST_CHECK(updateRecord(table, r));
+	freeRecord(r);
+	r = testRecord(schema, 7, "dupl", 0);
+	r->id = rids[6];
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, r), "update to a taken key");
+	freeRecord(r);
+	TEST_CHECK(createRecord(&check, schema));
+	TEST_CHECK(getRecord(table, rids[6], check));
+	TEST_CHECK(getAttrInt(check, schema, 0, &value));
+	ASSERT_EQUALS_INT(6, value, "refused update leaves the record");
+
+	// a deleted key is free again
+	TEST_CHECK(deleteRecord(table, rids[5]));
+	r = testRecord(schema, 5, "back", 0);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	freeSchema(schema);
+
+	// composite keys (b, c) are checked without a primary index
+	names = (char **) malloc(sizeof(char*) * 3);
+	dt = (DataType *) malloc(sizeof(DataType) * 3);
+	sizes = (int *) malloc(sizeof(int) * 3);
+	keys = (int *) malloc(sizeof(int) * 2);
+	for(i = 0; i < 3; i++)
+	{
+		names[i] = (char *) malloc(2);
+		sprintf(names[i], "%c", 'a' + i);
+		sizes[i] = (i == 1) ? 4 : 0;
+	}
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	dt[2] = DT_INT;
+	keys[0] = 1;
+	keys[1] = 2;
+	schema = createSchema(3, names, dt, sizes, 2, keys);
+
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, i % 2 ? "odds" : "even", i / 2);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	r = testRecord(schema, numInserts, "odds", 10);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate composite key");
+	freeRecord(r);
+	r = testRecord(schema, numInserts, "odds", numInserts);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+
+	// bulk loads check composite keys against the keys loaded before
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(startBulkLoad(table, load));
+	for(i = 0; i < 3000; i++)
+	{
+		r = testRecord(schema, i, i % 2 ? "odds" : "even", i / 2);
+		TEST_CHECK(bulkLoadRecord(load, r));
+		freeRecord(r);
+	}
+	r = testRecord(schema, 3000, "even", 1000);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, bulkLoadRecord(load, r), "duplicate composite key in a bulk load");
+	freeRecord(r);
+	r = testRecord(schema, 3000, "even", 1500);
+	TEST_CHECK(bulkLoadRecord(load, r));
+	freeRecord(r);
+	TEST_CHECK(finishBulkLoad(load));
+	ASSERT_EQUALS_INT(3001, getNumTuples(table), "refused record is not loaded");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	freeSchema(schema);
+
+	// keys compare by value: 0.0 may become -0.0, through the primary
+	// index (key b) and through the scan for a composite key (a, b)
+	for(numKeys = 1; numKeys <= 2; numKeys++)
+	{
+		names = (char **) malloc(sizeof(char*) * 2);
+		dt = (DataType *) malloc(sizeof(DataType) * 2);
+		sizes = (int *) calloc(2, sizeof(int));
+		keys = (int *) malloc(sizeof(int) * numKeys);
+		for(i = 0; i < 2; i++)
+		{
+			names[i] = (char *) malloc(2);
+			sprintf(names[i], "%c", 'a' + i);
+		}
+		dt[0] = DT_INT;
+		dt[1] = DT_FLOAT;
+		keys[0] = (numKeys == 1) ? 1 : 0;
+		if (numKeys == 2)
+			keys[1] = 1;
+		schema = createSchema(2, names, dt, sizes, numKeys, keys);
+
+		TEST_CHECK(createTable("test_table_r",schema));
+		TEST_CHECK(openTable(table, "test_table_r"));
+		TEST_CHECK(createRecord(&r, schema));
+		for(i = 0; i < 3; i++)
+		{
+			MAKE_VALUE(v, DT_INT, 0);
+			TEST_CHECK(setAttr(r, schema, 0, v));
+			freeVal(v);
+			MAKE_VALUE(v, DT_FLOAT, (float) i);
+			TEST_CHECK(setAttr(r, schema, 1, v));
+			freeVal(v);
+			TEST_CHECK(insertRecord(table, r));
+			if (i == 0)
+				rids[0] = r->id;
+		}
+		r->id = rids[0];
+		MAKE_VALUE(v, DT_FLOAT, -0.0f);
+		TEST_CHECK(setAttr(r, schema, 1, v));
+		freeVal(v);
+		TEST_CHECK(updateRecord(table, r));
+		MAKE_VALUE(v, DT_FLOAT, 2.0f);
+		TEST_CHECK(setAttr(r, schema, 1, v));
+		freeVal(v);
+		ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, r), "update to a taken float key");
+		freeRecord(r);
+
+		TEST_CHECK(closeTable(table));
+		TEST_CHECK(deleteTable("test_table_r"));
+		freeSchema(schema);
+	}
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(check);
+	free(rids);
+	free(load);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testBloomFilter (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numInserts = 3000, i, missed, smallBits = 64;
+	Record *r, *found;
+	RID victim;
+	Schema *schema;
+	char **names;
+	DataType *dt;
+	int *sizes, *keys;
+	Value *key;
+	Expr *sel, *left, *right, *both, *attr;
+	FILE *bloomFile;
+	testName = "test Bloom filter on the key attributes";
+
+	// a composite key (b, c) has no index, so only the filter avoids scans
+	names = (char **) malloc(sizeof(char*) * 3);
+	dt = (DataType *) malloc(sizeof(DataType) * 3);
+	sizes = (int *) malloc(sizeof(int) * 3);
+	keys = (int *) malloc(sizeof(int) * 2);
+	for(i = 0; i < 3; i++)
+	{
+		names[i] = (char *) malloc(2);
+		sprintf(names[i], "%c", 'a' + i);
+		sizes[i] = (i == 1) ? 4 : 0;
+	}
+	dt[0] = DT_INT;
+	dt[1] = DT_STRING;
+	dt[2] = DT_INT;
+	keys[0] = 1;
+	keys[1] = 2;
+	schema = createSchema(3, names, dt, sizes, 2, keys);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	// more keys than the initial filter holds, so it is resized on the way
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, i % 2 ? "odds" : "even", i / 2);
+		TEST_CHECK(insertRecord(table, r));
+		if (i == 20)
+			victim = r->id;
+		freeRecord(r);
+	}
+
+	// b = 'odds' AND c = 700, then the absent c = 5000
+	MAKE_CONS(left, stringToValue("sodds"));
+	MAKE_ATTRREF(right, 1);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_EQUAL);
+	MAKE_CONS(left, stringToValue("i700"));
+	MAKE_ATTRREF(attr, 2);
+	MAKE_BINOP_EXPR(right, left, attr, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(both, sel, right, OP_BOOL_AND);
+	ASSERT_EQUALS_INT(1, countMatches(table, both), "present composite key");
+	freeVal(left->expr.cons);
+	left->expr.cons = stringToValue("i5000");
+	ASSERT_EQUALS_INT(0, countMatches(table, both), "absent composite key");
+
+	// the filter never hides a present key, before and after a reopen
+	for(i = 0, missed = 0; i < numInserts; i += 7)
+	{
+		r = testRecord(schema, numInserts, i % 2 ? "odds" : "even", i / 2);
+		if (insertRecord(table, r) != RC_IM_KEY_ALREADY_EXISTS)
+			missed++;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(0, missed, "every sampled key refused");
+
+	TEST_CHECK(closeTable(table));
+	bloomFile = fopen("test_table_r.bf", "rb");
+	ASSERT_TRUE(bloomFile != NULL, "Bloom filter saved on close");
+	if (bloomFile != NULL)
+		fclose(bloomFile);
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	// a saved filter whose size does not match its capacity is rebuilt
+	TEST_CHECK(closeTable(table));
+	bloomFile = fopen("test_table_r.bf", "r+b");
+	ASSERT_TRUE(bloomFile != NULL, "Bloom filter saved again");
+	if (bloomFile != NULL)
+	{
+		fseek(bloomFile, 2 * sizeof(int), SEEK_SET);
+		fwrite(&smallBits, sizeof(int), 1, bloomFile);
+		fclose(bloomFile);
+	}
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0, missed = 0; i < numInserts; i += 7)
+	{
+		r = testRecord(schema, numInserts, i % 2 ? "odds" : "even", i / 2);
+		if (insertRecord(table, r) != RC_IM_KEY_ALREADY_EXISTS)
+			missed++;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(0, missed, "every sampled key refused after a bad header");
+
+	r = testRecord(schema, numInserts, "odds", 1499);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate after reopen");
+	freeRecord(r);
+	ASSERT_EQUALS_INT(0, countMatches(table, both), "absent key after reopen");
+
+	// a deleted key stays in the filter but may be used again
+	TEST_CHECK(deleteRecord(table, victim));
+	r = testRecord(schema, numInserts, "even", 10);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+
+	// without the side file the filter is rebuilt from the pages
+	TEST_CHECK(closeTable(table));
+	remove("test_table_r.bf");
+	TEST_CHECK(openTable(table, "test_table_r"));
+	r = testRecord(schema, numInserts, "even", 10);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate after rebuild");
+	freeRecord(r);
+	freeVal(left->expr.cons);
+	left->expr.cons = stringToValue("i1000");
+	ASSERT_EQUALS_INT(1, countMatches(table, both), "present key after rebuild");
+	freeExpr(both);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	freeSchema(schema);
+
+	// a single key answers lookupRecord() misses from the filter
+	schema = testSchema();
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < 100; i++)
+	{
+		r = testRecord(schema, i * 2, "bbbb", i);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createRecord(&found, schema));
+	key = stringToValue("i42");
+	TEST_CHECK(lookupRecord(table, 0, key, found));
+	freeVal(key);
+	key = stringToValue("i43");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, lookupRecord(table, 0, key, found), "absent key");
+	freeVal(key);
+	freeRecord(found);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeSchema(schema);
+	free(table);
+	TEST_DONE();
+}
+
+long
+tableFileSize (char *name)
+{
+	FILE *file = fopen(name, "rb");
+	long size = -1;
+	if (file != NULL)
+	{
+		fseek(file, 0, SEEK_END);
+		size = ftell(file);
+		fclose(file);
+	}
+	return size;
+}
+
+void
+testVacuum (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	int numInserts = 3000, i, value;
+	Record *r, *check;
+	RID *rids;
+	Schema *schema;
+	Value *key;
+	Expr *sel, *left, *right;
+	long before, after;
+	testName = "test vacuuming a table after deletes";
+	schema = testSchema();
+	rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(createIndex(table, 2));
+
+	// keep every tenth record
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "vacu", i);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	for(i = 0; i < numInserts; i++)
+		if (i % 10 != 0)
+			TEST_CHECK(deleteRecord(table, rids[i]));
+
+	// moving records under an open scan is refused
+	TEST_CHECK(startScan(table, sc, NULL));
+	ASSERT_EQUALS_INT(RC_RM_SCAN_OPEN, vacuumTable(table), "vacuum with an open scan");
+	TEST_CHECK(closeScan(sc));
+
+	before = tableFileSize("test_table_r");
+	TEST_CHECK(vacuumTable(table));
+	after = tableFileSize("test_table_r");
+	ASSERT_TRUE(after > 0 && after * 5 < before, "file truncated");
+	ASSERT_EQUALS_INT(numInserts / 10, getNumTuples(table), "no tuple lost");
+
+	MAKE_CONS(left, stringToValue("i0"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_GREATER_EQUAL);
+	ASSERT_EQUALS_INT(numInserts / 10, countMatches(table, sel), "scan after vacuum");
+	freeExpr(sel);
+
+	// old RIDs and both indexes lead to the moved records
+	TEST_CHECK(createRecord(&check, schema));
+	TEST_CHECK(getRecord(table, rids[2990], check));
+	TEST_CHECK(getAttrInt(check, schema, 0, &value));
+	ASSERT_EQUALS_INT(2990, value, "old RID forwards");
+	ASSERT_TRUE(check->id.page != rids[2990].page, "record moved");
+	key = stringToValue("i2980");
+	TEST_CHECK(lookupRecord(table, 0, key, check));
+	freeVal(key);
+	TEST_CHECK(getAttrInt(check, schema, 2, &value));
+	ASSERT_EQUALS_INT(2980, value, "primary index after vacuum");
+	key = stringToValue("i2970");
+	TEST_CHECK(lookupRecord(table, 2, key, check));
+	freeVal(key);
+	TEST_CHECK(getAttrInt(check, schema, 0, &value));
+	ASSERT_EQUALS_INT(2970, value, "hash index after vacuum");
+
+	r = testRecord(schema, 2960, "dupl", 0);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "moved key still taken");
+	freeRecord(r);
+
+	r = testRecord(schema, 2950, "upd8", 2950);
+	r->id = rids[2950];
+	TEST_CHECK(updateRecord(table, r));
+	freeRecord(r);
+	TEST_CHECK(deleteRecord(table, rids[2940]));
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecord(table, rids[2940], check), "deleted through old RID");
+
+	// the forwarding entries survive closing the table
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(getRecord(table, rids[2950], check));
+	TEST_CHECK(getAttrInt(check, schema, 0, &value));
+	ASSERT_EQUALS_INT(2950, value, "old RID after reopen");
+	for(i = 0; i < 100; i++)
+	{
+		r = testRecord(schema, numInserts + i, "more", 0);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(numInserts / 10 + 99, getNumTuples(table), "inserts after vacuum");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	ASSERT_TRUE(tableFileSize("test_table_r.fw") < 0, "forwarding entries deleted with the table");
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(check);
+	freeSchema(schema);
+	free(rids);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testExternalSort (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_SortHandle *sort = (RM_SortHandle *) malloc(sizeof(RM_SortHandle));
+	char *names[] = { "dddd", "cccc", "bbbb", "aaaa" };
+	int numInserts = 3000, i, count, ordered, a, c, prevA, prevC, rc;
+	const char *b;
+	char prevB[5];
+	int length;
+	Record *r, *check;
+	Schema *schema;
+	RM_SortKey keys[2];
+	Expr *sel, *left, *right;
+	testName = "test external merge sort over scans";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, (i * 7919) % numInserts, names[i % 4], i);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(createRecord(&check, schema));
+
+	// b ascending, a descending, over a filtered scan; three pages of
+	// memory hold a fraction of it, so runs are spilled and merged
+	MAKE_CONS(left, stringToValue("i100"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_GREATER_EQUAL);
+	keys[0].attrNum = 1;
+	keys[0].descending = 0;
+	keys[1].attrNum = 0;
+	keys[1].descending = 1;
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(startSort(sc, 2, keys, 3, sort));
+	TEST_CHECK(closeScan(sc));
+
+	count = 0;
+	ordered = 1;
+	prevA = 0;
+	prevB[0] = '\0';
+	while((rc = nextSorted(sort, r)) == RC_OK)
+	{
+		TEST_CHECK(getAttrString(r, schema, 1, &b, &length));
+		TEST_CHECK(getAttrInt(r, schema, 0, &a));
+		if (count > 0 && (strncmp(prevB, b, 4) > 0 || (strncmp(prevB, b, 4) == 0 && prevA <= a)))
+			ordered = 0;
+		memcpy(prevB, b, 4);
+		prevB[4] = '\0';
+		prevA = a;
+		if (count % 500 == 0)
+		{
+			TEST_CHECK(getRecord(table, r->id, check));
+			ASSERT_TRUE(memcmp(r->data, check->data, getRecordSize(schema)) == 0, "sorted record keeps its RID");
+		}
+		count++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "end of sort");
+	ASSERT_EQUALS_INT(numInserts - 100, count, "every match sorted");
+	ASSERT_TRUE(ordered, "sorted on (b, a DESC)");
+	TEST_CHECK(closeSort(sort));
+	freeExpr(sel);
+
+	// equal keys keep scan order (c ascending) through the merge
+	TEST_CHECK(startScan(table, sc, NULL));
+	TEST_CHECK(startSort(sc, 1, keys, 3, sort));
+	TEST_CHECK(closeScan(sc));
+	count = 0;
+	ordered = 1;
+	prevC = -1;
+	prevB[0] = '\0';
+	while(nextSorted(sort, r) == RC_OK)
+	{
+		TEST_CHECK(getAttrString(r, schema, 1, &b, &length));
+		TEST_CHECK(getAttrInt(r, schema, 2, &c));
+		if (strncmp(prevB, b, 4) == 0 && prevC >= c)
+			ordered = 0;
+		memcpy(prevB, b, 4);
+		prevB[4] = '\0';
+		prevC = c;
+		count++;
+	}
+	ASSERT_EQUALS_INT(numInserts, count, "whole table sorted");
+	ASSERT_TRUE(ordered, "sort is stable");
+	TEST_CHECK(closeSort(sort));
+
+	// a budget that holds everything sorts in memory
+	keys[0].attrNum = 0;
+	keys[0].descending = 0;
+	TEST_CHECK(startScan(table, sc, NULL));
+	TEST_CHECK(startSort(sc, 1, keys, 1000, sort));
+	TEST_CHECK(closeScan(sc));
+	for(i = 0, ordered = 1; nextSorted(sort, r) == RC_OK; i++)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 0, &a));
+		if (a != i)
+			ordered = 0;
+	}
+	ASSERT_EQUALS_INT(numInserts, i, "in-memory sort count");
+	ASSERT_TRUE(ordered, "sorted on a");
+	TEST_CHECK(closeSort(sort));
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	freeRecord(check);
+	freeSchema(schema);
+	free(sort);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testHashJoin (void)
+{
+	RM_TableData *build = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_TableData *probe = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_TableData *skewed = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *buildScan = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_ScanHandle *probeScan = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_JoinHandle *join = (RM_JoinHandle *) malloc(sizeof(RM_JoinHandle));
+	char *names[] = { "dddd", "cccc", "bbbb", "aaaa" };
+	int budgets[] = { 3, 100 };
+	int numBuild = 2000, numProbe = 1500, i, k, count, matched, a, c, rc, budget;
+	long sum;
+	char bound[16];
+	Record *r, *s, *r2, *check;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	testName = "test hash join of two scans";
+	schema = testSchema();
+
+	// join build.c (i % 500) with probe.a (i): probe records below 500
+	// match four build records each
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(createTable("test_table_j",schema));
+	TEST_CHECK(openTable(build, "test_table_r"));
+	TEST_CHECK(openTable(probe, "test_table_j"));
+	for(i = 0; i < numBuild; i++)
+	{
+		r = testRecord(schema, i, names[i % 4], i % 500);
+		TEST_CHECK(insertRecord(build, r));
+		freeRecord(r);
+	}
+	for(i = 0; i < numProbe; i++)
+	{
+		r = testRecord(schema, (i * 7) % numProbe, names[i % 4], i);
+		TEST_CHECK(insertRecord(probe, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(createRecord(&s, schema));
+	TEST_CHECK(createRecord(&check, schema));
+
+	// three pages partition both sides; a hundred hold the build side
+	for(k = 0; k < 2; k++)
+	{
+		TEST_CHECK(startScan(build, buildScan, NULL));
+		TEST_CHECK(startScan(probe, probeScan, NULL));
+		TEST_CHECK(startHashJoin(buildScan, 2, probeScan, 0, budgets[k], join));
+		count = 0;
+		matched = 1;
+		sum = 0;
+		while((rc = nextJoined(join, r, s)) == RC_OK)
+		{
+			TEST_CHECK(getAttrInt(r, schema, 2, &c));
+			TEST_CHECK(getAttrInt(s, schema, 0, &a));
+			if (a != c)
+				matched = 0;
+			TEST_CHECK(getAttrInt(r, schema, 0, &a));
+			sum += a;
+			if (count % 400 == 0)
+			{
+				TEST_CHECK(getRecord(probe, s->id, check));
+				ASSERT_TRUE(memcmp(s->data, check->data, getRecordSize(schema)) == 0, "probe record keeps its RID");
+			}
+			count++;
+		}
+		ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "end of join");
+		ASSERT_EQUALS_INT(numBuild, count, "every build record joined once");
+		ASSERT_TRUE(matched, "pairs have equal join values");
+		ASSERT_TRUE(sum == (long) numBuild * (numBuild - 1) / 2, "each build record once");
+		TEST_CHECK(closeHashJoin(join));
+		TEST_CHECK(closeScan(buildScan));
+		TEST_CHECK(closeScan(probeScan));
+	}
+
+	// a filtered build side spills too
+	MAKE_CONS(left, stringToValue("i1000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	TEST_CHECK(startScan(build, buildScan, sel));
+	TEST_CHECK(startScan(probe, probeScan, NULL));
+	TEST_CHECK(startHashJoin(buildScan, 2, probeScan, 0, 3, join));
+	for(count = 0; nextJoined(join, r, s) == RC_OK; count++)
+		;
+	ASSERT_EQUALS_INT(1000, count, "filtered build side");
+	TEST_CHECK(closeHashJoin(join));
+	TEST_CHECK(closeScan(buildScan));
+	TEST_CHECK(closeScan(probeScan));
+	freeExpr(sel);
+
+	// a build side that exactly fills three pages is joined in memory
+	budget = 3 * (PAGE_SIZE / ((int) sizeof(RID) + getRecordSize(schema)));
+	sprintf(bound, "i%d", budget);
+	MAKE_CONS(left, stringToValue(bound));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	TEST_CHECK(startScan(build, buildScan, sel));
+	TEST_CHECK(startScan(probe, probeScan, NULL));
+	TEST_CHECK(startHashJoin(buildScan, 2, probeScan, 0, 3, join));
+	for(count = 0; nextJoined(join, r, s) == RC_OK; count++)
+		;
+	ASSERT_EQUALS_INT(budget, count, "build side of exactly the budget");
+	TEST_CHECK(closeHashJoin(join));
+	TEST_CHECK(closeScan(buildScan));
+	TEST_CHECK(closeScan(probeScan));
+	freeExpr(sel);
+
+	// build partitions over the budget are split again until each holds
+	// one value, which is then loaded whole: build.c (i % 3) against
+	// probe.a (i)
+	TEST_CHECK(createTable("test_table_k",schema));
+	TEST_CHECK(openTable(skewed, "test_table_k"));
+	for(i = 0; i < 3000; i++)
+	{
+		r2 = testRecord(schema, i, names[i % 4], i % 3);
+		TEST_CHECK(insertRecord(skewed, r2));
+		freeRecord(r2);
+	}
+	TEST_CHECK(startScan(skewed, buildScan, NULL));
+	TEST_CHECK(startScan(probe, probeScan, NULL));
+	TEST_CHECK(startHashJoin(buildScan, 2, probeScan, 0, 3, join));
+	count = 0;
+	matched = 1;
+	sum = 0;
+	while((rc = nextJoined(join, r, s)) == RC_OK)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 2, &c));
+		TEST_CHECK(getAttrInt(s, schema, 0, &a));
+		if (a != c)
+			matched = 0;
+		TEST_CHECK(getAttrInt(r, schema, 0, &a));
+		sum += a;
+		count++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "end of skewed join");
+	ASSERT_EQUALS_INT(3000, count, "every skewed build record joined once");
+	ASSERT_TRUE(matched, "skewed pairs have equal join values");
+	ASSERT_TRUE(sum == 3000L * 2999 / 2, "each skewed build record once");
+	TEST_CHECK(closeHashJoin(join));
+	TEST_CHECK(closeScan(buildScan));
+	TEST_CHECK(closeScan(probeScan));
+	TEST_CHECK(closeTable(skewed));
+	TEST_CHECK(deleteTable("test_table_k"));
+
+	TEST_CHECK(startScan(build, buildScan, NULL));
+	TEST_CHECK(startScan(probe, probeScan, NULL));
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, startHashJoin(buildScan, 1, probeScan, 0, 3, join),
+			"join attributes of different types");
+	TEST_CHECK(closeScan(buildScan));
+	TEST_CHECK(closeScan(probeScan));
+
+	TEST_CHECK(closeTable(build));
+	TEST_CHECK(closeTable(probe));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(deleteTable("test_table_j"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	freeRecord(s);
+	freeRecord(check);
+	freeSchema(schema);
+	free(join);
+	free(buildScan);
+	free(probeScan);
+	free(build);
+	free(probe);
+	free(skewed);
+	TEST_DONE();
+}
+
+void
+testAggregate (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	char *names[] = { "dddd", "cccc", "bbbb", "aaaa" };
+	int numInserts = 3000, i, g, n, sumC, groupAttrs[2];
+	int count, sum, min, max, length;
+	float avg;
+	const char *str;
+	Record *r, row;
+	Schema *schema, *outSchema;
+	RecordBatch *out;
+	RM_AggSpec aggs[6];
+	Expr *sel, *left, *right;
+	testName = "test grouped aggregation";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, names[i % 4], i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// count, sum(a) and min(a) by b, in order of first appearance
+	groupAttrs[0] = 1;
+	groupAttrs[1] = 2;
+	aggs[0].func = AGG_COUNT;
+	aggs[1].func = AGG_SUM;
+	aggs[1].attrNum = 0;
+	aggs[2].func = AGG_MIN;
+	aggs[2].attrNum = 0;
+	TEST_CHECK(aggregate(table, NULL, 1, groupAttrs, 3, aggs, &outSchema, &out));
+	ASSERT_EQUALS_INT(4, outSchema->numAttr, "group-by and aggregate attributes");
+	ASSERT_EQUALS_STRING("sum(a)", outSchema->attrNames[2], "aggregate name");
+	ASSERT_EQUALS_INT(4, out->numRecords, "one record per b");
+	for(g = 0; g < out->numRecords; g++)
+	{
+		row.data = out->data + g * out->recordSize;
+		TEST_CHECK(getAttrString(&row, outSchema, 0, &str, &length));
+		ASSERT_TRUE(strncmp(str, names[g], 4) == 0, "groups in order of appearance");
+		TEST_CHECK(getAttrInt(&row, outSchema, 1, &count));
+		TEST_CHECK(getAttrInt(&row, outSchema, 2, &sum));
+		TEST_CHECK(getAttrInt(&row, outSchema, 3, &min));
+		ASSERT_EQUALS_INT(numInserts / 4, count, "count per group");
+		ASSERT_EQUALS_INT(750 * g + 4 * (749 * 750 / 2), sum, "sum per group");
+		ASSERT_EQUALS_INT(g, min, "min per group");
+	}
+	freeRecordBatch(out);
+	freeSchema(outSchema);
+
+	// two group-by attributes: (i % 4, i % 10) takes 20 combinations
+	TEST_CHECK(aggregate(table, NULL, 2, groupAttrs, 1, aggs, &outSchema, &out));
+	ASSERT_EQUALS_INT(20, out->numRecords, "groups of (b, c)");
+	for(g = 0, n = 0, sumC = 0; g < out->numRecords; g++)
+	{
+		row.data = out->data + g * out->recordSize;
+		TEST_CHECK(getAttrInt(&row, outSchema, 1, &i));
+		TEST_CHECK(getAttrInt(&row, outSchema, 2, &count));
+		sumC += i;
+		n += count;
+	}
+	ASSERT_EQUALS_INT(numInserts, n, "every record in a group");
+	ASSERT_EQUALS_INT(2 * 45, sumC, "each c twice");
+	freeRecordBatch(out);
+	freeSchema(outSchema);
+
+	// no group-by attributes over a filtered scan
+	MAKE_CONS(left, stringToValue("i1000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	aggs[2].func = AGG_MAX;
+	aggs[3].func = AGG_AVG;
+	aggs[3].attrNum = 2;
+	aggs[4].func = AGG_MIN;
+	aggs[4].attrNum = 1;
+	aggs[5].func = AGG_MAX;
+	aggs[5].attrNum = 1;
+	TEST_CHECK(aggregate(table, sel, 0, NULL, 6, aggs, &outSchema, &out));
+	ASSERT_EQUALS_INT(1, out->numRecords, "one group");
+	row.data = out->data;
+	TEST_CHECK(getAttrInt(&row, outSchema, 0, &count));
+	TEST_CHECK(getAttrInt(&row, outSchema, 1, &sum));
+	TEST_CHECK(getAttrInt(&row, outSchema, 2, &max));
+	TEST_CHECK(getAttrFloat(&row, outSchema, 3, &avg));
+	ASSERT_EQUALS_INT(1000, count, "filtered count");
+	ASSERT_EQUALS_INT(999 * 1000 / 2, sum, "filtered sum");
+	ASSERT_EQUALS_INT(999, max, "filtered max");
+	ASSERT_TRUE(avg > 4.49 && avg < 4.51, "avg of c");
+	TEST_CHECK(getAttrString(&row, outSchema, 4, &str, &length));
+	ASSERT_TRUE(strncmp(str, "aaaa", 4) == 0, "min of b");
+	TEST_CHECK(getAttrString(&row, outSchema, 5, &str, &length));
+	ASSERT_TRUE(strncmp(str, "dddd", 4) == 0, "max of b");
+	freeRecordBatch(out);
+	freeSchema(outSchema);
+	freeExpr(sel);
+
+	// nothing matches: still one record, counting 0
+	MAKE_CONS(left, stringToValue("i-1"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	TEST_CHECK(aggregate(table, sel, 0, NULL, 2, aggs, &outSchema, &out));
+	ASSERT_EQUALS_INT(1, out->numRecords, "one group for no records");
+	row.data = out->data;
+	TEST_CHECK(getAttrInt(&row, outSchema, 0, &count));
+	ASSERT_EQUALS_INT(0, count, "nothing counted");
+	freeRecordBatch(out);
+	freeSchema(outSchema);
+	freeExpr(sel);
+
+	aggs[1].attrNum = 1;
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, aggregate(table, NULL, 0, NULL, 2, aggs, &outSchema, &out),
+			"sum of a string");
+
+	// an INT sum that does not fit an INT is an error, not a wrapped value
+	for(i = 0; i < 2; i++)
+	{
+		r = testRecord(schema, numInserts + i, "huge", 2000000000);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	aggs[1].attrNum = 2;
+	ASSERT_EQUALS_INT(RC_RM_SUM_OVERFLOW, aggregate(table, NULL, 0, NULL, 2, aggs, &outSchema, &out),
+			"sum overflowing an INT");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeSchema(schema);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testCountMatching (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	char *names[] = { "dddd", "cccc", "bbbb", "aaaa" };
+	int numInserts = 4000, i, k, count;
+	Record *r;
+	RID rids[4000];
+	Schema *schema;
+	Expr *conds[7], *left, *right, *l2, *r2, *e1, *e2;
+	char **attrNames;
+	DataType *dt;
+	int *sizes, *keys;
+	Value *v;
+	testName = "test counting matches in place";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, names[i % 4], i % 50);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// a < 300 (primary key range), a >= 0 (every page covered by its
+	// zone), c = 7, b = "aaaa", a = 12 AND c = 12, NOT(a >= 3000) OR c = 5,
+	// a = 100000 (ruled out by the Bloom filter)
+	MAKE_CONS(left, stringToValue("i300"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(conds[0], right, left, OP_COMP_SMALLER);
+	MAKE_CONS(left, stringToValue("i0"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(conds[1], right, left, OP_COMP_GREATER_EQUAL);
+	MAKE_CONS(left, stringToValue("i7"));
+	MAKE_ATTRREF(right, 2);
+	MAKE_BINOP_EXPR(conds[2], right, left, OP_COMP_EQUAL);
+	MAKE_CONS(left, stringToValue("saaaa"));
+	MAKE_ATTRREF(right, 1);
+	MAKE_BINOP_EXPR(conds[3], right, left, OP_COMP_EQUAL);
+	MAKE_CONS(left, stringToValue("i12"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(e1, right, left, OP_COMP_EQUAL);
+	MAKE_CONS(l2, stringToValue("i12"));
+	MAKE_ATTRREF(r2, 2);
+	MAKE_BINOP_EXPR(e2, r2, l2, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(conds[4], e1, e2, OP_BOOL_AND);
+	MAKE_CONS(left, stringToValue("i3000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(e1, right, left, OP_COMP_GREATER_EQUAL);
+	MAKE_UNOP_EXPR(e2, e1, OP_BOOL_NOT);
+	MAKE_CONS(l2, stringToValue("i5"));
+	MAKE_ATTRREF(r2, 2);
+	MAKE_BINOP_EXPR(e1, r2, l2, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(conds[5], e2, e1, OP_BOOL_OR);
+	MAKE_CONS(left, stringToValue("i100000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(conds[6], right, left, OP_COMP_EQUAL);
+
+	TEST_CHECK(countMatching(table, NULL, &count));
+	ASSERT_EQUALS_INT(numInserts, count, "no condition");
+	for(k = 0; k < 7; k++)
+	{
+		TEST_CHECK(countMatching(table, conds[k], &count));
+		ASSERT_EQUALS_INT(countMatches(table, conds[k]), count, "count agrees with a scan");
+	}
+	TEST_CHECK(countMatching(table, conds[2], &count));
+	ASSERT_EQUALS_INT(numInserts / 50, count, "c = 7");
+
+	// through a hash index on c, and after deletes
+	TEST_CHECK(createIndex(table, 2));
+	TEST_CHECK(countMatching(table, conds[2], &count));
+	ASSERT_EQUALS_INT(numInserts / 50, count, "c = 7 through the index");
+	for(i = 0; i < numInserts; i += 3)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	for(k = 0; k < 7; k++)
+	{
+		TEST_CHECK(countMatching(table, conds[k], &count));
+		ASSERT_EQUALS_INT(countMatches(table, conds[k]), count, "count agrees after deletes");
+	}
+	TEST_CHECK(countMatching(table, conds[1], &count));
+	ASSERT_EQUALS_INT(getNumTuples(table), count, "a >= 0 after deletes");
+
+	for(k = 0; k < 7; k++)
+		freeExpr(conds[k]);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	freeSchema(schema);
+
+	// a FLOAT primary key holding NaN: the index finds candidates, = decides
+	attrNames = (char **) malloc(sizeof(char*));
+	dt = (DataType *) malloc(sizeof(DataType));
+	sizes = (int *) calloc(1, sizeof(int));
+	keys = (int *) calloc(1, sizeof(int));
+	attrNames[0] = (char *) malloc(2);
+	strcpy(attrNames[0], "k");
+	dt[0] = DT_FLOAT;
+	schema = createSchema(1, attrNames, dt, sizes, 1, keys);
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	TEST_CHECK(createRecord(&r, schema));
+	for(i = -2; i < 2000; i++)
+	{
+		if (i < 0)
+			v = stringToValue("fnan");
+		else
+			MAKE_VALUE(v, DT_FLOAT, (float) i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		freeVal(v);
+		TEST_CHECK(insertRecord(table, r));
+	}
+	freeRecord(r);
+	ASSERT_EQUALS_INT(2002, getNumTuples(table), "NaN keys are not duplicates");
+	MAKE_CONS(left, stringToValue("f0.0"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(conds[0], right, left, OP_COMP_EQUAL);
+	TEST_CHECK(countMatching(table, conds[0], &count));
+	ASSERT_EQUALS_INT(1, count, "k = 0.0 next to NaN keys");
+	freeExpr(conds[0]);
+
+	// NaN constants: = matches nothing, <> every record
+	MAKE_CONS(left, stringToValue("fnan"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(conds[0], right, left, OP_COMP_EQUAL);
+	TEST_CHECK(countMatching(table, conds[0], &count));
+	ASSERT_EQUALS_INT(0, count, "k = NaN matches nothing");
+	conds[0]->expr.op->type = OP_COMP_NOT_EQUAL;
+	TEST_CHECK(countMatching(table, conds[0], &count));
+	ASSERT_EQUALS_INT(2002, count, "k <> NaN matches every record");
+	ASSERT_EQUALS_INT(2002, countMatches(table, conds[0]), "scan of k <> NaN");
+	freeExpr(conds[0]);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeSchema(schema);
+	free(table);
+	TEST_DONE();
+}
+
+void
+testLimitAndTopK (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	RM_ScanOptions options;
+	char *names[] = { "dddd", "cccc", "bbbb", "aaaa" };
+	int numInserts = 3000, i, a, c, count, ok, rc;
+	const char *b;
+	int length;
+	Record *r, row;
+	RecordBatch *batch;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	testName = "test LIMIT and top-K scans";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, (i * 7919) % numInserts, names[i % 4], i);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(createRecordBatch(&batch, schema, 40));
+
+	// LIMIT 50 over a < 2000
+	MAKE_CONS(left, stringToValue("i2000"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	initScanOptions(&options);
+	options.limit = 50;
+	TEST_CHECK(startScanWithOptions(table, sc, sel, &options));
+	for(count = 0, ok = 1; (rc = next(sc, r)) == RC_OK; count++)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 0, &a));
+		if (a >= 2000)
+			ok = 0;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "limit ends the scan");
+	ASSERT_EQUALS_INT(50, count, "limit of 50");
+	ASSERT_TRUE(ok, "limited records match");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, r), "scan stays finished");
+	TEST_CHECK(closeScan(sc));
+
+	TEST_CHECK(startScanWithOptions(table, sc, sel, &options));
+	TEST_CHECK(nextBatch(sc, batch, 40));
+	ASSERT_EQUALS_INT(40, batch->numRecords, "first batch");
+	TEST_CHECK(nextBatch(sc, batch, 40));
+	ASSERT_EQUALS_INT(10, batch->numRecords, "batch cut at the limit");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, nextBatch(sc, batch, 40), "no batch past the limit");
+	TEST_CHECK(closeScan(sc));
+
+	// top 50 by a descending among a < 2000: 1999 down to 1950
+	initScanOptions(&options);
+	options.topK = 50;
+	options.orderAttr = 0;
+	options.descending = 1;
+	TEST_CHECK(startScanWithOptions(table, sc, sel, &options));
+	for(count = 0, ok = 1; next(sc, r) == RC_OK; count++)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 0, &a));
+		if (a != 1999 - count)
+			ok = 0;
+	}
+	ASSERT_EQUALS_INT(50, count, "top 50");
+	ASSERT_TRUE(ok, "top 50 by a, largest first");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// top 10 by b ascending: the first "aaaa" records in scan order;
+	// zero-copy records point into the heap until the scan closes
+	options.topK = 10;
+	options.orderAttr = 1;
+	options.descending = 0;
+	options.zeroCopy = 1;
+	row.data = NULL;
+	TEST_CHECK(startScanWithOptions(table, sc, NULL, &options));
+	for(count = 0, ok = 1; next(sc, &row) == RC_OK; count++)
+	{
+		TEST_CHECK(getAttrString(&row, schema, 1, &b, &length));
+		TEST_CHECK(getAttrInt(&row, schema, 2, &c));
+		if (strncmp(b, "aaaa", 4) != 0 || c != 4 * count + 3)
+			ok = 0;
+	}
+	ASSERT_EQUALS_INT(10, count, "top 10");
+	ASSERT_TRUE(ok, "ties in scan order");
+	TEST_CHECK(closeScan(sc));
+
+	// a limit on top of top-K, and a top-K larger than the table
+	options.zeroCopy = 0;
+	options.limit = 5;
+	TEST_CHECK(startScanWithOptions(table, sc, NULL, &options));
+	for(count = 0; next(sc, r) == RC_OK; count++)
+		;
+	ASSERT_EQUALS_INT(5, count, "limit over top-K");
+	TEST_CHECK(closeScan(sc));
+	options.limit = 0;
+	options.topK = numInserts * 2;
+	options.orderAttr = 2;
+	TEST_CHECK(startScanWithOptions(table, sc, NULL, &options));
+	for(count = 0, ok = 1; next(sc, r) == RC_OK; count++)
+	{
+		TEST_CHECK(getAttrInt(r, schema, 2, &c));
+		if (c != count)
+			ok = 0;
+	}
+	ASSERT_EQUALS_INT(numInserts, count, "every record when K exceeds the table");
+	ASSERT_TRUE(ok, "sorted by c");
+	TEST_CHECK(closeScan(sc));
+
+	options.orderAttr = 3;
+	ASSERT_EQUALS_INT(RC_RM_INVALID_ATTRIBUTE, startScanWithOptions(table, sc, NULL, &options), "no such order attribute");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecordBatch(batch);
+	freeRecord(r);
+	freeSchema(schema);
+	free(sc);
+	free(table);
+	TEST_DONE();
+}
+
+int
+countMatches (RM_TableData *table, Expr *cond)
+{
+	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	Record *r;
+	int count = 0, rc;
+
+	createRecord(&r, table->schema);
+	TEST_CHECK(startScan(table, sc, cond));
+	while((rc = next(sc, r)) == RC_OK)
+		count++;
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+
+	freeRecord(r);
+	free(sc);
+	return count;
+}
+
+void
+testZoneMaps (void)
+{
+	RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+	int numInserts = 3000, i;
+	Record *r;
+	RID first;
+	Schema *schema;
+	Expr *sel, *left, *right, *low, *high, *inner;
+	FILE *zoneFile;
+	testName = "test scans skipping pages on zone maps";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r",schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	// clustered on a, so each page covers a narrow range of it
+	for(i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, (i < 1500) ? "aaaa" : "zzzz", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		if (i == 0)
+			first = r->id;
+		freeRecord(r);
+	}
+
+	MAKE_CONS(left, stringToValue("i2500"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(1, countMatches(table, sel), "a = 2500");
+	freeExpr(sel);
+
+	MAKE_CONS(left, stringToValue("i100"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+	ASSERT_EQUALS_INT(100, countMatches(table, sel), "a < 100");
+	freeExpr(sel);
+
+	// NOT (a < 2900)
+	MAKE_CONS(left, stringToValue("i2900"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(inner, right, left, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(sel, inner, OP_BOOL_NOT);
+	ASSERT_EQUALS_INT(100, countMatches(table, sel), "NOT a < 2900");
+	freeExpr(sel);
+
+	MAKE_ATTRREF(right, 0);
+	MAKE_CONS(low, stringToValue("i1490"));
+	MAKE_CONS(high, stringToValue("i1509"));
+	MAKE_BETWEEN_EXPR(inner, right, low, high);
+	MAKE_CONS(left, stringToValue("szzzz"));
+	MAKE_ATTRREF(right, 1);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(left, inner, sel, OP_BOOL_AND);
+	ASSERT_EQUALS_INT(10, countMatches(table, left), "a BETWEEN 1490 AND 1509 AND b = 'zzzz'");
+	freeExpr(left);
+
+	// the bounds survive closing the table and widen on update
+	TEST_CHECK(closeTable(table));
+	zoneFile = fopen("test_table_r.zm", "rb");
+	ASSERT_TRUE(zoneFile != NULL, "zone map saved on close");
+	if (zoneFile != NULL)
+		fclose(zoneFile);
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	r = testRecord(schema, 99999, "aaaa", 0);
+	r->id = first;
+	TEST_CHECK(updateRecord(table, r));
+	freeRecord(r);
+
+	MAKE_CONS(left, stringToValue("i99999"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(1, countMatches(table, sel), "updated record found");
+	freeExpr(sel);
+
+	// without the side file the zone map is rebuilt from the pages
+	TEST_CHECK(closeTable(table));
+	remove("test_table_r.zm");
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	MAKE_CONS(left, stringToValue("i2950"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, right, left, OP_COMP_GREATER_EQUAL);
+	ASSERT_EQUALS_INT(51, countMatches(table, sel), "a >= 2950 after rebuild");
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	TEST_DONE();
+}
 
 Schema *
 testSchema (void)
@@ -0,0 +1,544 @@
+#include <stdlib.h>
+#include "dberror.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
+#include "expr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+// test methods
+static void testInsertAndFind (void);
+static void testDelete (void);
+static void testRangeScan (void);
+static void testStringKeys (void);
+static void testNanKeys (void);
+static void testHashIndex (void);
+
+// helper methods
+static int *createPermutation (int size);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	testInsertAndFind();
+	testDelete();
+	testRangeScan();
+	testStringKeys();
+	testNanKeys();
+	testHashIndex();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testInsertAndFind (void)
+{
+	int numKeys = 2000, i, result;
+	int *order = createPermutation(numKeys);
+	BTreeHandle *tree = NULL;
+	Value *key;
+	RID rid;
+	testName = "test b-tree inserting and finding keys";
+
+	TEST_CHECK(initIndexManager(NULL));
+	TEST_CHECK(createBtree("testidx", DT_INT, sizeof(int), 4));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	// insert keys in random order; small nodes force several levels
+	for(i = 0; i < numKeys; i++)
+	{
+		RID value = { order[i] / 10, order[i] % 10 };
+		MAKE_VALUE(key, DT_INT, order[i]);
+		TEST_CHECK(insertKey(tree, key, value));
+		freeVal(key);
+	}
+
+	TEST_CHECK(getNumEntries(tree, &result));
+	ASSERT_EQUALS_INT(numKeys, result, "number of entries in the btree");
+	TEST_CHECK(getNumNodes(tree, &result));
+	ASSERT_TRUE(result > numKeys / 4, "splits created more nodes");
+
+	// the same entry cannot be inserted twice
+	MAKE_VALUE(key, DT_INT, 7);
+	rid.page = 0;
+	rid.slot = 7;
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, key, rid), "duplicate entry rejected");
+	freeVal(key);
+
+	// the tree survives closing and reopening
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	for(i = 0; i < numKeys; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		TEST_CHECK(findKey(tree, key, &rid));
+		freeVal(key);
+		if (rid.page != i / 10 || rid.slot != i % 10)
+			break;
+	}
+	ASSERT_EQUALS_INT(numKeys, i, "every key found with its RID");
+
+	MAKE_VALUE(key, DT_INT, numKeys + 5);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, key, &rid), "missing key not found");
+	freeVal(key);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree("testidx"));
+	TEST_CHECK(shutdownIndexManager());
+	free(order);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testDelete (void)
+{
+	int numKeys = 1000, i, result, found;
+	int *order = createPermutation(numKeys);
+	BTreeHandle *tree = NULL;
+	Value *key;
+	RID rid;
+	testName = "test b-tree deleting keys";
+
+	TEST_CHECK(initIndexManager(NULL));
+	TEST_CHECK(createBtree("testidx", DT_INT, sizeof(int), 4));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	for(i = 0; i < numKeys; i++)
+	{
+		rid.page = order[i];
+		rid.slot = 0;
+		MAKE_VALUE(key, DT_INT, order[i]);
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	// delete the odd keys in random order
+	for(i = 0; i < numKeys; i++)
+	{
+		if (order[i] % 2 == 0)
+			continue;
+		MAKE_VALUE(key, DT_INT, order[i]);
+		TEST_CHECK(deleteKey(tree, key));
+		freeVal(key);
+	}
+
+	TEST_CHECK(getNumEntries(tree, &result));
+	ASSERT_EQUALS_INT(numKeys / 2, result, "entries left after deletes");
+
+	found = 0;
+	for(i = 0; i < numKeys; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		result = findKey(tree, key, &rid);
+		freeVal(key);
+		if ((i % 2 == 0 && result == RC_OK && rid.page == i) ||
+				(i % 2 == 1 && result == RC_IM_KEY_NOT_FOUND))
+			found++;
+	}
+	ASSERT_EQUALS_INT(numKeys, found, "only the even keys remain");
+
+	MAKE_VALUE(key, DT_INT, 1);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteKey(tree, key), "deleting a missing key");
+	freeVal(key);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree("testidx"));
+	free(order);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testRangeScan (void)
+{
+	int numKeys = 1500, i, count, ordered;
+	int *order = createPermutation(numKeys);
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc;
+	Value *key, *low, *high;
+	RID rid, last;
+	RC rc;
+	testName = "test b-tree ordered and range scans";
+
+	TEST_CHECK(initIndexManager(NULL));
+	TEST_CHECK(createBtree("testidx", DT_INT, sizeof(int), 0));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	// every key three times, with different RIDs
+	for(i = 0; i < numKeys * 3; i++)
+	{
+		rid.page = order[i % numKeys];
+		rid.slot = i / numKeys;
+		MAKE_VALUE(key, DT_INT, order[i % numKeys]);
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	// full scan comes back in key order
+	TEST_CHECK(openTreeScan(tree, &sc));
+	count = 0;
+	ordered = 1;
+	last.page = -1;
+	last.slot = 0;
+	while((rc = nextEntry(sc, &rid)) == RC_OK)
+	{
+		if (rid.page < last.page || (rid.page == last.page && rid.slot <= last.slot))
+			ordered = 0;
+		last = rid;
+		count++;
+	}
+	ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ends with no more entries");
+	ASSERT_EQUALS_INT(numKeys * 3, count, "full scan sees every entry");
+	ASSERT_TRUE(ordered, "full scan is ordered");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// range scan with inclusive bounds
+	MAKE_VALUE(low, DT_INT, 100);
+	MAKE_VALUE(high, DT_INT, 199);
+	TEST_CHECK(openTreeRangeScan(tree, low, high, &sc));
+	count = 0;
+	ordered = 1;
+	while((rc = nextEntry(sc, &rid)) == RC_OK)
+	{
+		if (rid.page < 100 || rid.page > 199)
+			ordered = 0;
+		count++;
+	}
+	ASSERT_EQUALS_INT(300, count, "range scan sees keys 100..199");
+	ASSERT_TRUE(ordered, "range scan stays within its bounds");
+	TEST_CHECK(closeTreeScan(sc));
+	freeVal(low);
+	freeVal(high);
+
+	// open-ended range after deleting one RID of a key
+	MAKE_VALUE(key, DT_INT, numKeys - 1);
+	rid.page = numKeys - 1;
+	rid.slot = 1;
+	TEST_CHECK(deleteEntry(tree, key, rid));
+	TEST_CHECK(openTreeRangeScan(tree, key, NULL, &sc));
+	count = 0;
+	while((rc = nextEntry(sc, &rid)) == RC_OK)
+		count++;
+	ASSERT_EQUALS_INT(2, count, "open-ended range after deleteEntry");
+	TEST_CHECK(closeTreeScan(sc));
+	freeVal(key);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree("testidx"));
+	free(order);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+	int numKeys = 500, i, ordered;
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc;
+	Value *key;
+	RID rid, last;
+	char buf[16];
+	char *tree_print;
+	testName = "test b-tree with string keys";
+
+	TEST_CHECK(initIndexManager(NULL));
+	TEST_CHECK(createBtree("testidx", DT_STRING, 6, 0));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	// keys k0499 ... k0000 inserted in descending order
+	for(i = numKeys - 1; i >= 0; i--)
+	{
+		sprintf(buf, "k%04d", i);
+		MAKE_STRING_VALUE(key, buf);
+		rid.page = i;
+		rid.slot = 0;
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	MAKE_STRING_VALUE(key, "k0250");
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(250, rid.page, "string key found");
+	freeVal(key);
+
+	TEST_CHECK(openTreeScan(tree, &sc));
+	ordered = 1;
+	last.page = -1;
+	for(i = 0; nextEntry(sc, &rid) == RC_OK; i++)
+	{
+		if (rid.page != last.page + 1)
+			ordered = 0;
+		last = rid;
+	}
+	ASSERT_EQUALS_INT(numKeys, i, "scan sees every string key");
+	ASSERT_TRUE(ordered, "string keys come back sorted");
+	TEST_CHECK(closeTreeScan(sc));
+
+	tree_print = printTree(tree);
+	ASSERT_TRUE(tree_print != NULL && strstr(tree_print, "k0000") != NULL, "printTree lists the keys");
+	free(tree_print);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree("testidx"));
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testNanKeys (void)
+{
+	int numKeys = 1000, i, count, inRange;
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc;
+	Value *key, *nan, *low, *high;
+	RID rid;
+	RC rc;
+	testName = "test b-tree NaN keys sort last and equal nothing";
+
+	TEST_CHECK(initIndexManager(NULL));
+	TEST_CHECK(createBtree("testidx", DT_FLOAT, sizeof(float), 0));
+	TEST_CHECK(openBtree(&tree, "testidx"));
+
+	// NaN before, among and after the numbers, which split the root
+	nan = stringToValue("fnan");
+	for(i = 0; i < numKeys; i++)
+	{
+		if (i % 400 == 0)
+		{
+			rid.page = -1;
+			rid.slot = i;
+			TEST_CHECK(insertKey(tree, nan, rid));
+		}
+		rid.page = i;
+		rid.slot = 0;
+		MAKE_VALUE(key, DT_FLOAT, (float) i);
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	MAKE_VALUE(key, DT_FLOAT, 0.0f);
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(0, rid.page, "0.0 finds its own entry");
+	freeVal(key);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, nan, &rid), "NaN equals no key");
+
+	// a full scan returns the NaN entries last
+	TEST_CHECK(openTreeScan(tree, &sc));
+	for(count = 0, inRange = 1; (rc = nextEntry(sc, &rid)) == RC_OK; count++)
+		inRange &= (rid.page == ((count < numKeys) ? count : -1));
+	ASSERT_EQUALS_INT(numKeys + 3, count, "full scan sees every entry");
+	ASSERT_TRUE(inRange, "numbers in order, then NaN");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// bounded scans stop before NaN, and a NaN bound admits nothing
+	MAKE_VALUE(low, DT_FLOAT, 990.0f);
+	TEST_CHECK(openTreeRangeScan(tree, low, NULL, &sc));
+	for(count = 0, inRange = 1; (rc = nextEntry(sc, &rid)) == RC_OK; count++)
+		inRange &= (rid.page >= 990);
+	ASSERT_EQUALS_INT(10, count, "open-ended range ends before NaN");
+	ASSERT_TRUE(inRange, "open-ended range holds only numbers");
+	TEST_CHECK(closeTreeScan(sc));
+	MAKE_VALUE(high, DT_FLOAT, 5.0f);
+	TEST_CHECK(openTreeRangeScan(tree, NULL, high, &sc));
+	for(count = 0; nextEntry(sc, &rid) == RC_OK; count++)
+		;
+	ASSERT_EQUALS_INT(6, count, "range up to 5.0");
+	TEST_CHECK(closeTreeScan(sc));
+	TEST_CHECK(openTreeRangeScan(tree, low, nan, &sc));
+	ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, nextEntry(sc, &rid), "NaN upper bound");
+	TEST_CHECK(closeTreeScan(sc));
+	TEST_CHECK(openTreeRangeScan(tree, nan, NULL, &sc));
+	ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, nextEntry(sc, &rid), "NaN lower bound");
+	TEST_CHECK(closeTreeScan(sc));
+	freeVal(low);
+	freeVal(high);
+
+	// an exact NaN entry can still be removed
+	rid.page = -1;
+	rid.slot = 400;
+	TEST_CHECK(deleteEntry(tree, nan, rid));
+	TEST_CHECK(getNumEntries(tree, &count));
+	ASSERT_EQUALS_INT(numKeys + 2, count, "NaN entry deleted");
+	freeVal(nan);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree("testidx"));
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testHashIndex (void)
+{
+	int numKeys = 5000, numDuplicates = 1000, i, result, found;
+	int *order = createPermutation(numKeys);
+	HashIndexHandle *index = NULL;
+	HI_ScanHandle *sc;
+	Value *key;
+	RID rid;
+	char buf[16];
+	testName = "test extendible hash index";
+
+	TEST_CHECK(createHashIndex("testidx", DT_INT, sizeof(int)));
+	TEST_CHECK(openHashIndex(&index, "testidx"));
+
+	for(i = 0; i < numKeys; i++)
+	{
+		rid.page = order[i] / 10;
+		rid.slot = order[i] % 10;
+		MAKE_VALUE(key, DT_INT, order[i]);
+		TEST_CHECK(insertHashKey(index, key, rid));
+		freeVal(key);
+	}
+
+	// more entries for one key than a bucket page holds
+	MAKE_VALUE(key, DT_INT, 42);
+	for(i = 1; i <= numDuplicates; i++)
+	{
+		rid.page = -1;
+		rid.slot = i;
+		TEST_CHECK(insertHashKey(index, key, rid));
+	}
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertHashKey(index, key, rid), "duplicate entry rejected");
+	freeVal(key);
+
+	TEST_CHECK(getNumHashEntries(index, &result));
+	ASSERT_EQUALS_INT(numKeys + numDuplicates, result, "number of entries in the hash index");
+	TEST_CHECK(getNumBuckets(index, &result));
+	ASSERT_TRUE(result > 10, "full buckets split");
+
+	// the directory and buckets survive closing and reopening
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(openHashIndex(&index, "testidx"));
+
+	found = 0;
+	for(i = 0; i < numKeys; i++)
+	{
+		if (i == 42)
+			continue;
+		MAKE_VALUE(key, DT_INT, i);
+		if (findHashKey(index, key, &rid) == RC_OK)
+			found += (rid.page == i / 10 && rid.slot == i % 10);
+		freeVal(key);
+	}
+	ASSERT_EQUALS_INT(numKeys - 1, found, "every key found with its RID");
+
+	MAKE_VALUE(key, DT_INT, 42);
+	TEST_CHECK(openHashScan(index, key, &sc));
+	for(i = 0; nextHashEntry(sc, &rid) == RC_OK; i++)
+		;
+	ASSERT_EQUALS_INT(numDuplicates + 1, i, "scan returns every RID of a key");
+	TEST_CHECK(closeHashScan(sc));
+	freeVal(key);
+
+	// delete the odd keys
+	for(i = 1; i < numKeys; i += 2)
+	{
+		rid.page = i / 10;
+		rid.slot = i % 10;
+		MAKE_VALUE(key, DT_INT, i);
+		TEST_CHECK(deleteHashEntry(index, key, rid));
+		ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteHashEntry(index, key, rid), "entry deleted once");
+		freeVal(key);
+	}
+
+	found = 0;
+	for(i = 0; i < numKeys; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		result = findHashKey(index, key, &rid);
+		freeVal(key);
+		found += (i % 2 == 0) ? (result == RC_OK) : (result == RC_IM_KEY_NOT_FOUND);
+	}
+	ASSERT_EQUALS_INT(numKeys, found, "only the even keys remain");
+
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(deleteHashIndex("testidx"));
+
+	// string keys
+	TEST_CHECK(createHashIndex("testidx", DT_STRING, 6));
+	TEST_CHECK(openHashIndex(&index, "testidx"));
+	for(i = 0; i < 1000; i++)
+	{
+		sprintf(buf, "k%04d", i);
+		MAKE_STRING_VALUE(key, buf);
+		rid.page = i;
+		rid.slot = 0;
+		TEST_CHECK(insertHashKey(index, key, rid));
+		freeVal(key);
+	}
+	MAKE_STRING_VALUE(key, "k0777");
+	TEST_CHECK(findHashKey(index, key, &rid));
+	ASSERT_EQUALS_INT(777, rid.page, "string key found");
+	freeVal(key);
+	MAKE_STRING_VALUE(key, "k2000");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findHashKey(index, key, &rid), "missing string key");
+	freeVal(key);
+
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(deleteHashIndex("testidx"));
+
+	// one-byte BOOL keys, with many RIDs each
+	TEST_CHECK(createHashIndex("testidx", DT_BOOL, 1));
+	TEST_CHECK(openHashIndex(&index, "testidx"));
+	for(i = 0; i < 600; i++)
+	{
+		MAKE_VALUE(key, DT_BOOL, i % 3 == 0);
+		rid.page = i;
+		rid.slot = 0;
+		TEST_CHECK(insertHashKey(index, key, rid));
+		freeVal(key);
+	}
+	MAKE_VALUE(key, DT_BOOL, 1);
+	TEST_CHECK(openHashScan(index, key, &sc));
+	for(i = 0, found = 0; nextHashEntry(sc, &rid) == RC_OK; i++)
+		found += (rid.page % 3 == 0);
+	ASSERT_EQUALS_INT(200, i, "every true entry");
+	ASSERT_EQUALS_INT(200, found, "only true entries");
+	TEST_CHECK(closeHashScan(sc));
+	freeVal(key);
+	MAKE_VALUE(key, DT_BOOL, 0);
+	rid.page = 1;
+	rid.slot = 0;
+	TEST_CHECK(deleteHashEntry(index, key, rid));
+	TEST_CHECK(getNumHashEntries(index, &result));
+	ASSERT_EQUALS_INT(599, result, "false entry deleted");
+	freeVal(key);
+
+	TEST_CHECK(closeHashIndex(index));
+	TEST_CHECK(deleteHashIndex("testidx"));
+	free(order);
+	TEST_DONE();
+}
+
+// ************************************************************
+int *
+createPermutation (int size)
+{
+	int *result = (int *) malloc(size * sizeof(int));
+	int i;
+
+	srand(42);
+	for(i = 0; i < size; i++)
+		result[i] = i;
+
+	for(i = size - 1; i > 0; i--)
+	{
+		int j = rand() % (i + 1);
+		int tmp = result[i];
+		result[i] = result[j];
+		result[j] = tmp;
+	}
+
+	return result;
+}
@@ -29,6 +29,12 @@
 static void testValueSerialize (void);
 static void testOperators (void);
 static void testExpressions (void);
+static void testCompiledExpressions (void);
+static void testExprOptimization (void);
+static void testRangeOperators (void);
+static void testBatchEvaluation (void);
+static void testPageEvaluation (void);
+static void testNanComparisons (void);
 
 char *testName;
 
@@ -41,6 +47,12 @@ main (void)
 	testValueSerialize();
 	testOperators();
 	testExpressions();
+	testCompiledExpressions();
+	testExprOptimization();
+	testRangeOperators();
+	testBatchEvaluation();
+	testPageEvaluation();
+	testNanComparisons();
 
 	return 0;
 }
@@ -123,3 +135,647 @@ testExpressions (void)
 
 	TEST_DONE();
 }
+
+// ************************************************************
+// evaluate expr both interpreted and compiled and check they agree
+#define ASSERT_COMPILED(expr, schema, record, expected, message)	\
+		do {							\
+			CompiledExpr *_prog;				\
+			Value *_res;					\
+			int _compiled;					\
+			TEST_CHECK(evalExpr(record, schema, expr, &_res));	\
+			TEST_CHECK(compileExpr(expr, schema, &_prog));	\
+			TEST_CHECK(evalCompiledExpr(_prog, (record)->data, &_compiled)); \
+			ASSERT_TRUE((_res->v.boolV != 0) == (expected), message); \
+			ASSERT_TRUE((_compiled != 0) == (expected), message); \
+			freeVal(_res);					\
+			freeCompiledExpr(_prog);			\
+		} while (0)
+
+void
+testCompiledExpressions (void)
+{
+	char *names[] = { "a", "b", "c" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+	int sizes[] = { 0, 6, 0 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 3);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *) malloc(sizeof(int) * 3);
+	Schema *schema;
+	Record *record;
+	Value *value;
+	Expr *op, *l, *r, *cmp1, *cmp2;
+	CompiledExpr *prog;
+	int i;
+	testName = "test compiled expressions against interpreted evaluation";
+
+	for(i = 0; i < 3; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	schema = createSchema(3, cpNames, cpDt, cpSizes, 0, NULL);
+
+	// record (a=7, b='abc', c=2.5)
+	TEST_CHECK(createRecord(&record, schema));
+	MAKE_VALUE(value, DT_INT, 7);
+	TEST_CHECK(setAttr(record, schema, 0, value));
+	freeVal(value);
+	MAKE_STRING_VALUE(value, "abc");
+	TEST_CHECK(setAttr(record, schema, 1, value));
+	freeVal(value);
+	MAKE_VALUE(value, DT_FLOAT, 2.5);
+	TEST_CHECK(setAttr(record, schema, 2, value));
+	freeVal(value);
+
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i7"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_EQUAL);
+	ASSERT_COMPILED(cmp1, schema, record, 1, "a = 7");
+
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabd"));
+	MAKE_BINOP_EXPR(cmp2, l, r, OP_COMP_SMALLER);
+	ASSERT_COMPILED(cmp2, schema, record, 1, "b < 'abd'");
+
+	MAKE_BINOP_EXPR(op, cmp1, cmp2, OP_BOOL_AND);
+	ASSERT_COMPILED(op, schema, record, 1, "a = 7 AND b < 'abd'");
+	freeExpr(op);
+
+	MAKE_CONS(l, stringToValue("f2.5"));
+	MAKE_ATTRREF(r, 2);
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(op, cmp1, OP_BOOL_NOT);
+	ASSERT_COMPILED(op, schema, record, 1, "NOT (2.5 < c)");
+	freeExpr(op);
+
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabc"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_EQUAL);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i3"));
+	MAKE_BINOP_EXPR(cmp2, l, r, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(op, cmp2, cmp1, OP_BOOL_OR);
+	ASSERT_COMPILED(op, schema, record, 1, "a < 3 OR b = 'abc'");
+	freeExpr(op);
+
+	// type errors are caught when compiling
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("sabc"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, compileExpr(op, schema, &prog), "int = string");
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testExprOptimization (void)
+{
+	char *names[] = { "a", "b" };
+	DataType dt[] = { DT_INT, DT_STRING };
+	int sizes[] = { 0, 6 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 2);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *cpSizes = (int *) malloc(sizeof(int) * 2);
+	Schema *schema;
+	Record *record;
+	Value *value, *res;
+	Expr *op, *opt, *l, *r, *cmp1, *cmp2, *cmp3;
+	CompiledExpr *prog;
+	int i, compiled;
+	testName = "test short-circuit evaluation, constant folding and predicate reordering";
+
+	for(i = 0; i < 2; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 2);
+	memcpy(cpSizes, sizes, sizeof(int) * 2);
+	schema = createSchema(2, cpNames, cpDt, cpSizes, 0, NULL);
+	TEST_CHECK(createRecord(&record, schema));
+	MAKE_STRING_VALUE(value, "abc");
+	TEST_CHECK(setAttr(record, schema, 1, value));
+	freeVal(value);
+
+	// comparisons of constants fold away
+	MAKE_CONS(l, stringToValue("i10"));
+	MAKE_CONS(r, stringToValue("i20"));
+	MAKE_BINOP_EXPR(cmp2, l, r, OP_COMP_SMALLER);
+	TEST_CHECK(optimizeExpr(cmp2, &opt));
+	ASSERT_TRUE(opt->type == EXPR_CONST && opt->expr.cons->v.boolV, "10 < 20 folds to true");
+	freeExpr(opt);
+
+	// (a = 7) AND (10 < 20) keeps only a = 7
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i7"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(cmp3, cmp1, cmp2, OP_BOOL_AND);
+	TEST_CHECK(optimizeExpr(cmp3, &opt));
+	ASSERT_TRUE(opt->type == EXPR_OP && opt->expr.op->type == OP_COMP_EQUAL, "AND with true keeps the other side");
+	freeExpr(opt);
+
+	// NOT (NOT ((a = 7) AND true)) becomes a = 7
+	MAKE_UNOP_EXPR(cmp1, cmp3, OP_BOOL_NOT);
+	MAKE_UNOP_EXPR(op, cmp1, OP_BOOL_NOT);
+	TEST_CHECK(optimizeExpr(op, &opt));
+	ASSERT_TRUE(opt->type == EXPR_OP && opt->expr.op->type == OP_COMP_EQUAL, "double negation is removed");
+	freeExpr(opt);
+	freeExpr(op);
+
+	// false AND x never looks at x, even if x would not type-check
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("sabc"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_EQUAL);
+	MAKE_CONS(l, stringToValue("bf"));
+	MAKE_BINOP_EXPR(op, l, cmp1, OP_BOOL_AND);
+	TEST_CHECK(evalExpr(record, schema, op, &res));
+	ASSERT_TRUE(res->dt == DT_BOOL && !res->v.boolV, "false AND (a = 'abc') short-circuits");
+	freeVal(res);
+	TEST_CHECK(optimizeExpr(op, &opt));
+	ASSERT_TRUE(opt->type == EXPR_CONST && !opt->expr.cons->v.boolV, "false AND x folds to false");
+	freeExpr(opt);
+	freeExpr(op);
+
+	// a < 900 AND b = 'abc' AND NOT (a = 3) AND a < 100: the compiled
+	// program reorders its conjuncts while running and must still agree
+	// with the interpreter on every row
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i900"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_SMALLER);
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabc"));
+	MAKE_BINOP_EXPR(cmp2, l, r, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(opt, cmp1, cmp2, OP_BOOL_AND);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i3"));
+	MAKE_BINOP_EXPR(cmp1, l, r, OP_COMP_EQUAL);
+	MAKE_UNOP_EXPR(cmp2, cmp1, OP_BOOL_NOT);
+	MAKE_BINOP_EXPR(op, opt, cmp2, OP_BOOL_AND);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i100"));
+	MAKE_BINOP_EXPR(cmp3, l, r, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(opt, op, cmp3, OP_BOOL_AND);
+	op = opt;
+	TEST_CHECK(compileExpr(op, schema, &prog));
+	for(i = 0; i < 2000; i++)
+	{
+		MAKE_VALUE(value, DT_INT, i % 1000);
+		TEST_CHECK(setAttr(record, schema, 0, value));
+		freeVal(value);
+		TEST_CHECK(evalExpr(record, schema, op, &res));
+		TEST_CHECK(evalCompiledExpr(prog, record->data, &compiled));
+		if ((res->v.boolV != 0) != (compiled != 0))
+			break;
+		freeVal(res);
+	}
+	ASSERT_EQUALS_INT(2000, i, "reordered conjuncts agree with evalExpr on every row");
+	freeCompiledExpr(prog);
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testRangeOperators (void)
+{
+	char *names[] = { "a", "b" };
+	DataType dt[] = { DT_INT, DT_STRING };
+	int sizes[] = { 0, 6 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 2);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *cpSizes = (int *) malloc(sizeof(int) * 2);
+	char *words[] = { "sa", "sab", "sabd", "sxyz", "sabc" };
+	Schema *schema;
+	Record *record;
+	Value *value;
+	Expr *op, *opt, *l, *r, *h;
+	Expr *list[20];
+	char buf[16];
+	int i;
+	testName = "test range, inequality and IN operators";
+
+	for(i = 0; i < 2; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 2);
+	memcpy(cpSizes, sizes, sizeof(int) * 2);
+	schema = createSchema(2, cpNames, cpDt, cpSizes, 0, NULL);
+
+	// record (a=15, b='abc')
+	TEST_CHECK(createRecord(&record, schema));
+	MAKE_VALUE(value, DT_INT, 15);
+	TEST_CHECK(setAttr(record, schema, 0, value));
+	freeVal(value);
+	MAKE_STRING_VALUE(value, "abc");
+	TEST_CHECK(setAttr(record, schema, 1, value));
+	freeVal(value);
+
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i15"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_GREATER_EQUAL);
+	ASSERT_COMPILED(op, schema, record, 1, "a >= 15");
+	op->expr.op->type = OP_COMP_GREATER;
+	ASSERT_COMPILED(op, schema, record, 0, "a > 15");
+	op->expr.op->type = OP_COMP_SMALLER_EQUAL;
+	ASSERT_COMPILED(op, schema, record, 1, "a <= 15");
+	op->expr.op->type = OP_COMP_NOT_EQUAL;
+	ASSERT_COMPILED(op, schema, record, 0, "a != 15");
+	freeExpr(op);
+
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sabd"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_GREATER);
+	ASSERT_COMPILED(op, schema, record, 0, "b > 'abd'");
+	op->expr.op->type = OP_COMP_NOT_EQUAL;
+	ASSERT_COMPILED(op, schema, record, 1, "b != 'abd'");
+	freeExpr(op);
+
+	// BETWEEN is inclusive on both ends
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i10"));
+	MAKE_CONS(h, stringToValue("i15"));
+	MAKE_BETWEEN_EXPR(op, l, r, h);
+	ASSERT_COMPILED(op, schema, record, 1, "a BETWEEN 10 AND 15");
+	op->expr.op->args[2]->expr.cons->v.intV = 14;
+	ASSERT_COMPILED(op, schema, record, 0, "a BETWEEN 10 AND 14");
+	freeExpr(op);
+
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sab"));
+	MAKE_CONS(h, stringToValue("sabd"));
+	MAKE_BETWEEN_EXPR(op, l, r, h);
+	ASSERT_COMPILED(op, schema, record, 1, "b BETWEEN 'ab' AND 'abd'");
+	freeExpr(op);
+
+	// short IN lists are probed linearly
+	for(i = 0; i < 5; i++)
+		MAKE_CONS(list[i], stringToValue(words[i]));
+	MAKE_ATTRREF(l, 1);
+	MAKE_IN_EXPR(op, l, list, 5);
+	ASSERT_COMPILED(op, schema, record, 1, "b IN ('a', 'ab', 'abd', 'xyz', 'abc')");
+	freeExpr(op);
+
+	for(i = 0; i < 4; i++)
+		MAKE_CONS(list[i], stringToValue(words[i]));
+	MAKE_ATTRREF(l, 1);
+	MAKE_IN_EXPR(op, l, list, 4);
+	ASSERT_COMPILED(op, schema, record, 0, "b IN ('a', 'ab', 'abd', 'xyz')");
+	freeExpr(op);
+
+	// long IN lists go through the hash set
+	for(i = 0; i < 20; i++)
+	{
+		sprintf(buf, "i%d", i * 3);
+		MAKE_CONS(list[i], stringToValue(buf));
+	}
+	MAKE_ATTRREF(l, 0);
+	MAKE_IN_EXPR(op, l, list, 20);
+	ASSERT_COMPILED(op, schema, record, 1, "a IN (0, 3, ..., 57)");
+	MAKE_VALUE(value, DT_INT, 16);
+	TEST_CHECK(setAttr(record, schema, 0, value));
+	freeVal(value);
+	ASSERT_COMPILED(op, schema, record, 0, "16 IN (0, 3, ..., 57) is false");
+	freeExpr(op);
+
+	// constant comparisons fold with the new operators too
+	MAKE_CONS(l, stringToValue("i3"));
+	MAKE_CONS(r, stringToValue("i1"));
+	MAKE_CONS(h, stringToValue("i5"));
+	MAKE_BETWEEN_EXPR(op, l, r, h);
+	TEST_CHECK(optimizeExpr(op, &opt));
+	ASSERT_TRUE(opt->type == EXPR_CONST && opt->expr.cons->v.boolV, "3 BETWEEN 1 AND 5 folds to true");
+	freeExpr(opt);
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testBatchEvaluation (void)
+{
+	char *names[] = { "a", "b", "c" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+	int sizes[] = { 0, 4, 0 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 3);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *) malloc(sizeof(int) * 3);
+	int numRows = 300;
+	int sel[150], out[150];
+	Schema *schema;
+	Record record;
+	Value *value;
+	Expr *op, *l, *r, *h, *between, *notSmaller, *both, *strEq;
+	CompiledExpr *prog;
+	char *rows;
+	int recordSize, i, pass, numOut, expected, result, agree;
+	testName = "test selection-vector batch evaluation";
+
+	for(i = 0; i < 3; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	schema = createSchema(3, cpNames, cpDt, cpSizes, 0, NULL);
+	recordSize = getRecordSize(schema);
+
+	// rows laid out back to back like RecordBatch->data
+	rows = (char *) calloc(numRows, recordSize);
+	for(i = 0; i < numRows; i++)
+	{
+		record.data = rows + i * recordSize;
+		MAKE_VALUE(value, DT_INT, i);
+		TEST_CHECK(setAttr(&record, schema, 0, value));
+		freeVal(value);
+		MAKE_STRING_VALUE(value, (i % 7 == 0) ? "xy" : "ab");
+		TEST_CHECK(setAttr(&record, schema, 1, value));
+		freeVal(value);
+		MAKE_VALUE(value, DT_FLOAT, (i % 20) * 1.0f);
+		TEST_CHECK(setAttr(&record, schema, 2, value));
+		freeVal(value);
+	}
+
+	// (a BETWEEN 50 AND 200 AND NOT (c < 10.0)) OR 'xy' = b
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i50"));
+	MAKE_CONS(h, stringToValue("i200"));
+	MAKE_BETWEEN_EXPR(between, l, r, h);
+	MAKE_ATTRREF(l, 2);
+	MAKE_CONS(r, stringToValue("f10.0"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(notSmaller, op, OP_BOOL_NOT);
+	MAKE_BINOP_EXPR(both, between, notSmaller, OP_BOOL_AND);
+	MAKE_CONS(l, stringToValue("sxy"));
+	MAKE_ATTRREF(r, 1);
+	MAKE_BINOP_EXPR(strEq, l, r, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(op, both, strEq, OP_BOOL_OR);
+	TEST_CHECK(compileExpr(op, schema, &prog));
+
+	// only the even rows are selected on input
+	for(i = 0; i < numRows / 2; i++)
+		sel[i] = 2 * i;
+
+	// run a few times so the children get reordered in between
+	agree = 1;
+	for(pass = 0; pass < 4; pass++)
+	{
+		TEST_CHECK(evalCompiledBatch(prog, rows, recordSize, sel, numRows / 2, out, &numOut));
+		expected = 0;
+		for(i = 0; i < numRows / 2; i++)
+		{
+			TEST_CHECK(evalCompiledExpr(prog, rows + sel[i] * recordSize, &result));
+			if (!result)
+				continue;
+			if (expected >= numOut || out[expected] != sel[i])
+				agree = 0;
+			expected++;
+		}
+		if (expected != numOut)
+			agree = 0;
+	}
+	ASSERT_TRUE(agree, "batch selection matches row-at-a-time evaluation");
+	ASSERT_TRUE(numOut > 0 && numOut < numRows / 2, "batch selection keeps some rows and drops others");
+
+	freeCompiledExpr(prog);
+	freeExpr(op);
+	free(rows);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// check a NaN comparison against the interpreter, the compiled evaluator
+// and the batch kernels
+#define ASSERT_NAN_COMPARE(expr, schema, record, expected, message)	\
+		do {							\
+			CompiledExpr *_prog;				\
+			int _sel = 0, _out, _numOut;			\
+			ASSERT_COMPILED(expr, schema, record, expected, message); \
+			TEST_CHECK(compileExpr(expr, schema, &_prog));	\
+			TEST_CHECK(evalCompiledBatch(_prog, (record)->data, getRecordSize(schema), \
+					&_sel, 1, &_out, &_numOut));	\
+			ASSERT_TRUE(_numOut == ((expected) ? 1 : 0), message); \
+			freeCompiledExpr(_prog);			\
+		} while (0)
+
+// ************************************************************
+void
+testNanComparisons (void)
+{
+	char *names[] = { "c", "d" };
+	DataType dt[] = { DT_FLOAT, DT_FLOAT };
+	int sizes[] = { 0, 0 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 2);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 2);
+	int *cpSizes = (int *) malloc(sizeof(int) * 2);
+	OpType ops[] = { OP_COMP_EQUAL, OP_COMP_SMALLER, OP_COMP_GREATER, OP_COMP_SMALLER_EQUAL,
+			OP_COMP_GREATER_EQUAL };
+	Schema *schema;
+	Record *record;
+	Value *value;
+	Expr *op, *l, *r, *h;
+	Expr *list[20];
+	char buf[16];
+	int i;
+	testName = "test comparisons with NaN are unordered";
+
+	for(i = 0; i < 2; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 2);
+	memcpy(cpSizes, sizes, sizeof(int) * 2);
+	schema = createSchema(2, cpNames, cpDt, cpSizes, 0, NULL);
+
+	// record (c=NaN, d=1.0)
+	TEST_CHECK(createRecord(&record, schema));
+	value = stringToValue("fnan");
+	TEST_CHECK(setAttr(record, schema, 0, value));
+	freeVal(value);
+	MAKE_VALUE(value, DT_FLOAT, 1.0f);
+	TEST_CHECK(setAttr(record, schema, 1, value));
+	freeVal(value);
+
+	// every ordering comparison is false, only <> holds
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("f1.0"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_NOT_EQUAL);
+	ASSERT_NAN_COMPARE(op, schema, record, 1, "NaN <> 1.0");
+	for(i = 0; i < 5; i++)
+	{
+		op->expr.op->type = ops[i];
+		ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN compared to 1.0 is false");
+	}
+	freeExpr(op);
+
+	// NaN is not even equal to itself
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("fnan"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_EQUAL);
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN = NaN is false");
+	op->expr.op->type = OP_COMP_SMALLER_EQUAL;
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN <= NaN is false");
+	op->expr.op->type = OP_COMP_NOT_EQUAL;
+	ASSERT_NAN_COMPARE(op, schema, record, 1, "NaN <> NaN");
+	freeExpr(op);
+
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("f-1000.0"));
+	MAKE_CONS(h, stringToValue("f1000.0"));
+	MAKE_BETWEEN_EXPR(op, l, r, h);
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN BETWEEN -1000.0 AND 1000.0 is false");
+	freeExpr(op);
+
+	// a NaN bound admits no value either
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("fnan"));
+	MAKE_CONS(h, stringToValue("f1000.0"));
+	MAKE_BETWEEN_EXPR(op, l, r, h);
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "1.0 BETWEEN NaN AND 1000.0 is false");
+	freeExpr(op);
+
+	// linear and hashed IN lists never match NaN
+	for(i = 0; i < 3; i++)
+	{
+		sprintf(buf, "f%d.0", i);
+		MAKE_CONS(list[i], stringToValue(i == 2 ? "fnan" : buf));
+	}
+	MAKE_ATTRREF(l, 0);
+	MAKE_IN_EXPR(op, l, list, 3);
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN IN (0.0, 1.0, NaN) is false");
+	freeExpr(op);
+
+	for(i = 0; i < 20; i++)
+	{
+		sprintf(buf, "f%d.0", i);
+		MAKE_CONS(list[i], stringToValue(i == 2 ? "fnan" : buf));
+	}
+	MAKE_ATTRREF(l, 0);
+	MAKE_IN_EXPR(op, l, list, 20);
+	ASSERT_NAN_COMPARE(op, schema, record, 0, "NaN IN (0.0, 1.0, NaN, ..., 19.0) is false");
+	freeExpr(op);
+
+	freeRecord(record);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testPageEvaluation (void)
+{
+	char *names[] = { "a", "b", "c" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+	int sizes[] = { 0, 4, 0 };
+	char **cpNames = (char **) malloc(sizeof(char*) * 3);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *) malloc(sizeof(int) * 3);
+	OpType ops[] = { OP_COMP_EQUAL, OP_COMP_SMALLER, OP_COMP_GREATER, OP_COMP_SMALLER_EQUAL,
+			OP_COMP_GREATER_EQUAL, OP_COMP_NOT_EQUAL, OP_BETWEEN };
+	int numRows = 101;
+	uint64_t occupied[2];
+	int out[101];
+	Schema *schema;
+	Record record;
+	Value *value;
+	Expr *op, *l, *r, *h, *second;
+	CompiledExpr *prog;
+	char *rows;
+	int recordSize, i, o, attr, conj, numOut, expected, result, agree;
+	testName = "test page evaluation of numeric filters against the occupancy bitmap";
+
+	for(i = 0; i < 3; i++)
+	{
+		cpNames[i] = (char *) malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	schema = createSchema(3, cpNames, cpDt, cpSizes, 0, NULL);
+	recordSize = getRecordSize(schema);
+
+	rows = (char *) calloc(numRows, recordSize);
+	memset(occupied, 0, sizeof(occupied));
+	for(i = 0; i < numRows; i++)
+	{
+		record.data = rows + i * recordSize;
+		MAKE_VALUE(value, DT_INT, (i * 37) % 50 - 25);
+		TEST_CHECK(setAttr(&record, schema, 0, value));
+		freeVal(value);
+		MAKE_STRING_VALUE(value, (i % 2) ? "ab" : "cd");
+		TEST_CHECK(setAttr(&record, schema, 1, value));
+		freeVal(value);
+		MAKE_VALUE(value, DT_FLOAT, (i % 13) - 6.5f);
+		TEST_CHECK(setAttr(&record, schema, 2, value));
+		freeVal(value);
+		if (i % 3 != 0 || i % 5 == 0)
+			occupied[i / 64] |= (uint64_t) 1 << (i % 64);
+	}
+
+	// every operator on the INT and FLOAT attribute, alone and as the
+	// first conjunct of an AND with a string comparison
+	agree = 1;
+	for(attr = 0; attr <= 2; attr += 2)
+		for(o = 0; o < 7; o++)
+			for(conj = 0; conj < 2; conj++)
+			{
+				MAKE_ATTRREF(l, attr);
+				MAKE_CONS(r, stringToValue(attr == 0 ? "i-3" : "f-0.5"));
+				if (ops[o] == OP_BETWEEN)
+				{
+					MAKE_CONS(h, stringToValue(attr == 0 ? "i12" : "f3.5"));
+					MAKE_BETWEEN_EXPR(op, l, r, h);
+				}
+				else
+					MAKE_BINOP_EXPR(op, l, r, ops[o]);
+				if (conj)
+				{
+					MAKE_ATTRREF(l, 1);
+					MAKE_CONS(r, stringToValue("sab"));
+					MAKE_BINOP_EXPR(h, l, r, OP_COMP_EQUAL);
+					MAKE_BINOP_EXPR(second, op, h, OP_BOOL_AND);
+					op = second;
+				}
+				TEST_CHECK(compileExpr(op, schema, &prog));
+				TEST_CHECK(evalCompiledPage(prog, rows, recordSize, numRows, occupied, out, &numOut));
+
+				expected = 0;
+				for(i = 0; i < numRows; i++)
+				{
+					if (!(occupied[i / 64] & ((uint64_t) 1 << (i % 64))))
+						continue;
+					TEST_CHECK(evalCompiledExpr(prog, rows + i * recordSize, &result));
+					if (!result)
+						continue;
+					if (expected >= numOut || out[expected] != i)
+						agree = 0;
+					expected++;
+				}
+				if (expected != numOut)
+					agree = 0;
+
+				freeCompiledExpr(prog);
+				freeExpr(op);
+			}
+	ASSERT_TRUE(agree, "page kernels match row-at-a-time evaluation on occupied slots");
+
+	free(rows);
+	freeSchema(schema);
+	TEST_DONE();
+}